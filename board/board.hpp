@@ -1 +1,9 @@
-#include "device.hpp"
\ No newline at end of file
+#pragma once
+
+#include "device.hpp"
+
+/// initialize every pin role in one batched pass over the GPIO pad registers, see GPIO::init_all()
+template <typename... Roles>
+inline void board_init(const Roles&... roles) noexcept {
+    GPIO::init_all<decltype(device::GPIO)>(roles...);
+}
@@ -622,8 +622,8 @@ namespace sfr {
             static constexpr bitfield_t<PADREG_t<PinOffset>, 0, 0, bool> PULL = {};
         };
 
-        template <GPIO::LowSideSwitch PinOffset>
-        struct PADREG_t<GPIO::LowSideSwitch> : reg_t<uint8_t, BASE_ADDRESS + 0x0 + PinOffset> {
+        template <unsigned PinOffset> requires GPIO::LowSideSwitch<PinOffset>
+        struct PADREG_t<PinOffset> : reg_t<uint8_t, BASE_ADDRESS + 0x0 + PinOffset> {
             using reg_t<uint8_t, BASE_ADDRESS + PinOffset>::operator=;
             static constexpr uint32_t reset_mask  = 0xFF;
             static constexpr uint32_t reset_value = 0x18;
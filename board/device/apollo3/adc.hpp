@@ -0,0 +1,149 @@
+#pragma once
+
+#include "ADC.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * Pieces shared by the ADC drivers: the slot and controller configuration, the FIFO word layout and direct
+ * register access for setup and software triggering.
+ */
+namespace ADC {
+
+    /// outcome of an ADC operation
+    enum class Status : uint8_t {
+        ok,
+        busy,           ///< a scan is still running
+        dma_error,      ///< DMA bus error
+        overflow,       ///< the FIFO filled up and conversions were lost
+        invalid,        ///< bad arguments, nothing was started
+    };
+
+    /// register layout of the ADC; the field positions do not depend on the instance
+    using registers = sfr::ADC_t<0x50010000>;
+
+    using Channel = sfr::ADC::CHSEL0v;
+    using Precision = sfr::ADC::PRMODE0v;
+    using Average = sfr::ADC::ADSEL0v;
+    using Reference = sfr::ADC::REFSELv;
+    using Trigger = sfr::ADC::TRIGSELv;
+    using Clock = sfr::ADC::CLKSELv;
+
+    constexpr std::size_t slots = 8;
+    constexpr std::size_t fifo_depth = 16;
+    constexpr uint32_t software_trigger = static_cast<uint32_t>(sfr::ADC::SWTv::GEN_SW_TRIGGER);
+    constexpr uint32_t default_spin_limit = 1000000;
+
+    /// INTEN/INTSTAT/INTCLR bits
+    namespace irq {
+        using INTSTAT_t = registers::INTSTAT_t;
+        constexpr uint32_t cnvcmp   = INTSTAT_t::CNVCMP.mask;
+        constexpr uint32_t scncmp   = INTSTAT_t::SCNCMP.mask;
+        constexpr uint32_t fifoovr1 = INTSTAT_t::FIFOOVR1.mask;     ///< FIFO 75 % full
+        constexpr uint32_t fifoovr2 = INTSTAT_t::FIFOOVR2.mask;     ///< FIFO full
+        constexpr uint32_t wcexc    = INTSTAT_t::WCEXC.mask;        ///< window excursion
+        constexpr uint32_t wcinc    = INTSTAT_t::WCINC.mask;        ///< window incursion
+        constexpr uint32_t dcmp     = INTSTAT_t::DCMP.mask;
+        constexpr uint32_t derr     = INTSTAT_t::DERR.mask;
+        constexpr uint32_t all      = INTSTAT_t::reset_mask;
+    }
+
+    /// one conversion slot: input, precision and hardware averaging of 2^average measurements
+    struct slot_config {
+        Channel   channel = Channel::SE0;
+        Precision precision = Precision::P14B;
+        Average   average = Average::AVG_1_MSRMT;
+        bool      window = false;               ///< take part in the window comparison
+
+        /// SLnCFG image with SLEN set; all slot registers share the SL0CFG layout
+        [[nodiscard]] constexpr uint32_t value() const noexcept {
+            using SL0CFG_t = registers::SL0CFG_t;
+            return (SL0CFG_t::ADSEL0.shift(average) | SL0CFG_t::PRMODE0.shift(precision) | SL0CFG_t::CHSEL0.shift(channel)
+                    | SL0CFG_t::WCEN0.shift(window) | SL0CFG_t::SLEN0.shift(true)).value;
+        }
+    };
+
+    /// controller setup. Repeating scans are paced by CTIMER A3, see scan_engine.
+    struct config {
+        Clock     clock = Clock::HFRC;
+        Reference reference = Reference::INT2P0;
+        Trigger   trigger = Trigger::SWT;
+        bool      falling_edge = false;         ///< TRIGPOL for external triggers
+        bool      low_power = false;            ///< LPMODE: power the ADC down between scans
+        bool      repeat = false;               ///< RPTEN
+
+        /// CFG image without ADCEN
+        [[nodiscard]] constexpr uint32_t value() const noexcept {
+            using CFG_t = registers::CFG_t;
+            return (CFG_t::CLKSEL.shift(clock) | CFG_t::TRIGPOL.shift(falling_edge) | CFG_t::TRIGSEL.shift(trigger) | CFG_t::REFSEL.shift(reference)
+                    | CFG_t::LPMODE.shift(low_power) | CFG_t::RPTEN.shift(repeat)).value;
+        }
+    };
+
+    /// fields of a FIFO word; DMA copies the words unchanged unless DMAMSK is set
+    namespace fifo {
+        using FIFO_t = registers::FIFO_t;
+        /// conversion result, 14.6 fixed point for 14 bit precision (integer part right aligned for lower precisions)
+        [[nodiscard]] constexpr uint32_t data(const uint32_t word) noexcept { return FIFO_t::DATA.extract(word); }
+        /// entries left in the FIFO, including this one
+        [[nodiscard]] constexpr uint32_t count(const uint32_t word) noexcept { return FIFO_t::COUNT.extract(word); }
+        [[nodiscard]] constexpr uint32_t slot(const uint32_t word) noexcept { return FIFO_t::SLOTNUM.extract(word); }
+    }
+
+    /// power the ADC up or down through PWRCTRL.DEVPWREN and wait for its domain to follow
+    template <typename PWRCTRL_T>
+    void power(const bool on) noexcept {
+        constexpr uint32_t bit = PWRCTRL_T::DEVPWREN_t::PWRADC.mask;
+        constexpr uint32_t domain = PWRCTRL_T::DEVPWRSTATUS_t::PWRADC.mask;
+        if (on) {
+            PWRCTRL_T::DEVPWREN |= bit;
+        } else {
+            PWRCTRL_T::DEVPWREN &= ~bit;
+        }
+        for (uint32_t spin = default_spin_limit; spin != 0 && static_cast<bool>(PWRCTRL_T::DEVPWRSTATUS.read() & domain) != on; --spin) { }
+    }
+
+    /**
+     * Register level access to the ADC. CFG and the slot registers may only change while the ADC is disabled,
+     * so configure() disables it and enable() has to follow. The SLnCFG registers are addressed by index since
+     * they are consecutive words.
+     */
+    template <typename ADC_T>
+    class controller {
+        static constexpr uint32_t adcen = ADC_T::CFG_t::ADCEN.mask;
+
+        static uint32_t slot_address(const std::size_t slot) noexcept { return ADC_T::SL0CFG.address + 4 * static_cast<uint32_t>(slot); }
+
+    public:
+        /// write CFG and the slots; slots beyond `slot_list` are disabled. Returns false for more than eight slots.
+        static bool configure(const config& cfg, const std::span<const slot_config> slot_list) noexcept {
+            if (slot_list.size() > slots) { return false; }
+            ADC_T::CFG.write(cfg.value());
+            for (std::size_t i = 0; i < slots; ++i) {
+                sfr::store<uint32_t>(slot_address(i), (i < slot_list.size()) ? slot_list[i].value() : 0u);
+            }
+            return true;
+        }
+
+        static void enable() noexcept { ADC_T::CFG |= adcen; }
+
+        static void disable() noexcept { ADC_T::CFG &= ~adcen; }
+
+        [[nodiscard]] static bool enabled() noexcept { return ADC_T::CFG.read() & adcen; }
+
+        /// start a scan of all enabled slots
+        static void trigger() noexcept { ADC_T::SWT.write(software_trigger); }
+
+        /// valid FIFO entries
+        [[nodiscard]] static uint32_t fifo_count() noexcept { return fifo::count(ADC_T::FIFO.read()); }
+
+        /// oldest FIFO word, removed from the FIFO. Only when the FIFO is not empty.
+        [[nodiscard]] static uint32_t pop() noexcept {
+            const uint32_t word = ADC_T::FIFO.read();
+            ADC_T::FIFO.write(0);                       // any write pops the entry
+            return word;
+        }
+    };  // class controller
+
+}   // namespace ADC
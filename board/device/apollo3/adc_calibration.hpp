@@ -0,0 +1,174 @@
+#pragma once
+
+#include "adc_decode.hpp"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace ADC {
+
+    /// y = (slope * x + offset) >> 16: fixed point conversion of a Q15 sample, one 32x32 multiply-accumulate
+    struct linear {
+        int32_t slope = 0;          ///< Q16 units per sample step
+        int64_t offset = 0;         ///< Q16 units, including the rounding half
+
+        [[nodiscard]] constexpr int32_t operator()(const sample x) const noexcept {
+            return static_cast<int32_t>((int64_t{slope} * x + offset) >> 16);
+        }
+    };
+
+    /// full scale of `reference` in microvolts
+    [[nodiscard]] constexpr int64_t reference_microvolts(const Reference reference) noexcept {
+        return (reference == Reference::INT1P5 || reference == Reference::EXT1P5) ? 1500000 : 2000000;
+    }
+
+    /**
+     * Temperature sensor calibration point. The sensor voltage is proportional to absolute temperature, so one
+     * point (sensor voltage at a known temperature) and the ADC offset define the line:
+     *
+     *     T = (V - offset) * T_cal / (V_cal - offset)
+     */
+    struct temperature_trim {
+        int32_t centikelvin = 29950;            ///< T_cal
+        int32_t microvolts = 1028090;           ///< V_cal
+        int32_t offset_microvolts = -4281;      ///< ADC offset
+
+        /// the three trim words of INFO1, kelvin and volts as IEEE floats
+        static constexpr uint32_t address = 0x50023010;
+
+        [[nodiscard]] constexpr bool valid() const noexcept {
+            return centikelvin > 20000 && centikelvin < 40000 && microvolts > 500000 && microvolts < 1500000
+                && offset_microvolts > -100000 && offset_microvolts < 100000;
+        }
+    };
+
+    /// Q15 sample to millivolts at the ADC input, removing the ADC offset
+    [[nodiscard]] constexpr linear millivolt_scale(const Reference reference, const int32_t offset_microvolts = 0, const int32_t divider = 1) noexcept {
+        // mV = divider * (sample * ref / 2^15 - offset) / 1000
+        const int64_t slope = divider * reference_microvolts(reference) * 2 / 1000;
+        return linear{static_cast<int32_t>(slope), -int64_t{divider} * offset_microvolts * 65536 / 1000 + 0x8000};
+    }
+
+    /// Q15 sample of the BATT channel (VDD divided by three) to millivolts of VDD
+    [[nodiscard]] constexpr linear battery_scale(const Reference reference, const int32_t offset_microvolts = 0) noexcept {
+        return millivolt_scale(reference, offset_microvolts, 3);
+    }
+
+    /// Q15 sample of the TEMP channel to hundredths of a degree Celsius
+    [[nodiscard]] constexpr linear temperature_scale(const Reference reference, const temperature_trim& trim = {}) noexcept {
+        // cK = (sample * ref / 2^15 - offset) * T_cal / (V_cal - offset), cC = cK - 27315
+        const int64_t span = int64_t{trim.microvolts} - trim.offset_microvolts;
+        const int64_t slope = reference_microvolts(reference) * trim.centikelvin * 2 / span;
+        const int64_t offset = -int64_t{trim.offset_microvolts} * trim.centikelvin * 65536 / span - int64_t{27315} * 65536;
+        return linear{static_cast<int32_t>(slope), offset + 0x8000};
+    }
+
+    /// nominal conversions indexed by Reference, for parts without trims or before calibration::init()
+    constexpr std::array<linear, 4> nominal_millivolts = {
+        millivolt_scale(Reference::INT2P0), millivolt_scale(Reference::INT1P5), millivolt_scale(Reference::EXT2P0), millivolt_scale(Reference::EXT1P5)};
+    constexpr std::array<linear, 4> nominal_battery = {
+        battery_scale(Reference::INT2P0), battery_scale(Reference::INT1P5), battery_scale(Reference::EXT2P0), battery_scale(Reference::EXT1P5)};
+    constexpr std::array<linear, 4> nominal_temperature = {
+        temperature_scale(Reference::INT2P0), temperature_scale(Reference::INT1P5), temperature_scale(Reference::EXT2P0), temperature_scale(Reference::EXT1P5)};
+
+    /**
+     * ADC reference trims as loaded from INFO space at boot. The hardware applies them by itself and the
+     * conversions do not depend on them; they are kept for diagnostics, and `compensation` tells whether the
+     * reference comparator is running.
+     */
+    struct reference_trim {
+        uint8_t buffer = 0;                     ///< ADCTRIM.ADCREFBUFTRIM
+        uint8_t buffer_bias = 0;                ///< ADCTRIM.ADCRFBUFIBTRIM
+        uint8_t keeper_bias = 0;                ///< ADCTRIM.ADCREFKEEPIBTRIM
+        uint8_t keeper = 0;                     ///< ADCREFCOMP.ADCREFKEEPTRIM
+        bool    compensation = false;           ///< ADCREFCOMP.ADCRFCMPEN
+    };
+
+    /**
+     * Calibration service: init() reads the trims once and builds the conversions for the reference in use,
+     * after which converting a sample is a single fixed point multiply-accumulate. The INFO1 temperature trim
+     * is stored as floats; it is converted once in init() and the nominal values are used when the words are
+     * erased or implausible.
+     */
+    template <typename MCUCTRL_T>
+    class calibration {
+        using ADCTRIM_t = typename MCUCTRL_T::ADCTRIM_t;
+        using ADCREFCOMP_t = typename MCUCTRL_T::ADCREFCOMP_t;
+
+        static constexpr uint32_t calibrated_bit = MCUCTRL_T::ADCCAL_t::ADCCALIBRATED.mask;
+        static constexpr uint32_t on_powerup_bit = MCUCTRL_T::ADCCAL_t::CALONPWRUP.mask;
+        static constexpr uint32_t comparator_out = ADCREFCOMP_t::ADC_REFCOMP_OUT.mask;
+
+        static inline Reference s_reference = Reference::INT2P0;
+        static inline temperature_trim s_trim{};
+        static inline reference_trim s_reference_trim{};
+        static inline bool s_trimmed = false;
+        static inline linear s_millivolts = nominal_millivolts[0];
+        static inline linear s_battery = nominal_battery[0];
+        static inline linear s_temperature = nominal_temperature[0];
+
+        static int32_t micro(const uint32_t word) noexcept {
+            const float value = std::bit_cast<float>(word) * 1e6f;
+            return (value > -2e9f && value < 2e9f) ? static_cast<int32_t>(value + (value < 0 ? -0.5f : 0.5f)) : 0;
+        }
+
+    public:
+        /// read the trims and build the conversions for samples taken with `reference`
+        static void init(const Reference reference, const uint32_t trim_address = temperature_trim::address) noexcept {
+            const uint32_t adctrim = MCUCTRL_T::ADCTRIM.read();
+            const uint32_t refcomp = MCUCTRL_T::ADCREFCOMP.read();
+            s_reference_trim = reference_trim{static_cast<uint8_t>(ADCTRIM_t::ADCREFBUFTRIM.extract(adctrim)),
+                                              static_cast<uint8_t>(ADCTRIM_t::ADCRFBUFIBTRIM.extract(adctrim)),
+                                              static_cast<uint8_t>(ADCTRIM_t::ADCREFKEEPIBTRIM.extract(adctrim)),
+                                              static_cast<uint8_t>(ADCREFCOMP_t::ADCREFKEEPTRIM.extract(refcomp)),
+                                              ADCREFCOMP_t::ADCRFCMPEN.extract(refcomp)};
+
+            const temperature_trim trim{(micro(sfr::load<uint32_t>(trim_address)) + 5000) / 10000, micro(sfr::load<uint32_t>(trim_address + 4)),
+                                        micro(sfr::load<uint32_t>(trim_address + 8))};
+            s_trimmed = trim.valid();
+            s_trim = s_trimmed ? trim : temperature_trim{};
+            s_reference = reference;
+            s_millivolts = millivolt_scale(reference, s_trim.offset_microvolts);
+            s_battery = battery_scale(reference, s_trim.offset_microvolts);
+            s_temperature = temperature_scale(reference, s_trim);
+        }
+
+        /// millivolts at the ADC input
+        [[nodiscard]] static int32_t millivolts(const sample x) noexcept { return s_millivolts(x); }
+
+        /// millivolts of VDD from a BATT channel sample
+        [[nodiscard]] static int32_t battery_millivolts(const sample x) noexcept { return s_battery(x); }
+
+        /// hundredths of a degree Celsius from a TEMP channel sample
+        [[nodiscard]] static int32_t centicelsius(const sample x) noexcept { return s_temperature(x); }
+
+        [[nodiscard]] static Reference reference() noexcept { return s_reference; }
+        [[nodiscard]] static const temperature_trim& temperature() noexcept { return s_trim; }
+        [[nodiscard]] static const reference_trim& trims() noexcept { return s_reference_trim; }
+
+        /// false when init() fell back to the nominal temperature trim
+        [[nodiscard]] static bool trimmed() noexcept { return s_trimmed; }
+
+        /// the ADC ran its offset calibration since power up
+        [[nodiscard]] static bool calibrated() noexcept { return MCUCTRL_T::ADCCAL.read() & calibrated_bit; }
+
+        /// run the offset calibration whenever the ADC is powered up
+        static void calibrate_on_powerup(const bool on) noexcept {
+            if (on) {
+                MCUCTRL_T::ADCCAL |= on_powerup_bit;
+            } else {
+                MCUCTRL_T::ADCCAL &= ~on_powerup_bit;
+            }
+        }
+
+        /// load the battery while it is measured, to read its voltage under load
+        static void battery_load(const bool on) noexcept { MCUCTRL_T::ADCBATTLOAD.write(MCUCTRL_T::ADCBATTLOAD_t::BATTLOAD.shift(on).value); }
+
+        /// output of the reference comparator; false when init() found compensation off
+        [[nodiscard]] static bool reference_comparator() noexcept {
+            return s_reference_trim.compensation && (MCUCTRL_T::ADCREFCOMP.read() & comparator_out);
+        }
+    };  // class calibration
+
+}   // namespace ADC
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "adc.hpp"
+#include "dsp.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace ADC {
+
+    /**
+     * Samples are Q15 of the reference voltage: 0 to 32767 for 0 V to full scale, whatever the precision of
+     * the slot. The FIFO DATA field is an N.6 fixed point value for N bit precision (the fraction comes from
+     * hardware averaging), so shifting it left by 14 - N and right by 5 aligns every precision mode.
+     */
+    using sample = int16_t;
+
+    [[nodiscard]] constexpr unsigned precision_shift(const Precision precision) noexcept { return 2u * static_cast<unsigned>(precision); }
+
+    /// Q15 value of one FIFO word taken with `precision`
+    [[nodiscard]] constexpr sample to_q15(const uint32_t word, const Precision precision) noexcept {
+        return static_cast<sample>(((fifo::data(word) << precision_shift(precision)) >> 5) & 0x7FFFu);
+    }
+
+    /// linear correction applied after scaling: gain in Q14 (0x4000 = 1), offset in Q15 steps
+    struct correction {
+        int16_t gain = 0x4000;
+        int16_t offset = 0;
+
+        [[nodiscard]] constexpr bool identity() const noexcept { return gain == 0x4000 && offset == 0; }
+    };
+
+    /**
+     * De-interleaves blocks of raw FIFO words (as delivered by scan_engine) into one contiguous Q15 array per
+     * slot, applying the slot's precision scaling and an optional correction.
+     *
+     * A block made of whole scans of slots 0 .. n-1 in order takes the fast path: each slot is walked with a
+     * stride of n, two samples at a time, extracted with UBFX, corrected with one SMUAD and saturated with
+     * SSAT, and stored as one word. The slot fields are checked on the way; a block that is not in scan order
+     * is decoded again word by word, the same as decode_any(). Simulation builds run the same code with the
+     * portable dsp:: equivalents.
+     */
+    class decoder {
+        using FIFO_t = registers::FIFO_t;
+        static constexpr unsigned data_lsb = FIFO_t::DATA.start, data_bits = FIFO_t::DATA.stop - FIFO_t::DATA.start + 1;
+        static constexpr unsigned slot_lsb = FIFO_t::SLOTNUM.start, slot_bits = FIFO_t::SLOTNUM.stop - FIFO_t::SLOTNUM.start + 1;
+
+        std::array<uint8_t, slots> m_shift{};
+        std::array<uint32_t, slots> m_coefficients{};   // gain | offset << 16, for SMUAD with sample | 0x4000 << 16
+        std::array<bool, slots> m_corrected{};
+        std::size_t m_slots = 0;
+
+        [[nodiscard]] sample convert(const uint32_t word, const std::size_t slot) const noexcept {
+            const int32_t value = static_cast<int32_t>((dsp::ubfx<data_lsb, data_bits>(word) << m_shift[slot]) >> 5);
+            if (!m_corrected[slot]) { return static_cast<sample>(value); }
+            return static_cast<sample>(dsp::ssat<16, 14>(dsp::smuad(dsp::pack(value, 0x4000), m_coefficients[slot])));
+        }
+
+        /// one slot of a block in scan order; returns non-zero if a word belongs to another slot
+        template <bool CORRECTED>
+        uint32_t column(const uint32_t* words, const std::size_t rows, const std::size_t slot, sample* out) const noexcept {
+            const std::size_t stride = m_slots;
+            const unsigned shift = m_shift[slot];
+            const uint32_t coefficients = m_coefficients[slot];
+            uint32_t mismatch = 0;
+            auto scale = [&](const uint32_t word) noexcept {
+                mismatch |= dsp::ubfx<slot_lsb, slot_bits>(word) ^ static_cast<uint32_t>(slot);
+                const int32_t value = static_cast<int32_t>((dsp::ubfx<data_lsb, data_bits>(word) << shift) >> 5);
+                if constexpr (CORRECTED) {
+                    return dsp::ssat<16, 14>(dsp::smuad(dsp::pack(value, 0x4000), coefficients));
+                } else {
+                    return value;
+                }
+            };
+
+            std::size_t row = 0;
+            if ((reinterpret_cast<uintptr_t>(out) & 3u) != 0 && rows != 0) {
+                out[0] = static_cast<sample>(scale(words[0]));
+                row = 1;
+            }
+            for (; row + 1 < rows; row += 2) {
+                const uint32_t pair = dsp::pack(scale(words[row * stride]), scale(words[(row + 1) * stride]));
+                std::memcpy(out + row, &pair, sizeof(pair));
+            }
+            if (row < rows) { out[row] = static_cast<sample>(scale(words[row * stride])); }
+            return mismatch;
+        }
+
+    public:
+        /// slots 0 .. slot_list.size()-1 as configured by controller::configure()
+        explicit decoder(const std::span<const slot_config> slot_list) noexcept : m_slots(slot_list.size() < slots ? slot_list.size() : slots) {
+            for (std::size_t i = 0; i < m_slots; ++i) { m_shift[i] = static_cast<uint8_t>(precision_shift(slot_list[i].precision)); }
+            for (std::size_t i = 0; i < slots; ++i) { set_correction(i, correction{}); }
+        }
+
+        void set_correction(const std::size_t slot, const correction& c) noexcept {
+            if (slot >= slots) { return; }
+            m_coefficients[slot] = dsp::pack(c.gain, c.offset);
+            m_corrected[slot] = !c.identity();
+        }
+
+        [[nodiscard]] std::size_t slot_count() const noexcept { return m_slots; }
+
+        /// Q15 value of a single FIFO word
+        [[nodiscard]] sample operator()(const uint32_t word) const noexcept { return convert(word, fifo::slot(word)); }
+
+        /**
+         * split `words` into out[slot]. Returns the samples written per slot; samples of slots without room
+         * left in their output are dropped.
+         */
+        std::array<std::size_t, slots> decode(const std::span<const uint32_t> words, const std::array<std::span<sample>, slots>& out) const noexcept {
+            if (m_slots != 0 && words.size() % m_slots == 0) {
+                const std::size_t rows = words.size() / m_slots;
+                bool fits = true;
+                for (std::size_t s = 0; s < m_slots; ++s) { fits = fits && out[s].size() >= rows; }
+                if (fits) {
+                    uint32_t mismatch = 0;
+                    for (std::size_t s = 0; s < m_slots && mismatch == 0; ++s) {
+                        mismatch |= m_corrected[s] ? column<true>(words.data() + s, rows, s, out[s].data())
+                                                   : column<false>(words.data() + s, rows, s, out[s].data());
+                    }
+                    if (mismatch == 0) {
+                        std::array<std::size_t, slots> counts{};
+                        for (std::size_t s = 0; s < m_slots; ++s) { counts[s] = rows; }
+                        return counts;
+                    }
+                }
+            }
+            return decode_any(words, out);
+        }
+
+        /// split `words` in any slot order, one word at a time
+        std::array<std::size_t, slots> decode_any(const std::span<const uint32_t> words, const std::array<std::span<sample>, slots>& out) const noexcept {
+            std::array<std::size_t, slots> counts{};
+            for (const uint32_t word : words) {
+                const std::size_t slot = fifo::slot(word);
+                if (counts[slot] < out[slot].size()) { out[slot][counts[slot]++] = convert(word, slot); }
+            }
+            return counts;
+        }
+    };  // class decoder
+
+}   // namespace ADC
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "adc_decode.hpp"
+#include "dsp.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+/**
+ * Decimation filters for Q15 sample streams, run per DMA block rather than per sample. A CIC decimator takes
+ * the bulk of the rate reduction with adds only; a FIR after it shapes the passband (and can compensate the
+ * CIC droop) at the lower rate. Averaging R samples gains up to log2(R)/2 bits, so the 16 bit output carries
+ * more resolution than a single 14 bit conversion. All filters may process in place (`out` the same as `in`).
+ */
+namespace ADC {
+
+    /**
+     * CIC decimator of ORDER stages, decimating by 2^LOG2_RATIO with a gain of one. The integrators wrap
+     * modulo 2^32, which is exact as long as the output fits, hence the limit on ORDER * LOG2_RATIO.
+     */
+    template <unsigned ORDER, unsigned LOG2_RATIO>
+    class cic {
+        static_assert(ORDER >= 1 && LOG2_RATIO >= 1, "a CIC needs at least one stage and decimation by two");
+        static_assert(16 + ORDER * LOG2_RATIO <= 32, "the CIC gain has to fit 32 bit registers");
+
+        static constexpr uint32_t ratio = 1u << LOG2_RATIO;
+        static constexpr unsigned shift = ORDER * LOG2_RATIO;
+
+        std::array<uint32_t, ORDER> m_integrator{};
+        std::array<uint32_t, ORDER> m_comb{};
+        uint32_t m_phase = 0;
+
+    public:
+        static constexpr std::size_t decimation = ratio;
+
+        void reset() noexcept { *this = cic{}; }
+
+        /// filter `in`, returns the outputs written to `out`; outputs beyond its size are dropped
+        std::size_t process(const std::span<const sample> in, const std::span<sample> out) noexcept {
+            std::size_t produced = 0;
+            for (const sample x : in) {
+                uint32_t value = static_cast<uint32_t>(static_cast<int32_t>(x));
+                for (uint32_t& integrator : m_integrator) {
+                    integrator += value;
+                    value = integrator;
+                }
+                if (++m_phase != ratio) { continue; }
+                m_phase = 0;
+                for (uint32_t& comb : m_comb) {
+                    const uint32_t difference = value - comb;
+                    comb = value;
+                    value = difference;
+                }
+                if (produced < out.size()) {
+                    const int32_t rounded = (static_cast<int32_t>(value) + (int32_t{1} << (shift - 1))) >> shift;
+                    out[produced++] = static_cast<sample>(dsp::ssat<16>(rounded));
+                }
+            }
+            return produced;
+        }
+    };  // class cic
+
+    /**
+     * FIR of up to TAPS Q15 coefficients, keeping every DECIMATION-th output. The history is stored twice so
+     * that the newest TAPS samples are always contiguous, and the inner loop multiplies two samples by two
+     * coefficients per SMLALD into a 64 bit accumulator, so no coefficient set can overflow it. Without
+     * coefficients the filter passes samples through (decimated).
+     */
+    template <std::size_t TAPS, std::size_t DECIMATION = 1>
+    class fir {
+        static_assert(TAPS != 0 && DECIMATION != 0, "empty filter");
+
+        static constexpr std::size_t length = (TAPS + 1) & ~std::size_t{1};    // whole pairs
+
+        alignas(4) std::array<int16_t, length> m_reversed{};                   // m_reversed[length - 1 - k] = h[k]
+        std::array<int16_t, 2 * length> m_history{};
+        std::size_t m_position = 0;
+        std::size_t m_phase = 0;
+        bool m_bypass = true;
+
+        [[nodiscard]] sample convolve() const noexcept {
+            const int16_t* const window = m_history.data() + m_position;       // oldest first
+            int64_t accumulator = 0;
+            for (std::size_t i = 0; i < length; i += 2) {
+                uint32_t samples;
+                uint32_t taps;
+                std::memcpy(&samples, window + i, sizeof(samples));
+                std::memcpy(&taps, m_reversed.data() + i, sizeof(taps));
+                accumulator = dsp::smlald(samples, taps, accumulator);
+            }
+            const int64_t rounded = (accumulator + 0x4000) >> 15;
+            return static_cast<sample>(rounded < -32768 ? -32768 : (rounded > 32767 ? 32767 : rounded));
+        }
+
+    public:
+        static constexpr std::size_t decimation = DECIMATION;
+
+        fir() noexcept = default;
+
+        explicit fir(const std::span<const int16_t> taps) noexcept { set_taps(taps); }
+
+        /// replace the coefficients, h[0] applying to the newest sample; more than TAPS are ignored
+        void set_taps(const std::span<const int16_t> taps) noexcept {
+            m_reversed.fill(0);
+            const std::size_t count = taps.size() < TAPS ? taps.size() : TAPS;
+            for (std::size_t k = 0; k < count; ++k) { m_reversed[length - 1 - k] = taps[k]; }
+            m_bypass = count == 0;
+        }
+
+        void reset() noexcept {
+            m_history.fill(0);
+            m_position = 0;
+            m_phase = 0;
+        }
+
+        /// filter `in`, returns the outputs written to `out`; outputs beyond its size are dropped
+        std::size_t process(const std::span<const sample> in, const std::span<sample> out) noexcept {
+            std::size_t produced = 0;
+            for (const sample x : in) {
+                m_history[m_position] = x;
+                m_history[m_position + length] = x;
+                m_position = (m_position + 1 == length) ? 0 : m_position + 1;
+                if (++m_phase != DECIMATION) { continue; }
+                m_phase = 0;
+                if (produced < out.size()) { out[produced++] = m_bypass ? x : convolve(); }
+            }
+            return produced;
+        }
+    };  // class fir
+
+    /// FIRST followed by SECOND, e.g. a cic and a fir
+    template <typename FIRST, typename SECOND>
+    class cascade {
+    public:
+        FIRST first;
+        SECOND second;
+
+        static constexpr std::size_t decimation = FIRST::decimation * SECOND::decimation;
+
+        void reset() noexcept {
+            first.reset();
+            second.reset();
+        }
+
+        std::size_t process(const std::span<const sample> in, const std::span<sample> out) noexcept {
+            const std::size_t middle = first.process(in, out);
+            return second.process(out.first(middle), out);
+        }
+    };  // class cascade
+
+    /// filtered samples of one slot, called from the ADC interrupt handler
+    using output_handler = void (*)(void* context, std::size_t slot, std::span<const sample> samples);
+
+    /**
+     * Filter stage for scan_engine: decodes each block of BLOCK raw FIFO words into Q15 per slot, runs every
+     * slot through its own FILTER and hands the decimated output to the handler. Pass block() as the
+     * scan_engine handler with the stage as context; all work happens in place in one scratch buffer.
+     */
+    template <std::size_t BLOCK, typename FILTER>
+    class filter_stage {
+        ADC::decoder m_decoder;
+        std::array<FILTER, slots> m_filters{};
+        output_handler m_output;
+        void* m_context;
+        alignas(4) std::array<sample, BLOCK + slots> m_scratch{};
+
+    public:
+        filter_stage(const std::span<const slot_config> slot_list, const output_handler output, void* const context = nullptr) noexcept
+            : m_decoder(slot_list), m_output(output), m_context(context) { }
+
+        /// the decoder, to set per slot corrections
+        [[nodiscard]] ADC::decoder& decoder() noexcept { return m_decoder; }
+
+        /// the filter of `slot`, to set coefficients
+        [[nodiscard]] FILTER& filter(const std::size_t slot) noexcept { return m_filters[slot < slots ? slot : 0]; }
+
+        void reset() noexcept {
+            for (FILTER& f : m_filters) { f.reset(); }
+        }
+
+        void process(const std::span<const uint32_t> words) noexcept {
+            const std::size_t count = m_decoder.slot_count();
+            if (count == 0 || m_output == nullptr) { return; }
+            std::size_t rows = (words.size() + count - 1) / count;
+            if (rows * count > m_scratch.size()) { rows = m_scratch.size() / count; }
+
+            std::array<std::span<sample>, slots> parts{};
+            for (std::size_t s = 0; s < count; ++s) { parts[s] = std::span<sample>(m_scratch.data() + s * rows, rows); }
+            const std::array<std::size_t, slots> decoded = m_decoder.decode(words, parts);
+            for (std::size_t s = 0; s < count; ++s) {
+                const std::size_t produced = m_filters[s].process(parts[s].first(decoded[s]), parts[s]);
+                if (produced != 0) { m_output(m_context, s, parts[s].first(produced)); }
+            }
+        }
+
+        /// scan_engine block handler, `stage` being the filter_stage
+        static void block(void* const stage, const std::span<const uint32_t> words) noexcept {
+            static_cast<filter_stage*>(stage)->process(words);
+        }
+    };  // class filter_stage
+
+}   // namespace ADC
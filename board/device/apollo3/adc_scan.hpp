@@ -0,0 +1,148 @@
+#pragma once
+
+#include "adc.hpp"
+#include "ctimer.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace ADC {
+
+    /// a full block of raw FIFO words, called from the ADC interrupt handler while DMA fills the other buffer
+    using block_handler = void (*)(void* context, std::span<const uint32_t> words);
+
+    /// what starts a scan of all enabled slots
+    struct pacing {
+        sfr::CTIMER::TMRA0CLKv clock = sfr::CTIMER::TMRA0CLKv::HFRC_DIV16;
+        uint32_t period = 0;                    ///< CTIMER A3 ticks per scan, 1-65536; 0 for software triggers only
+    };
+
+    /**
+     * Scan engine: up to eight slots converted per scan, the FIFO emptied by DMA into two buffers of BLOCK
+     * words in turn. When one is full, isr() points the DMA at the other and hands the full one to the block
+     * handler, so the core only wakes once per BLOCK samples; the 16 entry FIFO absorbs the interrupt latency.
+     * Words keep their slot number (DMAMSK is clear), see ADC::fifo, and BLOCK should be a multiple of the
+     * number of slots so that every block starts with slot 0.
+     *
+     * Scans are started by trigger() or, with a non-zero pacing period, by CTIMER A3 in repeating scan mode.
+     * The handler must be done with a block within BLOCK sample periods. Call isr() from the ADC interrupt
+     * handler. The ADC must be powered, see ADC::power(), and the pads of external channels set to analog.
+     */
+    template <typename ADC_T, typename CTIMER_T, std::size_t BLOCK>
+    class scan_engine {
+        static_assert(BLOCK != 0 && BLOCK <= 0xFFFF, "DMATOTCOUNT is limited to 65535 words");
+
+        using ctrl = controller<ADC_T>;
+        using timer = CTIMER::periodic<CTIMER_T, 3, CTIMER::Segment::A>;
+
+        using DMACFG_t = typename ADC_T::DMACFG_t;
+
+        static constexpr uint32_t done_mask = irq::dcmp | irq::derr | irq::fifoovr2;
+        static constexpr uint32_t ctimer_adc_enable = CTIMER_T::CTRL3_t::ADCEN.mask;
+        static constexpr uint32_t dmacfg = (DMACFG_t::DMADYNPRI.shift(true) | DMACFG_t::DMAEN.shift(true)).value;     // peripheral to memory
+
+        alignas(4) static inline uint32_t s_buffer[2][BLOCK] = {};
+        static inline std::atomic<uint8_t> s_active{0};             // buffer the DMA fills
+        static inline block_handler s_handler = nullptr;
+        static inline void* s_context = nullptr;
+        static inline bool s_paced = false;
+        static inline std::atomic<bool> s_running{false};
+        static inline std::atomic<uint32_t> s_blocks{0};
+        static inline std::atomic<uint32_t> s_overflows{0};
+        static inline std::atomic<Status> s_status{Status::ok};
+
+        static void arm(const uint8_t buffer) noexcept {
+            ADC_T::DMACFG.write(0);
+            ADC_T::DMASTAT.write(0);
+            ADC_T::DMATARGADDR.write(sfr::bus_address(s_buffer[buffer], sizeof(s_buffer[buffer])));
+            ADC_T::DMATOTCOUNT.write(ADC_T::DMATOTCOUNT_t::TOTCOUNT.shift(static_cast<uint32_t>(BLOCK)).value);     // bytes, in words
+            ADC_T::DMACFG.write(dmacfg);
+        }
+
+    public:
+        /**
+         * configure the ADC for `slot_list` and start converting. With `pace.period` 0 nothing happens until
+         * trigger(); paced scans always use the software trigger for the first scan.
+         */
+        static Status start(config cfg, const std::span<const slot_config> slot_list, const pacing& pace,
+                            const block_handler handler, void* const context = nullptr) noexcept {
+            if (running()) { return Status::busy; }
+            if (slot_list.empty() || handler == nullptr || pace.period > 65536) { return Status::invalid; }
+            s_paced = pace.period != 0;
+            cfg.repeat = s_paced;
+            if (s_paced) { cfg.trigger = Trigger::SWT; }
+            if (!ctrl::configure(cfg, slot_list)) { return Status::invalid; }
+
+            s_handler = handler;
+            s_context = context;
+            s_active.store(0, std::memory_order_relaxed);
+            s_status.store(Status::ok, std::memory_order_relaxed);
+            s_blocks.store(0, std::memory_order_relaxed);
+            s_overflows.store(0, std::memory_order_relaxed);
+            ADC_T::DMATRIGEN.write(ADC_T::DMATRIGEN_t::DFIFO75.mask);
+            arm(0);
+            ADC_T::INTCLR.write(irq::all);
+            ADC_T::INTEN |= done_mask;
+            s_running.store(true, std::memory_order_release);
+            ctrl::enable();
+
+            if (s_paced) {
+                timer::start(pace.clock, pace.period, false);
+                timer::ctrl_t::write(timer::ctrl_t::read() | ctimer_adc_enable);
+                ctrl::trigger();                                    // the first scan arms repeating mode
+            }
+            return Status::ok;
+        }
+
+        /// stop converting and discard the partly filled block
+        static void stop() noexcept {
+            if (s_paced) {
+                timer::ctrl_t::write(timer::ctrl_t::read() & ~ctimer_adc_enable);
+                timer::stop();
+            }
+            ctrl::disable();
+            ADC_T::INTEN &= ~done_mask;
+            ADC_T::DMACFG.write(0);
+            ADC_T::DMATRIGEN.write(0);
+            s_running.store(false, std::memory_order_release);
+        }
+
+        /// start one scan of all enabled slots
+        static void trigger() noexcept { ctrl::trigger(); }
+
+        [[nodiscard]] static bool running() noexcept { return s_running.load(std::memory_order_acquire); }
+
+        /// Status::dma_error once a DMA error stopped the engine, Status::overflow after samples were lost
+        [[nodiscard]] static Status status() noexcept { return s_status.load(std::memory_order_acquire); }
+
+        /// blocks handed to the handler, and FIFO overflows since start()
+        [[nodiscard]] static uint32_t blocks() noexcept { return s_blocks.load(std::memory_order_relaxed); }
+        [[nodiscard]] static uint32_t overflows() noexcept { return s_overflows.load(std::memory_order_relaxed); }
+
+        /// swap buffers on DCMP and deliver the full one. Call from the ADC interrupt handler.
+        static void isr() noexcept {
+            const uint32_t pending = ADC_T::INTSTAT.read() & ADC_T::INTEN.read() & done_mask;
+            ADC_T::INTCLR.write(pending);
+            if (!running()) { return; }
+            if (pending & irq::derr) {
+                stop();
+                s_status.store(Status::dma_error, std::memory_order_release);
+                return;
+            }
+            if (pending & irq::fifoovr2) {
+                s_overflows.fetch_add(1, std::memory_order_relaxed);
+                s_status.store(Status::overflow, std::memory_order_release);
+            }
+            if (pending & irq::dcmp) {
+                const uint8_t full = s_active.load(std::memory_order_relaxed);
+                const uint8_t next = static_cast<uint8_t>(full ^ 1u);
+                s_active.store(next, std::memory_order_relaxed);
+                arm(next);
+                s_blocks.fetch_add(1, std::memory_order_relaxed);
+                s_handler(s_context, std::span<const uint32_t>(s_buffer[full], BLOCK));
+            }
+        }
+    };  // class scan_engine
+
+}   // namespace ADC
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "adc_scan.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace ADC {
+
+    /// window comparator events, irq::wcexc and/or irq::wcinc, called from the ADC interrupt handler
+    using window_handler = void (*)(void* context, uint32_t events);
+
+    /**
+     * Window comparator limits, inclusive, in FIFO data format. With `scaled` set (SCWLIMEN) the limits are
+     * 14.6 fixed point and the ADC scales them to the precision of each slot, so one pair serves slots of any
+     * precision; otherwise they are compared with the FIFO data as is.
+     */
+    struct window {
+        uint32_t lower = 0;
+        uint32_t upper = registers::WULIM_t::ULIM.mask;
+        bool     scaled = true;
+
+        /// limits from Q15 samples as produced by ADC::decoder
+        [[nodiscard]] static constexpr window from_q15(const uint16_t lower, const uint16_t upper) noexcept {
+            return window{static_cast<uint32_t>(lower) << 5, static_cast<uint32_t>(upper) << 5, true};
+        }
+
+        [[nodiscard]] constexpr bool valid() const noexcept { return lower <= upper && upper <= registers::WULIM_t::ULIM.mask; }
+    };
+
+    /**
+     * Low power monitoring: CTIMER A3 paces repeating scans with the ADC powered down between them (LPMODE),
+     * and the slots with slot_config::window set are checked against one window in hardware. The core is only
+     * woken to run the handler when a sample leaves the window (irq::wcexc) or comes back into it
+     * (irq::wcinc), as selected by `events`.
+     *
+     * The comparator sees samples as they are written to the FIFO, so the FIFO must never fill up. It is
+     * emptied by the DMA of a scan_engine into two HISTORY word buffers; filling one costs a short interrupt
+     * that re-arms the DMA and nothing else, every HISTORY conversions. last_block() holds the samples before
+     * the most recent swap for a handler that wants to look at the values. scan_engine and window_monitor use
+     * the same ADC, DMA and timer, so only one of them can run at a time. Call isr() from the ADC interrupt
+     * handler instead of scan_engine::isr().
+     */
+    template <typename ADC_T, typename CTIMER_T, std::size_t HISTORY = 256>
+    class window_monitor {
+        using engine = scan_engine<ADC_T, CTIMER_T, HISTORY>;
+
+        static constexpr uint32_t window_mask = irq::wcexc | irq::wcinc;
+
+        static inline window_handler s_handler = nullptr;
+        static inline void* s_context = nullptr;
+        static inline uint32_t s_events = 0;
+        static inline std::span<const uint32_t> s_last{};
+        static inline std::atomic<bool> s_outside{false};
+        static inline std::atomic<uint32_t> s_wakes{0};
+
+        static void keep(void*, const std::span<const uint32_t> words) noexcept { s_last = words; }
+
+    public:
+        /**
+         * start monitoring `slot_list` against `limits`. `pace.period` must be non-zero; `events` selects
+         * which of irq::wcexc and irq::wcinc wake the core. Returns Status::invalid without a window slot.
+         */
+        static Status start(config cfg, const std::span<const slot_config> slot_list, const window& limits, const pacing& pace,
+                            const window_handler handler, void* const context = nullptr, const uint32_t events = irq::wcexc) noexcept {
+            if (engine::running()) { return Status::busy; }
+            bool compared = false;
+            for (const slot_config& slot : slot_list) { compared = compared || slot.window; }
+            if (!compared || !limits.valid() || pace.period == 0 || handler == nullptr || (events & window_mask) == 0) { return Status::invalid; }
+
+            s_handler = handler;
+            s_context = context;
+            s_events = events & window_mask;
+            s_last = {};
+            s_outside.store(false, std::memory_order_relaxed);
+            s_wakes.store(0, std::memory_order_relaxed);
+            set_window(limits);
+            ADC_T::INTCLR.write(window_mask);
+
+            cfg.low_power = true;
+            const Status status = engine::start(cfg, slot_list, pace, keep);
+            if (status == Status::ok) { ADC_T::INTEN |= s_events; }
+            return status;
+        }
+
+        static void stop() noexcept {
+            ADC_T::INTEN &= ~window_mask;
+            engine::stop();
+        }
+
+        /// move the window while monitoring, e.g. to add hysteresis from the handler
+        static void set_window(const window& limits) noexcept {
+            ADC_T::WLLIM.write(ADC_T::WLLIM_t::LLIM.shift(limits.lower).value);
+            ADC_T::WULIM.write(ADC_T::WULIM_t::ULIM.shift(limits.upper).value);
+            ADC_T::SCWLIM.write(ADC_T::SCWLIM_t::SCWLIMEN.shift(limits.scaled).value);
+        }
+
+        [[nodiscard]] static bool running() noexcept { return engine::running(); }
+
+        /// Status::dma_error or Status::overflow as for scan_engine; an overflow means samples went unchecked
+        [[nodiscard]] static Status status() noexcept { return engine::status(); }
+
+        /// true after an excursion until the next incursion; incursions are only seen with irq::wcinc in `events`
+        [[nodiscard]] static bool outside() noexcept { return s_outside.load(std::memory_order_acquire); }
+
+        /// window events that ran the handler since start()
+        [[nodiscard]] static uint32_t wakes() noexcept { return s_wakes.load(std::memory_order_relaxed); }
+
+        /// the last full block of raw FIFO words, empty before the first one
+        [[nodiscard]] static std::span<const uint32_t> last_block() noexcept { return s_last; }
+
+        /// call from the ADC interrupt handler
+        static void isr() noexcept {
+            const uint32_t pending = ADC_T::INTSTAT.read() & ADC_T::INTEN.read() & window_mask;
+            if (pending != 0) {
+                ADC_T::INTCLR.write(pending);
+                if (pending & irq::wcexc) { s_outside.store(true, std::memory_order_release); }
+                if (pending & irq::wcinc) { s_outside.store(false, std::memory_order_release); }
+                if (pending & s_events) {
+                    s_wakes.fetch_add(1, std::memory_order_relaxed);
+                    s_handler(s_context, pending & s_events);
+                }
+            }
+            engine::isr();
+        }
+    };  // class window_monitor
+
+}   // namespace ADC
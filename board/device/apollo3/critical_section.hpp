@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace util {
+
+    /**
+     * Masks interrupts for the lifetime of the object and restores the previous PRIMASK on destruction, so
+     * sections nest. Use it for short updates of state that is shared with an ISR and does not fit an atomic.
+     * In a simulation build there are no interrupts and the section is empty.
+     */
+    class critical_section {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+    public:
+        critical_section() noexcept { }
+        ~critical_section() noexcept { }    // user provided, so a scoped lock is not reported as unused
+#else
+        uint32_t m_primask;
+
+    public:
+        critical_section() noexcept {
+            __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r"(m_primask) :: "memory");
+        }
+
+        ~critical_section() noexcept {
+            __asm volatile ("msr primask, %0" :: "r"(m_primask) : "memory");
+        }
+#endif
+        critical_section(const critical_section&) = delete;
+        critical_section& operator=(const critical_section&) = delete;
+    };  // class critical_section
+
+}   // namespace util
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CTIMER.hpp"
+#include <cstdint>
+#include <tuple>
+
+namespace CTIMER {
+
+    /// the two 16 bit halves of each counter/timer
+    enum class Segment : uint8_t { A = 0, B = 1 };
+
+    /// input frequency of a counter/timer for each TMRxnCLK setting, assuming a 48 MHz HFRC/HCLK. 0 if external or chained.
+    constexpr uint32_t clock_hz(const sfr::CTIMER::TMRA0CLKv clk) noexcept {
+        using sfr::CTIMER::TMRA0CLKv;
+        switch (clk) {
+            case TMRA0CLKv::HFRC_DIV4:    return 12000000;
+            case TMRA0CLKv::HFRC_DIV16:   return 3000000;
+            case TMRA0CLKv::HFRC_DIV256:  return 187500;
+            case TMRA0CLKv::HFRC_DIV1024: return 46875;
+            case TMRA0CLKv::HFRC_DIV4K:   return 11718;
+            case TMRA0CLKv::XT:           return 32768;
+            case TMRA0CLKv::XT_DIV2:      return 16384;
+            case TMRA0CLKv::XT_DIV4:      return 8192;
+            case TMRA0CLKv::XT_DIV8:      return 4096;
+            case TMRA0CLKv::XT_DIV16:     return 2048;
+            case TMRA0CLKv::XT_DIV32:     return 1024;
+            case TMRA0CLKv::XT_DIV128:    return 256;
+            case TMRA0CLKv::LFRC_DIV2:    return 512;
+            case TMRA0CLKv::LFRC_DIV32:   return 32;
+            case TMRA0CLKv::LFRC_DIV1K:   return 1;
+            case TMRA0CLKv::LFRC:         return 1024;
+            case TMRA0CLKv::RTC_100HZ:    return 100;
+            case TMRA0CLKv::HCLK_DIV4:    return 12000000;
+            default:                      return 0;
+        }
+    }
+
+    /**
+     * One counter/timer segment running in repeated count mode, used as a periodic tick for drivers
+     * that need hardware pacing. Every timer has the CTRL0/CMPRA0 layout, and segment B sits 16 bits
+     * above segment A in CTRLn, so the fields of timer A0 describe all of them.
+     */
+    template <typename CTIMER_T, unsigned TIMER, Segment SEGMENT = Segment::A>
+    struct periodic {
+        static_assert(TIMER < 8, "Apollo3 has counter/timers 0-7");
+
+        using CTRL_t = typename CTIMER_T::CTRL0_t;
+        using CMPR_t = typename CTIMER_T::CMPRA0_t;
+
+        static constexpr unsigned shift = (SEGMENT == Segment::A) ? 0 : CTRL_t::TMRB0EN.start;
+        using ctrl_t = std::tuple_element_t<TIMER, std::tuple<typename CTIMER_T::CTRL0_t, typename CTIMER_T::CTRL1_t, typename CTIMER_T::CTRL2_t,
+            typename CTIMER_T::CTRL3_t, typename CTIMER_T::CTRL4_t, typename CTIMER_T::CTRL5_t, typename CTIMER_T::CTRL6_t, typename CTIMER_T::CTRL7_t>>;
+        using cmpr_t = std::conditional_t<SEGMENT == Segment::A,
+            std::tuple_element_t<TIMER, std::tuple<typename CTIMER_T::CMPRA0_t, typename CTIMER_T::CMPRA1_t, typename CTIMER_T::CMPRA2_t,
+                typename CTIMER_T::CMPRA3_t, typename CTIMER_T::CMPRA4_t, typename CTIMER_T::CMPRA5_t, typename CTIMER_T::CMPRA6_t, typename CTIMER_T::CMPRA7_t>>,
+            std::tuple_element_t<TIMER, std::tuple<typename CTIMER_T::CMPRB0_t, typename CTIMER_T::CMPRB1_t, typename CTIMER_T::CMPRB2_t,
+                typename CTIMER_T::CMPRB3_t, typename CTIMER_T::CMPRB4_t, typename CTIMER_T::CMPRB5_t, typename CTIMER_T::CMPRB6_t, typename CTIMER_T::CMPRB7_t>>>;
+
+        /// bit of this segment's COMPR0 interrupt in CTIMER INTEN/INTSTAT/INTCLR
+        static constexpr uint32_t irq_mask = 1u << (2 * TIMER + static_cast<unsigned>(SEGMENT));
+
+        // fields of the segment inside CTRLn, all relative to `shift`
+        static constexpr uint32_t ctrl_en  = CTRL_t::TMRA0EN.mask;
+        static constexpr uint32_t ctrl_clr = CTRL_t::TMRA0CLR.mask;
+        static constexpr uint32_t ctrl_mask = (1u << CTRL_t::TMRB0EN.start) - 1u;
+
+        static constexpr uint32_t ctrl_value(const sfr::CTIMER::TMRA0CLKv clk, const bool interrupt) noexcept {
+            return (CTRL_t::TMRA0CLK.shift(clk) | CTRL_t::TMRA0FN.shift(sfr::CTIMER::TMRA0FNv::REPEATEDCOUNT)
+                    | CTRL_t::TMRA0IE0.shift(interrupt)).value;
+        }
+
+        /// start counting `period` ticks of `clk` per interrupt. period must be 1-65536.
+        static void start(const sfr::CTIMER::TMRA0CLKv clk, const uint32_t period, const bool interrupt = true) noexcept {
+            const uint32_t other = ctrl_t::read() & ~(ctrl_mask << shift);
+            ctrl_t::write(other | ((ctrl_value(clk, interrupt) | ctrl_clr) << shift));
+            cmpr_t::write((cmpr_t::read() & ~CMPR_t::CMPR0A0.mask) | CMPR_t::CMPR0A0.shift(period - 1).value);
+            CTIMER_T::INTCLR.write(irq_mask);
+            if (interrupt) { CTIMER_T::INTEN |= irq_mask; }
+            ctrl_t::write(other | ((ctrl_value(clk, interrupt) | ctrl_en) << shift));
+        }
+
+        /// stop and clear the segment, and mask its interrupt
+        static void stop() noexcept {
+            CTIMER_T::INTEN &= ~irq_mask;
+            ctrl_t::write((ctrl_t::read() & ~(ctrl_mask << shift)) | (ctrl_clr << shift));
+            CTIMER_T::INTCLR.write(irq_mask);
+        }
+
+        [[nodiscard]] static bool pending() noexcept { return CTIMER_T::INTSTAT.read() & irq_mask; }
+
+        static void clear() noexcept { CTIMER_T::INTCLR.write(irq_mask); }
+    };  // struct periodic
+
+}   // namespace CTIMER
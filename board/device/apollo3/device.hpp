@@ -36,6 +36,41 @@
 #include "WDT.hpp"    // Watchdog Timer
 
 #include "pin_types.hpp"
+#include "stimer_capture.hpp"
+#include "ctimer.hpp"
+#include "fast_gpio.hpp"
+#include "iom_clock.hpp"
+#include "iom_spi.hpp"
+#include "iom_dma.hpp"
+#include "iom_cq.hpp"
+#include "iom_i2c.hpp"
+#include "iom_bus.hpp"
+#include "iom_async.hpp"
+#include "iom_bench.hpp"
+#include "ioslave.hpp"
+#include "ioslave_mailbox.hpp"
+#include "mspi.hpp"
+#include "mspi_xip.hpp"
+#include "mspi_dma.hpp"
+#include "mspi_cq.hpp"
+#include "mspi_flash.hpp"
+#include "mspi_psram.hpp"
+#include "mspi_scramble.hpp"
+#include "mspi_log.hpp"
+#include "adc.hpp"
+#include "adc_scan.hpp"
+#include "dsp.hpp"
+#include "adc_decode.hpp"
+#include "adc_window.hpp"
+#include "adc_calibration.hpp"
+#include "adc_filter.hpp"
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+#include "sim_gpio.hpp"
+#include "sim_iom.hpp"
+#include "sim_ios.hpp"
+#include "sim_mspi.hpp"
+#include "sim_adc.hpp"
+#endif
 #include <cstdint>
 #include <string_view>
 
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Cortex-M4 DSP extension instructions used by the sample processing code, each with a portable equivalent
+ * for simulation builds. Two signed 16 bit lanes are packed into one word with lane 0 in the low half, the
+ * layout the dual 16 bit multiply instructions expect.
+ */
+namespace dsp {
+
+    /// two lanes in one word; the compiler turns this into PKHBT
+    [[nodiscard]] constexpr uint32_t pack(const int32_t low, const int32_t high) noexcept {
+        return (static_cast<uint32_t>(low) & 0xFFFFu) | (static_cast<uint32_t>(high) << 16);
+    }
+
+    [[nodiscard]] constexpr int32_t low(const uint32_t lanes) noexcept { return static_cast<int16_t>(lanes & 0xFFFFu); }
+    [[nodiscard]] constexpr int32_t high(const uint32_t lanes) noexcept { return static_cast<int16_t>(lanes >> 16); }
+
+    /// UBFX: WIDTH bits of `value` from bit LSB
+    template <unsigned LSB, unsigned WIDTH>
+    [[nodiscard]] inline uint32_t ubfx(const uint32_t value) noexcept {
+        static_assert(WIDTH >= 1 && LSB + WIDTH <= 32, "bit field outside the word");
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+        uint32_t result;
+        __asm ("ubfx %0, %1, %2, %3" : "=r"(result) : "r"(value), "I"(LSB), "I"(WIDTH));
+        return result;
+#else
+        return (value >> LSB) & static_cast<uint32_t>((uint64_t{1} << WIDTH) - 1u);
+#endif
+    }
+
+    /// SMUAD: low * low + high * high
+    [[nodiscard]] inline int32_t smuad(const uint32_t a, const uint32_t b) noexcept {
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+        int32_t result;
+        __asm ("smuad %0, %1, %2" : "=r"(result) : "r"(a), "r"(b));
+        return result;
+#else
+        return static_cast<int32_t>(static_cast<uint32_t>(low(a) * low(b)) + static_cast<uint32_t>(high(a) * high(b)));
+#endif
+    }
+
+    /// SMLAD: accumulator + low * low + high * high
+    [[nodiscard]] inline int32_t smlad(const uint32_t a, const uint32_t b, const int32_t accumulator) noexcept {
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+        int32_t result;
+        __asm ("smlad %0, %1, %2, %3" : "=r"(result) : "r"(a), "r"(b), "r"(accumulator));
+        return result;
+#else
+        return static_cast<int32_t>(static_cast<uint32_t>(accumulator) + static_cast<uint32_t>(smuad(a, b)));
+#endif
+    }
+
+    /// SMLALD: 64 bit accumulator + low * low + high * high
+    [[nodiscard]] inline int64_t smlald(const uint32_t a, const uint32_t b, const int64_t accumulator) noexcept {
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+        uint32_t lo = static_cast<uint32_t>(accumulator);
+        uint32_t hi = static_cast<uint32_t>(static_cast<uint64_t>(accumulator) >> 32);
+        __asm ("smlald %0, %1, %2, %3" : "+r"(lo), "+r"(hi) : "r"(a), "r"(b));
+        return static_cast<int64_t>((static_cast<uint64_t>(hi) << 32) | lo);
+#else
+        return accumulator + int64_t{low(a)} * low(b) + int64_t{high(a)} * high(b);
+#endif
+    }
+
+    /// SSAT: `value` shifted right by SHIFT, saturated to a BITS bit signed range
+    template <unsigned BITS, unsigned SHIFT = 0>
+    [[nodiscard]] inline int32_t ssat(const int32_t value) noexcept {
+        static_assert(BITS >= 1 && BITS <= 32 && SHIFT <= 31, "SSAT range");
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+        int32_t result;
+        if constexpr (SHIFT == 0) {
+            __asm ("ssat %0, %1, %2" : "=r"(result) : "I"(BITS), "r"(value));
+        } else {
+            __asm ("ssat %0, %1, %2, asr %3" : "=r"(result) : "I"(BITS), "r"(value), "I"(SHIFT));
+        }
+        return result;
+#else
+        const int64_t shifted = static_cast<int64_t>(value) >> SHIFT;
+        const int64_t limit = int64_t{1} << (BITS - 1);
+        return static_cast<int32_t>(shifted < -limit ? -limit : (shifted > limit - 1 ? limit - 1 : shifted));
+#endif
+    }
+
+}   // namespace dsp
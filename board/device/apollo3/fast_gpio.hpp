@@ -0,0 +1,150 @@
+#pragma once
+
+#include "APBDMA.hpp"
+#include "ctimer.hpp"
+#include "pin_types.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace GPIO {
+
+    /**
+     * A pad driven by the APBDMA bit-bang (fast GPIO) register instead of WTA/WTB. Pad N follows bit (N % 8)
+     * of BBVALUE, so up to 8 pads with different (N % 8) can change together with a single register write.
+     * The pad is a GPIO in tri-state mode with its output enabled, which is what hands it to the fast GPIO path.
+     */
+    template <typename PIN_INSTANCE>
+    struct fast_output : public pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::MODE_TRISTATE | PinConfig::DRIVE_12MA, -1, true)> {
+        using base = pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::MODE_TRISTATE | PinConfig::DRIVE_12MA, -1, true)>;
+        static constexpr uint8_t bb_mask = 1u << (PIN_INSTANCE::PIN_NUM % 8);
+        explicit constexpr fast_output(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    /// a pad whose level can be sampled through APBDMA BBINPUT bit (N % 8)
+    template <typename PIN_INSTANCE>
+    struct fast_input : public input_floating<PIN_INSTANCE> {
+        static constexpr uint8_t bb_mask = 1u << (PIN_INSTANCE::PIN_NUM % 8);
+        explicit constexpr fast_input(const PIN_INSTANCE pin) : input_floating<PIN_INSTANCE>(pin) { }
+    };
+
+    /**
+     * Plays precomputed 8-bit pin patterns out of the APBDMA bit-bang register, one pattern per tick of a
+     * CTIMER segment. Each tick costs one BBSETCLEAR store from isr(), regardless of how many pads change,
+     * and only the pads in `mask` are touched so other fast GPIO users are left alone.
+     *
+     * NOTE: Apollo3 has no DMA channel that can target the APB bit-bang registers, so the timer interrupt
+     * moves the patterns. Output jitter is the variation in interrupt latency, not the length of the ISR.
+     *
+     * The SAMPLES buffer is split into two halves. The half that is not playing can be filled by the
+     * application and handed over with commit(); if playback reaches a half that has not been committed
+     * the engine stops and counts an underrun.
+     */
+    template <typename APBDMA_T, typename TIMER, std::size_t SAMPLES = 256>
+    class waveform_engine {
+        static_assert(SAMPLES >= 2 && SAMPLES % 2 == 0, "waveform buffer must split into two equal halves");
+        static constexpr std::size_t half_size = SAMPLES / 2;
+        static constexpr std::size_t no_end = SAMPLES + 1;   // streaming: s_position never gets there
+
+        static inline uint8_t s_buffer[SAMPLES] = {};
+        static inline std::atomic<bool> s_ready[2] = {false, false};
+        static inline std::atomic<bool> s_playing{false};
+        static inline std::atomic<uint32_t> s_underruns{0};
+        static inline std::size_t s_position = 0;
+        static inline uint32_t s_mask = 0;
+        static inline std::size_t s_end = no_end;     // one-shot playback stops here
+
+        static void emit(const uint8_t pattern) noexcept {
+            // set has priority over clear in BBSETCLEAR, so both fields are written with disjoint bits
+            APBDMA_T::BBSETCLEAR.write(((~pattern & s_mask) << 16) | (pattern & s_mask));
+        }
+
+    public:
+        static constexpr std::size_t samples = SAMPLES;
+        static constexpr std::size_t half_samples = half_size;
+
+        /// pointer to half 0 or 1 of the pattern buffer
+        [[nodiscard]] static uint8_t* half(const unsigned index) noexcept { return &s_buffer[(index & 1u) * half_size]; }
+
+        /// index of a half that may be written right now, or -1 if both are queued or playing
+        [[nodiscard]] static int writable_half() noexcept {
+            const unsigned playing = static_cast<unsigned>(s_position / half_size);
+            for (unsigned i = 0; i < 2; ++i) {
+                if (!s_ready[i].load(std::memory_order_acquire) && !(s_playing.load(std::memory_order_relaxed) && i == playing)) {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
+
+        /// mark half `index` as filled. It will play after the other half.
+        static void commit(const unsigned index) noexcept { s_ready[index & 1u].store(true, std::memory_order_release); }
+
+        /**
+         * start streaming. `mask` selects the bit-bang bits (pads N % 8) the engine drives, `period` is the
+         * number of timer ticks of `clk` per pattern. Half 0 must have been committed.
+         */
+        static bool start(const uint8_t mask, const sfr::CTIMER::TMRA0CLKv clk, const uint32_t period) noexcept {
+            if (!s_ready[0].load(std::memory_order_acquire)) { return false; }
+            s_mask = mask;
+            s_position = 0;
+            s_end = no_end;
+            s_playing.store(true, std::memory_order_release);
+            TIMER::start(clk, period);
+            return true;
+        }
+
+        /// play `count` patterns (at most one half) once and stop, e.g. a complete one-wire or LED frame
+        static bool play_once(const uint8_t* patterns, const std::size_t count, const uint8_t mask,
+                              const sfr::CTIMER::TMRA0CLKv clk, const uint32_t period) noexcept {
+            if (s_playing.load(std::memory_order_acquire) || count == 0 || count > half_size) { return false; }
+            for (std::size_t i = 0; i < count; ++i) { s_buffer[i] = patterns[i]; }
+            s_ready[0].store(true, std::memory_order_relaxed);
+            s_ready[1].store(false, std::memory_order_relaxed);
+            s_mask = mask;
+            s_position = 0;
+            s_end = count;
+            s_playing.store(true, std::memory_order_release);
+            TIMER::start(clk, period);
+            return true;
+        }
+
+        static void stop() noexcept {
+            TIMER::stop();
+            s_playing.store(false, std::memory_order_release);
+            s_ready[0].store(false, std::memory_order_relaxed);
+            s_ready[1].store(false, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] static bool playing() noexcept { return s_playing.load(std::memory_order_acquire); }
+        [[nodiscard]] static uint32_t underruns() noexcept { return s_underruns.load(std::memory_order_relaxed); }
+
+        /// read all 8 bit-bang inputs at once
+        [[nodiscard]] static uint8_t read_inputs() noexcept { return static_cast<uint8_t>(APBDMA_T::BBINPUT.read()); }
+
+        /// output the next pattern. Call from the CTIMER interrupt handler.
+        static void isr() noexcept {
+            if (!TIMER::pending()) { return; }
+            TIMER::clear();
+            if (!s_playing.load(std::memory_order_relaxed)) { return; }
+
+            emit(s_buffer[s_position]);
+            ++s_position;
+
+            if (s_position == s_end) {
+                stop();
+                return;
+            }
+            if (s_position % half_size == 0) {
+                const unsigned finished = static_cast<unsigned>((s_position - 1) / half_size);
+                s_ready[finished].store(false, std::memory_order_release);
+                if (s_position == SAMPLES) { s_position = 0; }
+                if (!s_ready[s_position / half_size].load(std::memory_order_acquire)) {
+                    s_underruns.fetch_add(1, std::memory_order_relaxed);
+                    stop();
+                }
+            }
+        }
+    };  // class waveform_engine
+
+}   // namespace GPIO
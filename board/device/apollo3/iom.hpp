@@ -0,0 +1,241 @@
+#pragma once
+
+#include "IOM0.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Pieces shared by the IO master (IOM0-5) drivers. All six IOMs have the same register layout at a 0x1000
+ * stride, so everything here is templated on the peripheral type and uses the sfr::IOM0 enums for all of them.
+ */
+namespace IOM {
+
+    /// outcome of an IOM transaction
+    enum class Status : uint8_t {
+        ok,
+        busy,           ///< a transaction is still in flight
+        nak,            ///< I2C device did not acknowledge
+        fifo_error,     ///< FIFO over- or underflow
+        command_error,  ///< illegal command or illegal FIFO access
+        dma_error,      ///< DMA bus error
+        timeout,        ///< the command did not complete within the spin limit
+        invalid,        ///< bad arguments, nothing was started
+    };
+
+    using Command = sfr::IOM0::CMDv;
+
+    /// register layout of all six IOMs, for field definitions outside the drivers templated on one of them
+    using registers = sfr::IOM0_t<0x50004000>;
+
+    constexpr std::size_t fifo_bytes = 32;                          // per direction
+    constexpr std::size_t max_command_bytes = 4095;                 // CMD.TSIZE
+    constexpr std::size_t max_chunk_bytes = max_command_bytes & ~std::size_t{3};  // keeps chained commands word aligned in the FIFO
+    constexpr uint32_t default_spin_limit = 1000000;
+
+    /// INTEN/INTSTAT/INTCLR bits
+    namespace irq {
+        using INTSTAT_t = registers::INTSTAT_t;
+        constexpr uint32_t cmdcmp   = INTSTAT_t::CMDCMP.mask;
+        constexpr uint32_t thr      = INTSTAT_t::THR.mask;
+        constexpr uint32_t fundfl   = INTSTAT_t::FUNDFL.mask;
+        constexpr uint32_t fovfl    = INTSTAT_t::FOVFL.mask;
+        constexpr uint32_t nak      = INTSTAT_t::NAK.mask;
+        constexpr uint32_t iacc     = INTSTAT_t::IACC.mask;
+        constexpr uint32_t icmd     = INTSTAT_t::ICMD.mask;
+        constexpr uint32_t start    = INTSTAT_t::START.mask;
+        constexpr uint32_t stop     = INTSTAT_t::STOP.mask;
+        constexpr uint32_t arb      = INTSTAT_t::ARB.mask;
+        constexpr uint32_t dcmp     = INTSTAT_t::DCMP.mask;
+        constexpr uint32_t derr     = INTSTAT_t::DERR.mask;
+        constexpr uint32_t cqpaused = INTSTAT_t::CQPAUSED.mask;
+        constexpr uint32_t cqupd    = INTSTAT_t::CQUPD.mask;
+        constexpr uint32_t cqerr    = INTSTAT_t::CQERR.mask;
+        constexpr uint32_t all      = INTSTAT_t::reset_mask;
+        constexpr uint32_t errors   = fundfl | fovfl | nak | iacc | icmd | derr | cqerr;
+    }
+
+    /// map error bits of INTSTAT to a Status, ok if none are set
+    constexpr Status status_from_irq(const uint32_t intstat) noexcept {
+        if (intstat & irq::nak)                    { return Status::nak; }
+        if (intstat & (irq::fundfl | irq::fovfl))  { return Status::fifo_error; }
+        if (intstat & (irq::iacc | irq::icmd))     { return Status::command_error; }
+        if (intstat & (irq::derr | irq::cqerr))    { return Status::dma_error; }
+        return Status::ok;
+    }
+
+    /// IOM number of a peripheral type, 0-5
+    template <typename IOM_T>
+    constexpr unsigned instance = (IOM_T::BaseAddress - 0x50004000u) / 0x1000u;
+
+    /**
+     * Value of the CMD register. `offset_count` (0-3) bytes of the offset/instruction are shifted out before the
+     * data, the low byte comes from OFFSETLO here and the upper two from OFFSETHI. `cont` keeps the chip select
+     * asserted (SPI) or skips the STOP condition (I2C) after the command.
+     */
+    constexpr uint32_t command_word(const Command cmd, const std::size_t size, const unsigned cs = 0, const bool cont = false,
+                                    const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+        using CMD_t = registers::CMD_t;
+        return CMD_t::CMD.shift(cmd).value
+             | CMD_t::OFFSETCNT.shift(offset_count).value
+             | CMD_t::CONT.shift(cont).value
+             | CMD_t::TSIZE.shift(static_cast<uint32_t>(size)).value
+             | CMD_t::CMDSEL.shift(cs).value
+             | CMD_t::OFFSETLO.shift(offset & 0xFFu).value;
+    }
+
+    /**
+     * CMD value for the chunk of a long transfer that starts `done` bytes into `size`. Chunks are at most
+     * max_chunk_bytes, all but the last keep the transaction open, and only the first sends the offset bytes.
+     */
+    constexpr uint32_t chunk_command(const Command cmd, const std::size_t done, const std::size_t size, const unsigned cs, const bool cont,
+                                     const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+        const std::size_t chunk = std::min(size - done, max_chunk_bytes);
+        const bool last = (done + chunk == size);
+        return (done == 0) ? command_word(cmd, chunk, cs, cont || !last, offset_count, offset)
+                           : command_word(cmd, chunk, cs, cont || !last);
+    }
+
+    /// CLKCFG image that feeds the interface straight from an FSEL tap, without the TOTPER/LOWPER divider
+    constexpr uint32_t clkcfg(const sfr::IOM0::FSELv fsel) noexcept {
+        return registers::CLKCFG_t::IOCLKEN.shift(true).value | registers::CLKCFG_t::FSEL.shift(fsel).value;
+    }
+
+    /// power an IOM up or down through PWRCTRL.DEVPWREN and wait for the power domain to follow
+    template <typename PWRCTRL_T, typename IOM_T>
+    void power(const bool on) noexcept {
+        constexpr uint32_t bit = PWRCTRL_T::DEVPWREN_t::PWRIOM0.mask << instance<IOM_T>;
+        constexpr uint32_t domain = (instance<IOM_T> < 3) ? PWRCTRL_T::DEVPWRSTATUS_t::HCPB.mask : PWRCTRL_T::DEVPWRSTATUS_t::HCPC.mask;
+        if (on) {
+            PWRCTRL_T::DEVPWREN |= bit;
+            while (!(PWRCTRL_T::DEVPWRSTATUS.read() & domain)) { }
+        } else {
+            PWRCTRL_T::DEVPWREN &= ~bit;
+        }
+    }
+
+    /**
+     * Low level access to one IOM used by the SPI, I2C, DMA and command queue drivers: command issue, FIFO
+     * word streaming and completion polling. Data moves between the FIFO and the caller's buffer directly, a
+     * whole word per FIFOPUSH/FIFOPOP; only the last 1-3 bytes of a command go through a temporary word.
+     */
+    template <typename IOM_T>
+    struct controller {
+        /// empty both FIFOs and clear all pending interrupt status
+        static void reset_fifo() noexcept {
+            IOM_T::FIFOCTRL.write(0);
+            IOM_T::FIFOCTRL.write(IOM_T::FIFOCTRL_t::FIFORSTN.shift(true).value);
+            IOM_T::INTCLR.write(irq::all);
+        }
+
+        /// start a command. The upper offset bytes go to OFFSETHI first since CMD triggers the transaction.
+        static void issue(const uint32_t cmd_word, const uint32_t offset = 0) noexcept {
+            if (IOM_T::CMD_t::OFFSETCNT.extract(cmd_word) > 1) { IOM_T::OFFSETHI.write(IOM_T::OFFSETHI_t::OFFSETHI.shift(offset >> 8).value); }
+            IOM_T::CMD.write(cmd_word);
+        }
+
+        [[nodiscard]] static std::size_t write_room() noexcept { return IOM_T::FIFOPTR_t::FIFO0REM.extract(IOM_T::FIFOPTR.read()); }
+        [[nodiscard]] static std::size_t read_level() noexcept { return IOM_T::FIFOPTR_t::FIFO1SIZ.extract(IOM_T::FIFOPTR.read()); }
+
+        /// push as much of `data` as the write FIFO has room for. Returns the number of bytes consumed.
+        static std::size_t fill(const uint8_t* data, const std::size_t remaining) noexcept {
+            std::size_t room = write_room();
+            std::size_t done = 0;
+            while (room >= 4 && remaining - done >= 4) {
+                uint32_t word;
+                std::memcpy(&word, data + done, 4);
+                IOM_T::FIFOPUSH.write(word);
+                done += 4;
+                room -= 4;
+            }
+            if (room >= 4 && remaining != done) {
+                uint32_t word = 0;
+                std::memcpy(&word, data + done, remaining - done);
+                IOM_T::FIFOPUSH.write(word);
+                done = remaining;
+            }
+            return done;
+        }
+
+        /// pop as much of the read FIFO into `data` as is available. Returns the number of bytes stored.
+        static std::size_t drain(uint8_t* data, const std::size_t remaining) noexcept {
+            std::size_t level = read_level();
+            std::size_t done = 0;
+            while (level >= 4 && remaining - done >= 4) {
+                const uint32_t word = IOM_T::FIFOPOP.read();
+                std::memcpy(data + done, &word, 4);
+                done += 4;
+                level -= 4;
+            }
+            if (remaining != done && level >= remaining - done) {
+                const uint32_t word = IOM_T::FIFOPOP.read();
+                std::memcpy(data + done, &word, remaining - done);
+                done = remaining;
+            }
+            return done;
+        }
+
+        /// error state of the current command from INTSTAT
+        [[nodiscard]] static Status check() noexcept { return status_from_irq(IOM_T::INTSTAT.read()); }
+
+        /// spin until `mask` shows up in INTSTAT or an error is flagged, then clear it
+        static Status wait(const uint32_t mask, uint32_t spin_limit = default_spin_limit) noexcept {
+            for (;;) {
+                const uint32_t status = IOM_T::INTSTAT.read();
+                if (status & irq::errors) {
+                    IOM_T::INTCLR.write(status);
+                    return status_from_irq(status);
+                }
+                if (status & mask) {
+                    IOM_T::INTCLR.write(status & mask);
+                    return Status::ok;
+                }
+                if (spin_limit-- == 0) { return Status::timeout; }
+            }
+        }
+
+        /**
+         * run a complete transfer with the CPU servicing the FIFO. `tx` and/or `rx` may be null; with both the
+         * received bytes of a full-duplex write are stored in `rx`. Transfers longer than one command are
+         * chained in max_chunk_bytes chunks, and the write FIFO is primed before each CMD.
+         */
+        static Status run(const Command cmd, const uint8_t* tx, uint8_t* rx, const std::size_t size, const unsigned cs,
+                          const bool cont, const unsigned offset_count, const uint32_t offset) noexcept {
+            reset_fifo();
+            std::size_t pushed = 0;
+            std::size_t popped = 0;
+            std::size_t done = 0;
+            do {
+                const std::size_t end = done + std::min(size - done, max_chunk_bytes);
+                if (tx) { pushed += fill(tx + pushed, end - pushed); }
+                issue(chunk_command(cmd, done, size, cs, cont, offset_count, offset), offset);
+                uint32_t spin = default_spin_limit;
+                while ((tx && pushed < end) || (rx && popped < end)) {
+                    std::size_t moved = 0;
+                    if (tx && pushed < end) {
+                        const std::size_t n = fill(tx + pushed, end - pushed);
+                        pushed += n;
+                        moved += n;
+                    }
+                    if (rx && popped < end) {
+                        const std::size_t n = drain(rx + popped, end - popped);
+                        popped += n;
+                        moved += n;
+                    }
+                    if (moved == 0) {
+                        if (const Status s = check(); s != Status::ok) { return s; }
+                        if (spin-- == 0) { return Status::timeout; }
+                    }
+                }
+                if (const Status s = wait(irq::cmdcmp); s != Status::ok) { return s; }
+                done = end;
+            } while (done < size);
+            return Status::ok;
+        }
+
+        /// true while a command is being executed
+        [[nodiscard]] static bool active() noexcept { return IOM_T::STATUS_t::CMDACT.extract(IOM_T::STATUS.read()); }
+    };  // struct controller
+
+}   // namespace IOM
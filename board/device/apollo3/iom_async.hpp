@@ -0,0 +1,147 @@
+#pragma once
+
+#include "iom.hpp"
+#include "iom_bus.hpp"
+#include "iom_dma.hpp"
+#include <coroutine>
+#include <cstdint>
+#include <span>
+
+namespace IOM {
+
+    /// completion notification, called from the IOMn interrupt handler with the result of the transaction
+    using completion = void (*)(void* context, Status result);
+
+    /**
+     * dma_engine with completion callbacks. start() returns as soon as the first command is issued and `done` is
+     * called from isr() when the last CMDCMP/DCMP pair is in, so the caller never polls STATUS. The callback may
+     * start the next transfer. Call isr() from the IOMn interrupt handler instead of dma_engine::isr().
+     */
+    template <typename IOM_T>
+    class async_engine {
+        using dma = dma_engine<IOM_T>;
+
+        static inline completion s_done = nullptr;
+        static inline void* s_context = nullptr;
+
+    public:
+        /// start a scatter-gather transfer, see dma_engine::start(). `done` is not called if this fails.
+        static Status start(const std::span<const segment> segments, const completion done, void* const context,
+                            const unsigned cs = 0, const bool cont = false, const unsigned offset_count = 0,
+                            const uint32_t offset = 0) noexcept {
+            if (dma::busy()) { return Status::busy; }
+            s_done = done;
+            s_context = context;
+            const Status started = dma::start(segments, cs, cont, offset_count, offset);
+            if (started != Status::ok) { s_done = nullptr; }
+            return started;
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return dma::busy(); }
+
+        /// chain the next command, or report completion. Call from the IOMn interrupt handler.
+        static void isr() noexcept {
+            dma::isr();
+            if (s_done != nullptr && !dma::busy()) {
+                const completion done = s_done;
+                s_done = nullptr;       // cleared first so the callback can start another transfer
+                done(s_context, dma::status());
+            }
+        }
+    };  // class async_engine
+
+    /**
+     * Common part of the awaitables below. The coroutine is suspended while the transaction runs and resumed
+     * directly from the IOM interrupt, so it continues in interrupt context until it suspends again. A
+     * cooperative scheduler that must not run task code from an ISR should use the callback API and wake the
+     * task from there instead. co_await yields the Status of the transaction.
+     */
+    class completion_awaiter {
+    protected:
+        std::coroutine_handle<> m_handle{};
+        Status m_status = Status::busy;
+
+        static void resume(void* const context, const Status result) noexcept {
+            auto* self = static_cast<completion_awaiter*>(context);
+            self->m_status = result;
+            self->m_handle.resume();
+        }
+
+        /// the handle is stored before submitting because the interrupt may fire before await_suspend() returns
+        bool suspended(const Status submitted) noexcept {
+            if (submitted == Status::ok) { return true; }
+            m_status = submitted;
+            return false;               // not queued, continue without suspending
+        }
+
+    public:
+        [[nodiscard]] constexpr bool await_ready() const noexcept { return false; }
+        [[nodiscard]] Status await_resume() const noexcept { return m_status; }
+    };  // class completion_awaiter
+
+    /// awaitable DMA transfer on an IOM used by one driver, see async_engine
+    template <typename IOM_T>
+    class transfer_awaiter : public completion_awaiter {
+        std::span<const segment> m_segments;
+        uint32_t m_offset;
+        uint8_t m_cs;
+        uint8_t m_offset_count;
+        bool m_cont;
+
+    public:
+        transfer_awaiter(const std::span<const segment> segments, const unsigned cs, const bool cont,
+                         const unsigned offset_count, const uint32_t offset) noexcept
+            : m_segments(segments), m_offset(offset), m_cs(static_cast<uint8_t>(cs)),
+              m_offset_count(static_cast<uint8_t>(offset_count)), m_cont(cont) { }
+
+        bool await_suspend(const std::coroutine_handle<> handle) noexcept {
+            m_handle = handle;
+            return suspended(async_engine<IOM_T>::start(m_segments, &completion_awaiter::resume,
+                                                        static_cast<completion_awaiter*>(this), m_cs, m_cont,
+                                                        m_offset_count, m_offset));
+        }
+    };  // class transfer_awaiter
+
+    /// awaitable transaction on a shared_bus, see shared_bus::submit()
+    template <typename BUS>
+    class bus_awaiter : public completion_awaiter {
+        bus_request m_request;
+
+    public:
+        explicit bus_awaiter(const bus_request& request) noexcept : m_request(request) { }
+
+        bool await_suspend(const std::coroutine_handle<> handle) noexcept {
+            m_handle = handle;
+            m_request.done = &completion_awaiter::resume;
+            m_request.context = static_cast<completion_awaiter*>(this);
+            return suspended(BUS::submit(m_request));
+        }
+    };  // class bus_awaiter
+
+    /**
+     * `Status s = co_await IOM::transfer<decltype(device::IOM0)>(segments);` - run a scatter-gather transfer without
+     * blocking. The segments and their buffers must stay valid until the co_await completes.
+     */
+    template <typename IOM_T>
+    [[nodiscard]] transfer_awaiter<IOM_T> transfer(const std::span<const segment> segments, const unsigned cs = 0,
+                                                   const bool cont = false, const unsigned offset_count = 0,
+                                                   const uint32_t offset = 0) noexcept {
+        return {segments, cs, cont, offset_count, offset};
+    }
+
+    /// `Status s = co_await IOM::submit<bus>(device, segments, priority);` - queue a transaction on a shared bus
+    template <typename BUS>
+    [[nodiscard]] bus_awaiter<BUS> submit(const device_config& device, const std::span<const segment> segments,
+                                          const uint8_t priority = 0, const unsigned offset_count = 0,
+                                          const uint32_t offset = 0, const bool cont = false) noexcept {
+        bus_request request{};
+        request.device = &device;
+        request.segments = segments;
+        request.priority = priority;
+        request.offset_count = static_cast<uint8_t>(offset_count);
+        request.offset = offset;
+        request.cont = cont;
+        return bus_awaiter<BUS>(request);
+    }
+
+}   // namespace IOM
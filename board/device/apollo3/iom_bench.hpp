@@ -0,0 +1,214 @@
+#pragma once
+
+#include "iom.hpp"
+#include "iom_clock.hpp"
+#include "iom_cq.hpp"
+#include "iom_dma.hpp"
+#include "iom_spi.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+#include "simulation.hpp"
+#endif
+
+namespace IOM {
+
+    /// transfer path of a benchmark run
+    enum class Path : uint8_t {
+        fifo,   ///< spi_master interrupt driven FIFO transfer
+        dma,    ///< dma_engine transfer
+        cq,     ///< DMA transfer issued by the command queue
+    };
+
+    /// measurements of one benchmark run
+    struct bench_result {
+        Path      path;
+        Direction direction;
+        uint32_t  size;             ///< bytes per transaction
+        uint32_t  repeat;           ///< transactions run back to back
+        uint32_t  wire_ns;          ///< time the data alone needs on the bus at the configured clock
+        uint32_t  setup_ns;         ///< from the start call until the IOM reports the command active
+        uint32_t  gap_ns;           ///< time per transaction beyond wire_ns in the back to back run
+        uint64_t  total_ns;         ///< duration of the back to back run
+        uint32_t  bytes_per_second;
+        Status    status;
+    };
+
+    /**
+     * Time base of the benchmark. On target this is the DWT cycle counter of the core, on the host it is the
+     * virtual time of the register simulator, so numbers from both can be compared directly.
+     */
+    template <uint32_t CORE_HZ = 48000000u>
+    class stopwatch {
+#if !(defined(SIMULATION_BUILD) && SIMULATION_BUILD)
+        using demcr_t = sfr::reg_t<uint32_t, 0xE000EDFC>;
+        using dwt_ctrl_t = sfr::reg_t<uint32_t, 0xE0001000>;
+        using dwt_cyccnt_t = sfr::reg_t<uint32_t, 0xE0001004>;
+#endif
+
+    public:
+        /// enable the cycle counter (DEMCR.TRCENA, DWT_CTRL.CYCCNTENA)
+        static void enable() noexcept {
+#if !(defined(SIMULATION_BUILD) && SIMULATION_BUILD)
+            demcr_t::write(demcr_t::read() | (1u << 24));
+            dwt_ctrl_t::write(dwt_ctrl_t::read() | 1u);
+#endif
+        }
+
+        /// free running tick count, core cycles on target and nanoseconds on the host
+        [[nodiscard]] static uint32_t ticks() noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            return static_cast<uint32_t>(sim::clock::now());
+#else
+            return dwt_cyccnt_t::read();
+#endif
+        }
+
+        /// ticks between two readings in ns. The counter wraps after 2^32 ticks, 89 s at 48 MHz.
+        [[nodiscard]] static uint64_t elapsed_ns(const uint32_t from, const uint32_t to) noexcept {
+            const uint32_t delta = to - from;
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            return delta;
+#else
+            return uint64_t{delta} * 1000000000ull / CORE_HZ;
+#endif
+        }
+    };  // class stopwatch
+
+    /**
+     * Throughput and overhead of the FIFO, DMA and command queue paths of one IOM. Each run measures the time
+     * from the start call until the IOM has the command active (setup), then runs `repeat` transactions back to
+     * back and reports bytes per second and the time each transaction costs beyond its wire time (gap). The
+     * wire time follows from CLKCFG, so a regression in a driver shows up as a larger gap at the same clock.
+     *
+     * The IOM must be powered and configured, e.g. with spi_master::init(), and is used exclusively. Interrupts
+     * are serviced by polling INTSTAT, so keep the IOMn interrupt disabled in the NVIC while benchmarking.
+     * Transfers up to max_size bytes use one static buffer in SRAM.
+     */
+    template <typename IOM_T, uint32_t CORE_HZ = 48000000u>
+    class benchmark {
+    public:
+        static constexpr std::size_t max_size = 65536;
+
+    private:
+        using clock = stopwatch<CORE_HZ>;
+        using spi = spi_master<IOM_T>;
+        using dma = dma_engine<IOM_T>;
+
+        static constexpr std::size_t entries_per_chunk = 5;   // DMACFG, DMATOTCOUNT, DMATARGADDR, DMACFG, CMD
+        static constexpr std::size_t max_cq_entries = (max_size + max_chunk_bytes - 1) / max_chunk_bytes * entries_per_chunk;
+
+        using queue = command_queue<IOM_T, 2 * (max_cq_entries + 2)>;     // room for the next block while one runs
+
+        alignas(4) static inline uint8_t s_buffer[max_size] = {};
+        static inline cq_program<IOM_T, max_cq_entries> s_program{};
+
+        /// the interrupt handler of the driver under test, run whenever one of its interrupts is pending
+        static void service(const Path path) noexcept {
+            if (!(IOM_T::INTSTAT.read() & IOM_T::INTEN.read())) { return; }
+            if (path == Path::fifo) { spi::isr(); }
+            else if (path == Path::dma) { dma::isr(); }
+        }
+
+        [[nodiscard]] static bool busy(const Path path) noexcept {
+            switch (path) {
+                case Path::fifo: return spi::busy();
+                case Path::dma:  return dma::busy();
+                default:         return !queue::idle();
+            }
+        }
+
+        static Status start(const Path path, const Direction direction, const std::size_t size, const unsigned cs) noexcept {
+            const std::span<uint8_t> data(s_buffer, size);
+            switch (path) {
+                case Path::fifo:
+                    return (direction == Direction::write) ? spi::start_write(data, cs) : spi::start_read(data, cs);
+                case Path::dma:
+                    return (direction == Direction::write) ? dma::write(data, cs) : dma::read(data, cs);
+                default:
+                    return queue::append(s_program);
+            }
+        }
+
+        static Status finish(const Path path) noexcept {
+            while (busy(path)) { service(path); }
+            switch (path) {
+                case Path::fifo: return spi::status();
+                case Path::dma:  return dma::status();
+                default:         return (IOM_T::INTSTAT.read() & irq::cqerr) ? Status::dma_error : Status::ok;
+            }
+        }
+
+        /// CQ program of one transfer, split into chunks like the drivers do
+        static void build_program(const Direction direction, const std::size_t size, const unsigned cs) noexcept {
+            s_program.clear();
+            const uint32_t address = sfr::bus_address(s_buffer, size);
+            for (std::size_t done = 0; done < size; done += max_chunk_bytes) {
+                const std::size_t chunk = (size - done < max_chunk_bytes) ? size - done : max_chunk_bytes;
+                s_program.transfer(direction, address + static_cast<uint32_t>(done), chunk, cs, done + chunk < size);
+            }
+        }
+
+        [[nodiscard]] static uint32_t wire_ns(const std::size_t size) noexcept {
+            const bool i2c = IOM_T::SUBMODCTRL_t::SMOD1EN.extract(IOM_T::SUBMODCTRL.read());
+            const uint32_t hz = clock_hz(IOM_T::CLKCFG.read(), i2c ? ClockMode::i2c : ClockMode::spi);
+            return hz ? static_cast<uint32_t>(uint64_t{size} * (i2c ? 9 : 8) * 1000000000ull / hz) : 0;
+        }
+
+    public:
+        /// run `repeat` transactions of `size` bytes (1 to max_size) on `path` and measure them
+        static bench_result run(const Path path, const std::size_t size, const uint32_t repeat = 8,
+                                const Direction direction = Direction::write, const unsigned cs = 0) noexcept {
+            bench_result result{path, direction, static_cast<uint32_t>(size), repeat, wire_ns(size), 0, 0, 0, 0, Status::invalid};
+            if (size == 0 || size > max_size || repeat == 0) { return result; }
+            for (std::size_t i = 0; i < size; ++i) { s_buffer[i] = static_cast<uint8_t>(i); }
+
+            clock::enable();
+            IOM_T::INTEN.write(0);
+            IOM_T::INTCLR.write(irq::all);
+            if (path == Path::cq) {
+                queue::start();
+                build_program(direction, size, cs);
+            }
+
+            // setup: start call until the first command is on the bus
+            uint32_t from = clock::ticks();
+            Status status = start(path, direction, size, cs);
+            while (status == Status::ok && !IOM_T::STATUS_t::CMDACT.extract(IOM_T::STATUS.read()) && busy(path)) { service(path); }
+            result.setup_ns = static_cast<uint32_t>(clock::elapsed_ns(from, clock::ticks()));
+            if (status == Status::ok) { status = finish(path); }
+
+            // throughput: back to back transactions, the next one is started as soon as the last has finished
+            from = clock::ticks();
+            for (uint32_t i = 0; i < repeat && status == Status::ok; ++i) {
+                status = start(path, direction, size, cs);
+                if (status == Status::ok) { status = finish(path); }
+            }
+            result.total_ns = clock::elapsed_ns(from, clock::ticks());
+            result.status = status;
+
+            if (path == Path::cq) { queue::stop(); }
+            IOM_T::INTEN.write(0);
+            if (result.total_ns != 0) {
+                result.bytes_per_second = static_cast<uint32_t>(uint64_t{repeat} * size * 1000000000ull / result.total_ns);
+                const uint64_t per_transaction = result.total_ns / repeat;
+                result.gap_ns = (per_transaction > result.wire_ns) ? static_cast<uint32_t>(per_transaction - result.wire_ns) : 0;
+            }
+            return result;
+        }
+
+        /// run() every power of two size from 1 byte to max_size and hand each result to `report`
+        static Status sweep(const Path path, void (*report)(const bench_result&), const uint32_t repeat = 8,
+                            const Direction direction = Direction::write, const unsigned cs = 0) noexcept {
+            for (std::size_t size = 1; size <= max_size; size *= 2) {
+                const bench_result result = run(path, size, repeat, direction, cs);
+                report(result);
+                if (result.status != Status::ok) { return result.status; }
+            }
+            return Status::ok;
+        }
+    };  // class benchmark
+
+}   // namespace IOM
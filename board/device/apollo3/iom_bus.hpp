@@ -0,0 +1,191 @@
+#pragma once
+
+#include "critical_section.hpp"
+#include "iom.hpp"
+#include "iom_dma.hpp"
+#include "iom_i2c.hpp"
+#include "iom_spi.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace IOM {
+
+    /// precomputed register image of one device on a shared IOM
+    struct device_config {
+        uint32_t submodctrl;
+        uint32_t clkcfg;
+        uint32_t mspicfg;
+        uint32_t mi2ccfg;
+        uint32_t devcfg;
+        uint8_t  cs;
+
+        [[nodiscard]] constexpr bool is_i2c() const noexcept { return registers::SUBMODCTRL_t::SMOD1EN.extract(submodctrl); }
+
+        static constexpr device_config spi(const uint32_t clk, const SpiMode mode = SpiMode::mode0, const unsigned cs = 0,
+                                           const bool lsb_first = false) noexcept {
+            return {registers::SUBMODCTRL_t::SMOD0EN.shift(true).value, clk, IOM::mspicfg(mode, lsb_first), 0, 0, static_cast<uint8_t>(cs & 0x3u)};
+        }
+
+        static constexpr device_config i2c(const uint16_t address, const i2c_timing timing = i2c_timing_for(I2cSpeed::fast_400k),
+                                           const bool ten_bit_address = false) noexcept {
+            using SUBMODCTRL_t = registers::SUBMODCTRL_t;
+            return {(SUBMODCTRL_t::SMOD1EN.shift(true) | SUBMODCTRL_t::SMOD1TYPE.shift(sfr::IOM0::SMOD1TYPEv::I2C_MASTER)).value, timing.clkcfg, 0,
+                    timing.mi2ccfg | registers::MI2CCFG_t::ADDRSZ.shift(ten_bit_address).value, registers::DEVCFG_t::DEVADDR.shift(address).value, 0};
+        }
+    };
+
+    /// one queued transaction on a shared bus
+    struct bus_request {
+        const device_config* device = nullptr;
+        std::span<const segment> segments;
+        uint8_t  priority = 0;          ///< higher runs first, equal priorities run in submit order
+        uint8_t  offset_count = 0;
+        uint32_t offset = 0;
+        bool     cont = false;
+        void (*done)(void* context, Status result) = nullptr;   ///< called from the IOM interrupt
+        void*    context = nullptr;
+    };
+
+    /**
+     * Arbiter for several devices sharing one IOM. Each device is described by a device_config image; before a
+     * transaction only the registers that differ from the image currently applied are written, so back to back
+     * transactions to the same device cost no configuration at all.
+     *
+     * Transactions wait in a priority queue of DEPTH entries and run one at a time through the DMA engine. When
+     * one completes, the highest priority request is started next, so a sensor read submitted while a bulk
+     * display update is queued goes first. A running transaction is never interrupted. Call isr() from the
+     * IOMn interrupt handler instead of dma_engine::isr(), and do not use the direct drivers on the same IOM.
+     */
+    template <typename IOM_T, std::size_t DEPTH = 8>
+    class shared_bus {
+        using dma = dma_engine<IOM_T>;
+
+        struct slot {
+            bus_request request;
+            uint32_t sequence;
+            bool used;
+        };
+
+        static inline slot s_queue[DEPTH] = {};
+        static inline uint32_t s_sequence = 0;
+        static inline bool s_running = false;
+        static inline bus_request s_current{};
+
+        // register values currently in the IOM, ~0 when unknown
+        static inline uint32_t s_submodctrl = ~0u;
+        static inline uint32_t s_clkcfg = ~0u;
+        static inline uint32_t s_mspicfg = ~0u;
+        static inline uint32_t s_mi2ccfg = ~0u;
+        static inline uint32_t s_devcfg = ~0u;
+        static inline uint32_t s_writes = 0;
+        static inline uint32_t s_skipped = 0;
+
+        template <typename REG>
+        static void update(const REG& reg, uint32_t& cached, const uint32_t value) noexcept {
+            if (cached == value) {
+                ++s_skipped;
+                return;
+            }
+            reg.write(value);
+            cached = value;
+            ++s_writes;
+        }
+
+        static void apply(const device_config& device) noexcept {
+            const bool switch_submodule = device.submodctrl != s_submodctrl;
+            if (switch_submodule) {
+                IOM_T::SUBMODCTRL.write(0);    // the interface is reconfigured with both submodules off
+                s_submodctrl = 0;
+            }
+            update(IOM_T::CLKCFG, s_clkcfg, device.clkcfg);
+            if (device.is_i2c()) {
+                update(IOM_T::MI2CCFG, s_mi2ccfg, device.mi2ccfg);
+                update(IOM_T::DEVCFG, s_devcfg, device.devcfg);
+            } else {
+                update(IOM_T::MSPICFG, s_mspicfg, device.mspicfg);
+            }
+            update(IOM_T::SUBMODCTRL, s_submodctrl, device.submodctrl);
+        }
+
+        static void complete(const Status result) noexcept {
+            if (s_current.done) { s_current.done(s_current.context, result); }
+        }
+
+        /// start queued requests until one is running or the queue is empty. Interrupts must be masked.
+        static void start_next() noexcept {
+            for (;;) {
+                slot* next = nullptr;
+                for (auto& s : s_queue) {
+                    if (s.used && (next == nullptr || s.request.priority > next->request.priority
+                               || (s.request.priority == next->request.priority && static_cast<int32_t>(s.sequence - next->sequence) < 0))) {
+                        next = &s;
+                    }
+                }
+                if (next == nullptr) {
+                    s_running = false;
+                    return;
+                }
+                s_current = next->request;
+                next->used = false;
+                s_running = true;
+
+                apply(*s_current.device);
+                const Status started = dma::start(s_current.segments, s_current.device->cs, s_current.cont,
+                                                  s_current.offset_count, s_current.offset);
+                if (started == Status::ok) { return; }
+                complete(started);
+            }
+        }
+
+    public:
+        /// forget the cached register image, e.g. after the IOM was powered down or used by another driver
+        static void invalidate() noexcept {
+            s_submodctrl = s_clkcfg = s_mspicfg = s_mi2ccfg = s_devcfg = ~0u;
+        }
+
+        /**
+         * queue a transaction. Returns Status::busy if the queue is full, Status::invalid for a request without
+         * device or segments. The segments and device image must stay valid until `done` has been called.
+         */
+        static Status submit(const bus_request& request) noexcept {
+            if (request.device == nullptr || request.segments.empty() || request.offset_count > 3) { return Status::invalid; }
+            util::critical_section lock;
+            slot* free = nullptr;
+            for (auto& s : s_queue) {
+                if (!s.used) {
+                    free = &s;
+                    break;
+                }
+            }
+            if (free == nullptr) { return Status::busy; }
+            *free = slot{request, s_sequence++, true};
+            if (!s_running) { start_next(); }
+            return Status::ok;
+        }
+
+        /// complete the running transaction and start the next one. Call from the IOMn interrupt handler.
+        static void isr() noexcept {
+            dma::isr();
+            if (s_running && !dma::busy()) {
+                complete(dma::status());
+                start_next();
+            }
+        }
+
+        /// true when nothing is running or queued
+        [[nodiscard]] static bool idle() noexcept { return !s_running; }
+
+        /// number of requests waiting behind the running one
+        [[nodiscard]] static std::size_t pending() noexcept {
+            std::size_t count = 0;
+            for (const auto& s : s_queue) { count += s.used; }
+            return count;
+        }
+
+        /// configuration register writes issued, and writes avoided because the register already held the value
+        [[nodiscard]] static uint32_t register_writes() noexcept { return s_writes; }
+        [[nodiscard]] static uint32_t register_writes_saved() noexcept { return s_skipped; }
+    };  // class shared_bus
+
+}   // namespace IOM
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "iom.hpp"
+#include <cstdint>
+
+namespace IOM {
+
+    /// HFRC frequency the FSEL taps are derived from
+    constexpr uint32_t hfrc_hz = 48000000u;
+
+    enum class ClockMode : uint8_t {
+        spi,    ///< interface clock is the divided clock
+        i2c,    ///< SCL runs at half the divided clock and has to meet the I2C low/high time minimums
+    };
+
+    /// one CLKCFG setting and the interface frequency it produces
+    struct clock_setting {
+        uint32_t clkcfg = 0;
+        uint32_t hz = 0;        ///< 0 if no setting reaches the requested frequency
+
+        [[nodiscard]] constexpr bool valid() const noexcept { return hz != 0; }
+    };
+
+    /// interface frequency a CLKCFG image produces from `source_hz`, 0 if the clock is off
+    constexpr uint32_t clock_hz(const uint32_t clkcfg, const ClockMode mode = ClockMode::spi, const uint32_t source_hz = hfrc_hz) noexcept {
+        using CLKCFG_t = registers::CLKCFG_t;
+        const auto fsel = static_cast<uint32_t>(CLKCFG_t::FSEL.extract(clkcfg));
+        if (!CLKCFG_t::IOCLKEN.extract(clkcfg) || fsel == 0) { return 0; }
+        uint32_t hz = source_hz >> (fsel - 1);
+        if (CLKCFG_t::DIV3.extract(clkcfg)) { hz /= 3; }
+        if (CLKCFG_t::DIVEN.extract(clkcfg)) { hz /= CLKCFG_t::TOTPER.extract(clkcfg) + 1; }
+        return (mode == ClockMode::i2c) ? hz / 2 : hz;
+    }
+
+    namespace detail {
+
+        /// I2C SCL low and high minimums in ns for the speed class of `hz` (standard, fast, fast plus)
+        struct scl_minimums {
+            uint32_t low_ns;
+            uint32_t high_ns;
+        };
+
+        constexpr scl_minimums scl_minimums_for(const uint32_t hz) noexcept {
+            if (hz <= 100000u) { return {4700, 4000}; }
+            if (hz <= 400000u) { return {1300, 600}; }
+            return {500, 260};
+        }
+
+        /// does `count` cycles of the divided clock (two SCL phases each in I2C) last at least `min_ns`
+        constexpr bool lasts(const uint32_t count, const uint32_t divided_hz, const uint32_t min_ns) noexcept {
+            return uint64_t{2} * count * 1000000000ull >= uint64_t{min_ns} * divided_hz;
+        }
+
+        /**
+         * LOWPER for a divider of `total` cycles: half the period for a 50% duty cycle, and for I2C lengthened
+         * until SCL low meets the minimum. Returns -1 if the high phase then gets too short.
+         */
+        constexpr int32_t lowper_for(const uint32_t total, const uint32_t divided_hz, const ClockMode mode, const uint32_t target_hz) noexcept {
+            uint32_t low = total / 2;
+            if (mode == ClockMode::i2c) {
+                const scl_minimums minimums = scl_minimums_for(target_hz);
+                while (low < total && !lasts(low, divided_hz, minimums.low_ns)) { ++low; }
+                if (low >= total || !lasts(total - low, divided_hz, minimums.high_ns)) { return -1; }
+            }
+            return static_cast<int32_t>(low) - 1;
+        }
+
+    }   // namespace detail
+
+    /// true if the SCL low and high times of an I2C CLKCFG image meet the minimums of its speed class
+    constexpr bool scl_timing_ok(const uint32_t clkcfg, const uint32_t source_hz = hfrc_hz) noexcept {
+        using CLKCFG_t = registers::CLKCFG_t;
+        const uint32_t hz = clock_hz(clkcfg, ClockMode::i2c, source_hz);
+        if (hz == 0 || hz > 1000000u || !CLKCFG_t::DIVEN.extract(clkcfg)) { return false; }
+        const uint32_t divided_hz = clock_hz(clkcfg & ~CLKCFG_t::DIVEN.mask, ClockMode::spi, source_hz);
+        const uint32_t total = CLKCFG_t::TOTPER.extract(clkcfg) + 1;
+        const uint32_t low = CLKCFG_t::LOWPER.extract(clkcfg) + 1;
+        const detail::scl_minimums minimums = detail::scl_minimums_for(hz);
+        return low < total && detail::lasts(low, divided_hz, minimums.low_ns) && detail::lasts(total - low, divided_hz, minimums.high_ns);
+    }
+
+    /**
+     * Find the CLKCFG setting with the highest interface frequency that does not exceed `target_hz`. All FSEL
+     * taps, DIV3 and the TOTPER divider are tried; on a tie the faster FSEL tap wins since it gives the finest
+     * LOWPER resolution, unless a tap reaches the frequency without the divider. SPI gets a duty cycle as close
+     * to 50% as the divider allows, I2C needs the divider and gets a LOWPER that meets the SCL low and high time
+     * minimums of the target's speed class (max 1 MHz).
+     * An unreachable target returns an invalid setting.
+     */
+    constexpr clock_setting solve_clock(const uint32_t target_hz, const ClockMode mode = ClockMode::spi, const uint32_t source_hz = hfrc_hz) noexcept {
+        using CLKCFG_t = registers::CLKCFG_t;
+        clock_setting best{};
+        if (target_hz == 0 || (mode == ClockMode::i2c && target_hz > 1000000u)) { return best; }
+
+        for (uint32_t fsel = 1; fsel <= 7; ++fsel) {
+            for (uint32_t div3 = 0; div3 <= 1; ++div3) {
+                const uint32_t base = (CLKCFG_t::IOCLKEN.shift(true) | CLKCFG_t::FSEL.shift(static_cast<sfr::IOM0::FSELv>(fsel))
+                                       | CLKCFG_t::DIV3.shift(div3 != 0)).value;
+                const uint32_t divided_source = (source_hz >> (fsel - 1)) / (div3 ? 3 : 1);
+
+                if (mode == ClockMode::spi) {
+                    const uint32_t hz = clock_hz(base, mode, source_hz);
+                    // an undivided tap has an exact 50% duty cycle, so it also wins a tie against the divider
+                    if (hz <= target_hz && (hz > best.hz || (hz == best.hz && CLKCFG_t::DIVEN.extract(best.clkcfg)))) { best = {base, hz}; }
+                }
+                // the smallest divider that does not exceed the target is the best one for this tap
+                const uint32_t scale = (mode == ClockMode::i2c) ? 2u : 1u;
+                uint32_t total = static_cast<uint32_t>((divided_source + uint64_t{target_hz} * scale - 1) / (uint64_t{target_hz} * scale));
+                if (total < 2) { total = 2; }
+                for (; total <= 256; ++total) {
+                    const uint32_t clkcfg = base | (CLKCFG_t::DIVEN.shift(true) | CLKCFG_t::TOTPER.shift(total - 1)).value;
+                    const uint32_t hz = clock_hz(clkcfg, mode, source_hz);
+                    if (hz <= best.hz) { break; }
+                    const int32_t lowper = detail::lowper_for(total, divided_source, mode, target_hz);
+                    if (lowper < 0) { continue; }
+                    best = {clkcfg | CLKCFG_t::LOWPER.shift(static_cast<uint32_t>(lowper)).value, hz};
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+
+    /// CLKCFG image for an SPI clock of at most HZ, rejected at compile time if no setting reaches it
+    template <uint32_t HZ, uint32_t SOURCE_HZ = hfrc_hz>
+    constexpr uint32_t spi_clkcfg() noexcept {
+        constexpr clock_setting setting = solve_clock(HZ, ClockMode::spi, SOURCE_HZ);
+        static_assert(setting.valid(), "SPI clock frequency is below the slowest reachable IOM clock");
+        return setting.clkcfg;
+    }
+
+    /// CLKCFG image for an I2C SCL of at most HZ with valid low/high times, rejected at compile time if unreachable
+    template <uint32_t HZ, uint32_t SOURCE_HZ = hfrc_hz>
+    constexpr uint32_t i2c_clkcfg() noexcept {
+        constexpr clock_setting setting = solve_clock(HZ, ClockMode::i2c, SOURCE_HZ);
+        static_assert(setting.valid(), "I2C clock frequency is out of range or can not meet the SCL low/high times");
+        return setting.clkcfg;
+    }
+
+}   // namespace IOM
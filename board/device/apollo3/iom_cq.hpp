@@ -0,0 +1,255 @@
+#pragma once
+
+#include "iom.hpp"
+#include "iom_dma.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace IOM {
+
+    /// one command queue entry: the CQ fetches the pair from SRAM and writes `value` to `address`
+    struct cq_entry {
+        uint32_t address;
+        uint32_t value;
+    };
+
+    /// CQPAUSEEN bits that do not depend on the IOM instance
+    namespace cq_pause {
+        using CQPENv = sfr::IOM0::CQPENv;
+        constexpr uint32_t index_equal = static_cast<uint32_t>(CQPENv::IDXEQ);       ///< pause while CQCURIDX == CQENDIDX
+        constexpr uint32_t gpio        = static_cast<uint32_t>(CQPENv::GPIOXOREN);   ///< pause while the GPIO CQ input XOR SWFLAG2 is 1
+        constexpr uint32_t iom         = static_cast<uint32_t>(CQPENv::IOMXOREN);    ///< pause while the IOM CQ input XOR SWFLAG3 is 1
+        constexpr uint32_t ble         = static_cast<uint32_t>(CQPENv::BLEXOREN);    ///< pause while the BLE CQ input XOR SWFLAG4 is 1
+        constexpr uint32_t software(const unsigned flag) noexcept { return static_cast<uint32_t>(CQPENv::SWFLAGEN0) << (flag & 0x7u); }
+    }
+
+    /**
+     * Builder for a list of IOM register writes that the command queue executes on its own. Programs can be
+     * built in a constexpr context (e.g. the fixed part of a sensor poll) and extended at runtime with DMA
+     * buffers whose addresses are only known then. The CQ holds further IOM register writes while a command is in
+     * flight, so transactions can simply be listed one after the other.
+     *
+     * N is the capacity in entries; overflow() reports a program that did not fit.
+     */
+    template <typename IOM_T, std::size_t N>
+    class cq_program {
+        std::array<cq_entry, N> m_entries{};
+        std::size_t m_size = 0;
+        bool m_overflow = false;
+
+    public:
+        static constexpr std::size_t capacity = N;
+
+        /// write `value` to the register at `address`; any APB/AHB register the CQ can reach
+        constexpr cq_program& write_absolute(const uint32_t address, const uint32_t value) noexcept {
+            if (m_size == N) {
+                m_overflow = true;
+                return *this;
+            }
+            m_entries[m_size++] = cq_entry{address, value};
+            return *this;
+        }
+
+        /// write `value` to a register of this IOM, e.g. write(IOM_T::CQSETCLEAR, ...)
+        template <typename REG>
+        constexpr cq_program& write(const REG&, const uint32_t value) noexcept {
+            return write_absolute(REG::address, value);
+        }
+
+        /// start a command, see IOM::command_word(). OFFSETHI is only written when more than one offset byte is sent.
+        constexpr cq_program& command(const uint32_t cmd_word, const uint32_t offset = 0) noexcept {
+            if (IOM_T::CMD_t::OFFSETCNT.extract(cmd_word) > 1) { write(IOM_T::OFFSETHI, IOM_T::OFFSETHI_t::OFFSETHI.shift(offset >> 8).value); }
+            return write(IOM_T::CMD, cmd_word);
+        }
+
+        /// write up to one FIFO worth of data embedded in the program, no buffer or DMA needed
+        constexpr cq_program& write_inline(const std::span<const uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                                           const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (data.empty() || data.size() > fifo_bytes) {
+                m_overflow = true;
+                return *this;
+            }
+            for (std::size_t i = 0; i < data.size(); i += 4) {
+                uint32_t word = 0;
+                for (std::size_t b = 0; b < 4 && i + b < data.size(); ++b) { word |= uint32_t{data[i + b]} << (8 * b); }
+                write(IOM_T::FIFOPUSH, word);
+            }
+            return command(command_word(Command::WRITE, data.size(), cs, cont, offset_count, offset), offset);
+        }
+
+        /// a DMA backed command moving `size` bytes from/to the SRAM address `address`
+        constexpr cq_program& transfer(const Direction direction, const uint32_t address, const std::size_t size, const unsigned cs = 0,
+                                       const bool cont = false, const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (size == 0 || size > max_command_bytes) {
+                m_overflow = true;
+                return *this;
+            }
+            const Command c = (direction == Direction::write) ? Command::WRITE : Command::READ;
+            write(IOM_T::DMACFG, 0);
+            write(IOM_T::DMATOTCOUNT, static_cast<uint32_t>(size));
+            write(IOM_T::DMATARGADDR, address);
+            write(IOM_T::DMACFG, IOM_T::DMACFG_t::DMADIR.shift(direction == Direction::write).value | IOM_T::DMACFG_t::DMAEN.shift(true).value);
+            return command(command_word(c, size, cs, cont, offset_count, offset), offset);
+        }
+
+        /// read into a buffer with DMA, see transfer()
+        cq_program& dma_read(const std::span<uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                         const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            return transfer(Direction::read, sfr::bus_address(data.data(), data.size()), data.size(), cs, cont, offset_count, offset);
+        }
+
+        /// write a buffer with DMA, see transfer()
+        cq_program& dma_write(const std::span<const uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                          const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            return transfer(Direction::write, sfr::bus_address(data.data(), data.size()), data.size(), cs, cont, offset_count, offset);
+        }
+
+        /// set, clear or toggle software flags (CQFLAGS 7:0)
+        constexpr cq_program& set_flags(const uint8_t mask) noexcept { return write(IOM_T::CQSETCLEAR, IOM_T::CQSETCLEAR_t::CQFSET.shift(mask).value); }
+        constexpr cq_program& clear_flags(const uint8_t mask) noexcept { return write(IOM_T::CQSETCLEAR, IOM_T::CQSETCLEAR_t::CQFCLR.shift(mask).value); }
+        constexpr cq_program& toggle_flags(const uint8_t mask) noexcept { return write(IOM_T::CQSETCLEAR, IOM_T::CQSETCLEAR_t::CQFTGL.shift(mask).value); }
+
+        /// replace the pause conditions, see IOM::cq_pause. index_equal is always kept so queue appends keep working.
+        constexpr cq_program& pause_on(const uint32_t conditions) noexcept {
+            return write(IOM_T::CQPAUSEEN, conditions | cq_pause::index_equal);
+        }
+
+        /// stop here until the CPU (or another queue) clears software flag `flag`, see command_queue::release()
+        constexpr cq_program& wait_for_release(const unsigned flag) noexcept {
+            set_flags(static_cast<uint8_t>(1u << (flag & 0x7u)));
+            return pause_on(cq_pause::software(flag));
+        }
+
+        /// raise the CQUPD interrupt when the queue gets here. Address bit 0 of any CQ write flags the update.
+        constexpr cq_program& notify() noexcept { return write_absolute(IOM_T::CQSETCLEAR.address | 1u, 0); }
+
+        /// append all entries of another program
+        template <std::size_t M>
+        constexpr cq_program& append(const cq_program<IOM_T, M>& other) noexcept {
+            for (const cq_entry& e : other.entries()) { write_absolute(e.address, e.value); }
+            return *this;
+        }
+
+        constexpr void clear() noexcept {
+            m_size = 0;
+            m_overflow = false;
+        }
+
+        [[nodiscard]] constexpr std::span<const cq_entry> entries() const noexcept { return {m_entries.data(), m_size}; }
+        [[nodiscard]] constexpr std::size_t size() const noexcept { return m_size; }
+        [[nodiscard]] constexpr bool overflow() const noexcept { return m_overflow; }
+    };  // class cq_program
+
+    /**
+     * Circular command queue of one IOM in SRAM. append() copies a program behind the ones still queued,
+     * closes it with a write of its block index to CQCURIDX and then moves CQENDIDX to that index. With the
+     * index_equal pause condition the queue runs until it has executed the newest block and waits there, so
+     * blocks can be added while it runs without stopping it. Space is reclaimed as CQCURIDX passes blocks.
+     *
+     * ENTRIES is the ring size; one entry is kept for the jump back to the start.
+     */
+    template <typename IOM_T, std::size_t ENTRIES = 128>
+    class command_queue {
+        static_assert(ENTRIES >= 4, "command queue ring is too small");
+
+        alignas(8) static inline cq_entry s_ring[ENTRIES] = {};
+        static inline std::size_t s_head = 0;                   // next free entry
+        static inline uint8_t s_index = 0;                      // index of the newest block
+        static inline uint16_t s_block_end[256] = {};           // ring position after each block index
+        static inline std::atomic<uint32_t> s_errors{0};
+
+        static constexpr uint32_t cqcuridx_address = IOM_T::CQCURIDX.address;
+        static constexpr uint32_t cqaddr_address = IOM_T::CQADDR.address;
+
+        [[nodiscard]] static uint32_t ring_address() noexcept { return sfr::bus_address(s_ring, sizeof(s_ring)); }
+
+        /// first ring position the queue may still fetch
+        [[nodiscard]] static std::size_t tail() noexcept { return s_block_end[completed_index()]; }
+
+    public:
+        /// reset the ring and enable the queue. It is idle until the first append().
+        static void start(const bool high_priority = false) noexcept {
+            IOM_T::CQCFG.write(0);
+            s_head = 0;
+            s_index = 0;
+            for (auto& end : s_block_end) { end = 0; }
+            IOM_T::CQCURIDX.write(0);
+            IOM_T::CQENDIDX.write(0);
+            IOM_T::CQADDR.write(ring_address());
+            IOM_T::CQPAUSEEN.write(cq_pause::index_equal);
+            IOM_T::FIFOTHR.write(IOM_T::FIFOTHR_t::FIFOWTHR.shift(fifo_bytes / 2).value       // DMA pacing for the transfer() entries
+                                 | IOM_T::FIFOTHR_t::FIFORTHR.shift(fifo_bytes / 2).value);
+            IOM_T::DMATRIGEN.write(IOM_T::DMATRIGEN_t::DTHREN.shift(true).value | IOM_T::DMATRIGEN_t::DCMDCMPEN.shift(true).value);
+            IOM_T::INTCLR.write(irq::cqerr | irq::cqupd | irq::cqpaused);
+            IOM_T::CQCFG.write(IOM_T::CQCFG_t::CQPRI.shift(high_priority).value | IOM_T::CQCFG_t::CQEN.shift(true).value);
+        }
+
+        /// disable the queue after the block that is executing now
+        static void stop() noexcept { IOM_T::CQCFG.write(0); }
+
+        /**
+         * queue a program. Returns Status::busy if the ring has no room for it until more blocks have run,
+         * Status::invalid if it overflowed its builder or can never fit.
+         */
+        template <std::size_t N>
+        static Status append(const cq_program<IOM_T, N>& program) noexcept {
+            const std::size_t needed = program.size() + 1;     // + index marker
+            if (program.overflow() || program.size() == 0 || needed + 1 > ENTRIES) { return Status::invalid; }
+
+            const std::size_t done = tail();
+            std::size_t position = s_head;
+            if (s_head >= done) {
+                if (needed + 1 > ENTRIES - s_head) {            // does not fit before the end of the ring
+                    if (done == 0 || needed > done - 1) { return Status::busy; }
+                    s_ring[s_head] = cq_entry{cqaddr_address, ring_address()};
+                    position = 0;
+                }
+            } else if (needed > done - s_head - 1) {
+                return Status::busy;
+            }
+
+            for (const cq_entry& e : program.entries()) { s_ring[position++] = e; }
+            const uint8_t index = static_cast<uint8_t>(s_index + 1);
+            s_ring[position++] = cq_entry{cqcuridx_address, index};
+            s_block_end[index] = static_cast<uint16_t>(position);
+            s_head = position;
+            s_index = index;
+
+            std::atomic_thread_fence(std::memory_order_release);    // entries must be in SRAM before the queue may fetch them
+            IOM_T::CQENDIDX.write(index);
+            return Status::ok;
+        }
+
+        /// index of the last block the queue has finished
+        [[nodiscard]] static uint8_t completed_index() noexcept { return static_cast<uint8_t>(IOM_T::CQCURIDX_t::CQCURIDX.extract(IOM_T::CQCURIDX.read())); }
+
+        /// index that append() gave the newest block
+        [[nodiscard]] static uint8_t queued_index() noexcept { return s_index; }
+
+        /// true once every appended block has run
+        [[nodiscard]] static bool idle() noexcept { return completed_index() == s_index; }
+
+        /// true once the block with `index` has run
+        [[nodiscard]] static bool done(const uint8_t index) noexcept {
+            return static_cast<uint8_t>(completed_index() - index) < 128;
+        }
+
+        /// let a queue that waits in cq_program::wait_for_release(flag) continue
+        static void release(const unsigned flag) noexcept { IOM_T::CQSETCLEAR.write(IOM_T::CQSETCLEAR_t::CQFCLR.shift(1u << (flag & 0x7u)).value); }
+
+        /// number of CQERR interrupts seen by isr()
+        [[nodiscard]] static uint32_t errors() noexcept { return s_errors.load(std::memory_order_relaxed); }
+
+        /// acknowledge queue interrupts and return them. Call from the IOMn interrupt handler.
+        static uint32_t isr() noexcept {
+            const uint32_t pending = IOM_T::INTSTAT.read() & (irq::cqerr | irq::cqupd | irq::cqpaused);
+            IOM_T::INTCLR.write(pending);
+            if (pending & irq::cqerr) { s_errors.fetch_add(1, std::memory_order_relaxed); }
+            return pending;
+        }
+    };  // class command_queue
+
+}   // namespace IOM
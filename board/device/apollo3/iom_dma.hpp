@@ -0,0 +1,200 @@
+#pragma once
+
+#include "iom.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace IOM {
+
+    /// data direction of a DMA segment, values match DMACFG.DMADIR
+    enum class Direction : uint8_t {
+        read  = 0,  ///< P2M - bus to memory
+        write = 1,  ///< M2P - memory to bus
+    };
+
+    /// one buffer of a scatter-gather transfer. Buffers must be in SRAM, the IOM DMA can not read flash.
+    struct segment {
+        uint8_t*  buffer;
+        uint32_t  length;
+        Direction direction;
+
+        static constexpr segment tx(const std::span<const uint8_t> data) noexcept {
+            return {const_cast<uint8_t*>(data.data()), static_cast<uint32_t>(data.size()), Direction::write};
+        }
+
+        static constexpr segment rx(const std::span<uint8_t> data) noexcept {
+            return {data.data(), static_cast<uint32_t>(data.size()), Direction::read};
+        }
+    };
+
+    /**
+     * DMA transfer engine for one IOM. A list of segments runs as one bus transaction: every command but the
+     * last has CONT set, so the chip select stays asserted (SPI) or a repeated start follows (I2C), and the next
+     * segment is programmed from isr() as soon as both CMDCMP and DCMP of the current one are in. Segments
+     * longer than one command are split into word aligned chunks.
+     *
+     * The CPU is only needed once per command, so it can sleep in wait() for the bulk of a transfer. Call
+     * isr() from the IOMn interrupt handler. The segment list and its buffers must stay valid until busy() is false.
+     */
+    template <typename IOM_T>
+    class dma_engine {
+        using io = controller<IOM_T>;
+
+        static constexpr uint32_t thresholds = IOM_T::FIFOTHR_t::FIFOWTHR.shift(fifo_bytes / 2).value | IOM_T::FIFOTHR_t::FIFORTHR.shift(fifo_bytes / 2).value;
+        static constexpr uint32_t done_mask = irq::cmdcmp | irq::dcmp;
+
+        static inline const segment* s_segments = nullptr;
+        static inline std::size_t s_count = 0;
+        static inline std::size_t s_index = 0;      // current segment
+        static inline uint32_t s_offset = 0;        // bytes of the current segment already transferred
+        static inline uint32_t s_chunk = 0;         // bytes of the command in flight
+        static inline uint32_t s_waiting = 0;       // completion bits still missing for the command in flight
+        static inline uint8_t s_cs = 0;
+        static inline bool s_cont = false;
+        static inline bool s_priority = false;
+        static inline std::atomic<Status> s_status{Status::ok};
+        static inline segment s_single{};           // backs the single buffer read()/write()
+
+        [[nodiscard]] static bool in_sram(const segment& seg) noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            (void)seg;
+            return true;
+#else
+            const uint32_t address = sfr::bus_address(seg.buffer, seg.length);
+            return (address & 0xFFF00000u) == 0x10000000u;
+#endif
+        }
+
+        /// program DMA and CMD for the next chunk of the current segment
+        static void program(const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            const segment& seg = s_segments[s_index];
+            s_chunk = static_cast<uint32_t>(std::min<std::size_t>(seg.length - s_offset, max_chunk_bytes));
+            const bool last = (s_index + 1 == s_count) && (s_offset + s_chunk == seg.length);
+            const Command cmd = (seg.direction == Direction::write) ? Command::WRITE : Command::READ;
+
+            IOM_T::DMACFG.write(0);
+            IOM_T::DMATOTCOUNT.write(s_chunk);
+            IOM_T::DMATARGADDR.write(sfr::bus_address(seg.buffer + s_offset, s_chunk));
+            IOM_T::DMACFG.write(IOM_T::DMACFG_t::DMADIR.shift(seg.direction == Direction::write).value
+                                | IOM_T::DMACFG_t::DMAPRI.shift(s_priority).value | IOM_T::DMACFG_t::DMAEN.shift(true).value);
+            s_waiting = done_mask;
+            io::issue(command_word(cmd, s_chunk, s_cs, s_cont || !last, offset_count, offset), offset);
+        }
+
+        static void finish(const Status result) noexcept {
+            IOM_T::INTEN.write(0);
+            IOM_T::DMACFG.write(0);
+            IOM_T::DMATRIGEN.write(0);
+            s_status.store(result, std::memory_order_release);
+        }
+
+    public:
+        /// give the IOM DMA priority over the CPU on the AHB (DMACFG.DMAPRI) for following transfers
+        static void priority(const bool high) noexcept { s_priority = high; }
+
+        /**
+         * start a scatter-gather transfer. `offset_count` (0-3) instruction/address bytes from `offset` are sent
+         * before the first segment. With `cont` the transaction is left open after the last segment.
+         */
+        static Status start(const std::span<const segment> segments, const unsigned cs = 0, const bool cont = false,
+                            const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (segments.empty() || offset_count > 3) { return Status::invalid; }
+            for (const segment& seg : segments) {
+                if (seg.length == 0 || seg.buffer == nullptr || !in_sram(seg)) { return Status::invalid; }
+            }
+            if (busy()) { return Status::busy; }
+
+            s_segments = segments.data();
+            s_count = segments.size();
+            s_index = 0;
+            s_offset = 0;
+            s_cs = static_cast<uint8_t>(cs);
+            s_cont = cont;
+            s_status.store(Status::busy, std::memory_order_release);
+
+            io::reset_fifo();
+            IOM_T::FIFOTHR.write(thresholds);
+            IOM_T::DMATRIGEN.write(IOM_T::DMATRIGEN_t::DTHREN.shift(true).value | IOM_T::DMATRIGEN_t::DCMDCMPEN.shift(true).value);
+            IOM_T::INTEN.write(done_mask | irq::errors);
+            program(offset_count, offset);
+            return Status::ok;
+        }
+
+        /// single buffer write, see start()
+        static Status write(const std::span<const uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                            const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (busy()) { return Status::busy; }
+            s_single = segment::tx(data);
+            return start(std::span<const segment>(&s_single, 1), cs, cont, offset_count, offset);
+        }
+
+        /// single buffer read, see start()
+        static Status read(const std::span<uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                           const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (busy()) { return Status::busy; }
+            s_single = segment::rx(data);
+            return start(std::span<const segment>(&s_single, 1), cs, cont, offset_count, offset);
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return s_status.load(std::memory_order_acquire) == Status::busy; }
+
+        /// result of the last transfer, Status::busy while it runs
+        [[nodiscard]] static Status status() noexcept { return s_status.load(std::memory_order_acquire); }
+
+        /// number of bytes transferred so far, summed over all segments
+        [[nodiscard]] static std::size_t transferred() noexcept {
+            std::size_t total = s_offset;
+            for (std::size_t i = 0; i < s_index && i < s_count; ++i) { total += s_segments[i].length; }
+            return total;
+        }
+
+        /**
+         * sleep until the transfer is done. On target the core waits in WFI between the IOM interrupts, with
+         * interrupts masked around the check so the last one can not slip in between busy() and WFI; a pending
+         * interrupt still ends WFI and is taken once they are unmasked again.
+         */
+        static Status wait() noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            while (busy()) {                        // no NVIC on the host, take the pending interrupt here
+                if (IOM_T::INTSTAT.read() & IOM_T::INTEN.read() & (done_mask | irq::errors)) { isr(); }
+            }
+#else
+            uint32_t primask;
+            __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+            while (busy()) {
+                __asm volatile ("wfi\n\tcpsie i\n\tisb\n\tcpsid i" ::: "memory");
+            }
+            __asm volatile ("msr primask, %0" :: "r"(primask) : "memory");
+#endif
+            return status();
+        }
+
+        /// account for completed commands and chain the next one. Call from the IOMn interrupt handler.
+        static void isr() noexcept {
+            const uint32_t pending = IOM_T::INTSTAT.read() & IOM_T::INTEN.read();
+            IOM_T::INTCLR.write(pending);
+            if (!busy()) { return; }
+
+            if (pending & irq::errors) {
+                finish(status_from_irq(pending));
+                return;
+            }
+            s_waiting &= ~pending;
+            if (s_waiting != 0) { return; }
+
+            s_offset += s_chunk;
+            if (s_offset == s_segments[s_index].length) {
+                s_offset = 0;
+                if (++s_index == s_count) {
+                    finish(Status::ok);
+                    return;
+                }
+            }
+            program();
+        }
+    };  // class dma_engine
+
+}   // namespace IOM
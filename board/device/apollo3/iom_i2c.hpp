@@ -0,0 +1,179 @@
+#pragma once
+
+#include "iom.hpp"
+#include "iom_clock.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace IOM {
+
+    enum class I2cSpeed : uint8_t { standard_100k, fast_400k, fast_plus_1m };
+
+    /// CLKCFG and MI2CCFG images for one bus speed
+    struct i2c_timing {
+        uint32_t clkcfg;
+        uint32_t mi2ccfg;
+    };
+
+    /**
+     * Timing for the standard bus speeds from the 48 MHz HFRC. The I2C submodule runs SCL at half the
+     * divided clock, so HFRC/2 with TOTPER+1 = 120, 30 or 12 gives 100 kHz, 400 kHz or 1 MHz. LOWPER keeps SCL low
+     * and high within the I2C minimums, which the asserts below check. Other frequencies: i2c_clkcfg().
+     */
+    constexpr i2c_timing i2c_timing_for(const I2cSpeed speed) noexcept {
+        using CLKCFG_t = registers::CLKCFG_t;
+        using MI2CCFG_t = registers::MI2CCFG_t;
+        constexpr auto clkcfg = [](const uint32_t totper, const uint32_t lowper) {
+            return (CLKCFG_t::TOTPER.shift(totper) | CLKCFG_t::LOWPER.shift(lowper) | CLKCFG_t::FSEL.shift(sfr::IOM0::FSELv::HFRC_DIV2)
+                    | CLKCFG_t::DIVEN.shift(true) | CLKCFG_t::IOCLKEN.shift(true)).value;
+        };
+        constexpr auto mi2ccfg = [](const uint32_t sdaendly, const uint32_t sclendly, const uint32_t sdadly) {
+            return (MI2CCFG_t::SMPCNT.shift(3) | MI2CCFG_t::SDAENDLY.shift(sdaendly) | MI2CCFG_t::SCLENDLY.shift(sclendly)
+                    | MI2CCFG_t::SDADLY.shift(sdadly) | MI2CCFG_t::MI2CRST.shift(true)).value;
+        };
+        switch (speed) {
+            case I2cSpeed::standard_100k:
+                return {clkcfg(119, 59), mi2ccfg(15, 0, 3)};
+            case I2cSpeed::fast_400k:     // SCL low 16 cycles, 50% would miss the 1.3 us minimum
+                return {clkcfg(29, 15), mi2ccfg(15, 2, 3)};
+            default:
+                return {clkcfg(11, 5), mi2ccfg(3, 0, 0)};
+        }
+    }
+
+    static_assert(clock_hz(i2c_timing_for(I2cSpeed::standard_100k).clkcfg, ClockMode::i2c) == 100000 && scl_timing_ok(i2c_timing_for(I2cSpeed::standard_100k).clkcfg));
+    static_assert(clock_hz(i2c_timing_for(I2cSpeed::fast_400k).clkcfg, ClockMode::i2c) == 400000 && scl_timing_ok(i2c_timing_for(I2cSpeed::fast_400k).clkcfg));
+    static_assert(clock_hz(i2c_timing_for(I2cSpeed::fast_plus_1m).clkcfg, ClockMode::i2c) == 1000000 && scl_timing_ok(i2c_timing_for(I2cSpeed::fast_plus_1m).clkcfg));
+
+    /// one entry of a batched register read. `status` is filled in by i2c_master::read_registers().
+    struct i2c_read {
+        uint16_t device;
+        uint32_t reg;
+        uint8_t  reg_bytes;     ///< 0-3 register address bytes sent before the repeated start
+        std::span<uint8_t> data;
+        Status   status = Status::busy;
+    };
+
+    /**
+     * I2C master on one IOM. Register access is a single hardware transaction: the register address goes out
+     * as the CMD offset bytes, followed by a repeated start and the read, so there is no software gap between
+     * the write and the read phase. The device address is kept in DEVCFG and only rewritten when it changes.
+     * Transfers are limited to one command (max_command_bytes).
+     */
+    template <typename IOM_T>
+    class i2c_master {
+        using io = controller<IOM_T>;
+
+        static inline uint32_t s_device = ~0u;      // DEVCFG value currently applied
+
+        static void select(const uint16_t device) noexcept {
+            if (s_device != device) {
+                IOM_T::DEVCFG.write(IOM_T::DEVCFG_t::DEVADDR.shift(device).value);
+                s_device = device;
+            }
+        }
+
+        [[nodiscard]] static bool valid(const std::size_t size, const unsigned offset_count) noexcept {
+            return size != 0 && size <= max_command_bytes && offset_count <= 3;
+        }
+
+        /// after a failed command let the IOM finish its STOP and flush the FIFO, otherwise the next command sees stale data
+        static Status recover(const Status result) noexcept {
+            if (result != Status::ok) {
+                for (uint32_t spin = default_spin_limit; io::active() && spin != 0; --spin) { }
+                io::reset_fifo();
+            }
+            return result;
+        }
+
+    public:
+        /// configure the IOM as I2C master. The IOM must be powered, see IOM::power().
+        static void init(const i2c_timing timing, const bool ten_bit_address = false) noexcept {
+            IOM_T::SUBMODCTRL.write(0);
+            IOM_T::INTEN.write(0);
+            IOM_T::CLKCFG.write(timing.clkcfg);
+            IOM_T::MI2CCFG.write(timing.mi2ccfg | IOM_T::MI2CCFG_t::ADDRSZ.shift(ten_bit_address).value);
+            IOM_T::SUBMODCTRL.write((registers::SUBMODCTRL_t::SMOD1EN.shift(true) | registers::SUBMODCTRL_t::SMOD1TYPE.shift(sfr::IOM0::SMOD1TYPEv::I2C_MASTER)).value);
+            s_device = ~0u;
+            io::reset_fifo();
+        }
+
+        static void init(const I2cSpeed speed = I2cSpeed::fast_400k, const bool ten_bit_address = false) noexcept {
+            init(i2c_timing_for(speed), ten_bit_address);
+        }
+
+        /// turn the I2C submodule and its clock off
+        static void deinit() noexcept {
+            IOM_T::SUBMODCTRL.write(0);
+            IOM_T::CLKCFG.write(0);
+        }
+
+        /**
+         * write `data` to `device`, preceded by `offset_count` (0-3) bytes of `offset`, most significant first.
+         * With `cont` no STOP is sent so the next command starts with a repeated start.
+         */
+        static Status write(const uint16_t device, const std::span<const uint8_t> data, const bool cont = false,
+                            const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (!valid(data.size(), offset_count)) { return Status::invalid; }
+            select(device);
+            return recover(io::run(Command::WRITE, data.data(), nullptr, data.size(), 0, cont, offset_count, offset));
+        }
+
+        /// read from `device`. With offset bytes this is write-offset, repeated start, read in one transaction.
+        static Status read(const uint16_t device, const std::span<uint8_t> data, const bool cont = false,
+                           const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (!valid(data.size(), offset_count)) { return Status::invalid; }
+            select(device);
+            return recover(io::run(Command::READ, nullptr, data.data(), data.size(), 0, cont, offset_count, offset));
+        }
+
+        /// read `data.size()` bytes starting at register `reg` (reg_bytes wide)
+        static Status read_register(const uint16_t device, const uint32_t reg, const std::span<uint8_t> data, const unsigned reg_bytes = 1) noexcept {
+            return read(device, data, false, reg_bytes, reg);
+        }
+
+        /// write `data` starting at register `reg` (reg_bytes wide)
+        static Status write_register(const uint16_t device, const uint32_t reg, const std::span<const uint8_t> data, const unsigned reg_bytes = 1) noexcept {
+            return write(device, data, false, reg_bytes, reg);
+        }
+
+        /**
+         * read a list of {device, register, length} tuples back to back. The FIFO is drained while each read
+         * is on the bus, so between two reads the CPU only pops the last word, updates DEVCFG if the device
+         * changed and issues the next CMD. A NAK fails only its own entry. Returns the number of entries read.
+         */
+        static std::size_t read_registers(const std::span<i2c_read> batch) noexcept {
+            std::size_t ok = 0;
+            io::reset_fifo();
+            for (i2c_read& r : batch) {
+                if (!valid(r.data.size(), r.reg_bytes)) {
+                    r.status = Status::invalid;
+                    continue;
+                }
+                select(r.device);
+                io::issue(command_word(Command::READ, r.data.size(), 0, false, r.reg_bytes, r.reg), r.reg);
+
+                std::size_t popped = 0;
+                uint32_t spin = default_spin_limit;
+                Status result = Status::ok;
+                while (popped < r.data.size()) {
+                    const std::size_t n = io::drain(r.data.data() + popped, r.data.size() - popped);
+                    popped += n;
+                    if (n == 0) {
+                        if ((result = io::check()) != Status::ok) { break; }
+                        if (spin-- == 0) {
+                            result = Status::timeout;
+                            break;
+                        }
+                    }
+                }
+                if (result == Status::ok) { result = io::wait(irq::cmdcmp); }
+                r.status = recover(result);
+                ok += (result == Status::ok);
+            }
+            return ok;
+        }
+    };  // class i2c_master
+
+}   // namespace IOM
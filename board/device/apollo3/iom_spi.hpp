@@ -0,0 +1,190 @@
+#pragma once
+
+#include "iom.hpp"
+#include "iom_clock.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace IOM {
+
+    /// SPI clock polarity/phase. Bit 0 is MSPICFG.SPOL, bit 1 is MSPICFG.SPHA.
+    enum class SpiMode : uint8_t { mode0 = 0x0, mode1 = 0x2, mode2 = 0x1, mode3 = 0x3 };
+
+    /// MSPICFG image for a mode; `full_duplex` is applied per transfer by spi_master::transfer()
+    constexpr uint32_t mspicfg(const SpiMode mode, const bool lsb_first = false) noexcept {
+        using MSPICFG_t = registers::MSPICFG_t;
+        return MSPICFG_t::SPOL.shift(static_cast<uint32_t>(mode) & 1u).value | MSPICFG_t::SPHA.shift(static_cast<uint32_t>(mode) >> 1).value
+             | MSPICFG_t::SPILSB.shift(lsb_first).value;
+    }
+
+    /**
+     * SPI master on one IOM. Transfers are split into commands of at most max_chunk_bytes that are chained
+     * with CONT so the chip select stays asserted, and the FIFO is serviced a word at a time straight from and
+     * into the caller's spans. The write FIFO is primed before CMD is issued so the first clock is not held
+     * back by the CPU.
+     *
+     * read()/write()/transfer() poll the FIFO and return when the transfer is done. start_read()/start_write()
+     * return immediately and let isr() service the FIFO from the THR (half full/half empty) and CMDCMP
+     * interrupts; call isr() from the IOMn interrupt handler and poll busy()/status() or wait().
+     */
+    template <typename IOM_T>
+    class spi_master {
+        using io = controller<IOM_T>;
+
+        static constexpr uint32_t full_duplex_bit = IOM_T::MSPICFG_t::FULLDUP.mask;
+        static constexpr uint32_t write_threshold = IOM_T::FIFOTHR_t::FIFOWTHR.shift(fifo_bytes / 2).value;
+        static constexpr uint32_t read_threshold = IOM_T::FIFOTHR_t::FIFORTHR.shift(fifo_bytes / 2).value;
+
+        // state of the transfer serviced by isr()
+        static inline const uint8_t* s_tx = nullptr;
+        static inline uint8_t* s_rx = nullptr;
+        static inline std::size_t s_size = 0;       // bytes in the whole transfer
+        static inline std::size_t s_issued = 0;     // bytes covered by commands issued so far
+        static inline std::size_t s_moved = 0;      // bytes pushed or popped so far
+        static inline uint8_t s_cs = 0;
+        static inline bool s_cont = false;
+        static inline std::atomic<Status> s_status{Status::ok};
+
+    public:
+        /**
+         * configure the IOM as SPI master. `clk` is a CLKCFG image, e.g. clkcfg(FSELv::HFRC) for 48 MHz, or
+         * spi_clkcfg<HZ>() for the fastest setting not above HZ. The IOM must be powered, see IOM::power().
+         */
+        static void init(const uint32_t clk, const SpiMode mode = SpiMode::mode0, const bool lsb_first = false) noexcept {
+            IOM_T::SUBMODCTRL.write(0);
+            IOM_T::INTEN.write(0);
+            IOM_T::CLKCFG.write(clk);
+            IOM_T::MSPICFG.write(mspicfg(mode, lsb_first));
+            IOM_T::SUBMODCTRL.write(IOM_T::SUBMODCTRL_t::SMOD0EN.shift(true).value);    // SMOD0TYPE reads back SPI_MASTER
+            io::reset_fifo();
+        }
+
+        /// turn the SPI submodule and its clock off
+        static void deinit() noexcept {
+            IOM_T::INTEN.write(0);
+            IOM_T::SUBMODCTRL.write(0);
+            IOM_T::CLKCFG.write(0);
+        }
+
+        /**
+         * send `data` after `offset_count` (0-3) instruction/address bytes taken from `offset`, most significant
+         * byte first. With `cont` the chip select stays asserted for a following command.
+         */
+        static Status write(const std::span<const uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                            const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (data.empty() || offset_count > 3) { return Status::invalid; }
+            return io::run(Command::WRITE, data.data(), nullptr, data.size(), cs, cont, offset_count, offset);
+        }
+
+        /// clock `data.size()` bytes in after the instruction/address bytes, see write()
+        static Status read(const std::span<uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                           const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (data.empty() || offset_count > 3) { return Status::invalid; }
+            return io::run(Command::READ, nullptr, data.data(), data.size(), cs, cont, offset_count, offset);
+        }
+
+        /// full-duplex exchange of tx.size() bytes; rx must be the same size
+        static Status transfer(const std::span<const uint8_t> tx, const std::span<uint8_t> rx, const unsigned cs = 0,
+                               const bool cont = false) noexcept {
+            if (tx.empty() || tx.size() != rx.size()) { return Status::invalid; }
+            IOM_T::MSPICFG |= full_duplex_bit;
+            const Status result = io::run(Command::WRITE, tx.data(), rx.data(), tx.size(), cs, cont, 0, 0);
+            IOM_T::MSPICFG &= ~full_duplex_bit;
+            return result;
+        }
+
+        /// start an interrupt driven write, see write(). `data` must stay valid until busy() is false.
+        static Status start_write(const std::span<const uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                                  const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (data.empty() || offset_count > 3) { return Status::invalid; }
+            if (busy()) { return Status::busy; }
+            return start(Command::WRITE, data.data(), nullptr, data.size(), cs, cont, offset_count, offset);
+        }
+
+        /// start an interrupt driven read, see read(). `data` is filled in place and valid once busy() is false.
+        static Status start_read(const std::span<uint8_t> data, const unsigned cs = 0, const bool cont = false,
+                                 const unsigned offset_count = 0, const uint32_t offset = 0) noexcept {
+            if (data.empty() || offset_count > 3) { return Status::invalid; }
+            if (busy()) { return Status::busy; }
+            return start(Command::READ, nullptr, data.data(), data.size(), cs, cont, offset_count, offset);
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return s_status.load(std::memory_order_acquire) == Status::busy; }
+
+        /// result of the last interrupt driven transfer, Status::busy while it runs
+        [[nodiscard]] static Status status() noexcept { return s_status.load(std::memory_order_acquire); }
+
+        /// spin until the interrupt driven transfer is done
+        static Status wait() noexcept {
+            while (busy()) { }
+            return status();
+        }
+
+        /// service the FIFO and chain the next command. Call from the IOMn interrupt handler.
+        static void isr() noexcept {
+            const uint32_t pending = IOM_T::INTSTAT.read() & IOM_T::INTEN.read();
+            IOM_T::INTCLR.write(pending);
+            if (!busy()) { return; }
+
+            if (pending & irq::errors) {
+                finish(status_from_irq(pending));
+                return;
+            }
+            service();
+            if (!(pending & irq::cmdcmp)) { return; }
+
+            if (s_moved < s_issued) { return; }     // more data is still in flight
+            if (s_issued == s_size) {
+                finish(Status::ok);
+                return;
+            }
+            const Command cmd = s_tx ? Command::WRITE : Command::READ;
+            const uint32_t word = chunk_command(cmd, s_issued, s_size, s_cs, s_cont);
+            s_issued += std::min(s_size - s_issued, max_chunk_bytes);
+            service();
+            if (s_tx && s_moved < s_issued) { IOM_T::FIFOTHR.write(write_threshold); }
+            io::issue(word);
+        }
+
+    private:
+        static Status start(const Command cmd, const uint8_t* tx, uint8_t* rx, const std::size_t size, const unsigned cs,
+                            const bool cont, const unsigned offset_count, const uint32_t offset) noexcept {
+            s_tx = tx;
+            s_rx = rx;
+            s_size = size;
+            s_moved = 0;
+            s_cs = static_cast<uint8_t>(cs);
+            s_cont = cont;
+            s_status.store(Status::busy, std::memory_order_release);
+
+            io::reset_fifo();
+            const uint32_t word = chunk_command(cmd, 0, size, cs, cont, offset_count, offset);
+            s_issued = std::min(size, max_chunk_bytes);
+            IOM_T::FIFOTHR.write(tx ? write_threshold : read_threshold);
+            service();
+            IOM_T::INTEN.write(irq::cmdcmp | irq::thr | irq::errors);
+            io::issue(word, offset);
+            return Status::ok;
+        }
+
+        /// move data between the FIFO and the buffer for the commands issued so far
+        static void service() noexcept {
+            if (s_tx) {
+                s_moved += io::fill(s_tx + s_moved, s_issued - s_moved);
+                if (s_moved == s_issued) { IOM_T::FIFOTHR.write(0); }   // nothing left to push, stop the THR interrupts
+            } else {
+                s_moved += io::drain(s_rx + s_moved, s_issued - s_moved);
+            }
+        }
+
+        static void finish(const Status result) noexcept {
+            IOM_T::INTEN.write(0);
+            IOM_T::FIFOTHR.write(0);
+            s_status.store(result, std::memory_order_release);
+        }
+    };  // class spi_master
+
+}   // namespace IOM
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "IOSLAVE.hpp"
+#include "critical_section.hpp"
+#include "ring_buffer.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * Driver for the I2C/SPI slave. The host sees 256 bytes of LRAM: a direct access area it can read and write
+ * like a register file, a read-only area the firmware fills, and a FIFO it drains through host address 0x7F.
+ * The CPU reaches the same LRAM at the start of the IOSLAVE block.
+ */
+namespace IOS {
+
+    enum class Interface : uint8_t { i2c = 0, spi = 1 };
+
+    /// register layout of the IO slave, for field definitions outside the driver templated on it
+    using registers = sfr::IOSLAVE_t<0x50000000>;
+
+    constexpr std::size_t lram_bytes = 256;
+    constexpr std::size_t host_window = 0x78;       // host offsets above are the interrupt, FIFOCTR and FIFO registers
+
+    /// INTEN/INTSTAT/INTCLR bits
+    namespace irq {
+        using INTSTAT_t = registers::INTSTAT_t;
+        constexpr uint32_t fsize  = INTSTAT_t::FSIZE.mask;     ///< FIFOSIZ fell below FIFOTHR
+        constexpr uint32_t fovfl  = INTSTAT_t::FOVFL.mask;
+        constexpr uint32_t fundfl = INTSTAT_t::FUNDFL.mask;    ///< the host read from an empty FIFO
+        constexpr uint32_t frderr = INTSTAT_t::FRDERR.mask;
+        constexpr uint32_t genad  = INTSTAT_t::GENAD.mask;     ///< I2C general call address received
+        constexpr uint32_t iointw = INTSTAT_t::IOINTW.mask;    ///< the host wrote the IOINT registers
+        constexpr uint32_t xcmprf = INTSTAT_t::XCMPRF.mask;    ///< host read transfer complete, FIFO access
+        constexpr uint32_t xcmprr = INTSTAT_t::XCMPRR.mask;    ///< host read transfer complete, register access
+        constexpr uint32_t xcmpwf = INTSTAT_t::XCMPWF.mask;    ///< host write transfer complete, FIFO access
+        constexpr uint32_t xcmpwr = INTSTAT_t::XCMPWR.mask;    ///< host write transfer complete, register access
+        constexpr uint32_t all    = INTSTAT_t::reset_mask;
+    }
+
+    /**
+     * Partition of the LRAM in bytes, each boundary a multiple of 8. [0, ro_base) is host read/write,
+     * [ro_base, fifo_base) host read-only and [fifo_base, fifo_end) the FIFO. The default gives the host the
+     * whole 120 byte window as registers and the upper half of the LRAM as FIFO.
+     */
+    struct layout {
+        uint16_t ro_base = host_window;
+        uint16_t fifo_base = 0x80;
+        uint16_t fifo_end = lram_bytes;
+
+        [[nodiscard]] constexpr bool valid() const noexcept {
+            return ro_base % 8 == 0 && fifo_base % 8 == 0 && fifo_end % 8 == 0 && ro_base <= host_window
+                && ro_base <= fifo_base && fifo_base < fifo_end && fifo_end <= lram_bytes && fifo_base <= 0xF8;
+        }
+
+        [[nodiscard]] constexpr uint32_t fifocfg() const noexcept {
+            using FIFOCFG_t = registers::FIFOCFG_t;
+            return (FIFOCFG_t::ROBASE.shift(ro_base / 8u) | FIFOCFG_t::FIFOMAX.shift(fifo_end / 8u) | FIFOCFG_t::FIFOBASE.shift(fifo_base / 8u)).value;
+        }
+
+        [[nodiscard]] constexpr std::size_t fifo_size() const noexcept { return fifo_end - fifo_base; }
+    };
+
+    /// power the IO slave up or down through PWRCTRL.DEVPWREN and wait for the HCPA domain to follow
+    template <typename PWRCTRL_T>
+    void power(const bool on) noexcept {
+        constexpr uint32_t bit = PWRCTRL_T::DEVPWREN_t::PWRIOS.mask;
+        constexpr uint32_t domain = PWRCTRL_T::DEVPWRSTATUS_t::HCPA.mask;
+        if (on) {
+            PWRCTRL_T::DEVPWREN |= bit;
+        } else {
+            PWRCTRL_T::DEVPWREN &= ~bit;
+        }
+        for (uint32_t spin = 1000000; spin != 0 && static_cast<bool>(PWRCTRL_T::DEVPWRSTATUS.read() & domain) != on; --spin) { }
+    }
+
+    /**
+     * IO slave with a host register map and a streaming FIFO.
+     *
+     * Register map: write_registers() puts values into the direct access or read-only area. The copy is done
+     * with FUPD.FIFOUPD set and only once FUPD.IOREAD shows no host read in progress, with interrupts masked,
+     * so a multi-byte value is never returned half updated. Host writes to the map are reported by isr().
+     *
+     * FIFO: write() queues bytes in a RING byte software ring and moves as much as fits into the LRAM FIFO.
+     * The FSIZE interrupt (FIFOSIZ below FIFOTHR) refills the LRAM FIFO from the ring while the host reads, so
+     * a burst larger than the LRAM FIFO streams without the host seeing an underrun. FIFOCTR, the byte count
+     * the host polls, is advanced through FIFOINC inside the same FUPD bracket so the host never reads it torn.
+     */
+    template <typename IOS_T, std::size_t RING = 1024>
+    class slave {
+        static constexpr uint32_t fifoupd = IOS_T::FUPD_t::FIFOUPD.mask;
+        static constexpr uint32_t ioread = IOS_T::FUPD_t::IOREAD.mask;
+
+        static inline util::spsc_ring<uint8_t, RING> s_ring{};
+        static inline layout s_layout{};
+        static inline uint16_t s_write = 0;             // LRAM offset the next FIFO byte goes to
+        static inline std::atomic<uint32_t> s_underruns{0};
+
+        static void lram_store(const std::size_t offset, const uint8_t value) noexcept {
+            sfr::store<uint8_t>(IOS_T::BaseAddress + static_cast<uint32_t>(offset), value);
+        }
+
+        [[nodiscard]] static uint8_t lram_load(const std::size_t offset) noexcept {
+            return sfr::load<uint8_t>(IOS_T::BaseAddress + static_cast<uint32_t>(offset));
+        }
+
+        /// bytes in the LRAM FIFO not yet read by the host
+        [[nodiscard]] static std::size_t fifo_level() noexcept { return IOS_T::FIFOPTR_t::FIFOSIZ.extract(IOS_T::FIFOPTR.read()); }
+
+        /// hold off until no host read is in flight and mark an update in progress
+        static void begin_update() noexcept {
+            IOS_T::FUPD.write(fifoupd);
+            for (uint32_t spin = 100000; spin != 0 && (IOS_T::FUPD.read() & ioread); --spin) { }
+        }
+
+        static void end_update() noexcept { IOS_T::FUPD.write(0); }
+
+        /// move ring bytes into the free part of the LRAM FIFO. Interrupts must be masked or this runs in isr().
+        static void refill() noexcept {
+            const std::size_t level = fifo_level();
+            std::size_t room = s_layout.fifo_size() - level;
+            std::size_t moved = 0;
+            uint8_t byte = 0;
+            while (room != 0 && s_ring.pop(byte)) {
+                lram_store(s_write, byte);
+                if (++s_write == s_layout.fifo_end) { s_write = s_layout.fifo_base; }
+                --room;
+                ++moved;
+            }
+            if (moved != 0) {
+                begin_update();
+                IOS_T::FIFOINC.write(IOS_T::FIFOINC_t::FIFOINC.shift(static_cast<uint32_t>(moved)).value);
+                end_update();
+            }
+            // FSIZE stays pending while the FIFO is low, so it is only enabled while the ring has data to give
+            const uint32_t inten = IOS_T::INTEN.read();
+            IOS_T::INTEN.write(s_ring.empty() ? (inten & ~irq::fsize) : (inten | irq::fsize));
+        }
+
+    public:
+        /**
+         * configure and enable the interface. `address` is the 7-bit I2C address (ignored for SPI), `threshold`
+         * the FIFOSIZ level in bytes below which the FIFO is refilled, 0 for half the FIFO. `events` are
+         * further interrupts to enable and report from isr(). The IO slave must be powered, see IOS::power().
+         */
+        static bool init(const Interface interface, const uint8_t address = 0, const layout map = layout{},
+                         const std::size_t threshold = 0, const uint32_t events = 0) noexcept {
+            if (!map.valid()) { return false; }
+            IOS_T::CFG.write(0);
+            IOS_T::INTEN.write(0);
+            IOS_T::INTCLR.write(irq::all);
+            s_layout = map;
+            s_write = map.fifo_base;
+            s_ring.clear();
+            IOS_T::FIFOCFG.write(map.fifocfg());
+            IOS_T::FIFOTHR.write(IOS_T::FIFOTHR_t::FIFOTHR.shift(static_cast<uint32_t>(threshold ? threshold : map.fifo_size() / 2)).value);
+            IOS_T::FIFOPTR.write(IOS_T::FIFOPTR_t::FIFOPTR.shift(map.fifo_base).value);    // empty FIFO, host read pointer at its start
+            IOS_T::FIFOCTR.write(0);
+            IOS_T::INTEN.write(irq::fundfl | irq::fovfl | events);
+            using CFG_t = typename IOS_T::CFG_t;
+            IOS_T::CFG.write((CFG_t::IFCEN.shift(true) | CFG_t::I2CADDR.shift(static_cast<uint32_t>(address) << 1u)
+                              | CFG_t::IFCSEL.shift(interface == Interface::spi)).value);
+            return true;
+        }
+
+        /// disable the interface
+        static void deinit() noexcept {
+            IOS_T::CFG.write(0);
+            IOS_T::INTEN.write(0);
+        }
+
+        /**
+         * update `data.size()` bytes of the host register map at `offset`, in the read/write or read-only area.
+         * Returns false if the range runs into the FIFO.
+         */
+        static bool write_registers(const std::size_t offset, const std::span<const uint8_t> data) noexcept {
+            if (offset + data.size() > s_layout.fifo_base) { return false; }
+            util::critical_section lock;
+            begin_update();
+            for (std::size_t i = 0; i < data.size(); ++i) { lram_store(offset + i, data[i]); }
+            end_update();
+            return true;
+        }
+
+        /// read back the register map, e.g. a value the host has written
+        static bool read_registers(const std::size_t offset, const std::span<uint8_t> data) noexcept {
+            if (offset + data.size() > s_layout.fifo_base) { return false; }
+            util::critical_section lock;
+            for (std::size_t i = 0; i < data.size(); ++i) { data[i] = lram_load(offset + i); }
+            return true;
+        }
+
+        /// enable the REGACC interrupts for `mask`, reported by isr() as host_writes()
+        static void watch(const uint32_t mask) noexcept { IOS_T::REGACCINTEN.write(mask); }
+
+        /**
+         * queue bytes for the host to read from the FIFO. Returns the number of bytes taken, less than
+         * `data.size()` when the software ring is full.
+         */
+        static std::size_t write(const std::span<const uint8_t> data) noexcept {
+            std::size_t taken = 0;
+            while (taken < data.size() && s_ring.push(data[taken])) { ++taken; }
+            util::critical_section lock;
+            refill();
+            return taken;
+        }
+
+        /// bytes still waiting for the host, in the LRAM FIFO and the software ring
+        [[nodiscard]] static std::size_t pending() noexcept {
+            return fifo_level() + s_ring.size();
+        }
+
+        /// room in the software ring
+        [[nodiscard]] static std::size_t available() noexcept { return RING - s_ring.size(); }
+
+        /// number of host reads from an empty FIFO since init()
+        [[nodiscard]] static uint32_t underruns() noexcept { return s_underruns.load(std::memory_order_relaxed); }
+
+        /// drop everything not yet read by the host and zero FIFOCTR
+        static void flush() noexcept {
+            util::critical_section lock;
+            s_ring.clear();
+            s_write = s_layout.fifo_base;
+            begin_update();
+            IOS_T::FIFOPTR.write(IOS_T::FIFOPTR_t::FIFOPTR.shift(s_layout.fifo_base).value);
+            IOS_T::FIFOCTR.write(0);
+            end_update();
+            IOS_T::INTEN &= ~irq::fsize;
+        }
+
+        /// REGACC bits of host register accesses since the last call. Call from the IOSLAVEACC interrupt handler or poll.
+        [[nodiscard]] static uint32_t host_writes() noexcept {
+            const uint32_t pending = IOS_T::REGACCINTSTAT.read();
+            IOS_T::REGACCINTCLR.write(pending);
+            return pending;
+        }
+
+        /// refill the FIFO and count underruns. Call from the IOSLAVE interrupt handler. Returns the other
+        /// pending interrupt bits enabled through init(), e.g. irq::xcmpwr after a host register write.
+        static uint32_t isr() noexcept {
+            const uint32_t pending = IOS_T::INTSTAT.read() & IOS_T::INTEN.read();
+            IOS_T::INTCLR.write(pending);
+            if (pending & irq::fundfl) { s_underruns.fetch_add(1, std::memory_order_relaxed); }
+            if (pending & irq::fsize) { refill(); }
+            return pending & ~(irq::fsize | irq::fundfl | irq::fovfl);
+        }
+    };  // class slave
+
+}   // namespace IOS
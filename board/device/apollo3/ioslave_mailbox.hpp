@@ -0,0 +1,177 @@
+#pragma once
+
+#include "critical_section.hpp"
+#include "ioslave.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace IOS {
+
+    /// when a batch of events is handed to the host
+    struct batch_policy {
+        uint16_t max_bytes = 96;        ///< flush once this many bytes are staged (throughput)
+        uint16_t max_events = 16;       ///< flush once this many events are staged
+        uint32_t max_latency = 0;       ///< flush when the oldest event is this many ticks old, 0 = no deadline
+        uint8_t  host_interrupt = 0;    ///< IOINT bit (0-7) raised when data is ready
+    };
+
+    /**
+     * Event mailbox between the sensor hub and the host on top of IOS::slave. Events are framed as
+     * [type][length][payload] and staged in SRAM; a batch goes to the FIFO in one burst with one host interrupt
+     * when the byte or event count of the policy is reached, when the oldest event exceeds max_latency, or for
+     * an urgent event. While the host has not yet cleared the previous interrupt, further batches only extend
+     * the FIFO, so the host is woken at most once per read.
+     *
+     * The host side: on the IOINT line read FIFOCTR, burst that many bytes from the FIFO, clear IOINT. The
+     * host sends commands by writing the inbox registers [inbox, inbox + INBOX) of the register map; isr()
+     * hands them to the command handler once the write completes.
+     *
+     * post() may be called from any context. service() checks the latency deadline and must be called
+     * periodically with a monotonic tick count, e.g. from the main loop or a timer interrupt.
+     */
+    template <typename IOS_T, typename SLAVE = slave<IOS_T>, std::size_t STAGE = 256, std::size_t INBOX = 8>
+    class mailbox {
+        static_assert(STAGE >= 8 && STAGE <= 65535, "mailbox stage size out of range");
+
+        using IOINTCTL_t = typename IOS_T::IOINTCTL_t;
+
+        static inline std::array<uint8_t, STAGE> s_stage{};
+        static inline std::size_t s_staged = 0;
+        static inline uint16_t s_events = 0;
+        static inline std::size_t s_partial = 0;        // bytes at the start of the stage left of a cut frame
+        static inline uint32_t s_oldest = 0;            // tick of the first staged event
+        static inline uint32_t s_now = 0;               // tick of the last post() or service()
+        static inline batch_policy s_policy{};
+        static inline uint8_t s_inbox = 0;
+        static inline void (*s_command)(std::span<const uint8_t>) = nullptr;
+        static inline uint32_t s_batches = 0;
+        static inline uint32_t s_interrupts = 0;
+        static inline uint32_t s_dropped = 0;
+
+        [[nodiscard]] static bool due() noexcept {
+            return s_staged >= s_policy.max_bytes || s_events >= s_policy.max_events;
+        }
+
+        /// re-count the frames left after the first `taken` bytes of the stage are delivered, a cut one included
+        static void count_remaining(const std::size_t taken) noexcept {
+            uint16_t frames = 0;
+            std::size_t cut = 0;
+            for (std::size_t at = 0; at < s_staged;) {
+                const std::size_t end = (at == 0 && s_partial != 0) ? s_partial : at + 2u + s_stage[at + 1];
+                if (end > taken) {
+                    ++frames;
+                    if (at < taken) { cut = end - taken; }
+                }
+                at = end;
+            }
+            s_events = frames;
+            s_partial = cut;
+        }
+
+        /**
+         * hand the staged bytes to the FIFO and raise the host interrupt. Interrupts must be masked. When the
+         * FIFO ring takes only part of the stage, the rest counts as a new batch staged at `now`, so it waits
+         * out the latency again rather than being pushed on every service().
+         */
+        static void deliver(const uint32_t now) noexcept {
+            if (s_staged == 0) { return; }
+            const std::size_t taken = SLAVE::write(std::span<const uint8_t>(s_stage.data(), s_staged));
+            if (taken == 0) { return; }     // FIFO ring full, retry on the next service()
+            count_remaining(taken);
+            std::memmove(s_stage.data(), s_stage.data() + taken, s_staged - taken);
+            s_staged -= taken;
+            s_oldest = now;
+            ++s_batches;
+
+            const uint32_t bit = 1u << (s_policy.host_interrupt & 0x7u);
+            const uint32_t iointctl = IOS_T::IOINTCTL.read();
+            if (!(IOINTCTL_t::IOINT.extract(iointctl) & bit)) {     // raise it unless the host still has the last one pending
+                IOS_T::IOINTCTL.write((IOINTCTL_t::IOINTSET.shift(bit) | IOINTCTL_t::IOINTEN.shift(IOINTCTL_t::IOINTEN.extract(iointctl))).value);
+                ++s_interrupts;
+            }
+        }
+
+    public:
+        /**
+         * set the batching policy and the inbox for host commands at register map offset `inbox`. The slave
+         * must be initialised with irq::xcmpwr in its events for the inbox to work.
+         */
+        static void init(const batch_policy policy = batch_policy{}, const uint8_t inbox = 0,
+                         void (*command)(std::span<const uint8_t>) = nullptr) noexcept {
+            util::critical_section lock;
+            s_policy = policy;
+            if (s_policy.max_bytes > STAGE) { s_policy.max_bytes = STAGE; }
+            s_inbox = inbox;
+            s_command = command;
+            s_staged = 0;
+            s_events = 0;
+            s_partial = 0;
+            const uint32_t iointctl = IOS_T::IOINTCTL.read();
+            IOS_T::IOINTCTL.write((IOINTCTL_t::IOINTCLR.shift(true) | IOINTCTL_t::IOINTEN.shift(IOINTCTL_t::IOINTEN.extract(iointctl))).value);
+        }
+
+        /**
+         * stage an event with `now` as its tick. Returns false if it does not fit even after a flush.
+         * `urgent` delivers the batch right away, e.g. for a threshold crossing the host must see now.
+         */
+        static bool post(const uint8_t type, const std::span<const uint8_t> payload, const uint32_t now, const bool urgent = false) noexcept {
+            const std::size_t frame = payload.size() + 2;
+            if (payload.size() > 255 || frame > STAGE) { return false; }
+            util::critical_section lock;
+            s_now = now;
+            if (s_staged + frame > STAGE) { deliver(now); }
+            if (s_staged + frame > STAGE) {
+                ++s_dropped;
+                return false;
+            }
+            if (s_staged == 0) { s_oldest = now; }
+            s_stage[s_staged++] = type;
+            s_stage[s_staged++] = static_cast<uint8_t>(payload.size());
+            std::memcpy(s_stage.data() + s_staged, payload.data(), payload.size());
+            s_staged += payload.size();
+            ++s_events;
+            if (urgent || due()) { deliver(now); }
+            return true;
+        }
+
+        /// deliver the staged events if the oldest one has waited max_latency ticks, or a retry is pending
+        static void service(const uint32_t now) noexcept {
+            util::critical_section lock;
+            s_now = now;
+            if (s_staged == 0) { return; }
+            if (due() || (s_policy.max_latency != 0 && now - s_oldest >= s_policy.max_latency)) { deliver(now); }
+        }
+
+        /// deliver whatever is staged now
+        static void flush() noexcept {
+            util::critical_section lock;
+            deliver(s_now);
+        }
+
+        /// run SLAVE::isr() and pass completed host writes to the inbox to the command handler. Call from the
+        /// IOSLAVE interrupt handler instead of SLAVE::isr(); returns the bits left for the application.
+        static uint32_t isr() noexcept {
+            uint32_t pending = SLAVE::isr();
+            if ((pending & irq::xcmpwr) && s_command != nullptr) {
+                std::array<uint8_t, INBOX> command{};
+                if (SLAVE::read_registers(s_inbox, command)) { s_command(command); }
+                pending &= ~irq::xcmpwr;
+            }
+            return pending;
+        }
+
+        [[nodiscard]] static std::size_t staged() noexcept { return s_staged; }
+
+        /// events with bytes still in the stage, a frame cut by a partial delivery included
+        [[nodiscard]] static uint16_t staged_events() noexcept { return s_events; }
+
+        /// batches handed to the FIFO, host interrupts raised and events dropped because the stage was full
+        [[nodiscard]] static uint32_t batches() noexcept { return s_batches; }
+        [[nodiscard]] static uint32_t interrupts() noexcept { return s_interrupts; }
+        [[nodiscard]] static uint32_t dropped() noexcept { return s_dropped; }
+    };  // class mailbox
+
+}   // namespace IOS
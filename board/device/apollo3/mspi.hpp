@@ -0,0 +1,251 @@
+#pragma once
+
+#include "MSPI.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+/**
+ * Pieces shared by the multi-bit SPI master drivers: the device configuration (frame format, clock, pads and
+ * the instructions used for XIP and automatic DMA) and programmed IO commands through the 16 word FIFOs.
+ */
+namespace MSPI {
+
+    /// outcome of an MSPI operation
+    enum class Status : uint8_t {
+        ok,
+        busy,           ///< a transfer is still in flight
+        dma_error,      ///< DMA bus error
+        scramble_error, ///< scrambled access to a device address that is not word aligned
+        timeout,        ///< the command did not complete within the spin limit
+        invalid,        ///< bad arguments, nothing was started
+    };
+
+    using Frame = sfr::MSPI::DEVCFGv;
+    using Divider = sfr::MSPI::CLKDIVv;
+    using Ack = sfr::MSPI::XIPACKv;
+
+    /// register layout of the MSPI, for field definitions outside the drivers templated on it
+    using registers = sfr::MSPI_t<0x50014000>;
+
+    constexpr uint32_t xip_base = 0x04000000;       // external flash/RAM as seen by the core in XIP mode
+    constexpr std::size_t xip_size = 0x04000000;
+    constexpr std::size_t fifo_words = 16;          // per direction
+    constexpr std::size_t max_pio_bytes = 65535;    // CTRL.XFERBYTES
+    constexpr uint32_t default_spin_limit = 1000000;
+
+    /// INTEN/INTSTAT/INTCLR bits
+    namespace irq {
+        using INTSTAT_t = registers::INTSTAT_t;
+        constexpr uint32_t cmdcmp   = INTSTAT_t::CMDCMP.mask;
+        constexpr uint32_t txe      = INTSTAT_t::TXE.mask;
+        constexpr uint32_t txo      = INTSTAT_t::TXO.mask;
+        constexpr uint32_t rxu      = INTSTAT_t::RXU.mask;
+        constexpr uint32_t rxo      = INTSTAT_t::RXO.mask;
+        constexpr uint32_t rxf      = INTSTAT_t::RXF.mask;
+        constexpr uint32_t dcmp     = INTSTAT_t::DCMP.mask;
+        constexpr uint32_t derr     = INTSTAT_t::DERR.mask;
+        constexpr uint32_t cqcmp    = INTSTAT_t::CQCMP.mask;
+        constexpr uint32_t cqupd    = INTSTAT_t::CQUPD.mask;
+        constexpr uint32_t cqpaused = INTSTAT_t::CQPAUSED.mask;
+        constexpr uint32_t cqerr    = INTSTAT_t::CQERR.mask;
+        constexpr uint32_t screrr   = INTSTAT_t::SCRERR.mask;
+        constexpr uint32_t all      = INTSTAT_t::reset_mask;
+    }
+
+    /// lines used by XIP and automatic DMA on top of a serial DEVCFG: 1-1-2, 1-2-2, 1-1-4 or 1-4-4 reads
+    enum class Mixed : uint8_t { normal = 0, d2 = 1, ad2 = 3, d4 = 5, ad4 = 7 };
+
+    /**
+     * Bus setup for one external device. Programmed IO commands use the DEVCFG frame format; XIP and automatic
+     * DMA send read_instruction/write_instruction, the address and `turnaround` dummy clocks, optionally with
+     * the address and data phases widened by `mixed`.
+     */
+    struct device_config {
+        Frame    frame = Frame::SERIAL0;
+        Divider  divider = Divider::CLK24;
+        uint8_t  address_bytes = 3;         ///< 1-4
+        uint8_t  turnaround = 8;            ///< dummy clocks between address and read data
+        Mixed    mixed = Mixed::normal;
+        uint8_t  read_instruction = 0x0B;   ///< fast read
+        uint8_t  write_instruction = 0x02;  ///< page program
+        Ack      ack = Ack::NOACK;          ///< Micron XIP confirmation bit
+        bool     cpol = false;
+        bool     cpha = false;
+        uint32_t padcfg = 0;                ///< PADCFG image, pad swaps for boards that route the data lines differently
+
+        [[nodiscard]] constexpr bool valid() const noexcept {
+            return address_bytes >= 1 && address_bytes <= 4 && turnaround < 64;
+        }
+
+        [[nodiscard]] constexpr bool chip_select1() const noexcept {
+            return (static_cast<uint32_t>(frame) & 0x3u) == 0x2u;
+        }
+
+        [[nodiscard]] constexpr uint32_t cfg() const noexcept {
+            using CFG_t = registers::CFG_t;
+            return (CFG_t::CPOL.shift(cpol) | CFG_t::CPHA.shift(cpha) | CFG_t::TURNAROUND.shift(turnaround)
+                    | CFG_t::ASIZE.shift(static_cast<sfr::MSPI::ASIZEv>(address_bytes - 1u)) | CFG_t::DEVCFG.shift(frame)).value;
+        }
+
+        /// PADOUTEN: clock plus the data lines the widest phase drives
+        [[nodiscard]] constexpr uint32_t padouten() const noexcept {
+            using OUTENv = sfr::MSPI::OUTENv;
+            constexpr uint32_t clock = 1u << 8;
+            const uint32_t f = static_cast<uint32_t>(frame);
+            uint32_t lines = 0x3u;                                              // serial and dual
+            if (f >= 0xD || f == 0x3) { return registers::PADOUTEN_t::OUTEN.shift(OUTENv::OCTAL).value; }  // octal and paired quad
+            if (f >= 0x9 || mixed == Mixed::d4 || mixed == Mixed::ad4) { lines = 0xFu; }
+            return registers::PADOUTEN_t::OUTEN.shift(static_cast<OUTENv>(clock | (chip_select1() ? (lines << 4) : lines))).value;
+        }
+
+        [[nodiscard]] constexpr uint32_t flash(const bool xip) const noexcept {
+            using FLASH_t = registers::FLASH_t;
+            return (FLASH_t::READINSTR.shift(read_instruction) | FLASH_t::WRITEINSTR.shift(write_instruction)
+                    | FLASH_t::XIPMIXED.shift(static_cast<uint32_t>(mixed)) | FLASH_t::XIPSENDI.shift(true) | FLASH_t::XIPSENDA.shift(true)
+                    | FLASH_t::XIPENTURN.shift(turnaround != 0) | FLASH_t::XIPACK.shift(ack) | FLASH_t::XIPEN.shift(xip)).value;
+        }
+
+        /// MSPICFG without the reset bits: no IOM handshake, data sampled on the next rising edge
+        [[nodiscard]] constexpr uint32_t mspicfg() const noexcept {
+            using MSPICFG_t = registers::MSPICFG_t;
+            return (MSPICFG_t::CLKDIV.shift(divider) | MSPICFG_t::IOMSEL.shift(sfr::MSPI::IOMSELv::DISABLED) | MSPICFG_t::RXCAP.shift(true)).value;
+        }
+    };
+
+    /// power the MSPI up or down through PWRCTRL.DEVPWREN and wait for its domain to follow
+    template <typename PWRCTRL_T>
+    void power(const bool on) noexcept {
+        constexpr uint32_t bit = PWRCTRL_T::DEVPWREN_t::PWRMSPI.mask;
+        constexpr uint32_t domain = PWRCTRL_T::DEVPWRSTATUS_t::PWRMSPI.mask;
+        if (on) {
+            PWRCTRL_T::DEVPWREN |= bit;
+        } else {
+            PWRCTRL_T::DEVPWREN &= ~bit;
+        }
+        for (uint32_t spin = default_spin_limit; spin != 0 && static_cast<bool>(PWRCTRL_T::DEVPWRSTATUS.read() & domain) != on; --spin) { }
+    }
+
+    /**
+     * Low level access to the MSPI: configuration and programmed IO commands with the CPU servicing the FIFOs,
+     * used for device setup, status polling and anything too short to be worth a DMA.
+     */
+    template <typename MSPI_T>
+    struct controller {
+        using CTRL_t = typename MSPI_T::CTRL_t;
+
+        static constexpr uint32_t ctrl_start = CTRL_t::START.mask;
+        static constexpr uint32_t ctrl_status = CTRL_t::STATUS.mask;    // command complete, cleared by the next START
+        static constexpr uint32_t ctrl_busy = CTRL_t::BUSY.mask;
+
+        /**
+         * reset the MSPI and program it for `device`. XIP stays off; the FLASH instructions are set so automatic
+         * DMA can be used right away.
+         */
+        static bool configure(const device_config& device) noexcept {
+            if (!device.valid()) { return false; }
+            using MSPICFG_t = typename MSPI_T::MSPICFG_t;
+            constexpr uint32_t prstn = MSPICFG_t::PRSTN.mask, iprstn = MSPICFG_t::IPRSTN.mask, fiforeset = MSPICFG_t::FIFORESET.mask;
+            MSPI_T::FLASH.write(device.flash(false));
+            MSPI_T::MSPICFG.write(device.mspicfg() | fiforeset);
+            MSPI_T::MSPICFG.write(device.mspicfg() | prstn | iprstn);
+            MSPI_T::CFG.write(device.cfg());
+            MSPI_T::PADCFG.write(device.padcfg);
+            MSPI_T::PADOUTEN.write(device.padouten());
+            MSPI_T::INTCLR.write(irq::all);
+            return true;
+        }
+
+        /// true while a programmed IO command is executing
+        [[nodiscard]] static bool busy() noexcept { return MSPI_T::CTRL.read() & ctrl_busy; }
+
+        /**
+         * run one programmed IO command: `instruction`, then `address_bytes` of `address` if `send_address`,
+         * then `size` data bytes, written from `tx` or read into `rx` after the CFG.TURNAROUND dummy clocks
+         * when `turnaround` is set. `paired` replicates a write to both devices in paired quad mode.
+         */
+        static Status command(const uint8_t instruction, const uint8_t* tx, uint8_t* rx, const std::size_t size,
+                              const bool send_address = false, const uint32_t address = 0, const bool turnaround = false,
+                              const bool paired = false, uint32_t spin_limit = default_spin_limit) noexcept {
+            if (size > max_pio_bytes || (tx && rx) || (size != 0 && !tx && !rx)) { return Status::invalid; }
+            MSPI_T::ADDR.write(address);
+            MSPI_T::INSTR.write(instruction);
+            MSPI_T::CTRL.write((CTRL_t::XFERBYTES.shift(static_cast<uint32_t>(size)) | CTRL_t::TXRX.shift(rx == nullptr) | CTRL_t::SENDI.shift(true)
+                                | CTRL_t::SENDA.shift(send_address) | CTRL_t::ENTURN.shift(turnaround) | CTRL_t::QUADCMD.shift(paired)
+                                | CTRL_t::START.shift(true)).value);
+
+            std::size_t done = 0;
+            while (done < size) {
+                const std::size_t moved = tx ? fill(tx + done, size - done) : drain(rx + done, size - done);
+                done += moved;
+                if (moved == 0 && spin_limit-- == 0) { return Status::timeout; }
+            }
+            while (!(MSPI_T::CTRL.read() & ctrl_status)) {
+                if (spin_limit-- == 0) { return Status::timeout; }
+            }
+            return Status::ok;
+        }
+
+        /// instruction only, e.g. write enable or reset
+        static Status command(const uint8_t instruction) noexcept { return command(instruction, nullptr, nullptr, 0); }
+
+        /// instruction followed by `data`, e.g. a status register write
+        static Status write(const uint8_t instruction, const std::span<const uint8_t> data) noexcept {
+            return command(instruction, data.data(), nullptr, data.size());
+        }
+
+        /// instruction followed by reading `data`, e.g. the JEDEC ID or a status register
+        static Status read(const uint8_t instruction, const std::span<uint8_t> data) noexcept {
+            return command(instruction, nullptr, data.data(), data.size());
+        }
+
+        /**
+         * read the status register with `instruction` and test it against `mask`, e.g. the write in progress bit.
+         * Paired quad devices answer together with one nibble of each in every byte, so both bytes are read there.
+         */
+        static Status device_busy(const uint8_t instruction, const uint8_t mask, const bool paired, bool& busy) noexcept {
+            uint8_t status[2] = {};
+            const Status s = command(instruction, nullptr, status, paired ? 2 : 1);
+            if (!paired) {
+                busy = status[0] & mask;
+            } else {
+                const uint8_t low = mask & 0x0Fu;
+                const uint8_t high = static_cast<uint8_t>(mask >> 4);
+                busy = (status[1] & (low | (low << 4))) || (status[0] & (high | (high << 4)));
+            }
+            return s;
+        }
+
+    private:
+        /// push whole words while the TX FIFO has room, the last 1-3 bytes padded. Returns the bytes consumed.
+        static std::size_t fill(const uint8_t* data, const std::size_t remaining) noexcept {
+            std::size_t room = fifo_words - MSPI_T::TXENTRIES_t::TXENTRIES.extract(MSPI_T::TXENTRIES.read());
+            std::size_t done = 0;
+            while (room != 0 && done < remaining) {
+                uint32_t word = 0;
+                const std::size_t n = (remaining - done < 4) ? remaining - done : 4;
+                std::memcpy(&word, data + done, n);
+                MSPI_T::TXFIFO.write(word);
+                done += n;
+                --room;
+            }
+            return done;
+        }
+
+        /// pop the words available in the RX FIFO. Returns the bytes stored.
+        static std::size_t drain(uint8_t* data, const std::size_t remaining) noexcept {
+            std::size_t level = MSPI_T::RXENTRIES_t::RXENTRIES.extract(MSPI_T::RXENTRIES.read());
+            std::size_t done = 0;
+            while (level != 0 && done < remaining) {
+                const uint32_t word = MSPI_T::RXFIFO.read();
+                const std::size_t n = (remaining - done < 4) ? remaining - done : 4;
+                std::memcpy(data + done, &word, n);
+                done += n;
+                --level;
+            }
+            return done;
+        }
+    };  // struct controller
+
+}   // namespace MSPI
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "mspi.hpp"
+#include "mspi_dma.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace MSPI {
+
+    /// one command queue entry: the CQ fetches the pair from SRAM and writes `value` to `address`
+    struct cq_entry {
+        uint32_t address;
+        uint32_t value;
+    };
+
+    /// CQFLAGS bits for CQPAUSE. The queue pauses while all bits of CQPAUSE are set in CQFLAGS.
+    namespace cq_pause {
+        using CQMASKv = sfr::MSPI::CQMASKv;
+        constexpr uint32_t stop        = static_cast<uint32_t>(CQMASKv::STOP);
+        constexpr uint32_t index_equal = static_cast<uint32_t>(CQMASKv::CQIDX);     ///< CQCURIDX == CQENDIDX
+        constexpr uint32_t software(const unsigned flag) noexcept { return static_cast<uint32_t>(CQMASKv::SWFLAG0) << (flag & 0x7u); }
+    }
+
+    /**
+     * Builder for a list of MSPI register writes that the command queue executes on its own: programmed IO
+     * commands without data (write enable, erase), DMA transfers and flag/pause handling. The queue waits for a
+     * command or DMA it has started to complete before it fetches the next entry, so operations are listed one
+     * after the other.
+     *
+     * N is the capacity in entries; overflow() reports a program that did not fit.
+     */
+    template <typename MSPI_T, std::size_t N>
+    class cq_program {
+        using CTRL_t = typename MSPI_T::CTRL_t;
+        using DMACFG_t = typename MSPI_T::DMACFG_t;
+        using CQSETCLEAR_t = typename MSPI_T::CQSETCLEAR_t;
+
+        std::array<cq_entry, N> m_entries{};
+        std::size_t m_size = 0;
+        bool m_overflow = false;
+
+    public:
+        static constexpr std::size_t capacity = N;
+
+        /// write `value` to the register at `address`; any APB/AHB register the CQ can reach
+        constexpr cq_program& write_absolute(const uint32_t address, const uint32_t value) noexcept {
+            if (m_size == N) {
+                m_overflow = true;
+                return *this;
+            }
+            m_entries[m_size++] = cq_entry{address, value};
+            return *this;
+        }
+
+        /// write `value` to a register of this MSPI, e.g. write(MSPI_T::CQSETCLEAR, ...)
+        template <typename REG>
+        constexpr cq_program& write(const REG&, const uint32_t value) noexcept {
+            return write_absolute(REG::address, value);
+        }
+
+        /// programmed IO command without data, e.g. WREN, or an erase with `send_address`
+        constexpr cq_program& command(const uint8_t instruction, const bool send_address = false, const uint32_t address = 0,
+                                      const bool paired = false) noexcept {
+            if (send_address) { write(MSPI_T::ADDR, address); }
+            write(MSPI_T::INSTR, instruction);
+            return write(MSPI_T::CTRL, (CTRL_t::TXRX.shift(true) | CTRL_t::SENDI.shift(true) | CTRL_t::SENDA.shift(send_address)
+                                        | CTRL_t::QUADCMD.shift(paired) | CTRL_t::START.shift(true)).value);
+        }
+
+        /// automatic DMA of `size` bytes between the SRAM address `address` and device address `device`
+        constexpr cq_program& transfer(const Direction direction, const uint32_t address, const uint32_t device, const std::size_t size,
+                                       const uint8_t burst = 32) noexcept {
+            if (size == 0 || size > max_dma_bytes) {
+                m_overflow = true;
+                return *this;
+            }
+            write(MSPI_T::DMACFG, 0);
+            write(MSPI_T::DMATARGADDR, address);
+            write(MSPI_T::DMADEVADDR, device);
+            write(MSPI_T::DMATOTCOUNT, MSPI_T::DMATOTCOUNT_t::TOTCOUNT.shift(static_cast<uint32_t>(size)).value);
+            write(MSPI_T::DMABCOUNT, MSPI_T::DMABCOUNT_t::BCOUNT.shift(burst).value);
+            return write(MSPI_T::DMACFG, (DMACFG_t::DMADIR.shift(direction == Direction::write) | DMACFG_t::DMAEN.shift(sfr::MSPI::DMAENv::EN)).value);
+        }
+
+        /// set, clear or toggle software flags (CQFLAGS 7:0)
+        constexpr cq_program& set_flags(const uint8_t mask) noexcept { return write(MSPI_T::CQSETCLEAR, CQSETCLEAR_t::CQFSET.shift(mask).value); }
+        constexpr cq_program& clear_flags(const uint8_t mask) noexcept { return write(MSPI_T::CQSETCLEAR, CQSETCLEAR_t::CQFCLR.shift(mask).value); }
+        constexpr cq_program& toggle_flags(const uint8_t mask) noexcept { return write(MSPI_T::CQSETCLEAR, CQSETCLEAR_t::CQFTOGGLE.shift(mask).value); }
+
+        /// replace the pause condition, see MSPI::cq_pause
+        constexpr cq_program& pause_on(const uint32_t conditions) noexcept { return write(MSPI_T::CQPAUSE, conditions); }
+
+        /**
+         * stop here until the CPU clears software flag `flag`, see command_queue::release(). Raises CQUPD as the
+         * queue gets here. The pause condition is back to index_equal afterwards so queue appends keep working.
+         */
+        constexpr cq_program& wait_for_release(const unsigned flag) noexcept {
+            write_absolute(MSPI_T::CQSETCLEAR.address | 1u, CQSETCLEAR_t::CQFSET.shift(1u << (flag & 0x7u)).value);
+            pause_on(cq_pause::software(flag));
+            return pause_on(cq_pause::index_equal);
+        }
+
+        /// raise the CQUPD interrupt when the queue gets here. Address bit 0 of any CQ write flags the update.
+        constexpr cq_program& notify() noexcept { return write_absolute(MSPI_T::CQSETCLEAR.address | 1u, 0); }
+
+        constexpr void clear() noexcept {
+            m_size = 0;
+            m_overflow = false;
+        }
+
+        [[nodiscard]] constexpr std::span<const cq_entry> entries() const noexcept { return {m_entries.data(), m_size}; }
+        [[nodiscard]] constexpr std::size_t size() const noexcept { return m_size; }
+        [[nodiscard]] constexpr bool overflow() const noexcept { return m_overflow; }
+    };  // class cq_program
+
+    /**
+     * Circular command queue of the MSPI in SRAM, the same scheme as IOM::command_queue: append() copies a
+     * program behind the ones still queued, closes it with a write of its block index to CQCURIDX and moves
+     * CQENDIDX there. With the index_equal pause condition the queue runs until it has executed the newest
+     * block and waits there, so blocks can be added while it runs.
+     *
+     * ENTRIES is the ring size; one entry is kept for the jump back to the start.
+     */
+    template <typename MSPI_T, std::size_t ENTRIES = 128>
+    class command_queue {
+        static_assert(ENTRIES >= 4, "command queue ring is too small");
+
+        alignas(8) static inline cq_entry s_ring[ENTRIES] = {};
+        static inline std::size_t s_head = 0;                   // next free entry
+        static inline uint8_t s_index = 0;                      // index of the newest block
+        static inline uint16_t s_block_end[256] = {};           // ring position after each block index
+        static inline std::atomic<uint32_t> s_errors{0};
+
+        static constexpr uint32_t cqcuridx_address = MSPI_T::CQCURIDX.address;
+        static constexpr uint32_t cqaddr_address = MSPI_T::CQADDR.address;
+
+        [[nodiscard]] static uint32_t ring_address() noexcept { return sfr::bus_address(s_ring, sizeof(s_ring)); }
+
+        /// first ring position the queue may still fetch
+        [[nodiscard]] static std::size_t tail() noexcept { return s_block_end[completed_index()]; }
+
+    public:
+        /// reset the ring and enable the queue. It is idle until the first append().
+        static void start(const bool high_priority = false) noexcept {
+            MSPI_T::CQCFG.write(0);
+            s_head = 0;
+            s_index = 0;
+            for (auto& end : s_block_end) { end = 0; }
+            MSPI_T::CQCURIDX.write(0);
+            MSPI_T::CQENDIDX.write(0);
+            MSPI_T::CQADDR.write(ring_address());
+            MSPI_T::CQPAUSE.write(cq_pause::index_equal);
+            MSPI_T::INTCLR.write(irq::cqerr | irq::cqupd | irq::cqpaused | irq::cqcmp);
+            MSPI_T::CQCFG.write((MSPI_T::CQCFG_t::CQPRI.shift(high_priority) | MSPI_T::CQCFG_t::CQEN.shift(true)).value);
+        }
+
+        /// disable the queue after the entry that is executing now
+        static void stop() noexcept { MSPI_T::CQCFG.write(0); }
+
+        /**
+         * queue a program. Returns Status::busy if the ring has no room for it until more blocks have run,
+         * Status::invalid if it overflowed its builder or can never fit.
+         */
+        template <std::size_t N>
+        static Status append(const cq_program<MSPI_T, N>& program) noexcept {
+            const std::size_t needed = program.size() + 1;     // + index marker
+            if (program.overflow() || program.size() == 0 || needed + 1 > ENTRIES) { return Status::invalid; }
+
+            const std::size_t done = tail();
+            std::size_t position = s_head;
+            if (s_head >= done) {
+                if (needed + 1 > ENTRIES - s_head) {            // does not fit before the end of the ring
+                    if (done == 0 || needed > done - 1) { return Status::busy; }
+                    s_ring[s_head] = cq_entry{cqaddr_address, ring_address()};
+                    position = 0;
+                }
+            } else if (needed > done - s_head - 1) {
+                return Status::busy;
+            }
+
+            for (const cq_entry& e : program.entries()) { s_ring[position++] = e; }
+            const uint8_t index = static_cast<uint8_t>(s_index + 1);
+            s_ring[position++] = cq_entry{cqcuridx_address, index};
+            s_block_end[index] = static_cast<uint16_t>(position);
+            s_head = position;
+            s_index = index;
+
+            std::atomic_thread_fence(std::memory_order_release);    // entries must be in SRAM before the queue may fetch them
+            MSPI_T::CQENDIDX.write(index);
+            return Status::ok;
+        }
+
+        /// index of the last block the queue has finished
+        [[nodiscard]] static uint8_t completed_index() noexcept { return static_cast<uint8_t>(MSPI_T::CQCURIDX_t::CQCURIDX.extract(MSPI_T::CQCURIDX.read())); }
+
+        /// index that append() gave the newest block
+        [[nodiscard]] static uint8_t queued_index() noexcept { return s_index; }
+
+        /// true once every appended block has run
+        [[nodiscard]] static bool idle() noexcept { return completed_index() == s_index; }
+
+        /// true once the block with `index` has run
+        [[nodiscard]] static bool done(const uint8_t index) noexcept {
+            return static_cast<uint8_t>(completed_index() - index) < 128;
+        }
+
+        /// true while the queue waits in cq_program::wait_for_release(flag)
+        [[nodiscard]] static bool waiting(const unsigned flag) noexcept {
+            return MSPI_T::CQSTAT_t::CQPAUSED.extract(MSPI_T::CQSTAT.read()) && (MSPI_T::CQFLAGS.read() & cq_pause::software(flag));
+        }
+
+        /// let a queue that waits in cq_program::wait_for_release(flag) continue
+        static void release(const unsigned flag) noexcept { MSPI_T::CQSETCLEAR.write(MSPI_T::CQSETCLEAR_t::CQFCLR.shift(1u << (flag & 0x7u)).value); }
+
+        /// number of CQERR interrupts seen by isr()
+        [[nodiscard]] static uint32_t errors() noexcept { return s_errors.load(std::memory_order_relaxed); }
+
+        /// acknowledge queue interrupts and return them. Call from the MSPI interrupt handler.
+        static uint32_t isr() noexcept {
+            const uint32_t pending = MSPI_T::INTSTAT.read() & (irq::cqerr | irq::cqupd | irq::cqpaused | irq::cqcmp);
+            MSPI_T::INTCLR.write(pending);
+            if (pending & irq::cqerr) { s_errors.fetch_add(1, std::memory_order_relaxed); }
+            return pending;
+        }
+    };  // class command_queue
+
+}   // namespace MSPI
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "mspi.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace MSPI {
+
+    /// data direction of a DMA transfer, values match DMACFG.DMADIR
+    enum class Direction : uint8_t {
+        read  = 0,  ///< P2M - device to memory
+        write = 1,  ///< M2P - memory to device
+    };
+
+    constexpr std::size_t max_dma_bytes = 0xFFFC;  // DMATOTCOUNT, kept word aligned so chained chunks stay aligned in SRAM
+
+    /**
+     * How transfers to a device are cut into DMA commands. Writes never cross a multiple of `page` (the page of a
+     * NOR flash, the wrap boundary of a PSRAM); no command is longer than `max_chunk`, e.g. to respect the
+     * maximum chip select low time of a PSRAM. With `write_enable` every write command is preceded by WREN and
+     * followed by polling the status register, as NOR flash page programs need.
+     */
+    struct memory_profile {
+        uint32_t page = 0;                      ///< bytes, power of two, 0 for no limit
+        uint32_t max_chunk = max_dma_bytes;
+        bool     write_enable = false;
+        uint8_t  status_instruction = 0x05;
+        uint8_t  busy_mask = 0x01;
+    };
+
+    namespace profiles {
+        constexpr memory_profile nor_flash{256, max_dma_bytes, true};
+        constexpr memory_profile psram{1024, 184, false};   // APS6404L: 1 KB wrap, 8 us tCEM allows 184 data bytes at 48 MHz quad
+    }
+
+    /**
+     * DMA engine for the MSPI. The controller sends FLASH.READINSTR/WRITEINSTR and DMADEVADDR itself, so a bulk
+     * read or write is one DMA command per chunk and the CPU only steps in between chunks from isr(). Chunks
+     * follow the memory_profile; for a device that needs WREN the page program time is spent in the flash, and
+     * the engine checks the status register from poll() instead of spinning.
+     *
+     * DMABCOUNT sets the bytes moved per FIFO request on the AHB, DMATHRESH the FIFO level in words at which
+     * one is raised. In paired quad mode (Frame::QUADPAIRED) the two devices act as one 8 bit wide memory:
+     * pages are twice as large, addresses and lengths must be even, and WREN and status reads go to both.
+     *
+     * Call configure() after controller::configure() and isr() from the MSPI interrupt handler. Buffers must be
+     * in SRAM and stay valid until busy() is false. XIP must be disabled while writing to a flash.
+     */
+    template <typename MSPI_T>
+    class dma_engine {
+        using ctrl = controller<MSPI_T>;
+        using DMACFG_t = typename MSPI_T::DMACFG_t;
+
+        static constexpr uint32_t done_mask = irq::dcmp | irq::derr | irq::screrr;
+
+        enum class Stage : uint8_t { idle, transfer, program };
+
+        static inline memory_profile s_profile = profiles::psram;
+        static inline uint8_t s_burst = 32;
+        static inline uint8_t s_threshold = 8;
+        static inline bool s_priority = false;
+        static inline bool s_paired = false;
+
+        static inline uint8_t* s_buffer = nullptr;
+        static inline uint32_t s_address = 0;       // device address of the first byte
+        static inline uint32_t s_length = 0;
+        static inline uint32_t s_offset = 0;        // bytes already transferred
+        static inline uint32_t s_chunk = 0;         // bytes of the command in flight
+        static inline Direction s_direction = Direction::read;
+        static inline std::atomic<Stage> s_stage{Stage::idle};
+        static inline std::atomic<Status> s_status{Status::ok};
+
+        [[nodiscard]] static bool in_sram(const void* buffer, const std::size_t size) noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            (void)buffer;
+            (void)size;
+            return true;
+#else
+            const uint32_t address = sfr::bus_address(buffer, size);
+            return (address & 0xFFF00000u) == 0x10000000u;
+#endif
+        }
+
+        [[nodiscard]] static uint32_t page() noexcept { return s_paired ? s_profile.page * 2 : s_profile.page; }
+
+        /// bytes of the next command: up to max_chunk and, for writes, up to the next page boundary
+        [[nodiscard]] static uint32_t next_chunk() noexcept {
+            uint32_t chunk = std::min(s_length - s_offset, s_profile.max_chunk);
+            if (s_direction == Direction::write && page() != 0) {
+                const uint32_t address = s_address + s_offset;
+                chunk = std::min(chunk, page() - (address & (page() - 1u)));
+            }
+            return chunk;
+        }
+
+        static void program() noexcept {
+            s_chunk = next_chunk();
+            if (s_direction == Direction::write && s_profile.write_enable) {
+                if (ctrl::command(0x06, nullptr, nullptr, 0, false, 0, false, s_paired) != Status::ok) {
+                    finish(Status::timeout);
+                    return;
+                }
+            }
+            MSPI_T::DMACFG.write(0);
+            MSPI_T::DMATARGADDR.write(sfr::bus_address(s_buffer + s_offset, s_chunk));
+            MSPI_T::DMADEVADDR.write(s_address + s_offset);
+            MSPI_T::DMATOTCOUNT.write(MSPI_T::DMATOTCOUNT_t::TOTCOUNT.shift(s_chunk).value);
+            MSPI_T::DMABCOUNT.write(MSPI_T::DMABCOUNT_t::BCOUNT.shift(s_burst).value);
+            MSPI_T::DMATHRESH.write(MSPI_T::DMATHRESH_t::DMATHRESH.shift(s_threshold).value);
+            s_stage.store(Stage::transfer, std::memory_order_release);
+            MSPI_T::DMACFG.write((DMACFG_t::DMAPRI.shift(s_priority ? sfr::MSPI::DMAPRIv::HIGH : sfr::MSPI::DMAPRIv::LOW)
+                                  | DMACFG_t::DMADIR.shift(s_direction == Direction::write) | DMACFG_t::DMAEN.shift(sfr::MSPI::DMAENv::EN)).value);
+        }
+
+        static void finish(const Status result) noexcept {
+            MSPI_T::INTEN &= ~done_mask;
+            MSPI_T::DMACFG.write(0);
+            s_stage.store(Stage::idle, std::memory_order_relaxed);
+            s_status.store(result, std::memory_order_release);
+        }
+
+        /// the chunk in flight is done: start the next one, or wait for the page program to finish
+        static void advance() noexcept {
+            s_offset += s_chunk;
+            if (s_direction == Direction::write && s_profile.write_enable) {
+                s_stage.store(Stage::program, std::memory_order_release);
+                return;
+            }
+            if (s_offset == s_length) {
+                finish(Status::ok);
+            } else {
+                program();
+            }
+        }
+
+        static Status start(const Direction direction, const uint32_t address, uint8_t* buffer, const std::size_t size) noexcept {
+            if (size == 0 || size > 0xFFFFFFFFu || buffer == nullptr || !in_sram(buffer, size)) { return Status::invalid; }
+            if (s_paired && ((address | size) & 1u)) { return Status::invalid; }
+            if (busy()) { return Status::busy; }
+            s_buffer = buffer;
+            s_address = address;
+            s_length = static_cast<uint32_t>(size);
+            s_offset = 0;
+            s_direction = direction;
+            s_status.store(Status::busy, std::memory_order_release);
+            MSPI_T::INTCLR.write(done_mask);
+            MSPI_T::INTEN |= done_mask;
+            program();
+            return Status::ok;
+        }
+
+    public:
+        /**
+         * set how transfers are split and paced. `burst` is DMABCOUNT in bytes (16 or 32 recommended),
+         * `threshold` DMATHRESH in FIFO words; `priority` gives the DMA priority over the CPU on the AHB.
+         */
+        static bool configure(const memory_profile& profile, const uint8_t burst = 32, const uint8_t threshold = 8,
+                              const bool priority = false) noexcept {
+            if (busy() || profile.max_chunk == 0 || profile.max_chunk > max_dma_bytes || (profile.page & (profile.page - 1u))
+                || burst == 0 || threshold == 0 || threshold > 15) {
+                return false;
+            }
+            s_profile = profile;
+            s_paired = MSPI_T::CFG_t::DEVCFG.extract(MSPI_T::CFG.read()) == Frame::QUADPAIRED;
+            if (s_paired) { s_profile.max_chunk &= ~1u; }
+            s_burst = burst;
+            s_threshold = threshold;
+            s_priority = priority;
+            return true;
+        }
+
+        /// read `data.size()` bytes from device `address` into SRAM
+        static Status read(const uint32_t address, const std::span<uint8_t> data) noexcept {
+            return start(Direction::read, address, data.data(), data.size());
+        }
+
+        /// write `data` to device `address`. For a flash the range must have been erased.
+        static Status write(const uint32_t address, const std::span<const uint8_t> data) noexcept {
+            return start(Direction::write, address, const_cast<uint8_t*>(data.data()), data.size());
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return s_status.load(std::memory_order_acquire) == Status::busy; }
+
+        /// result of the last transfer, Status::busy while it runs
+        [[nodiscard]] static Status status() noexcept { return s_status.load(std::memory_order_acquire); }
+
+        /// bytes of the current or last transfer that have reached their destination
+        [[nodiscard]] static std::size_t transferred() noexcept {
+            return (s_stage.load(std::memory_order_acquire) == Stage::program) ? s_offset - s_chunk : s_offset;
+        }
+
+        /**
+         * check on a flash page program: if the device is ready, start the next page. Call from the main loop or
+         * a timer while busy(); wait() does so itself. Returns busy().
+         */
+        static bool poll() noexcept {
+            if (s_stage.load(std::memory_order_acquire) != Stage::program) { return busy(); }
+            bool pending = true;
+            const Status error = ctrl::device_busy(s_profile.status_instruction, s_profile.busy_mask, s_paired, pending);
+            if (error != Status::ok) {
+                finish(error);
+            } else if (!pending) {
+                if (s_offset == s_length) {
+                    finish(Status::ok);
+                } else {
+                    program();
+                }
+            }
+            return busy();
+        }
+
+        /**
+         * sleep until the transfer is done. On target the core waits in WFI during DMA commands and polls the
+         * flash between them. busy() and the stage are checked with interrupts masked and WFI wakes on the
+         * pending interrupt, so a DCMP arriving between the check and the WFI is not slept through.
+         */
+        static Status wait() noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            while (busy()) {                        // no NVIC on the host, take the pending interrupt here
+                if (MSPI_T::INTSTAT.read() & MSPI_T::INTEN.read() & done_mask) { isr(); }
+                if (s_stage.load(std::memory_order_acquire) == Stage::program) { poll(); }
+            }
+#else
+            uint32_t primask;
+            __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+            while (busy()) {
+                if (s_stage.load(std::memory_order_acquire) == Stage::program) {
+                    poll();
+                    continue;
+                }
+                __asm volatile ("wfi\n\tcpsie i\n\tisb\n\tcpsid i" ::: "memory");
+            }
+            __asm volatile ("msr primask, %0" :: "r"(primask) : "memory");
+#endif
+            return status();
+        }
+
+        /// chain the next chunk after DCMP. Call from the MSPI interrupt handler.
+        static void isr() noexcept {
+            const uint32_t pending = MSPI_T::INTSTAT.read() & MSPI_T::INTEN.read() & done_mask;
+            MSPI_T::INTCLR.write(pending);
+            if (!busy() || s_stage.load(std::memory_order_acquire) != Stage::transfer) { return; }
+            if (pending & irq::derr) {
+                finish(Status::dma_error);
+            } else if (pending & irq::screrr) {
+                finish(Status::scramble_error);
+            } else if (pending & irq::dcmp) {
+                advance();
+            }
+        }
+    };  // class dma_engine
+
+}   // namespace MSPI
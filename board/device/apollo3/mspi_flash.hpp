@@ -0,0 +1,247 @@
+#pragma once
+
+#include "mspi.hpp"
+#include "mspi_cq.hpp"
+#include "mspi_dma.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace MSPI {
+
+    /// erase and program units of a NOR flash
+    struct flash_geometry {
+        uint32_t page = 256;
+        uint32_t sector = 4096;
+        uint32_t block = 65536;                 ///< 0 if the part only erases sectors
+        uint8_t  sector_erase = 0x20;
+        uint8_t  block_erase = 0xD8;
+        uint8_t  status_instruction = 0x05;
+        uint8_t  busy_mask = 0x01;
+
+        [[nodiscard]] constexpr bool valid() const noexcept {
+            return page != 0 && (page & (page - 1u)) == 0 && page <= max_dma_bytes && sector != 0 && (sector & (sector - 1u)) == 0
+                && (block == 0 || (block > sector && (block & (block - 1u)) == 0));
+        }
+    };
+
+    /**
+     * Erase and program pipeline on the MSPI command queue. A request (erase a range, program a buffer, or both
+     * for an OTA image) is turned into one CQ block per sector erase or page program: write enable, the erase
+     * command or the page DMA, then a pause on software flag FLAG. The queue runs ahead through the ring on its
+     * own; the only CPU work per operation is one status register read in poll() that releases the pause once
+     * the flash is ready, since the Apollo3 CQ can not branch on device status itself. 64 KB block erases are
+     * used where the range allows.
+     *
+     * Call poll() from thread context while busy(), e.g. periodically at about the page program time, and isr()
+     * from the MSPI interrupt handler. isr() only records that the queue reached a pause or failed, so poll()
+     * never runs twice at once; pending() tells a main loop that sleeps between polls when one is worth making.
+     * The MSPI must be configured for the flash with XIP disabled, and the program data must stay valid in SRAM
+     * until busy() is false.
+     */
+    template <typename MSPI_T, std::size_t ENTRIES = 256, unsigned FLAG = 0>
+    class flash_pipeline {
+        static_assert(FLAG < 8, "software flags are 0-7");
+
+        using ctrl = controller<MSPI_T>;
+        using queue = command_queue<MSPI_T, ENTRIES>;
+        using block = cq_program<MSPI_T, 16>;
+
+        static inline flash_geometry s_geometry{};
+        static inline uint8_t s_burst = 32;
+        static inline bool s_paired = false;
+
+        static inline uint32_t s_erase_next = 0;        // next device address to erase
+        static inline uint32_t s_erase_end = 0;
+        static inline const uint8_t* s_data = nullptr;
+        static inline uint32_t s_program_next = 0;      // next device address to program
+        static inline uint32_t s_program_address = 0;
+        static inline uint32_t s_program_end = 0;
+        static inline uint32_t s_queued = 0;            // operations appended to the queue
+        static inline std::atomic<uint32_t> s_completed{0};
+        static inline uint32_t s_total = 0;
+        static inline std::atomic<Status> s_status{Status::ok};
+        static inline std::atomic<bool> s_update{false};        // CQUPD seen by isr() since the last poll()
+        static inline std::atomic<bool> s_error{false};         // CQERR seen by isr()
+
+        [[nodiscard]] static uint32_t page() noexcept { return s_paired ? s_geometry.page * 2 : s_geometry.page; }
+
+        [[nodiscard]] static uint32_t operations(const uint32_t erase_from, const uint32_t erase_to, const uint32_t program_from,
+                                                 const uint32_t program_to) noexcept {
+            uint32_t count = 0;
+            for (uint32_t a = erase_from; a < erase_to; a += erase_size(a, erase_to)) { ++count; }
+            for (uint32_t a = program_from; a < program_to; a = (a | (page() - 1u)) + 1u) { ++count; }
+            return count;
+        }
+
+        [[nodiscard]] static uint32_t erase_size(const uint32_t address, const uint32_t end) noexcept {
+            const uint32_t block_size = s_geometry.block;
+            return (block_size != 0 && (address & (block_size - 1u)) == 0 && end - address >= block_size) ? block_size : s_geometry.sector;
+        }
+
+        /// CQ block of the next operation, false once everything is queued
+        [[nodiscard]] static bool next(block& b) noexcept {
+            b.clear();
+            if (s_erase_next < s_erase_end) {
+                const uint32_t size = erase_size(s_erase_next, s_erase_end);
+                b.command(0x06, false, 0, s_paired);
+                b.command((size == s_geometry.sector) ? s_geometry.sector_erase : s_geometry.block_erase, true, s_erase_next, s_paired);
+                s_erase_next += size;
+            } else if (s_program_next < s_program_end) {
+                const uint32_t end = (s_program_next | (page() - 1u)) + 1u;
+                const uint32_t size = ((end < s_program_end) ? end : s_program_end) - s_program_next;
+                const uint8_t* from = s_data + (s_program_next - s_program_address);
+                b.command(0x06, false, 0, s_paired);
+                b.transfer(Direction::write, sfr::bus_address(from, size), s_program_next, size, s_burst);
+                s_program_next += size;
+            } else {
+                return false;
+            }
+            b.wait_for_release(FLAG);
+            return true;
+        }
+
+        /// append operations while the ring has room
+        static void refill() noexcept {
+            block b;
+            while (s_queued < s_total) {
+                const uint32_t erase_next = s_erase_next;
+                const uint32_t program_next = s_program_next;
+                if (!next(b)) { return; }
+                if (queue::append(b) != Status::ok) {
+                    s_erase_next = erase_next;      // retry this operation once blocks have run
+                    s_program_next = program_next;
+                    return;
+                }
+                ++s_queued;
+            }
+        }
+
+        static void finish(const Status result) noexcept {
+            queue::stop();
+            MSPI_T::INTEN &= ~(irq::cqupd | irq::cqerr);
+            s_status.store(result, std::memory_order_release);
+        }
+
+        static Status start(const uint32_t erase_from, const uint32_t erase_to, const uint8_t* data, const uint32_t program_from,
+                            const uint32_t program_to) noexcept {
+            if (busy()) { return Status::busy; }
+            s_paired = MSPI_T::CFG_t::DEVCFG.extract(MSPI_T::CFG.read()) == Frame::QUADPAIRED;
+            if (s_paired && ((program_from | program_to) & 1u)) { return Status::invalid; }
+            s_erase_next = erase_from;
+            s_erase_end = erase_to;
+            s_data = data;
+            s_program_next = program_from;
+            s_program_address = program_from;
+            s_program_end = program_to;
+            s_queued = 0;
+            s_completed.store(0, std::memory_order_relaxed);
+            s_total = operations(erase_from, erase_to, program_from, program_to);
+            if (s_total == 0) { return Status::invalid; }
+            s_update.store(false, std::memory_order_relaxed);
+            s_error.store(false, std::memory_order_relaxed);
+            s_status.store(Status::busy, std::memory_order_release);
+
+            queue::start();
+            MSPI_T::DMATHRESH.write(MSPI_T::DMATHRESH_t::DMATHRESH.shift(8).value);
+            MSPI_T::INTCLR.write(irq::cqupd | irq::cqerr);
+            MSPI_T::INTEN |= irq::cqupd | irq::cqerr;
+            refill();
+            return Status::ok;
+        }
+
+        [[nodiscard]] static bool aligned(const uint32_t address, const std::size_t length) noexcept {
+            const uint32_t mask = s_geometry.sector - 1u;
+            return length != 0 && ((address | static_cast<uint32_t>(length)) & mask) == 0;
+        }
+
+    public:
+        /// set the flash geometry and the DMABCOUNT used for page data
+        static bool init(const flash_geometry& geometry = flash_geometry{}, const uint8_t burst = 32) noexcept {
+            if (busy() || !geometry.valid()) { return false; }
+            s_geometry = geometry;
+            s_burst = burst;
+            return true;
+        }
+
+        /// erase [address, address + length), both multiples of the sector size
+        static Status erase(const uint32_t address, const std::size_t length) noexcept {
+            if (!aligned(address, length)) { return Status::invalid; }
+            return start(address, address + static_cast<uint32_t>(length), nullptr, 0, 0);
+        }
+
+        /// program `data` at `address`, which must have been erased. Pages are written as far as data reaches.
+        static Status program(const uint32_t address, const std::span<const uint8_t> data) noexcept {
+            if (data.empty()) { return Status::invalid; }
+            return start(0, 0, data.data(), address, address + static_cast<uint32_t>(data.size()));
+        }
+
+        /// erase the sectors covering `data` at `address` and program it, e.g. an OTA image. `address` must be sector aligned.
+        static Status update(const uint32_t address, const std::span<const uint8_t> data) noexcept {
+            if (data.empty() || !aligned(address, s_geometry.sector)) { return Status::invalid; }
+            const uint32_t end = address + static_cast<uint32_t>(data.size());
+            const uint32_t erase_end = (end + s_geometry.sector - 1u) & ~(s_geometry.sector - 1u);
+            return start(address, erase_end, data.data(), address, end);
+        }
+
+        /**
+         * release the queue if it waits for an operation that the flash has finished, and queue further
+         * operations. Thread context only. Returns busy().
+         */
+        static bool poll() noexcept {
+            if (!busy()) { return false; }
+            s_update.store(false, std::memory_order_relaxed);
+            if (s_error.load(std::memory_order_acquire)) {
+                finish(Status::dma_error);
+                return false;
+            }
+            if (queue::waiting(FLAG)) {
+                bool pending = true;
+                if (const Status s = ctrl::device_busy(s_geometry.status_instruction, s_geometry.busy_mask, s_paired, pending); s != Status::ok) {
+                    finish(s);
+                    return false;
+                }
+                if (!pending) {
+                    queue::release(FLAG);
+                    s_completed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            refill();
+            if (s_completed.load(std::memory_order_relaxed) == s_total && queue::idle()) { finish(Status::ok); }
+            return busy();
+        }
+
+        /// poll until the request is done
+        static Status wait() noexcept {
+            while (poll()) { }
+            return status();
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return s_status.load(std::memory_order_acquire) == Status::busy; }
+
+        /// result of the last request, Status::busy while it runs
+        [[nodiscard]] static Status status() noexcept { return s_status.load(std::memory_order_acquire); }
+
+        /// erase and program operations finished and in total for the current request
+        [[nodiscard]] static uint32_t completed() noexcept { return s_completed.load(std::memory_order_relaxed); }
+        [[nodiscard]] static uint32_t total() noexcept { return s_total; }
+
+        /// true if the queue reached a pause or failed since the last poll()
+        [[nodiscard]] static bool pending() noexcept {
+            return s_update.load(std::memory_order_relaxed) || s_error.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * record queue interrupts for the next poll(): CQUPD marks a pause that may already be over, CQERR aborts
+         * the request. Call from the MSPI interrupt handler.
+         */
+        static void isr() noexcept {
+            const uint32_t pending = queue::isr();
+            if (!busy()) { return; }
+            if (pending & irq::cqerr) { s_error.store(true, std::memory_order_release); }
+            if (pending & irq::cqupd) { s_update.store(true, std::memory_order_relaxed); }
+        }
+    };  // class flash_pipeline
+
+}   // namespace MSPI
@@ -0,0 +1,455 @@
+#pragma once
+
+#include "mspi.hpp"
+#include "mspi_dma.hpp"
+#include "mspi_flash.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace MSPI {
+
+    /**
+     * Log structured key/value store on an external NOR flash. SECTORS erase sectors starting at the base
+     * address form a ring: records are appended at the head with dma_engine, and an update or remove()
+     * only appends a newer record, so a sector is erased once per lap of the ring instead of once per update.
+     * The garbage collector takes the oldest sector, moves its live records to the head and erases it through
+     * flash_pipeline on the command queue; since every sector goes round in turn, static data is moved as well
+     * and all sectors see the same number of erases.
+     *
+     * Keys are 0 .. KEYS-1. The index in RAM holds the device address and length of every key (6 bytes per
+     * key), so size() is O(1) and get() is a single DMA read.
+     *
+     * Flash format: each used sector starts with {magic, sequence}; records follow as {key, length, crc32} and
+     * the value padded to a word. Length 0 marks a removed key. mount() rebuilds the index from the flash,
+     * checking the crc of every record, so a record torn by a reset is ignored and its sector closed.
+     *
+     * Everything runs from the main loop: put() and remove() start an append and return, poll() finishes it and
+     * runs garbage collection steps when fewer than two erased sectors are left, and put() answers
+     * Status::busy until then. mount() and get() wait for their transfers. Call isr() from the MSPI interrupt
+     * handler. The MSPI must be configured for the flash with XIP disabled.
+     */
+    template <typename MSPI_T, std::size_t SECTORS, std::size_t KEYS, std::size_t MAX_VALUE = 256>
+    class log_store {
+        static_assert(SECTORS >= 4, "the ring needs two spare sectors and two in use");
+        static_assert(KEYS != 0 && KEYS < 0xFFFF, "keys are 16 bit, 0xFFFF marks erased flash");
+        static_assert(MAX_VALUE != 0 && MAX_VALUE < 0xFFFF, "value lengths are 16 bit");
+
+        using dma = dma_engine<MSPI_T>;
+        using pipeline = flash_pipeline<MSPI_T, 64>;
+
+        struct sector_header {
+            uint32_t magic;
+            uint32_t sequence;
+        };
+
+        struct record_header {
+            uint16_t key;
+            uint16_t length;
+            uint32_t crc;
+        };
+
+        static_assert(sizeof(sector_header) == 8 && sizeof(record_header) == 8, "flash format");
+
+        static constexpr uint32_t magic = 0x31534B4Cu;         // "LKS1"
+        static constexpr uint32_t nowhere = 0xFFFFFFFFu;
+        static constexpr uint32_t max_record = sizeof(record_header) + ((MAX_VALUE + 3u) & ~3u);
+
+        enum class Stage : uint8_t { idle, append, relocate_read, relocate_write, erase };
+
+        static inline uint32_t s_base = 0;
+        static inline uint32_t s_sector = 0;
+
+        static inline std::array<uint32_t, KEYS> s_where{};     // device address of the live record
+        static inline std::array<uint16_t, KEYS> s_length{};
+        static inline std::array<uint32_t, SECTORS> s_used{};   // record bytes written to each sector
+        static inline std::array<uint32_t, SECTORS> s_live{};   // of which still referenced by the index
+        static inline uint32_t s_live_total = 0;
+        static inline uint32_t s_dead_total = 0;
+
+        static inline std::size_t s_head = 0;                   // sector appended to
+        static inline std::size_t s_tail = 0;                   // oldest sector in use
+        static inline std::size_t s_free = SECTORS;             // erased sectors
+        static inline uint32_t s_offset = 0;                    // next free byte of the head sector, 0 if it has no header yet
+        static inline bool s_open = false;                      // the head sector is in use
+        static inline uint32_t s_sequence = 0;
+
+        static inline Stage s_stage = Stage::idle;
+        static inline Status s_status = Status::ok;
+        static inline uint16_t s_key = 0;                       // record in flight
+        static inline uint16_t s_pending_length = 0;
+        static inline uint32_t s_pending_at = 0;
+        static inline uint32_t s_pending_bytes = 0;
+
+        // sector header in front of the record, for the first append to a sector
+        alignas(4) static inline uint8_t s_stage_buffer[sizeof(sector_header) + max_record] = {};
+
+        [[nodiscard]] static uint8_t* record() noexcept { return s_stage_buffer + sizeof(sector_header); }
+
+        [[nodiscard]] static constexpr uint32_t record_bytes(const uint32_t length) noexcept {
+            return static_cast<uint32_t>(sizeof(record_header)) + ((length + 3u) & ~3u);
+        }
+
+        [[nodiscard]] static uint32_t sector_address(const std::size_t sector) noexcept { return s_base + static_cast<uint32_t>(sector) * s_sector; }
+        [[nodiscard]] static std::size_t sector_of(const uint32_t address) noexcept { return (address - s_base) / s_sector; }
+        [[nodiscard]] static constexpr std::size_t next(const std::size_t sector) noexcept { return (sector + 1) % SECTORS; }
+
+        /// CRC-32 (IEEE, reflected), four bits per step
+        [[nodiscard]] static uint32_t crc32(const uint8_t* data, const std::size_t size, uint32_t crc = 0) noexcept {
+            static constexpr uint32_t table[16] = {
+                0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+                0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+            };
+            crc = ~crc;
+            for (std::size_t i = 0; i < size; ++i) {
+                crc = (crc >> 4) ^ table[(crc ^ data[i]) & 0xFu];
+                crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0xFu];
+            }
+            return ~crc;
+        }
+
+        /// crc of the record in the stage: key and length, then the value
+        [[nodiscard]] static uint32_t record_crc() noexcept {
+            record_header header;
+            std::memcpy(&header, record(), sizeof(header));
+            const uint32_t crc = crc32(record(), 4);
+            return crc32(record() + sizeof(header), header.length, crc);
+        }
+
+        static Status read_blocking(const uint32_t address, const std::span<uint8_t> data) noexcept {
+            if (const Status s = dma::read(address, data); s != Status::ok) { return s; }
+            return dma::wait();
+        }
+
+        /// account for a record of `bytes` at `at` in `sector` that replaces the key's previous one
+        static void commit(const uint16_t key, const uint16_t length, const uint32_t at, const uint32_t bytes, const std::size_t sector) noexcept {
+            if (s_where[key] != nowhere) {
+                const uint32_t old = record_bytes(s_length[key]);
+                s_live[sector_of(s_where[key])] -= old;
+                s_live_total -= old;
+                s_dead_total += old;
+            }
+            s_used[sector] += bytes;
+            if (length == 0) {
+                s_where[key] = nowhere;
+                s_dead_total += bytes;
+            } else {
+                s_where[key] = at;
+                s_length[key] = length;
+                s_live[sector] += bytes;
+                s_live_total += bytes;
+            }
+        }
+
+        /// make room for `bytes` at the head, opening the next sector if needed. Appends leave one erased sector to the collector.
+        [[nodiscard]] static bool reserve(const uint32_t bytes, const bool collecting) noexcept {
+            if (s_open && std::max<uint32_t>(s_offset, sizeof(sector_header)) + bytes <= s_sector) { return true; }
+            if (s_free < (collecting ? 1u : 2u)) { return false; }
+            if (s_open) { s_head = next(s_head); }
+            --s_free;
+            s_offset = 0;
+            s_open = true;
+            return true;
+        }
+
+        /// append the record in the stage at the head
+        static Status write_record(const Stage stage, const uint32_t bytes) noexcept {
+            uint32_t address = sector_address(s_head) + s_offset;
+            std::span<const uint8_t> data(record(), bytes);
+            if (s_offset == 0) {
+                const sector_header header{magic, s_sequence++};
+                std::memcpy(s_stage_buffer, &header, sizeof(header));
+                data = std::span<const uint8_t>(s_stage_buffer, sizeof(header) + bytes);
+                s_offset = sizeof(header);
+            }
+            s_pending_at = sector_address(s_head) + s_offset;
+            s_pending_bytes = bytes;
+            s_offset += bytes;
+            const Status s = dma::write(address, data);
+            if (s != Status::ok) {
+                s_offset = s_sector;
+                return s;
+            }
+            s_stage = stage;
+            return Status::ok;
+        }
+
+        /// record bytes in closed sectors that garbage collection can win back
+        [[nodiscard]] static uint32_t reclaimable() noexcept {
+            return s_dead_total - (s_open ? s_used[s_head] - s_live[s_head] : 0u);
+        }
+
+        /// start the next garbage collection step: move a live record out of the tail, or erase it once empty
+        static void collect() noexcept {
+            if (s_tail == s_head) { return; }
+            const uint32_t from = sector_address(s_tail);
+            for (std::size_t key = 0; key < KEYS; ++key) {
+                if (s_where[key] == nowhere || s_where[key] - from >= s_sector) { continue; }
+                s_key = static_cast<uint16_t>(key);
+                const Status s = dma::read(s_where[key], std::span<uint8_t>(record(), record_bytes(s_length[key])));
+                if (s == Status::ok) {
+                    s_stage = Stage::relocate_read;
+                } else {
+                    s_status = s;
+                }
+                return;
+            }
+            if (const Status s = pipeline::erase(from, s_sector); s != Status::ok) {
+                s_status = s;
+                return;
+            }
+            s_stage = Stage::erase;
+        }
+
+        /// index the records of one sector. Returns the offset after the last good one, s_sector if the sector must not be appended to.
+        static uint32_t scan(const std::size_t sector) noexcept {
+            const uint32_t base = sector_address(sector);
+            uint32_t offset = sizeof(sector_header);
+            while (offset + sizeof(record_header) <= s_sector) {
+                record_header header;
+                if (read_blocking(base + offset, std::span<uint8_t>(record(), sizeof(header))) != Status::ok) { return s_sector; }
+                std::memcpy(&header, record(), sizeof(header));
+                if (header.key == 0xFFFF && header.length == 0xFFFF) { return offset; }
+                const uint32_t bytes = record_bytes(header.length);
+                if (header.key >= KEYS || header.length > MAX_VALUE || offset + bytes > s_sector) { return s_sector; }
+                if (header.length != 0
+                    && read_blocking(base + offset + sizeof(header), std::span<uint8_t>(record() + sizeof(header), bytes - sizeof(header))) != Status::ok) {
+                    return s_sector;
+                }
+                if (record_crc() != header.crc) { return s_sector; }
+                commit(header.key, header.length, base + offset, bytes, sector);
+                offset += bytes;
+            }
+            return s_sector;
+        }
+
+        /// answer for an append that needs a sector: wait for garbage collection, or its error once it has stopped
+        [[nodiscard]] static Status stalled() noexcept { return (s_status != Status::ok) ? s_status : Status::busy; }
+
+        static void reset() noexcept {
+            s_where.fill(nowhere);
+            s_length.fill(0);
+            s_used.fill(0);
+            s_live.fill(0);
+            s_live_total = 0;
+            s_dead_total = 0;
+            s_head = 0;
+            s_tail = 0;
+            s_free = SECTORS;
+            s_offset = 0;
+            s_open = false;
+            s_sequence = 0;
+            s_stage = Stage::idle;
+            s_status = Status::ok;
+        }
+
+    public:
+        /**
+         * use SECTORS sectors of `geometry` from the sector aligned device address `base` and rebuild the index
+         * from them. Sectors that hold neither the store nor erased flash are erased. Waits until done.
+         */
+        static Status mount(const uint32_t base, const flash_geometry& geometry = flash_geometry{}) noexcept {
+            if (busy()) { return Status::busy; }
+            if (!geometry.valid() || (base & (geometry.sector - 1u)) || geometry.sector <= sizeof(sector_header) + max_record) { return Status::invalid; }
+            if (!pipeline::init(geometry)
+                || !dma::configure(memory_profile{geometry.page, max_dma_bytes, true, geometry.status_instruction, geometry.busy_mask})) {
+                return Status::invalid;
+            }
+            s_base = base;
+            s_sector = geometry.sector;
+            reset();
+
+            std::array<uint32_t, SECTORS> sequence{};
+            std::array<std::size_t, SECTORS> order{};
+            std::size_t used = 0;
+            for (std::size_t sector = 0; sector < SECTORS; ++sector) {
+                sector_header header;
+                if (const Status s = read_blocking(sector_address(sector), std::span<uint8_t>(record(), sizeof(header))); s != Status::ok) { return s; }
+                std::memcpy(&header, record(), sizeof(header));
+                if (header.magic == magic) {
+                    sequence[sector] = header.sequence;
+                    std::size_t at = used++;
+                    for (; at != 0 && sequence[order[at - 1]] > header.sequence; --at) {          // oldest first
+                        order[at] = order[at - 1];
+                    }
+                    order[at] = sector;
+                } else if (header.magic != 0xFFFFFFFFu || header.sequence != 0xFFFFFFFFu) {
+                    Status s = pipeline::erase(sector_address(sector), s_sector);
+                    if (s == Status::ok) { s = pipeline::wait(); }
+                    if (s != Status::ok) { return s; }
+                }
+            }
+
+            for (std::size_t i = 0; i < used; ++i) { s_offset = scan(order[i]); }
+            s_free = SECTORS - used;
+            if (used != 0) {
+                s_tail = order[0];
+                s_head = order[used - 1];
+                s_open = true;
+                s_sequence = sequence[s_head] + 1u;
+            }
+            return Status::ok;
+        }
+
+        /// erase all sectors and start empty. Waits until done.
+        static Status format() noexcept {
+            if (busy() || s_sector == 0) { return Status::invalid; }
+            Status s = pipeline::erase(s_base, static_cast<uint32_t>(SECTORS) * s_sector);
+            if (s == Status::ok) { s = pipeline::wait(); }
+            reset();
+            return s;
+        }
+
+        /**
+         * start storing `value` under `key`. Status::busy while a transfer runs or garbage collection has to win
+         * back a sector first; Status::invalid for a bad key or length, or when the live data would no longer
+         * fit beside the spare sectors. If garbage collection has stopped on an error, that error until clear().
+         */
+        static Status put(const uint16_t key, const std::span<const uint8_t> value) noexcept {
+            if (key >= KEYS || value.empty() || value.size() > MAX_VALUE || s_sector == 0) { return Status::invalid; }
+            const uint32_t bytes = record_bytes(static_cast<uint32_t>(value.size()));
+            const uint32_t replaced = (s_where[key] != nowhere) ? record_bytes(s_length[key]) : 0u;
+            if (s_live_total - replaced + bytes > static_cast<uint32_t>(SECTORS - 2) * (s_sector - sizeof(sector_header) - max_record)) {
+                return Status::invalid;
+            }
+            if (busy()) { return Status::busy; }
+            if (!reserve(bytes, false)) { return stalled(); }
+
+            const record_header header{key, static_cast<uint16_t>(value.size()), 0};
+            std::memcpy(record(), &header, sizeof(header));
+            std::memcpy(record() + sizeof(header), value.data(), value.size());
+            std::fill(record() + sizeof(header) + value.size(), record() + bytes, uint8_t{0xFF});
+            const uint32_t crc = record_crc();
+            std::memcpy(record() + offsetof(record_header, crc), &crc, sizeof(crc));
+            s_key = key;
+            s_pending_length = header.length;
+            return write_record(Stage::append, bytes);
+        }
+
+        /// start removing `key`
+        static Status remove(const uint16_t key) noexcept {
+            if (key >= KEYS || s_sector == 0) { return Status::invalid; }
+            if (s_where[key] == nowhere) { return Status::ok; }
+            if (busy()) { return Status::busy; }
+            if (!reserve(sizeof(record_header), false)) { return stalled(); }
+            const record_header header{key, 0, 0};
+            std::memcpy(record(), &header, sizeof(header));
+            const uint32_t crc = record_crc();
+            std::memcpy(record() + offsetof(record_header, crc), &crc, sizeof(crc));
+            s_key = key;
+            s_pending_length = 0;
+            return write_record(Stage::append, sizeof(record_header));
+        }
+
+        /**
+         * read the value of `key` into `data`, at most data.size() bytes; `length` is set to the stored length.
+         * Waits for the read. Status::invalid if the key is not stored or the record fails its crc.
+         */
+        static Status get(const uint16_t key, const std::span<uint8_t> data, std::size_t& length) noexcept {
+            if (key >= KEYS || s_where[key] == nowhere) { return Status::invalid; }
+            if (busy()) { return Status::busy; }
+            const uint32_t bytes = record_bytes(s_length[key]);
+            if (const Status s = read_blocking(s_where[key], std::span<uint8_t>(record(), bytes)); s != Status::ok) { return s; }
+            record_header header;
+            std::memcpy(&header, record(), sizeof(header));
+            if (header.key != key || header.length != s_length[key] || record_crc() != header.crc) { return Status::invalid; }
+            length = header.length;
+            std::memcpy(data.data(), record() + sizeof(header), std::min<std::size_t>(data.size(), header.length));
+            return Status::ok;
+        }
+
+        [[nodiscard]] static bool contains(const uint16_t key) noexcept { return key < KEYS && s_where[key] != nowhere; }
+
+        /// stored length of `key`, 0 if it is not stored
+        [[nodiscard]] static std::size_t size(const uint16_t key) noexcept { return contains(key) ? s_length[key] : 0; }
+
+        /**
+         * finish the append or garbage collection step in progress and start the next collection step when
+         * needed. Call from the main loop or a timer. Returns busy().
+         */
+        static bool poll() noexcept {
+            switch (s_stage) {
+            case Stage::append:
+            case Stage::relocate_write:
+                if (dma::poll()) { return true; }
+                s_stage = Stage::idle;
+                if (dma::status() != Status::ok) {
+                    s_status = dma::status();
+                    s_offset = s_sector;            // what the failed program left is unknown, start a new sector next time
+                    break;
+                }
+                commit(s_key, s_pending_length, s_pending_at, s_pending_bytes, s_head);
+                break;
+            case Stage::relocate_read:
+                if (dma::busy()) { return true; }
+                s_stage = Stage::idle;
+                if (dma::status() != Status::ok) {
+                    s_status = dma::status();
+                    break;
+                }
+                s_pending_length = s_length[s_key];
+                if (!reserve(record_bytes(s_pending_length), true)) {
+                    s_status = Status::invalid;
+                    break;
+                }
+                if (const Status s = write_record(Stage::relocate_write, record_bytes(s_pending_length)); s != Status::ok) { s_status = s; }
+                return busy();
+            case Stage::erase:
+                if (pipeline::poll()) { return true; }
+                s_stage = Stage::idle;
+                if (pipeline::status() != Status::ok) {
+                    s_status = pipeline::status();
+                    break;
+                }
+                s_dead_total -= s_used[s_tail];
+                s_used[s_tail] = 0;
+                s_live[s_tail] = 0;
+                s_tail = next(s_tail);
+                ++s_free;
+                break;
+            case Stage::idle:
+                break;
+            }
+            if (s_free < 2 && s_status == Status::ok && reclaimable() != 0) { collect(); }
+            return busy();
+        }
+
+        /// poll until the append and any garbage collection it made necessary are done
+        static Status wait() noexcept {
+            while (poll()) { }
+            return s_status;
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return s_stage != Stage::idle; }
+
+        /// first error of an append or garbage collection step, Status::ok if none. Garbage collection stops on it.
+        [[nodiscard]] static Status status() noexcept { return s_status; }
+
+        /**
+         * forget the error so that the next poll() resumes garbage collection, e.g. after a transient bus error.
+         * A failed append is simply lost; a failed relocation or erase is retried. Returns the error.
+         */
+        static Status clear() noexcept {
+            const Status s = s_status;
+            s_status = Status::ok;
+            return s;
+        }
+
+        /// bytes of live records and of records that garbage collection can reclaim
+        [[nodiscard]] static uint32_t live_bytes() noexcept { return s_live_total; }
+        [[nodiscard]] static uint32_t dead_bytes() noexcept { return s_dead_total; }
+
+        /// erased sectors ready for appends
+        [[nodiscard]] static std::size_t free_sectors() noexcept { return s_free; }
+
+        /// DMA and command queue interrupts. Call from the MSPI interrupt handler.
+        static void isr() noexcept {
+            dma::isr();
+            pipeline::isr();
+        }
+    };  // class log_store
+
+}   // namespace MSPI
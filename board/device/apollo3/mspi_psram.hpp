@@ -0,0 +1,247 @@
+#pragma once
+
+#include "critical_section.hpp"
+#include "mspi.hpp"
+#include "mspi_dma.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace MSPI {
+
+    /// a PSRAM part: bus setup once in quad (QPI) mode and its capacity
+    struct psram_part {
+        device_config bus{};
+        uint32_t size = 0;                      ///< bytes
+        uint8_t  enter_quad = 0x35;             ///< sent in SPI mode after the reset, 0 if the part starts in QPI
+        uint32_t tcem_ns = 8000;                ///< maximum chip select low time, limits the DMA chunk
+    };
+
+    namespace psram_parts {
+        /// AP Memory APS6404L, 8 MB: QPI fast quad read 0xEB with 6 wait clocks, quad write 0x38
+        constexpr psram_part aps6404l{device_config{Frame::QUAD0, Divider::CLK48, 3, 6, Mixed::normal, 0xEB, 0x38}, 8u << 20};
+    }
+
+    /// DMA profile for a PSRAM: 1 KB wrap pages and as many bytes per command as fit in tCEM with the
+    /// 14 clocks of instruction, address and wait cycles in front
+    constexpr memory_profile psram_profile(const psram_part& part) noexcept {
+        const uint32_t clock_mhz = 48u / static_cast<uint32_t>(part.bus.divider);
+        const uint32_t lines = (static_cast<uint32_t>(part.bus.frame) >= 0xD) ? 8u : 4u;
+        const uint32_t clocks = part.tcem_ns * clock_mhz / 1000u;
+        const uint32_t bytes = (clocks > 14u) ? (clocks - 14u) * lines / 8u : 4u;
+        return memory_profile{1024, static_cast<uint32_t>(std::min<std::size_t>(bytes, max_dma_bytes)) & ~3u, false};
+    }
+
+    /// a range of PSRAM handed out by an arena or pool. `address` is the device address.
+    struct psram_block {
+        uint32_t address = 0;
+        uint32_t size = 0;
+
+        [[nodiscard]] constexpr explicit operator bool() const noexcept { return size != 0; }
+
+        /// where the core sees the block while the PSRAM is mapped with XIP
+        [[nodiscard]] constexpr uint32_t window() const noexcept { return xip_base + address; }
+    };
+
+    /**
+     * Bump allocator over a range of PSRAM. Blocks are only given back all at once, with release() to an
+     * earlier mark() or reset(), which suits buffers whose lifetimes nest (a recording, a processing pass).
+     * Not interrupt safe; allocate from one context or carve pools from it at startup.
+     */
+    class arena {
+        uint32_t m_base = 0;
+        uint32_t m_end = 0;
+        uint32_t m_next = 0;
+
+    public:
+        constexpr arena() noexcept = default;
+        constexpr arena(const uint32_t base, const uint32_t size) noexcept : m_base(base), m_end(base + size), m_next(base) { }
+
+        /// `size` bytes aligned to `align` (a power of two), an empty block if the arena is exhausted
+        constexpr psram_block allocate(const uint32_t size, const uint32_t align = 32) noexcept {
+            const uint32_t at = (m_next + align - 1u) & ~(align - 1u);
+            if (size == 0 || at < m_next || at > m_end || m_end - at < size) { return psram_block{}; }
+            m_next = at + size;
+            return psram_block{at, size};
+        }
+
+        [[nodiscard]] constexpr uint32_t mark() const noexcept { return m_next; }
+
+        /// free everything allocated since `mark`
+        constexpr void release(const uint32_t mark) noexcept {
+            if (mark >= m_base && mark <= m_next) { m_next = mark; }
+        }
+
+        constexpr void reset() noexcept { m_next = m_base; }
+
+        [[nodiscard]] constexpr uint32_t used() const noexcept { return m_next - m_base; }
+        [[nodiscard]] constexpr uint32_t available() const noexcept { return m_end - m_next; }
+    };  // class arena
+
+    /**
+     * COUNT blocks of BLOCK bytes of PSRAM with a free bitmap in SRAM. allocate() and free() are O(words) and
+     * interrupt safe, so a sampling ISR can take blocks while the main loop returns drained ones.
+     */
+    template <uint32_t BLOCK, std::size_t COUNT>
+    class pool {
+        static_assert(BLOCK != 0 && BLOCK % 4 == 0, "pool blocks must be whole words for the DMA");
+        static_assert(COUNT != 0, "empty pool");
+
+        static constexpr std::size_t words = (COUNT + 31) / 32;
+
+        uint32_t m_base = 0;
+        std::array<uint32_t, words> m_free{};       // set bit = free block
+        std::size_t m_available = 0;
+
+    public:
+        static constexpr uint32_t block_size = BLOCK;
+        static constexpr std::size_t capacity = COUNT;
+
+        /// take the pool's memory from `from`. Returns false if the arena has no room for it.
+        bool attach(arena& from) noexcept {
+            const psram_block range = from.allocate(BLOCK * static_cast<uint32_t>(COUNT));
+            if (!range) { return false; }
+            util::critical_section lock;
+            m_base = range.address;
+            for (std::size_t i = 0; i < COUNT; ++i) { m_free[i / 32] |= 1u << (i % 32); }
+            m_available = COUNT;
+            return true;
+        }
+
+        /// a free block, or an empty one if all are in use
+        psram_block allocate() noexcept {
+            util::critical_section lock;
+            for (std::size_t w = 0; w < words; ++w) {
+                if (m_free[w] == 0) { continue; }
+                const unsigned bit = static_cast<unsigned>(__builtin_ctz(m_free[w]));
+                m_free[w] &= ~(1u << bit);
+                --m_available;
+                return psram_block{m_base + static_cast<uint32_t>(w * 32 + bit) * BLOCK, BLOCK};
+            }
+            return psram_block{};
+        }
+
+        /// give a block back. Returns false for a block that is not from this pool or already free.
+        bool free(const psram_block& block) noexcept {
+            if (block.address < m_base || (block.address - m_base) % BLOCK != 0) { return false; }
+            const std::size_t index = (block.address - m_base) / BLOCK;
+            if (index >= COUNT) { return false; }
+            util::critical_section lock;
+            const uint32_t bit = 1u << (index % 32);
+            if (m_free[index / 32] & bit) { return false; }
+            m_free[index / 32] |= bit;
+            ++m_available;
+            return true;
+        }
+
+        [[nodiscard]] bool owns(const psram_block& block) const noexcept {
+            return block.address >= m_base && block.address < m_base + BLOCK * COUNT;
+        }
+
+        [[nodiscard]] std::size_t available() const noexcept { return m_available; }
+    };  // class pool
+
+    /**
+     * Slab classes: one pool per block size, SIZES ascending, COUNT blocks each. allocate() serves a request
+     * from the smallest class that fits and falls back to larger ones when that class is empty.
+     */
+    template <std::size_t COUNT, uint32_t... SIZES>
+    class slab_heap {
+        static_assert(sizeof...(SIZES) != 0, "slab_heap needs at least one class");
+
+        template <uint32_t SIZE>
+        struct slab { pool<SIZE, COUNT> blocks; };
+
+        struct classes : slab<SIZES>... { };
+        classes m_classes{};
+
+    public:
+        /// carve all classes from `from`
+        bool attach(arena& from) noexcept {
+            return (static_cast<slab<SIZES>&>(m_classes).blocks.attach(from) && ...);
+        }
+
+        psram_block allocate(const uint32_t size) noexcept {
+            psram_block block{};
+            ((block = (!block && size <= SIZES) ? static_cast<slab<SIZES>&>(m_classes).blocks.allocate() : block), ...);
+            return block;
+        }
+
+        bool free(const psram_block& block) noexcept {
+            return ((static_cast<slab<SIZES>&>(m_classes).blocks.owns(block) && static_cast<slab<SIZES>&>(m_classes).blocks.free(block)) || ...);
+        }
+
+        /// free blocks of the class that serves `size`
+        [[nodiscard]] std::size_t available(const uint32_t size) const noexcept {
+            std::size_t count = 0;
+            bool found = false;
+            ((count = (!found && size <= SIZES) ? (found = true, static_cast<const slab<SIZES>&>(m_classes).blocks.available()) : count), ...);
+            return count;
+        }
+    };  // class slab_heap
+
+    /**
+     * PSRAM access for one MSPI: init() resets the part, switches it to QPI and sets up the bus and the DMA
+     * profile; store() and load() move data between SRAM and a block with dma_engine, in chunks that respect
+     * the chip select low time, so the CPU is free while they run. copy() moves data between two blocks through
+     * an SRAM bounce buffer.
+     */
+    template <typename MSPI_T>
+    class psram {
+        using ctrl = controller<MSPI_T>;
+        using dma = dma_engine<MSPI_T>;
+
+        [[nodiscard]] static bool inside(const psram_block& block, const uint32_t offset, const std::size_t size) noexcept {
+            return block && size != 0 && offset <= block.size && size <= block.size - offset;
+        }
+
+    public:
+        /// reset the part and put it in quad mode. The MSPI must be powered and its pads selected.
+        static Status init(const psram_part& part) noexcept {
+            device_config spi = part.bus;
+            spi.frame = part.bus.chip_select1() ? Frame::SERIAL1 : Frame::SERIAL0;
+            if (!ctrl::configure(spi)) { return Status::invalid; }
+            for (const uint8_t instruction : {uint8_t{0x66}, uint8_t{0x99}, part.enter_quad}) {
+                if (instruction == 0) { continue; }
+                if (const Status s = ctrl::command(instruction); s != Status::ok) { return s; }
+            }
+            if (!ctrl::configure(part.bus) || !dma::configure(psram_profile(part))) { return Status::invalid; }
+            return Status::ok;
+        }
+
+        /// start writing `data` to `block` at `offset`
+        static Status store(const psram_block& block, const uint32_t offset, const std::span<const uint8_t> data) noexcept {
+            if (!inside(block, offset, data.size())) { return Status::invalid; }
+            return dma::write(block.address + offset, data);
+        }
+
+        /// start reading `data.size()` bytes of `block` from `offset`
+        static Status load(const psram_block& block, const uint32_t offset, const std::span<uint8_t> data) noexcept {
+            if (!inside(block, offset, data.size())) { return Status::invalid; }
+            return dma::read(block.address + offset, data);
+        }
+
+        /// copy `size` bytes between blocks through `bounce` in SRAM. Blocks until done.
+        static Status copy(const psram_block& to, const uint32_t to_offset, const psram_block& from, const uint32_t from_offset,
+                           const std::size_t size, const std::span<uint8_t> bounce) noexcept {
+            if (!inside(to, to_offset, size) || !inside(from, from_offset, size) || bounce.empty()) { return Status::invalid; }
+            for (std::size_t done = 0; done < size; done += bounce.size()) {
+                const std::size_t n = (size - done < bounce.size()) ? size - done : bounce.size();
+                const std::span<uint8_t> part = bounce.first(n);
+                Status s = dma::read(from.address + from_offset + static_cast<uint32_t>(done), part);
+                if (s == Status::ok) { s = dma::wait(); }
+                if (s == Status::ok) { s = dma::write(to.address + to_offset + static_cast<uint32_t>(done), part); }
+                if (s == Status::ok) { s = dma::wait(); }
+                if (s != Status::ok) { return s; }
+            }
+            return Status::ok;
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return dma::busy(); }
+
+        static Status wait() noexcept { return dma::wait(); }
+    };  // class psram
+
+}   // namespace MSPI
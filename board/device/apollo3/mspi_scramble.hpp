@@ -0,0 +1,208 @@
+#pragma once
+
+#include "mspi.hpp"
+#include "mspi_dma.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace MSPI {
+
+    constexpr uint32_t scramble_block = 0x10000;    // SCRAMBLING granularity
+
+    /// range of 64 KB blocks of device addresses that the MSPI scrambles, both ends included
+    struct scramble_region {
+        using SCRAMBLING_t = registers::SCRAMBLING_t;
+
+        uint16_t first = 1;
+        uint16_t last = 0;
+
+        /// the blocks covering [address, address + size)
+        [[nodiscard]] static constexpr scramble_region covering(const uint32_t address, const uint32_t size) noexcept {
+            if (size == 0) { return scramble_region{}; }
+            return scramble_region{static_cast<uint16_t>(address / scramble_block), static_cast<uint16_t>((address + size - 1u) / scramble_block)};
+        }
+
+        [[nodiscard]] constexpr bool valid() const noexcept { return first <= last && last <= SCRAMBLING_t::SCRSTART.mask; }
+
+        [[nodiscard]] constexpr uint32_t address() const noexcept { return uint32_t{first} * scramble_block; }
+        [[nodiscard]] constexpr uint32_t size() const noexcept { return valid() ? (uint32_t{last} - first + 1u) * scramble_block : 0; }
+
+        [[nodiscard]] constexpr bool contains(const uint32_t from, const std::size_t length) const noexcept {
+            return valid() && from >= address() && from - address() <= size() && length <= size() - (from - address());
+        }
+
+        /// SCRAMBLING image with SCRENABLE set
+        [[nodiscard]] constexpr uint32_t scrambling() const noexcept {
+            return (SCRAMBLING_t::SCRENABLE.shift(true) | SCRAMBLING_t::SCREND.shift(last) | SCRAMBLING_t::SCRSTART.shift(first)).value;
+        }
+    };
+
+    /**
+     * Storage in a scrambled region of the external memory. The MSPI scrambles every XIP and DMA access to the
+     * region by word, so a transfer that starts off a word boundary fails with SCRERR and a partial word write
+     * leaves the rest of the word unreadable. The store never hands such a transfer to the hardware:
+     *
+     * - read() takes any range. The word aligned middle goes straight into the caller's buffer by DMA; the one
+     *   to three bytes at either end are read as whole words first.
+     * - write() needs a word aligned address. A length that is not a whole number of words is padded with 0xFF
+     *   to the next word, which then counts as written.
+     * - put() batches small writes to sequential addresses in two STAGE byte buffers and writes each full buffer
+     *   with a single DMA while the other one fills, so records of any size go out at DMA speed.
+     *
+     * Transfers use dma_engine with whatever memory_profile it has been configured with, so the same store
+     * works on a NOR flash (erased beforehand) or a PSRAM. As with dma_engine, call poll() while a flash write
+     * runs and dma_engine::isr() from the MSPI interrupt handler. The region can only be changed while no
+     * transfer and no XIP access is in progress.
+     */
+    template <typename MSPI_T, std::size_t STAGE = 1024>
+    class secure_store {
+        static_assert(STAGE != 0 && STAGE % 4 == 0 && STAGE <= max_dma_bytes, "stage size must be whole words within one DMA");
+
+        using dma = dma_engine<MSPI_T>;
+
+        static inline scramble_region s_region{};
+        alignas(4) static inline uint8_t s_edge[4] = {};
+        alignas(4) static inline uint8_t s_stage[2][STAGE] = {};
+        static inline uint8_t s_current = 0;            // stage put() fills
+        static inline std::size_t s_filled = 0;         // bytes in the current stage
+        static inline uint32_t s_stream = 0;            // device address of the current stage
+
+        /// read the word at `address` into s_edge and wait for it
+        static Status read_word(const uint32_t address) noexcept {
+            if (const Status s = dma::read(address, s_edge); s != Status::ok) { return s; }
+            return dma::wait();
+        }
+
+        /// write the current stage, padded to a word, and switch to the other one
+        static Status send() noexcept {
+            const std::size_t size = (s_filled + 3u) & ~std::size_t{3};
+            std::fill(s_stage[s_current] + s_filled, s_stage[s_current] + size, uint8_t{0xFF});
+            if (const Status s = dma::write(s_stream, std::span<const uint8_t>(s_stage[s_current], size)); s != Status::ok) { return s; }
+            s_stream += static_cast<uint32_t>(size);
+            s_current ^= 1u;
+            s_filled = 0;
+            return Status::ok;
+        }
+
+    public:
+        /// scramble `region` from now on. Returns false while a transfer runs or for an invalid region.
+        static bool init(const scramble_region& region) noexcept {
+            if (!region.valid() || dma::busy()) { return false; }
+            s_region = region;
+            MSPI_T::SCRAMBLING.write(region.scrambling());
+            return true;
+        }
+
+        /// stop scrambling; the region reads back as stored on the device
+        static void disable() noexcept {
+            MSPI_T::SCRAMBLING.write(0);
+            s_region = scramble_region{};
+        }
+
+        [[nodiscard]] static const scramble_region& region() noexcept { return s_region; }
+
+        /// start reading `data.size()` bytes at device `address`, which must lie in the region
+        static Status read(const uint32_t address, const std::span<uint8_t> data) noexcept {
+            if (data.empty() || !s_region.contains(address, data.size())) { return Status::invalid; }
+            if (dma::busy()) { return Status::busy; }
+            const uint32_t end = address + static_cast<uint32_t>(data.size());
+            const uint32_t inner = (address + 3u) & ~3u;     // first whole word
+            const uint32_t outer = end & ~3u;                // end of the last whole word
+
+            if (inner >= outer) {                            // within one or two words
+                for (uint32_t word = address & ~3u; word < end; word += 4) {
+                    if (const Status s = read_word(word); s != Status::ok) { return s; }
+                    const uint32_t from = std::max(word, address);
+                    const uint32_t to = std::min(word + 4u, end);
+                    std::memcpy(data.data() + (from - address), s_edge + (from - word), to - from);
+                }
+                return Status::ok;
+            }
+            if (address != inner) {
+                if (const Status s = read_word(address & ~3u); s != Status::ok) { return s; }
+                std::memcpy(data.data(), s_edge + (address & 3u), inner - address);
+            }
+            if (end != outer) {
+                if (const Status s = read_word(outer); s != Status::ok) { return s; }
+                std::memcpy(data.data() + (outer - address), s_edge, end - outer);
+            }
+            return dma::read(inner, data.subspan(inner - address, outer - inner));
+        }
+
+        /// start writing `data` at the word aligned device `address` in the region. A partial last word is padded with 0xFF.
+        static Status write(const uint32_t address, const std::span<const uint8_t> data) noexcept {
+            const std::size_t padded = (data.size() + 3u) & ~std::size_t{3};
+            if (data.empty() || (address & 3u) || !s_region.contains(address, padded)) { return Status::invalid; }
+            if (dma::busy()) { return Status::busy; }
+            const std::size_t whole = data.size() & ~std::size_t{3};
+            if (whole != data.size()) {
+                std::fill(std::begin(s_edge), std::end(s_edge), uint8_t{0xFF});
+                std::memcpy(s_edge, data.data() + whole, data.size() - whole);
+                Status s = dma::write(address + static_cast<uint32_t>(whole), s_edge);
+                if (s == Status::ok) { s = dma::wait(); }
+                if (s != Status::ok || whole == 0) { return s; }
+            }
+            return dma::write(address, data.first(whole));
+        }
+
+        /// begin a batched write at the word aligned device `address`, see put()
+        static Status stream(const uint32_t address) noexcept {
+            if ((address & 3u) || !s_region.contains(address, 4)) { return Status::invalid; }
+            s_stream = address;
+            s_filled = 0;
+            return Status::ok;
+        }
+
+        /**
+         * append `data` to the batched write. Returns the bytes taken: fewer than data.size() when both stages
+         * are full because the previous one is still being written, or the end of the region is reached.
+         */
+        static std::size_t put(std::span<const uint8_t> data) noexcept {
+            std::size_t taken = 0;
+            while (!data.empty()) {
+                const std::size_t room = std::min<std::size_t>(STAGE - s_filled, s_region.address() + s_region.size() - s_stream - s_filled);
+                const std::size_t n = std::min(room, data.size());
+                if (n == 0) { break; }
+                std::memcpy(s_stage[s_current] + s_filled, data.data(), n);
+                s_filled += n;
+                taken += n;
+                data = data.subspan(n);
+                if (s_filled == STAGE && (dma::busy() || send() != Status::ok)) { break; }
+            }
+            return taken;
+        }
+
+        /// write what put() has staged. The batch continues at the next word; padding bytes are 0xFF.
+        static Status flush() noexcept {
+            if (s_filled == 0) { return Status::ok; }
+            if (dma::busy()) { return Status::busy; }
+            return send();
+        }
+
+        /// device address the next put() byte goes to
+        [[nodiscard]] static uint32_t position() noexcept { return s_stream + static_cast<uint32_t>(s_filled); }
+
+        /// continue a flash write and start a full stage once the previous one is done. Returns busy().
+        static bool poll() noexcept {
+            const bool running = dma::poll();
+            if (!running && s_filled == STAGE) { send(); }
+            return dma::busy();
+        }
+
+        [[nodiscard]] static bool busy() noexcept { return dma::busy(); }
+
+        /// wait for the transfer in progress, then write a full stage left by put()
+        static Status wait() noexcept {
+            Status s = dma::wait();
+            if (s == Status::ok && s_filled == STAGE) {
+                s = send();
+                if (s == Status::ok) { s = dma::wait(); }
+            }
+            return s;
+        }
+    };  // class secure_store
+
+}   // namespace MSPI
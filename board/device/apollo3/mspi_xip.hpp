@@ -0,0 +1,164 @@
+#pragma once
+
+#include "mspi.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Placement of read-only data and cold code in the external flash. The sections are collected by
+ * script/mspi_xip.ld into the .mspi_xip output section at xip_base; the build turns that section into a
+ * separate image for the external flash programmer. Code placed with MSPI_XIP_CODE is reached through the -mlong-calls the
+ * target build already uses, and must not run while XIP is being set up or disabled.
+ */
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+#define MSPI_XIP_CONST
+#define MSPI_XIP_CODE
+#else
+#define MSPI_XIP_CONST __attribute__((section(".mspi_xip.rodata")))
+#define MSPI_XIP_CODE  __attribute__((section(".mspi_xip.text"), noinline))
+#endif
+
+#if !(defined(SIMULATION_BUILD) && SIMULATION_BUILD)
+extern "C" const uint8_t __mspi_xip_start[];   // NOLINT: defined by script/mspi_xip.ld
+extern "C" const uint8_t __mspi_xip_end[];     // NOLINT
+#endif
+
+namespace MSPI {
+
+    /// command sent once at XIP setup, e.g. to set the quad enable bit of a status register
+    struct setup_command {
+        uint8_t instruction = 0;
+        uint8_t size = 0;                       ///< data bytes, 0-3
+        std::array<uint8_t, 3> data{};
+        bool    write_enable = false;           ///< send WREN (0x06) first
+        bool    wait = false;                   ///< poll the status register until the device is ready afterwards
+    };
+
+    /// an external flash part: bus setup, capacity and what has to be sent before it can be read in place
+    struct flash_part {
+        device_config bus{};
+        uint32_t size = 0;                      ///< bytes
+        std::array<setup_command, 2> setup{};
+        uint8_t setup_count = 0;
+        uint8_t status_instruction = 0x05;      ///< read status register
+        uint8_t busy_mask = 0x01;               ///< write in progress
+    };
+
+    namespace flash_parts {
+        /// any SPI NOR flash with serial fast read (0x0B, 8 dummy clocks) and nothing to set up
+        constexpr flash_part serial_nor(const uint32_t bytes, const Divider divider = Divider::CLK24) noexcept {
+            flash_part part{};
+            part.bus.divider = divider;
+            part.bus.address_bytes = (bytes > 0x1000000u) ? 4 : 3;
+            part.size = bytes;
+            return part;
+        }
+
+        /// Macronix MX25R6435F, 8 MB: 1-4-4 quad IO read (0xEB, mode and dummy 6 clocks) after setting SR.QE
+        constexpr flash_part mx25r6435f = [] {
+            flash_part part{};
+            part.bus = device_config{Frame::SERIAL0, Divider::CLK24, 3, 6, Mixed::ad4, 0xEB, 0x38};
+            part.size = 8u << 20;
+            part.setup[0] = setup_command{0x01, 1, {0x40, 0, 0}, true, true};
+            part.setup_count = 1;
+            return part;
+        }();
+    }
+
+    /**
+     * Execute in place: maps the external flash at xip_base so the core reads and executes it like internal
+     * memory, through the flash cache. init() configures CFG, FLASH, PADCFG and PADOUTEN for the part, runs its
+     * setup commands with programmed IO and enables XIPEN. The MSPI must be powered, see MSPI::power(), and its
+     * pads selected by the board.
+     *
+     * Anything that changes the flash contents (programmed IO, DMA writes) has to run with XIP disabled and
+     * not from XIP, and must be followed by invalidate() so the cache drops lines it holds for the old data.
+     */
+    template <typename MSPI_T, typename CACHECTRL_T>
+    class xip {
+        using ctrl = controller<MSPI_T>;
+
+        using CACHECFG_t = typename CACHECTRL_T::CACHECFG_t;
+
+        static constexpr uint32_t xipen = MSPI_T::FLASH_t::XIPEN.mask;
+        static constexpr uint32_t cache_enable = CACHECFG_t::ENABLE.mask | CACHECFG_t::ICACHE_ENABLE.mask | CACHECFG_t::DCACHE_ENABLE.mask;
+        static constexpr uint32_t cache_invalidate = CACHECTRL_T::CTRL_t::INVALIDATE.mask;
+        static constexpr uint32_t cache_ready = CACHECTRL_T::CTRL_t::CACHE_READY.mask;
+
+        static inline flash_part s_part{};
+
+    public:
+        /// configure the MSPI for `part`, send its setup commands and map it. Returns the first failure.
+        static Status init(const flash_part& part) noexcept {
+            if (part.size == 0 || part.size > xip_size || part.setup_count > part.setup.size()) { return Status::invalid; }
+            if (!ctrl::configure(part.bus)) { return Status::invalid; }
+            s_part = part;
+            for (std::size_t i = 0; i < part.setup_count; ++i) {
+                const setup_command& setup = part.setup[i];
+                if (setup.write_enable) {
+                    if (const Status s = ctrl::command(0x06); s != Status::ok) { return s; }
+                }
+                const Status s = ctrl::write(setup.instruction, std::span<const uint8_t>(setup.data.data(), setup.size));
+                if (s != Status::ok) { return s; }
+                if (setup.wait) {
+                    if (const Status w = wait_ready(); w != Status::ok) { return w; }
+                }
+            }
+            if ((CACHECTRL_T::CACHECFG.read() & cache_enable) != cache_enable) { CACHECTRL_T::CACHECFG |= cache_enable; }
+            enable();
+            invalidate();
+            return Status::ok;
+        }
+
+        /// poll the status register of the flash until its busy bit clears. XIP must be disabled.
+        static Status wait_ready(uint32_t spin_limit = default_spin_limit) noexcept {
+            uint8_t status = 0;
+            do {
+                if (const Status s = ctrl::read(s_part.status_instruction, std::span<uint8_t>(&status, 1)); s != Status::ok) { return s; }
+                if (!(status & s_part.busy_mask)) { return Status::ok; }
+            } while (spin_limit-- != 0);
+            return Status::timeout;
+        }
+
+        static void enable() noexcept { MSPI_T::FLASH.write(s_part.bus.flash(true)); }
+
+        /// stop XIP, e.g. before programmed IO to the flash. Must not be called from code placed in XIP.
+        static void disable() noexcept {
+            MSPI_T::FLASH.write(s_part.bus.flash(false));
+            while (ctrl::busy()) { }
+        }
+
+        [[nodiscard]] static bool enabled() noexcept { return MSPI_T::FLASH.read() & xipen; }
+
+        /// drop cached lines, after the flash contents have changed behind the cache
+        static void invalidate() noexcept {
+            CACHECTRL_T::CTRL.write(cache_invalidate);
+            for (uint32_t spin = default_spin_limit; spin != 0 && !(CACHECTRL_T::CTRL.read() & cache_ready); --spin) { }
+        }
+
+        /// core address of byte `offset` of the flash
+        [[nodiscard]] static constexpr uint32_t address(const uint32_t offset) noexcept { return xip_base + offset; }
+
+        /// flash offset of an object placed with MSPI_XIP_CONST, e.g. to update it with programmed IO
+        [[nodiscard]] static uint32_t offset(const void* object) noexcept {
+            return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(object)) - xip_base;
+        }
+
+        /// true if [object, object + size) lies in the mapped flash
+        [[nodiscard]] static bool contains(const void* object, const std::size_t size = 1) noexcept {
+            const uintptr_t at = reinterpret_cast<uintptr_t>(object);
+            return at >= xip_base && at + size <= xip_base + s_part.size;
+        }
+
+        [[nodiscard]] static const flash_part& part() noexcept { return s_part; }
+
+#if !(defined(SIMULATION_BUILD) && SIMULATION_BUILD)
+        /// bytes the linker placed in the .mspi_xip section, to check the external image fits and matches
+        [[nodiscard]] static std::size_t image_size() noexcept {
+            return static_cast<std::size_t>(__mspi_xip_end - __mspi_xip_start);
+        }
+#endif
+    };  // class xip
+
+}   // namespace MSPI
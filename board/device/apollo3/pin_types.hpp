@@ -1,38 +1,240 @@
 #pragma once
 
+#include "GPIO.hpp"
+#include "register.hpp"
 #include <cstdint>
+#include <array>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <algorithm>
 
 namespace GPIO {
+
+    /**
+     * Pad configuration flags. The low byte maps directly onto the PADREG byte of a pad (excluding FNCSEL)
+     * and bits 8-11 map onto the 4-bit CFG field of the pad, so a PinConfig can be merged into a register
+     * image without any translation.
+     */
+    enum class PinConfig : uint16_t {
+        MODE_FLOATING   = 0x0000,   ///< no pull resistor
+        MODE_PULLUP     = 0x0001,   ///< PADREG PULL. NOTE: pad 20 has a pulldown instead of a pullup!
+        INPUT_ENABLE    = 0x0002,   ///< PADREG INPEN, enable the input buffer
+        DRIVE_12MA      = 0x0004,   ///< PADREG STRNG, high drive strength
+        PULLUP_1_5K     = 0x0000,   ///< PADREG RSEL, only on I2C capable pads
+        PULLUP_6K       = 0x0040,   ///< PADREG RSEL, only on I2C capable pads
+        PULLUP_12K      = 0x0080,   ///< PADREG RSEL, only on I2C capable pads
+        PULLUP_24K      = 0x00C0,   ///< PADREG RSEL, only on I2C capable pads
+        READ_ZERO       = 0x0100,   ///< CFG INCFG, GPIO reads return zero
+        MODE_TOTEM      = 0x0200,   ///< CFG OUTCFG, push-pull output
+        MODE_OPENDRAIN  = 0x0400,   ///< CFG OUTCFG, open drain output
+        MODE_TRISTATE   = 0x0600,   ///< CFG OUTCFG, tri-state output controlled by ENA/ENB
+        INT_HIGH_TO_LOW = 0x0800,   ///< CFG INTD, interrupt on falling edge
+    };
+
+    constexpr PinConfig operator|(const PinConfig lhs, const PinConfig rhs) noexcept {
+        return static_cast<PinConfig>(static_cast<uint16_t>(lhs) | static_cast<uint16_t>(rhs));
+    }
+
+    constexpr uint8_t padreg_mask = 0xC7;   // PADREG bits owned by PinConfig: RSEL, STRNG, INPEN, PULL
+    constexpr uint8_t fncsel_gpio = 0x3;    // FNCSEL value that connects every pad to the GPIO block
+
+    /// The complete configuration of one pad: its PADREG byte, its CFG nibble and an optional output level.
+    struct pad_config {
+        uint8_t padreg = fncsel_gpio << 3;  // reset value: GPIO function, input disabled, no pull
+        uint8_t cfg    = 0;                 // reset value: output disabled
+        int8_t  level  = -1;                // initial output level, -1 leaves the output register untouched
+        bool    enable = false;             // set the pad's ENA/ENB bit, needed for MODE_TRISTATE outputs
+    };
+
+    /// build a pad_config from a function select and a set of PinConfig flags
+    constexpr pad_config make_pad_config(const uint8_t fncsel, const PinConfig config, const int8_t level = -1,
+                                         const bool enable = false) noexcept {
+        const auto flags = static_cast<uint16_t>(config);
+        return pad_config{ static_cast<uint8_t>((flags & padreg_mask) | ((fncsel & 0x7) << 3)),
+                           static_cast<uint8_t>((flags >> 8) & 0xF),
+                           level,
+                           enable };
+    }
+
+    /// a pad_config bound to a pad number, the unit that role types hand to init_all()
+    struct pad_setting {
+        uint8_t    pin;
+        pad_config config;
+    };
+
+    /***************************************  PAD FUNCTION TABLE  ******************************************/
+
+    /// peripheral signals that role types can request from the pad mux
+    enum class Signal : uint8_t { SCK, MISO, MOSI, SCL, SDA, UART_TX, UART_RX };
+
+    struct pad_function {
+        uint8_t pad;
+        uint8_t fncsel;
+        Signal  signal;
+        uint8_t instance;   // IOM or UART number
+    };
+
+    /// every IOM and UART signal available on each pad, taken from the PADnFNCSELv enumerations
+    inline constexpr pad_function pad_functions[] = {
+        {1, 2, Signal::UART_TX, 0},
+        {2, 0, Signal::UART_RX, 1}, {2, 2, Signal::UART_RX, 0},
+        {4, 5, Signal::UART_RX, 0},
+        {5, 0, Signal::SCL, 0}, {5, 1, Signal::SCK, 0},
+        {6, 0, Signal::SDA, 0}, {6, 1, Signal::MISO, 0},
+        {7, 1, Signal::MOSI, 0}, {7, 5, Signal::UART_TX, 0},
+        {8, 0, Signal::SCL, 1}, {8, 1, Signal::SCK, 1}, {8, 6, Signal::UART_TX, 1},
+        {9, 0, Signal::SDA, 1}, {9, 1, Signal::MISO, 1}, {9, 6, Signal::UART_RX, 1},
+        {10, 1, Signal::MOSI, 1},
+        {11, 6, Signal::UART_RX, 0},
+        {12, 7, Signal::UART_TX, 1},
+        {13, 7, Signal::UART_RX, 1},
+        {14, 2, Signal::UART_TX, 1},
+        {15, 2, Signal::UART_RX, 1},
+        {16, 6, Signal::UART_TX, 0},
+        {17, 6, Signal::UART_RX, 0},
+        {18, 6, Signal::UART_TX, 1},
+        {19, 6, Signal::UART_RX, 1},
+        {20, 4, Signal::UART_TX, 0}, {20, 5, Signal::UART_TX, 1},
+        {21, 4, Signal::UART_RX, 0}, {21, 5, Signal::UART_RX, 1},
+        {22, 0, Signal::UART_TX, 0},
+        {23, 0, Signal::UART_RX, 0},
+        {24, 0, Signal::UART_TX, 1},
+        {25, 0, Signal::UART_RX, 1}, {25, 4, Signal::SDA, 2}, {25, 5, Signal::MISO, 2},
+        {26, 6, Signal::UART_TX, 0},
+        {27, 0, Signal::UART_RX, 0}, {27, 4, Signal::SCL, 2}, {27, 5, Signal::SCK, 2},
+        {28, 5, Signal::MOSI, 2}, {28, 6, Signal::UART_TX, 0},
+        {29, 6, Signal::UART_RX, 0},
+        {30, 4, Signal::UART_TX, 0},
+        {31, 4, Signal::UART_RX, 0},
+        {34, 6, Signal::UART_RX, 0},
+        {35, 2, Signal::UART_TX, 1},
+        {36, 2, Signal::UART_RX, 1},
+        {37, 5, Signal::UART_TX, 1},
+        {38, 5, Signal::MOSI, 3}, {38, 6, Signal::UART_RX, 1},
+        {39, 0, Signal::UART_TX, 0}, {39, 1, Signal::UART_TX, 1}, {39, 4, Signal::SCL, 4}, {39, 5, Signal::SCK, 4},
+        {40, 0, Signal::UART_RX, 0}, {40, 1, Signal::UART_RX, 1}, {40, 4, Signal::SDA, 4}, {40, 5, Signal::MISO, 4},
+        {41, 6, Signal::UART_TX, 0},
+        {42, 0, Signal::UART_TX, 1}, {42, 4, Signal::SCL, 3}, {42, 5, Signal::SCK, 3},
+        {43, 0, Signal::UART_RX, 1}, {43, 4, Signal::SDA, 3}, {43, 5, Signal::MISO, 3},
+        {44, 5, Signal::MOSI, 4},
+        {45, 6, Signal::UART_RX, 0},
+        {46, 6, Signal::UART_TX, 1},
+        {47, 5, Signal::MOSI, 5}, {47, 6, Signal::UART_RX, 1},
+        {48, 0, Signal::UART_TX, 0}, {48, 4, Signal::SCL, 5}, {48, 5, Signal::SCK, 5},
+        {49, 0, Signal::UART_RX, 0}, {49, 4, Signal::SDA, 5}, {49, 5, Signal::MISO, 5},
+    };
+
+    constexpr int any_instance = -1;
+
+    /// find the FNCSEL value that connects `signal` of peripheral `instance` to `pad`. Returns -1 if impossible.
+    constexpr int find_function(const unsigned pad, const Signal signal, const int instance = any_instance) noexcept {
+        for (const auto& f : pad_functions) {
+            if (f.pad == pad && f.signal == signal && (instance == any_instance || f.instance == instance)) {
+                return f.fncsel;
+            }
+        }
+        return -1;
+    }
+
+    static_assert(find_function(5, Signal::SCK, 0) == 1, "pad 5 is IOM0 SCK on function 1");
+    static_assert(find_function(5, Signal::SCK, 1) == -1, "pad 5 is not an IOM1 pad");
+
+    /***************************************  PIN AND PIN GROUP  ******************************************/
+
+    namespace detail {
+        /// PADREGA-M of PORT by index, four pads each
+        template <typename PORT, std::size_t I>
+        using padreg = std::tuple_element_t<I, std::tuple<typename PORT::PADREGA_t, typename PORT::PADREGB_t, typename PORT::PADREGC_t,
+            typename PORT::PADREGD_t, typename PORT::PADREGE_t, typename PORT::PADREGF_t, typename PORT::PADREGG_t, typename PORT::PADREGH_t,
+            typename PORT::PADREGI_t, typename PORT::PADREGJ_t, typename PORT::PADREGK_t, typename PORT::PADREGL_t, typename PORT::PADREGM_t>>;
+
+        /// CFGA-G of PORT by index, eight pads each
+        template <typename PORT, std::size_t I>
+        using cfgreg = std::tuple_element_t<I, std::tuple<typename PORT::CFGA_t, typename PORT::CFGB_t, typename PORT::CFGC_t,
+            typename PORT::CFGD_t, typename PORT::CFGE_t, typename PORT::CFGF_t, typename PORT::CFGG_t>>;
+
+        /// the A register of a data register pair for pads 0-31, the B register for pads 32-49
+        template <unsigned PIN, typename A, typename B>
+        using bank = std::conditional_t<(PIN < 32), A, B>;
+
+        /// PADKEY value that unlocks the PADREG and CFG registers
+        template <typename PORT>
+        constexpr uint32_t pad_key = PORT::PADKEY_t::PADKEY.shift(sfr::GPIO::PADKEYv::Key).value;
+    }   // namespace detail
+
     template <class PORT, unsigned PIN>
     struct pin {
-        static_assert(PIN < 49, "PIN value in gpio_pin must be a number 0-49");
+        static_assert(PIN < 50, "PIN value in gpio_pin must be a number 0-49");
         static constexpr PORT Port{};           // GPIO instance or port this pin uses
+        static constexpr unsigned PIN_NUM = PIN;
+        static constexpr uint32_t PIN_MASK = 1u << (PIN % 32);
+
+        // Registers of this pad. PADREGA-M hold 4 pads each, CFGA-G hold 8 pads each, the data registers are A/B banks.
+        using padreg_t = detail::padreg<PORT, PIN / 4>;
+        using cfgreg_t = detail::cfgreg<PORT, PIN / 8>;
+        using padkey_t = typename PORT::PADKEY_t;
+        using rd_t     = detail::bank<PIN, typename PORT::RDA_t, typename PORT::RDB_t>;
+        using wt_t     = detail::bank<PIN, typename PORT::WTA_t, typename PORT::WTB_t>;
+        using wts_t    = detail::bank<PIN, typename PORT::WTSA_t, typename PORT::WTSB_t>;
+        using wtc_t    = detail::bank<PIN, typename PORT::WTCA_t, typename PORT::WTCB_t>;
+        using ens_t    = detail::bank<PIN, typename PORT::ENSA_t, typename PORT::ENSB_t>;
+        using enc_t    = detail::bank<PIN, typename PORT::ENCA_t, typename PORT::ENCB_t>;
+        static constexpr unsigned pad_shift = 8 * (PIN % 4);
+        static constexpr unsigned cfg_shift = 4 * (PIN % 8);
 
         /// sets the pin to the expected startup state. Base class version does nothing.
         constexpr void init() const noexcept {
         }
 
-        /// Set the pin as an output
+        /// write a complete pad configuration: output level first, then CFG and PADREG under the pad key
+        constexpr void apply(const pad_config config) const noexcept {
+            if (config.level >= 0) { set_value(config.level != 0); }
+            write_config(0xFFu, config.padreg, 0xFu, config.cfg);
+            if (config.enable) { enable_output(); }
+        }
+
+        /// configure the pin with some OR value of flags in GPIO::PinConfig. The pad function is not changed.
+        constexpr void configure(const PinConfig config) const noexcept {
+            const pad_config c = make_pad_config(0, config);
+            write_config(padreg_mask, c.padreg, 0xFu, c.cfg);
+        }
+
+        /// Set the pin as a push-pull GPIO output
         constexpr void set_output() const noexcept {
+            write_config(0x38u, fncsel_gpio << 3, 0x6u, make_pad_config(0, PinConfig::MODE_TOTEM).cfg);
         }
 
-        /// Set the pin as in input
+        /// Set the pin as a GPIO input
         constexpr void set_input() const noexcept {
+            write_config(0x3Au, (fncsel_gpio << 3) | 0x2u, 0x6u, 0);
         }
 
         /// Set the output level of the pin to low. Pin must be set as Output.
         constexpr void set_low() const noexcept {
+            wtc_t::write(PIN_MASK);
         }
 
         /// Set the output level of the pin to high. Pin must be set as Output.
         constexpr void set_high() const noexcept {
+            wts_t::write(PIN_MASK);
+        }
+
+        /// enable the output driver of a MODE_TRISTATE pin
+        constexpr void enable_output() const noexcept {
+            ens_t::write(PIN_MASK);
+        }
+
+        /// disable (tri-state) the output driver of a MODE_TRISTATE pin
+        constexpr void disable_output() const noexcept {
+            enc_t::write(PIN_MASK);
         }
 
-        /// Toggle the output level of the pin. Pin must be set as Output.
+        /// Toggle the output level of the pin. Pin must be set as Output. Goes through WTS/WTC, so writes to other
+        /// pins of the bank from an interrupt are never undone.
         constexpr void toggle() const noexcept {
+            if (wt_t::read() & PIN_MASK) { wtc_t::write(PIN_MASK); }
+            else { wts_t::write(PIN_MASK); }
         }
 
         /// set the level of the pin using a boolean argument
@@ -42,17 +244,12 @@ namespace GPIO {
         }
 
         /// get the current state of the pin. Digital input buffer must be enabled.
-        [[nodiscard]] constexpr volatile bool get_value() const noexcept {
-            return Port.IN & PIN_MASK;
+        [[nodiscard]] constexpr bool get_value() const noexcept {
+            return rd_t::read() & PIN_MASK;
         }
 
         /// return the state of the pin
-        constexpr operator volatile bool&() noexcept {
-            return get_value();
-        }
-
-        /// return the state of the pin as a constant value
-        constexpr operator const volatile bool&() const noexcept {
+        constexpr operator bool() const noexcept {
             return get_value();
         }
 
@@ -65,25 +262,44 @@ namespace GPIO {
         }
 
         /// set the pin to a low-power state, enabling any settings that prevent leakage for an unused pin
-        constexpr void set_lowpower() const noexcept { }
-        /// set pin to an analog mode
-        constexpr void set_analog() const noexcept { }
+        constexpr void set_lowpower() const noexcept {
+            apply(pad_config{});
+        }
 
+        /// set pin to an analog mode. Analog functions are selected by the peripheral, this only removes the digital load.
+        constexpr void set_analog() const noexcept {
+            set_lowpower();
+        }
+
+    private:
+        /// read-modify-write the pad's PADREG byte and CFG nibble with the pad key unlocked
+        constexpr void write_config(const uint32_t pad_mask, const uint32_t pad_value,
+                                    const uint32_t cfg_mask, const uint32_t cfg_value) const noexcept {
+            padkey_t::write(detail::pad_key<PORT>);
+            cfgreg_t::write((cfgreg_t::read() & ~(cfg_mask << cfg_shift)) | ((cfg_value & cfg_mask) << cfg_shift));
+            padreg_t::write((padreg_t::read() & ~(pad_mask << pad_shift)) | ((pad_value & pad_mask) << pad_shift));
+            padkey_t::write(0);
+        }
     };  // struct pin
 
+    template <typename T, typename... Ts>
+    constexpr bool all_same_type(T, Ts...) noexcept {
+        return std::conjunction_v<std::is_same<T, Ts>...>;
+    }
+
     template <typename... Pins>
     struct PinGroup {
         static constexpr std::tuple<Pins...> m_pins{};  // tuple of all the pins used in this group
-        static constexpr unsigned pin_count = std::tuple_size_v<decltype(m_pins)>;  // number of pins in this group
-        static constexpr decltype( std::tuple_element_t<0, decltype(m_pins)>::Port ) m_port{};  // find underlying GPIO instance
-
-//        static constexpr uint8_t m_shift = [](){ return std::min( {Pins::PIN_NUM...} ); }();
-//        static constexpr uint8_t m_mask  = [](){ return std::apply([](auto&&... args){ return ((args.PIN_MASK) | ...); }, m_pins); }();
+        static constexpr unsigned pin_count = std::tuple_size_v<std::remove_cv_t<decltype(m_pins)>>;  // number of pins in this group
+        static constexpr decltype( std::tuple_element_t<0, std::remove_cv_t<decltype(m_pins)>>::Port ) m_port{};  // find underlying GPIO instance
 
         static_assert(all_same_type(Pins::Port...), "All pins in a pin group must be on the same port!");
         static_assert(pin_count <= 8, "Only 8 or less pins can be in a pin group?");
         static_assert(pin_count > 1, "Only use a pin group for GROUPS of pins please!");
 
+        static constexpr uint32_t m_mask_a = (((Pins::PIN_NUM < 32) ? Pins::PIN_MASK : 0u) | ...);
+        static constexpr uint32_t m_mask_b = (((Pins::PIN_NUM >= 32) ? Pins::PIN_MASK : 0u) | ...);
+
         /// constructor mainly to allow CTAD
         constexpr PinGroup(Pins... p) {};
 
@@ -92,208 +308,326 @@ namespace GPIO {
             std::apply([](auto&&... args){((args.init()), ...);}, m_pins);
         }
 
-        /// configure all the pins with some OR value of flags in device::io::PinConfig
+        /// configure all the pins with some OR value of flags in GPIO::PinConfig
         constexpr void configure(const GPIO::PinConfig config) const noexcept {
             std::apply([config](auto&&... args){((args.configure(config)), ...);}, m_pins);
         }
 
         /// Set all pins as output
         constexpr void set_output() const noexcept {
-//            m_port.DIRSET = m_mask;
+            std::apply([](auto&&... args){((args.set_output()), ...);}, m_pins);
         }
 
         /// Set all pins as input
         constexpr void set_input() const noexcept {
-//            m_port.DIRCLR = m_mask;
+            std::apply([](auto&&... args){((args.set_input()), ...);}, m_pins);
         }
 
-        /// reads the value of the pin set. The value is masked and shifted to be left aligned. No consideration is taken for non-contiguous pins.
-        [[nodiscard]] constexpr volatile uint8_t read() const noexcept {
-//            return (m_port.IN & m_mask) >> m_shift;
+        /// reads the value of the pin set. Bit N of the result is the Nth pin of the group.
+        [[nodiscard]] constexpr uint8_t read() const noexcept {
+            const uint32_t a = m_mask_a ? m_port.RDA.read() : 0u;
+            const uint32_t b = m_mask_b ? m_port.RDB.read() : 0u;
+            return gather(a, b, std::index_sequence_for<Pins...>{});
         }
 
-        /// writes the given value to the pin set. Input value is masked and shifted. No consideration is taken for non-contiguous pins.
+        /// writes the given value to the pin set. Bit N of the value is written to the Nth pin of the group.
         constexpr void write(const uint8_t v) const noexcept {
-//            const uint8_t temp = m_port.OUT;
-//            m_port.OUT = (temp & ~m_mask) | ((v << m_shift) & m_mask);
+            uint32_t set[2] = {0, 0};
+            scatter(v, set, std::index_sequence_for<Pins...>{});
+            if constexpr (m_mask_a != 0) {
+                m_port.WTSA = set[0];
+                m_port.WTCA = m_mask_a & ~set[0];
+            }
+            if constexpr (m_mask_b != 0) {
+                m_port.WTSB = set[1];
+                m_port.WTCB = m_mask_b & ~set[1];
+            }
+        }
+
+    private:
+        template <std::size_t... I>
+        static constexpr uint8_t gather(const uint32_t a, const uint32_t b, std::index_sequence<I...>) noexcept {
+            return static_cast<uint8_t>(((((Pins::PIN_NUM < 32 ? a : b) & Pins::PIN_MASK) ? (1u << I) : 0u) | ...));
+        }
+
+        template <std::size_t... I>
+        static constexpr void scatter(const uint8_t v, uint32_t (&set)[2], std::index_sequence<I...>) noexcept {
+            ((set[Pins::PIN_NUM / 32] |= (v & (1u << I)) ? Pins::PIN_MASK : 0u), ...);
         }
     };  // struct PinGroup
 
+    /***************************************  BATCHED INITIALIZATION  ******************************************/
+
+    /**
+     * Register image of any number of pad_settings. Built entirely at compile time by init_all(), so
+     * initializing N pins costs one write (or read-modify-write) per touched PADREG, CFG and WTS/WTC register
+     * instead of N independent sequences of unlock/modify/lock.
+     */
+    struct pad_image {
+        uint32_t pad_value[13] = {};
+        uint32_t pad_mask[13]  = {};
+        uint32_t cfg_value[7]  = {};
+        uint32_t cfg_mask[7]   = {};
+        uint32_t set[2]        = {};
+        uint32_t clear[2]      = {};
+        uint32_t enable[2]     = {};
+        uint64_t claimed       = 0;
+        bool     conflict      = false;
+
+        constexpr void add(const pad_setting& s) noexcept {
+            const uint64_t bit = 1ull << s.pin;
+            conflict = conflict || (claimed & bit) != 0;
+            claimed |= bit;
+            pad_value[s.pin / 4] |= uint32_t{s.config.padreg} << (8 * (s.pin % 4));
+            pad_mask[s.pin / 4]  |= 0xFFu << (8 * (s.pin % 4));
+            cfg_value[s.pin / 8] |= uint32_t{s.config.cfg & 0xFu} << (4 * (s.pin % 8));
+            cfg_mask[s.pin / 8]  |= 0xFu << (4 * (s.pin % 8));
+            if (s.config.level == 1) { set[s.pin / 32] |= 1u << (s.pin % 32); }
+            if (s.config.level == 0) { clear[s.pin / 32] |= 1u << (s.pin % 32); }
+            if (s.config.enable) { enable[s.pin / 32] |= 1u << (s.pin % 32); }
+        }
+    };
+
+    template <typename... Roles>
+    constexpr pad_image make_pad_image() noexcept {
+        pad_image image{};
+        ([&image]() { for (const auto& s : Roles::settings) { image.add(s); } }(), ...);
+        return image;
+    }
+
+    namespace detail {
+        template <typename REG, uint32_t VALUE, uint32_t MASK>
+        inline void write_masked() noexcept {
+            if constexpr (MASK == 0xFFFFFFFFu) { REG::write(VALUE); }
+            else if constexpr (MASK != 0) { REG::write((REG::read() & ~MASK) | VALUE); }
+        }
+
+        template <typename REG, uint32_t VALUE>
+        inline void write_nonzero() noexcept {
+            if constexpr (VALUE != 0) { REG::write(VALUE); }
+        }
+
+        template <typename PORT, pad_image IMAGE, std::size_t... I>
+        inline void write_cfg(std::index_sequence<I...>) noexcept {
+            (write_masked<cfgreg<PORT, I>, IMAGE.cfg_value[I], IMAGE.cfg_mask[I]>(), ...);
+        }
+
+        template <typename PORT, pad_image IMAGE, std::size_t... I>
+        inline void write_pads(std::index_sequence<I...>) noexcept {
+            (write_masked<padreg<PORT, I>, IMAGE.pad_value[I], IMAGE.pad_mask[I]>(), ...);
+        }
+    }   // namespace detail
+
+    /// initialize every role in one pass over the GPIO registers. Registers no role touches are never accessed.
+    template <typename PORT, typename... Roles>
+    inline void init_all(const Roles&...) noexcept {
+        constexpr pad_image image = make_pad_image<std::remove_cvref_t<Roles>...>();
+        static_assert(!image.conflict, "a pad is claimed by more than one role!");
+        detail::write_nonzero<typename PORT::WTSA_t, image.set[0]>();
+        detail::write_nonzero<typename PORT::WTSB_t, image.set[1]>();
+        detail::write_nonzero<typename PORT::WTCA_t, image.clear[0]>();
+        detail::write_nonzero<typename PORT::WTCB_t, image.clear[1]>();
+        if constexpr (image.claimed != 0) {
+            PORT::PADKEY_t::write(detail::pad_key<PORT>);
+            detail::write_cfg<PORT, image>(std::make_index_sequence<7>{});
+            detail::write_pads<PORT, image>(std::make_index_sequence<13>{});
+            PORT::PADKEY_t::write(0);
+        }
+        detail::write_nonzero<typename PORT::ENSA_t, image.enable[0]>();
+        detail::write_nonzero<typename PORT::ENSB_t, image.enable[1]>();
+    }
+
     /***************************************  PIN TYPE BUILDING BLOCKS  ******************************************/
 
+    /// a role that configures one pad with a fixed pad_config. All single pin roles build on this.
+    template <typename PIN_INSTANCE, pad_config CONFIG>
+    struct pin_role {
+        PIN_INSTANCE m_pin;
+        static constexpr std::array<pad_setting, 1> settings = {{ {PIN_INSTANCE::PIN_NUM, CONFIG} }};
+        explicit constexpr pin_role(const PIN_INSTANCE pin) : m_pin(pin) { }
+        constexpr void init() const noexcept {
+            init_all<std::remove_cv_t<decltype(PIN_INSTANCE::Port)>>(*this);
+        }
+    };
+
     struct no_pin {
+        static constexpr std::array<pad_setting, 0> settings = {};
         constexpr void init() const noexcept { }
     };
 
     template <typename PIN_INSTANCE>
     struct no_init {
         PIN_INSTANCE m_pin;
+        static constexpr std::array<pad_setting, 0> settings = {};
         explicit constexpr no_init(const PIN_INSTANCE pin) : m_pin(pin) { }
         constexpr void init() const noexcept { }
     };
 
     template <typename PIN_INSTANCE>
-    struct Unused {
-        PIN_INSTANCE m_pin;
-        explicit constexpr Unused(const PIN_INSTANCE pin) : m_pin(pin) { }
-        constexpr void init() const noexcept {
-            m_pin.set_lowpower();
-        }
+    struct Unused : public pin_role<PIN_INSTANCE, pad_config{}> {
+        explicit constexpr Unused(const PIN_INSTANCE pin) : pin_role<PIN_INSTANCE, pad_config{}>(pin) { }
+    };
+
+    template <typename PIN_INSTANCE>
+    struct output_low : public pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::MODE_TOTEM, 0)> {
+        using base = pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::MODE_TOTEM, 0)>;
+        explicit constexpr output_low(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE>
+    struct output_high : public pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::MODE_TOTEM, 1)> {
+        using base = pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::MODE_TOTEM, 1)>;
+        explicit constexpr output_high(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE>
+    struct input_floating : public pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::INPUT_ENABLE)> {
+        using base = pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::INPUT_ENABLE)>;
+        explicit constexpr input_floating(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE>
+    struct input_pullup : public pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::INPUT_ENABLE | PinConfig::MODE_PULLUP)> {
+        using base = pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::INPUT_ENABLE | PinConfig::MODE_PULLUP)>;
+        explicit constexpr input_pullup(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    /// NOTE: the only pad with a pulldown on Apollo3 is pad 20, its PULL bit selects the pulldown.
+    template <typename PIN_INSTANCE>
+    struct input_pulldown : public pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::INPUT_ENABLE | PinConfig::MODE_PULLUP)> {
+        static_assert(PIN_INSTANCE::PIN_NUM == 20, "Only pad 20 has a pulldown resistor on Apollo3");
+        using base = pin_role<PIN_INSTANCE, make_pad_config(fncsel_gpio, PinConfig::INPUT_ENABLE | PinConfig::MODE_PULLUP)>;
+        explicit constexpr input_pulldown(const PIN_INSTANCE pin) : base(pin) { }
     };
 
-//    template <typename PIN_INSTANCE>
-//    struct output_low {
-//        PIN_INSTANCE m_pin;
-//        explicit constexpr output_low(const PIN_INSTANCE pin) : m_pin(pin) { }
-//        constexpr void init() const noexcept {
-//            m_pin.set_output();
-//            m_pin.configure(GPIO::PinConfig::MODE_TOTEM);
-//            m_pin.set_low();
-//        }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct output_high {
-//        PIN_INSTANCE m_pin;
-//        explicit constexpr output_high(const PIN_INSTANCE pin) : m_pin(pin) { }
-//        constexpr void init() const noexcept {
-//            m_pin.set_output();
-//            m_pin.configure(GPIO::PinConfig::MODE_TOTEM);
-//            m_pin.set_high();
-//        }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct input_floating {
-//        PIN_INSTANCE m_pin;
-//        explicit constexpr input_floating(const PIN_INSTANCE pin) : m_pin(pin) { }
-//        constexpr void init() const noexcept {
-//            m_pin.set_input();
-//            m_pin.configure(GPIO::PinConfig::MODE_TOTEM);
-//        }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct input_buskeeper {
-//        PIN_INSTANCE m_pin;
-//        explicit constexpr input_buskeeper(const PIN_INSTANCE pin) : m_pin(pin) { }
-//        constexpr void init() const noexcept {
-//            m_pin.set_input();
-//            m_pin.configure(GPIO::PinConfig::MODE_BUSKEEPER);
-//        }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct input_pullup {
-//        PIN_INSTANCE m_pin;
-//        explicit constexpr input_pullup(const PIN_INSTANCE pin) : m_pin(pin) { }
-//        constexpr void init() const noexcept {
-//            m_pin.set_input();
-//            m_pin.configure(GPIO::PinConfig::MODE_PULLUP);
-//        }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct input_pulldown {
-//        PIN_INSTANCE m_pin;
-//        explicit constexpr input_pulldown(const PIN_INSTANCE pin) : m_pin(pin) { }
-//        constexpr void init() const noexcept {
-//            m_pin.set_input();
-//            m_pin.configure(GPIO::PinConfig::MODE_PULLDOWN);
-//        }
-//    };
+    /// connect a pad to an IOM or UART signal. Fails to compile if the pad can not carry that signal.
+    template <typename PIN_INSTANCE, Signal SIGNAL, int INSTANCE, PinConfig CONFIG>
+    struct peripheral_pin : public pin_role<PIN_INSTANCE, make_pad_config(
+            static_cast<uint8_t>(find_function(PIN_INSTANCE::PIN_NUM, SIGNAL, INSTANCE)), CONFIG)> {
+        static constexpr int fncsel = find_function(PIN_INSTANCE::PIN_NUM, SIGNAL, INSTANCE);
+        static_assert(fncsel >= 0, "This pad can not be connected to the requested peripheral signal");
+        using base = pin_role<PIN_INSTANCE, make_pad_config(static_cast<uint8_t>(fncsel), CONFIG)>;
+        explicit constexpr peripheral_pin(const PIN_INSTANCE pin) : base(pin) { }
+    };
 
     /***************************************  PERIPHERAL SPECIFIC PIN TYPES  ******************************************/
 
-//    template <typename PIN_INSTANCE>
-//    struct SDA : public no_init<PIN_INSTANCE> {
-//        /// NOTE: for some reason initializing TWI pins causes the first few transmissions to fail. Override with empty init()
-//        explicit constexpr SDA(const PIN_INSTANCE pin) : no_init<PIN_INSTANCE>(pin) { }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct SCL : public no_init<PIN_INSTANCE> {
-//        /// NOTE: for some reason initializing TWI pins causes the first few transmissions to fail. Override with empty init()
-//        explicit constexpr SCL(const PIN_INSTANCE pin) : no_init<PIN_INSTANCE>(pin) { }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct MOSI : public output_low<PIN_INSTANCE> {
-//        explicit constexpr MOSI(const PIN_INSTANCE pin) : output_low<PIN_INSTANCE>(pin) { }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct MISO : public input_floating<PIN_INSTANCE> {
-//        explicit constexpr MISO(const PIN_INSTANCE pin) : input_floating<PIN_INSTANCE>(pin) { }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct SCK : public output_low<PIN_INSTANCE> {
-//        explicit constexpr SCK(const PIN_INSTANCE pin) : output_low<PIN_INSTANCE>(pin) { }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct USART_RX : public input_floating<PIN_INSTANCE> {
-//        explicit constexpr USART_RX(const PIN_INSTANCE pin) : input_floating<PIN_INSTANCE>(pin) { }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    struct USART_TX : public output_low<PIN_INSTANCE> {
-//        explicit constexpr USART_TX(const PIN_INSTANCE pin) : output_low<PIN_INSTANCE>(pin) { }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    class Led : public output_low<PIN_INSTANCE> {
-//    public:
-//        using base = output_low<PIN_INSTANCE>;
-//        explicit constexpr Led(const PIN_INSTANCE pin) : output_low<PIN_INSTANCE>(pin) { }
-//
-//        constexpr void toggle() const noexcept {
-//            base::m_pin.toggle();
-//        }
-//
-//        constexpr void on() const noexcept {
-//            base::m_pin.set_high();
-//        }
-//
-//        constexpr void off() const noexcept {
-//            base::m_pin.set_low();
-//        }
-//
-//        constexpr void set(const bool enable) const noexcept {
-//            base::m_pin.set_value(enable);
-//        }
-//    };
-//
-//    template <typename PIN_INSTANCE>
-//    class LedInverted : public Led<PIN_INSTANCE> {
-//    public:
-//        explicit constexpr LedInverted(const PIN_INSTANCE pin) : Led<PIN_INSTANCE>(pin) { }
-//        constexpr void init() const noexcept {
-//            Led<PIN_INSTANCE>::m_pin.set_output();
-//            Led<PIN_INSTANCE>::m_pin.configure(GPIO::PinConfig::INVERT_PIN | GPIO::PinConfig::MODE_TOTEM);
-//        }
-//    };
-//
-//    template<typename... Pins>
-//    class BoardVersion : private PinGroup<Pins...> {
-//        using base = PinGroup<Pins...>;
-//    public:
-//        /// CTAD constructor
-//        constexpr BoardVersion(Pins... p) : base(p...) {};
-//        /// default init to pulldown inputs
-//        constexpr void init() const noexcept {
-//            base::set_input();
-//            base::configure(GPIO::PinConfig::MODE_PULLDOWN);
-//        }
-//
-//        /// read the board version by enabling pullups and reading the pins, then returning the pins to pulldown state
-//        constexpr operator uint8_t() const noexcept {
-//            base::configure(GPIO::PinConfig::MODE_PULLUP);
-//            const uint8_t temp = base::read();
-//            base::configure(GPIO::PinConfig::MODE_PULLDOWN);
-//            return temp;
-//        }
-//    };
-
-}   // namespace GPIO
\ No newline at end of file
+    /// I2C pads are open drain with the strongest internal pullup, as recommended by Ambiq
+    inline constexpr PinConfig i2c_config = PinConfig::INPUT_ENABLE | PinConfig::MODE_PULLUP | PinConfig::PULLUP_1_5K
+                                          | PinConfig::DRIVE_12MA | PinConfig::MODE_OPENDRAIN;
+
+    template <typename PIN_INSTANCE, int INSTANCE = any_instance>
+    struct SDA : public peripheral_pin<PIN_INSTANCE, Signal::SDA, INSTANCE, i2c_config> {
+        using base = peripheral_pin<PIN_INSTANCE, Signal::SDA, INSTANCE, i2c_config>;
+        explicit constexpr SDA(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE, int INSTANCE = any_instance>
+    struct SCL : public peripheral_pin<PIN_INSTANCE, Signal::SCL, INSTANCE, i2c_config> {
+        using base = peripheral_pin<PIN_INSTANCE, Signal::SCL, INSTANCE, i2c_config>;
+        explicit constexpr SCL(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE, int INSTANCE = any_instance>
+    struct MOSI : public peripheral_pin<PIN_INSTANCE, Signal::MOSI, INSTANCE, PinConfig::DRIVE_12MA> {
+        using base = peripheral_pin<PIN_INSTANCE, Signal::MOSI, INSTANCE, PinConfig::DRIVE_12MA>;
+        explicit constexpr MOSI(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE, int INSTANCE = any_instance>
+    struct MISO : public peripheral_pin<PIN_INSTANCE, Signal::MISO, INSTANCE, PinConfig::INPUT_ENABLE> {
+        using base = peripheral_pin<PIN_INSTANCE, Signal::MISO, INSTANCE, PinConfig::INPUT_ENABLE>;
+        explicit constexpr MISO(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE, int INSTANCE = any_instance>
+    struct SCK : public peripheral_pin<PIN_INSTANCE, Signal::SCK, INSTANCE, PinConfig::DRIVE_12MA> {
+        using base = peripheral_pin<PIN_INSTANCE, Signal::SCK, INSTANCE, PinConfig::DRIVE_12MA>;
+        explicit constexpr SCK(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE, int INSTANCE = any_instance>
+    struct USART_RX : public peripheral_pin<PIN_INSTANCE, Signal::UART_RX, INSTANCE, PinConfig::INPUT_ENABLE> {
+        using base = peripheral_pin<PIN_INSTANCE, Signal::UART_RX, INSTANCE, PinConfig::INPUT_ENABLE>;
+        explicit constexpr USART_RX(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE, int INSTANCE = any_instance>
+    struct USART_TX : public peripheral_pin<PIN_INSTANCE, Signal::UART_TX, INSTANCE, PinConfig::MODE_FLOATING> {
+        using base = peripheral_pin<PIN_INSTANCE, Signal::UART_TX, INSTANCE, PinConfig::MODE_FLOATING>;
+        explicit constexpr USART_TX(const PIN_INSTANCE pin) : base(pin) { }
+    };
+
+    template <typename PIN_INSTANCE>
+    class Led : public output_low<PIN_INSTANCE> {
+    public:
+        using base = output_low<PIN_INSTANCE>;
+        explicit constexpr Led(const PIN_INSTANCE pin) : output_low<PIN_INSTANCE>(pin) { }
+
+        constexpr void toggle() const noexcept {
+            base::m_pin.toggle();
+        }
+
+        constexpr void on() const noexcept {
+            base::m_pin.set_high();
+        }
+
+        constexpr void off() const noexcept {
+            base::m_pin.set_low();
+        }
+
+        constexpr void set(const bool enable) const noexcept {
+            base::m_pin.set_value(enable);
+        }
+    };
+
+    /// LED wired to the supply. Apollo3 pads have no output inversion so the levels are swapped in software.
+    template <typename PIN_INSTANCE>
+    class LedInverted : public output_high<PIN_INSTANCE> {
+    public:
+        using base = output_high<PIN_INSTANCE>;
+        explicit constexpr LedInverted(const PIN_INSTANCE pin) : output_high<PIN_INSTANCE>(pin) { }
+
+        constexpr void toggle() const noexcept {
+            base::m_pin.toggle();
+        }
+
+        constexpr void on() const noexcept {
+            base::m_pin.set_low();
+        }
+
+        constexpr void off() const noexcept {
+            base::m_pin.set_high();
+        }
+
+        constexpr void set(const bool enable) const noexcept {
+            base::m_pin.set_value(!enable);
+        }
+    };
+
+    template<typename... Pins>
+    class BoardVersion : private PinGroup<Pins...> {
+        using base = PinGroup<Pins...>;
+    public:
+        /// inputs without pull resistors. Apollo3 has no pulldowns, so the strapping resistors must define the level.
+        static constexpr std::array<pad_setting, sizeof...(Pins)> settings = {{
+            {Pins::PIN_NUM, make_pad_config(fncsel_gpio, PinConfig::INPUT_ENABLE)}...
+        }};
+
+        /// CTAD constructor
+        constexpr BoardVersion(Pins... p) : base(p...) {};
+        /// default init to floating inputs
+        constexpr void init() const noexcept {
+            init_all<std::remove_cv_t<decltype(base::m_port)>>(*this);
+        }
+
+        /// read the board version by enabling pullups and reading the pins, then returning the pins to floating state
+        constexpr operator uint8_t() const noexcept {
+            base::configure(GPIO::PinConfig::INPUT_ENABLE | GPIO::PinConfig::MODE_PULLUP);
+            const uint8_t temp = base::read();
+            base::configure(GPIO::PinConfig::INPUT_ENABLE);
+            return temp;
+        }
+    };
+
+}   // namespace GPIO
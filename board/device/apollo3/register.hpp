@@ -1,10 +1,15 @@
 #pragma once
 #pragma GCC diagnostic ignored "-Wreturn-local-addr"
 
+#include <cstddef>
 #include <cstdint>
 #include <utility>
 #include <algorithm>
 
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+#include "simulation.hpp"
+#endif
+
 namespace sfr {
 
     using registerType = uint32_t;
@@ -83,24 +88,42 @@ namespace sfr {
 
         static inline volatile T& value() noexcept;
 
+        /// raw load of the register without access checks. In a simulation build this goes to sim::bus.
+        static inline T load() noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            return static_cast<T>(sim::bus::read(address, sizeof(T)));
+#else
+            return *reinterpret_cast<volatile T *>(address);
+#endif
+        }
+
+        /// raw store to the register without access checks. In a simulation build this goes to sim::bus.
+        static inline void store(const T val) noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+            sim::bus::write(address, val, sizeof(T));
+#else
+            *reinterpret_cast<volatile T *>(address) = val;
+#endif
+        }
+
         static inline T read() noexcept {
             static_assert (access != AccessType::write_only, "this register is write-only, and can not be read!");
             static_assert (access != AccessType::read_write_once, "this register is read-write-once!");
             static_assert (access != AccessType::write_once, "this register may only be accessed once, and can not be read!");
-            return *reinterpret_cast<volatile T *>(address);
+            return load();
         }
 
         static inline void write(const T val) noexcept {
             static_assert (access != AccessType::read_only, "this register is read-only, and may not be written!");
             static_assert (access != AccessType::write_once, "this register may only be accessed once!");
             static_assert (access != AccessType::read_write_once, "this register is read-write-once!");
-            *reinterpret_cast<volatile T *>(address) = val;
+            store(val);
         }
 
         inline constexpr reg_t operator=(const T& value) const noexcept {
             static_assert (access != AccessType::read_only, "this register is read-only, and may not be written!");
             static_assert (access != AccessType::write_once && access != AccessType::read_write_once, "this register may only be accessed once!");
-            reg_t::value() = value;
+            store(value);
             return reg_t<T,address>{};
         }
 
@@ -109,7 +132,7 @@ namespace sfr {
         {
             static_assert (access != AccessType::read_only, "this register is read-only, and may not be written!");
             static_assert (access != AccessType::write_once && access != AccessType::read_write_once, "this register may only be accessed once!");
-            reg_t::value() = bit_field_value.value;
+            store(bit_field_value.value);
             return reg_t<T,address>{};
         }
 
@@ -118,21 +141,21 @@ namespace sfr {
         {
             static_assert (access != AccessType::read_only, "this register is read-only, and may not be written!");
             static_assert (access != AccessType::write_once && access != AccessType::read_write_once, "this register may only be accessed once!");
-            reg_t::value() = (reg_t::value() & ~bit_field_value.mask) | bit_field_value.value;
+            store((load() & ~bit_field_value.mask) | bit_field_value.value);
             return reg_t<T,address>{};
         }
 
         inline constexpr reg_t operator|=(const T& value) const noexcept {
             static_assert (access != AccessType::read_only, "this register is read-only, and may not be written!");
             static_assert (access != AccessType::write_once && access != AccessType::read_write_once, "this register may only be accessed once!");
-            reg_t::value() |= value;
+            store(load() | value);
             return reg_t<T,address>{};
         }
 
         inline constexpr reg_t operator&=(const T& value) const noexcept {
             static_assert (access != AccessType::read_only, "this register is read-only, and may not be written!");
             static_assert (access != AccessType::write_once && access != AccessType::read_write_once, "this register may only be accessed once!");
-            reg_t::value() &= value;
+            store(load() & value);
             return reg_t<T,address>{};
         }
 
@@ -145,13 +168,46 @@ namespace sfr {
         constexpr operator const volatile T&() const noexcept {
             static_assert (access != AccessType::write_once && access != AccessType::read_write_once, "this register may only be accessed once!");
             static_assert (access != AccessType::write_only, "this register can only be written, not read!");
-            return *reinterpret_cast<volatile T*>(address);
+            return value();
         }
     };
 
     template<typename T, uint32_t addr, AccessType access_type>
     volatile T &reg_t<T, addr, access_type>::value() noexcept  {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+        return sim::bus::storage<T>(address);
+#else
         return *reinterpret_cast<volatile T *>(address);
+#endif
+    }
+
+    /// address of a buffer as seen by the peripheral bus masters (DMA, command queues)
+    inline uint32_t bus_address(const volatile void* p, [[maybe_unused]] const std::size_t size) noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+        return sim::memory::map(p, size);
+#else
+        return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(p));
+#endif
+    }
+
+    /// load from a peripheral address only known at runtime, e.g. a byte of IOSLAVE LRAM
+    template <typename T>
+    inline T load(const addressType address) noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+        return static_cast<T>(sim::bus::read(address, sizeof(T)));
+#else
+        return *reinterpret_cast<volatile T *>(address);
+#endif
+    }
+
+    /// store to a peripheral address only known at runtime, see load()
+    template <typename T>
+    inline void store(const addressType address, const T value) noexcept {
+#if defined(SIMULATION_BUILD) && SIMULATION_BUILD
+        sim::bus::write(address, static_cast<uint32_t>(value), sizeof(T));
+#else
+        *reinterpret_cast<volatile T *>(address) = value;
+#endif
     }
 
     namespace details {
@@ -186,20 +242,25 @@ namespace sfr {
             return {static_cast<type>((static_cast<type>(value)<<start) & mask), mask};
         }
 
+        /// the field in a register image, e.g. a value read once and decoded field by field
+        static constexpr value_t extract(const type word) noexcept {
+            return value_t((word & mask) >> start);
+        }
+
         inline constexpr bitfield_t operator=(const value_t& value) const noexcept {
             static_assert (access != AccessType::read_only, "this bit field is read-only, and may not be written!");
             typename reg_t::type tmp = shift(value).value;
-            reg_t::value() = (reg_t::value() &  ~mask)|tmp;
+            reg_t::store((reg_t::load() &  ~mask)|tmp);
             return bitfield_t<reg_t, start_index, stop_index, value_t>{};
         }
 
         constexpr operator value_t() noexcept {
             static_assert (access != AccessType::read_only, "this bit field is read-only, and may not be written!");
-            return value_t(( static_cast<int>(reg_t::value()) & mask ) >> start);
+            return value_t(( static_cast<int>(reg_t::load()) & mask ) >> start);
         }
 
         constexpr operator value_t() const noexcept {
-            return value_t(( static_cast<int>(reg_t::value()) & mask ) >> start);
+            return value_t(( static_cast<int>(reg_t::load()) & mask ) >> start);
         }
     };
 
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+    /**
+     * Single-producer/single-consumer ring buffer. One side (usually an ISR) only ever calls push(),
+     * the other side only ever calls pop(), so no locking or interrupt masking is needed.
+     * DEPTH must be a power of two so that the indices can free-run and wrap with a mask.
+     */
+    template <typename T, std::size_t DEPTH>
+    class spsc_ring {
+        static_assert(DEPTH >= 2 && (DEPTH & (DEPTH - 1)) == 0, "spsc_ring DEPTH must be a power of two");
+        static_assert(std::atomic<uint32_t>::is_always_lock_free, "spsc_ring needs lock-free 32-bit atomics");
+
+        T m_data[DEPTH] = {};
+        std::atomic<uint32_t> m_head{0};    // next slot to write, only modified by the producer
+        std::atomic<uint32_t> m_tail{0};    // next slot to read, only modified by the consumer
+        std::atomic<uint32_t> m_dropped{0}; // number of pushes rejected because the ring was full
+
+    public:
+        static constexpr std::size_t capacity = DEPTH;
+
+        /// add an element. Returns false (and counts a drop) if the ring is full. Producer side only.
+        bool push(const T& value) noexcept {
+            const uint32_t head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail.load(std::memory_order_acquire) >= DEPTH) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            m_data[head & (DEPTH - 1)] = value;
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// remove the oldest element into value. Returns false if the ring is empty. Consumer side only.
+        bool pop(T& value) noexcept {
+            const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = m_data[tail & (DEPTH - 1)];
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// look at the element offset places from the oldest without removing it. Consumer side only.
+        [[nodiscard]] const T* peek(const std::size_t offset = 0) const noexcept {
+            const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+            if (offset >= m_head.load(std::memory_order_acquire) - tail) {
+                return nullptr;
+            }
+            return &m_data[(tail + offset) & (DEPTH - 1)];
+        }
+
+        /// number of elements currently waiting to be popped
+        [[nodiscard]] std::size_t size() const noexcept {
+            return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+        /// number of pushes that were lost since construction because the consumer fell behind
+        [[nodiscard]] uint32_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+        /// discard everything currently queued. Consumer side only.
+        void clear() noexcept {
+            m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+    };  // class spsc_ring
+
+}   // namespace util
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "simulation.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iterator>
+
+namespace sim {
+
+    /**
+     * Model of the ADC for SIMULATION_BUILD. A software trigger, or timer_trigger() standing in for CTIMER A3
+     * in repeating mode, converts every enabled slot once: input() gives the 14 bit code of a slot for a scan,
+     * which lands in the FIFO as N.6 data for the slot's precision (no averaging fraction). A full 16 word
+     * FIFO drops the conversion and raises FIFOOVR2; clearing ADCEN empties it.
+     *
+     * With DMAEN set, the DMA empties the FIFO into a buffer registered with sim::memory whenever a DMATRIGEN
+     * condition holds (12 words for DFIFO75, 16 for DFIFOFULL), and raises DCMP after DMATOTCOUNT bytes or
+     * DERR for an unmapped buffer. Slots with WCEN raise WCEXC when their sample leaves [WLLIM, WULIM] and
+     * WCINC when it comes back; SCWLIMEN scales the limits to the slot's precision.
+     */
+    class adc_model : public device_model {
+    public:
+        /// 14 bit code of `slot` in scan number `scan`
+        using source = std::function<uint16_t(unsigned slot, uint32_t scan)>;
+
+    private:
+        // register offsets
+        static constexpr addressType cfg = 0x000, swt = 0x008, sl0cfg = 0x00C, wulim = 0x02C, wllim = 0x030, scwlim = 0x034;
+        static constexpr addressType fifo = 0x038, fifopr = 0x03C;
+        static constexpr addressType inten = 0x200, intstat = 0x204, intclr = 0x208, intset = 0x20C;
+        static constexpr addressType dmatrigen = 0x240, dmacfg = 0x280, dmatotcount = 0x288, dmatargaddr = 0x28C, dmastat = 0x290;
+
+        // INTSTAT bits
+        static constexpr uint32_t cnvcmp = 1u << 0, scncmp = 1u << 1, fifoovr2 = 1u << 3, wcexc = 1u << 4, wcinc = 1u << 5;
+        static constexpr uint32_t dcmp = 1u << 6, derr = 1u << 7;
+
+        static constexpr std::size_t depth = 16;
+
+        uint32_t m_cfg = 0;
+        uint32_t m_slots[8] = {};
+        uint32_t m_upper = 0;
+        uint32_t m_lower = 0;
+        uint32_t m_scaled = 0;
+        uint32_t m_intstat = 0;
+        uint32_t m_inten = 0;
+        uint32_t m_dma_trigger = 0;
+        uint32_t m_dma_cfg = 0;
+        uint32_t m_dma_count = 0;
+        uint32_t m_dma_target = 0;
+        uint32_t m_dma_moved = 0;
+        uint32_t m_dma_status = 0;
+        std::deque<uint32_t> m_fifo;
+        bool     m_outside[8] = {};
+        uint32_t m_scans = 0;
+        uint32_t m_dropped = 0;
+        source   m_input = [](unsigned, uint32_t) -> uint16_t { return 0; };
+
+        /// the FIFO word at the front, with COUNT filled in
+        [[nodiscard]] uint32_t front() const noexcept { return m_fifo.front() | (static_cast<uint32_t>(m_fifo.size()) << 20); }
+
+        void dma() {
+            if (!(m_dma_cfg & 1u) || m_dma_moved >= m_dma_count) { return; }
+            const bool due = ((m_dma_trigger & 1u) && m_fifo.size() >= depth * 3 / 4) || ((m_dma_trigger & 2u) && m_fifo.size() == depth);
+            if (!due) { return; }
+            while (!m_fifo.empty() && m_dma_moved < m_dma_count) {
+                uint8_t* const to = memory::host(m_dma_target + m_dma_moved);
+                if (to == nullptr) {
+                    m_dma_status = 0x4u;                                    // DMAERR
+                    m_intstat |= derr;
+                    m_dma_cfg &= ~1u;
+                    return;
+                }
+                const uint32_t word = front();
+                std::memcpy(to, &word, 4);
+                m_fifo.pop_front();
+                m_dma_moved += 4;
+            }
+            if (m_dma_moved >= m_dma_count) {
+                m_dma_status = 0x2u;                                        // DMACPL
+                m_intstat |= dcmp;
+            }
+        }
+
+        /// clearing ADCEN empties the FIFO and forgets the window state
+        void reset() {
+            m_fifo.clear();
+            std::fill(std::begin(m_outside), std::end(m_outside), false);
+        }
+
+        void compare(const unsigned slot, const uint32_t data, const unsigned shift) {
+            const uint32_t lower = m_scaled ? (m_lower >> shift) : m_lower;
+            const uint32_t upper = m_scaled ? (m_upper >> shift) : m_upper;
+            const bool outside = data < lower || data > upper;
+            if (outside != m_outside[slot]) {
+                m_outside[slot] = outside;
+                m_intstat |= outside ? wcexc : wcinc;
+            }
+        }
+
+        void scan() {
+            if (!(m_cfg & 1u)) { return; }
+            for (unsigned slot = 0; slot < 8; ++slot) {
+                const uint32_t config = m_slots[slot];
+                if (!(config & 1u)) { continue; }
+                const unsigned shift = 2u * ((config >> 16) & 0x3u);
+                const uint32_t data = (static_cast<uint32_t>(m_input(slot, m_scans) & 0x3FFFu) >> shift) << 6;
+                if (config & 2u) { compare(slot, data, shift); }
+                m_intstat |= cnvcmp;
+                if (m_fifo.size() == depth) {
+                    ++m_dropped;
+                    m_intstat |= fifoovr2;
+                    continue;
+                }
+                m_fifo.push_back((slot << 28) | data);
+                dma();
+            }
+            ++m_scans;
+            m_intstat |= scncmp;
+        }
+
+    public:
+        explicit adc_model(const addressType base_address = 0x50010000) : device_model(base_address, 0x1000) { bus::attach(this); }
+        ~adc_model() override { bus::detach(this); }
+
+        adc_model(const adc_model&) = delete;
+        adc_model& operator=(const adc_model&) = delete;
+
+        uint32_t read(const addressType offset, const uint32_t stored) override {
+            switch (offset) {
+                case cfg:     return m_cfg;
+                case fifo:    return m_fifo.empty() ? 0u : front();
+                case fifopr: {
+                    if (m_fifo.empty()) { return 0; }
+                    const uint32_t word = front();
+                    m_fifo.pop_front();
+                    return word;
+                }
+                case inten:   return m_inten;
+                case intstat: return m_intstat;
+                case dmastat: return m_dma_status;
+                default:      return stored;
+            }
+        }
+
+        void write(const addressType offset, const uint32_t value, uint32_t& stored) override {
+            stored = value;
+            if (offset >= sl0cfg && offset < wulim) {
+                m_slots[(offset - sl0cfg) / 4] = value;
+                return;
+            }
+            switch (offset) {
+                case cfg:
+                    m_cfg = value;
+                    if (!(value & 1u)) { reset(); }
+                    break;
+                case swt:
+                    if ((value & 0xFFu) == 0x37u) { scan(); }
+                    break;
+                case wulim:       m_upper = value & 0xFFFFFu; break;
+                case wllim:       m_lower = value & 0xFFFFFu; break;
+                case scwlim:      m_scaled = value & 1u; break;
+                case fifo:
+                    if (!m_fifo.empty()) { m_fifo.pop_front(); }
+                    break;
+                case inten:       m_inten = value; break;
+                case intclr:      m_intstat &= ~value; break;
+                case intset:      m_intstat |= value; break;
+                case dmatrigen:   m_dma_trigger = value & 0x3u; dma(); break;
+                case dmacfg:
+                    m_dma_cfg = value;
+                    m_dma_moved = 0;
+                    dma();
+                    break;
+                case dmatotcount: m_dma_count = value & 0x3FFFCu; break;
+                case dmatargaddr: m_dma_target = value; break;
+                case dmastat:     m_dma_status = value; break;
+                default: break;
+            }
+        }
+
+        /// where conversions take their codes from
+        void input(source function) { m_input = std::move(function); }
+
+        /// a trigger from CTIMER A3: one scan if the ADC is enabled in repeating mode
+        void timer_trigger() {
+            if (m_cfg & (1u << 2)) { scan(); }
+        }
+
+        /// scans so far, and conversions dropped on a full FIFO
+        [[nodiscard]] uint32_t scans() const noexcept { return m_scans; }
+        [[nodiscard]] uint32_t dropped() const noexcept { return m_dropped; }
+
+        /// words waiting in the FIFO
+        [[nodiscard]] std::size_t fifo_level() const noexcept { return m_fifo.size(); }
+    };  // class adc_model
+
+}   // namespace sim
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "simulation.hpp"
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+    /**
+     * Pin level model of the Apollo3 GPIO block for SIMULATION_BUILD. Tracks the pad function, output
+     * configuration, output register and output enable of all 50 pads, resolves each pad to 0/1/z/x and
+     * records every level change with its sim::clock timestamp so the run can be dumped as a VCD file.
+     *
+     * PADREG and CFG writes are only accepted while PADKEY is unlocked, like on hardware; rejected writes are
+     * counted in locked_writes() so missing unlocks show up in a simulation instead of on a board.
+     */
+    class gpio_model : public device_model {
+    public:
+        static constexpr unsigned pin_count = 50;
+
+        /// resolved state of a pad as it would be seen on a logic analyzer
+        enum class Level : char { low = '0', high = '1', floating = 'z', peripheral = 'x' };
+
+        struct event {
+            uint64_t time_ns;
+            uint8_t  pin;
+            Level    level;
+        };
+
+    private:
+        static constexpr uint32_t key_value = 0x73;
+        static constexpr uint8_t fncsel_gpio = 3;
+        static constexpr uint64_t all_pins = (1ull << pin_count) - 1;
+
+        std::array<uint8_t, pin_count> m_padreg{};
+        std::array<uint8_t, pin_count> m_cfg{};
+        std::array<Level, pin_count>   m_level{};
+        uint64_t m_wt = 0;
+        uint64_t m_en = 0;
+        uint64_t m_external = 0;        // value driven onto a pad by the test bench
+        uint64_t m_external_valid = 0;  // pads the test bench is driving
+        bool     m_unlocked = false;
+        uint32_t m_locked_writes = 0;
+        std::vector<event> m_events;
+
+        static uint64_t bank(const addressType offset, const uint32_t value) noexcept {
+            return (offset & 4u) ? (static_cast<uint64_t>(value) << 32) : value;
+        }
+
+        static uint64_t bank_mask(const addressType offset) noexcept {
+            return (offset & 4u) ? (all_pins & ~0xFFFFFFFFull) : 0xFFFFFFFFull;
+        }
+
+        [[nodiscard]] Level resolve(const unsigned pin) const noexcept {
+            const uint64_t bit = 1ull << pin;
+            const bool pull = m_padreg[pin] & 0x1u;
+            const Level released = (m_external_valid & bit) ? ((m_external & bit) ? Level::high : Level::low)
+                                 : pull ? (pin == 20 ? Level::low : Level::high)
+                                 : Level::floating;
+            if (((m_padreg[pin] >> 3) & 0x7u) != fncsel_gpio) {
+                return Level::peripheral;
+            }
+            const bool out = m_wt & bit;
+            switch ((m_cfg[pin] >> 1) & 0x3u) {
+                case 1:  return out ? Level::high : Level::low;                             // push-pull
+                case 2:  return out ? released : Level::low;                                // open drain
+                case 3:  return (m_en & bit) ? (out ? Level::high : Level::low) : released; // tri-state
+                default: return released;                                                   // disabled
+            }
+        }
+
+        void update() {
+            for (unsigned pin = 0; pin < pin_count; ++pin) {
+                const Level now = resolve(pin);
+                if (now != m_level[pin]) {
+                    m_level[pin] = now;
+                    m_events.push_back(event{clock::now(), static_cast<uint8_t>(pin), now});
+                }
+            }
+        }
+
+        [[nodiscard]] uint64_t read_bits() const noexcept {
+            uint64_t bits = 0;
+            for (unsigned pin = 0; pin < pin_count; ++pin) {
+                const bool input_enabled = (m_padreg[pin] & 0x2u) && !(m_cfg[pin] & 0x1u);
+                if (input_enabled && m_level[pin] == Level::high) { bits |= 1ull << pin; }
+            }
+            return bits;
+        }
+
+        static std::string vcd_id(unsigned index) {
+            std::string id;
+            do { id.push_back(static_cast<char>('!' + index % 94)); index /= 94; } while (index != 0);
+            return id;
+        }
+
+    public:
+        explicit gpio_model(const addressType base_address = 0x40010000) : device_model(base_address, 0x220) {
+            for (unsigned pin = 0; pin < pin_count; ++pin) { m_padreg[pin] = fncsel_gpio << 3; }
+            m_level.fill(Level::floating);
+            bus::attach(this);
+        }
+
+        ~gpio_model() override { bus::detach(this); }
+
+        gpio_model(const gpio_model&) = delete;
+        gpio_model& operator=(const gpio_model&) = delete;
+
+        uint32_t read(const addressType offset, const uint32_t stored) override {
+            if (offset < 0x34) {
+                uint32_t word = 0;
+                for (unsigned i = 0; i < 4 && offset + i < pin_count; ++i) { word |= uint32_t{m_padreg[offset + i]} << (8 * i); }
+                return word;
+            }
+            if (offset >= 0x40 && offset < 0x5C) {
+                const unsigned first = (offset - 0x40) * 2;
+                uint32_t word = 0;
+                for (unsigned i = 0; i < 8 && first + i < pin_count; ++i) { word |= uint32_t{m_cfg[first + i]} << (4 * i); }
+                return word;
+            }
+            switch (offset) {
+                case 0x80: case 0x84: return static_cast<uint32_t>((read_bits() & bank_mask(offset)) >> ((offset & 4u) ? 32 : 0));
+                case 0x88: case 0x8C: return static_cast<uint32_t>((m_wt & bank_mask(offset)) >> ((offset & 4u) ? 32 : 0));
+                case 0xA0: case 0xA4: return static_cast<uint32_t>((m_en & bank_mask(offset)) >> ((offset & 4u) ? 32 : 0));
+                case 0x60:            return m_unlocked ? 1u : 0u;
+                default:              return stored;
+            }
+        }
+
+        void write(const addressType offset, const uint32_t value, uint32_t& stored) override {
+            if (offset < 0x34) {
+                if (!m_unlocked) { ++m_locked_writes; return; }
+                stored = value;
+                for (unsigned i = 0; i < 4 && offset + i < pin_count; ++i) {
+                    m_padreg[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+                }
+            }
+            else if (offset >= 0x40 && offset < 0x5C) {
+                if (!m_unlocked) { ++m_locked_writes; return; }
+                stored = value;
+                const unsigned first = (offset - 0x40) * 2;
+                for (unsigned i = 0; i < 8 && first + i < pin_count; ++i) {
+                    m_cfg[first + i] = static_cast<uint8_t>((value >> (4 * i)) & 0xFu);
+                }
+            }
+            else {
+                stored = value;
+                switch (offset) {
+                    case 0x60: m_unlocked = (value == key_value); break;
+                    case 0x88: case 0x8C: m_wt = (m_wt & ~bank_mask(offset)) | (bank(offset, value) & bank_mask(offset)); break;
+                    case 0x90: case 0x94: m_wt |= bank(offset, value) & bank_mask(offset); break;
+                    case 0x98: case 0x9C: m_wt &= ~(bank(offset, value) & bank_mask(offset)); break;
+                    case 0xA0: case 0xA4: m_en = (m_en & ~bank_mask(offset)) | (bank(offset, value) & bank_mask(offset)); break;
+                    case 0xA8: case 0xAC: m_en |= bank(offset, value) & bank_mask(offset); break;
+                    case 0xB4: m_en &= ~(bank(0, value) & bank_mask(0)); break;     // ENCA/ENCB break the A/B offset pattern
+                    case 0xB8: m_en &= ~(bank(4, value) & bank_mask(4)); break;
+                    default: break;
+                }
+            }
+            update();
+        }
+
+        /// drive a pad from the test bench, as an external device would. Only visible while the pad is released.
+        void drive(const unsigned pin, const bool level) {
+            m_external_valid |= 1ull << pin;
+            if (level) { m_external |= 1ull << pin; } else { m_external &= ~(1ull << pin); }
+            update();
+        }
+
+        /// stop driving a pad from the test bench
+        void release(const unsigned pin) {
+            m_external_valid &= ~(1ull << pin);
+            update();
+        }
+
+        [[nodiscard]] Level level(const unsigned pin) const noexcept { return m_level[pin]; }
+        [[nodiscard]] uint8_t function(const unsigned pin) const noexcept { return (m_padreg[pin] >> 3) & 0x7u; }
+        [[nodiscard]] bool is_output(const unsigned pin) const noexcept {
+            const unsigned outcfg = (m_cfg[pin] >> 1) & 0x3u;
+            return function(pin) == fncsel_gpio && (outcfg == 1 || outcfg == 2 || (outcfg == 3 && (m_en >> pin) & 1u));
+        }
+
+        /// number of PADREG/CFG writes that were dropped because PADKEY was locked
+        [[nodiscard]] uint32_t locked_writes() const noexcept { return m_locked_writes; }
+
+        [[nodiscard]] const std::vector<event>& events() const noexcept { return m_events; }
+
+        /// number of 0->1 and 1->0 transitions seen on a pad
+        [[nodiscard]] std::size_t transitions(const unsigned pin) const noexcept {
+            std::size_t count = 0;
+            Level last = Level::floating;
+            for (const auto& e : m_events) {
+                if (e.pin != pin) { continue; }
+                if ((last == Level::low && e.level == Level::high) || (last == Level::high && e.level == Level::low)) { ++count; }
+                last = e.level;
+            }
+            return count;
+        }
+
+        void clear_events() { m_events.clear(); }
+
+        /// write every recorded level change as a Value Change Dump, one 4-state wire per pad
+        void write_vcd(std::ostream& out, const std::string& module = "apollo3") const {
+            out << "$timescale 1ns $end\n$scope module " << module << " $end\n";
+            for (unsigned pin = 0; pin < pin_count; ++pin) {
+                out << "$var wire 1 " << vcd_id(pin) << " P" << pin << " $end\n";
+            }
+            out << "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n";
+            for (unsigned pin = 0; pin < pin_count; ++pin) {
+                out << 'z' << vcd_id(pin) << '\n';
+            }
+            out << "$end\n";
+            uint64_t time = 0;
+            for (const auto& e : m_events) {
+                if (e.time_ns != time) {
+                    time = e.time_ns;
+                    out << '#' << time << '\n';
+                }
+                out << static_cast<char>(e.level) << vcd_id(e.pin) << '\n';
+            }
+        }
+
+        bool write_vcd(const std::string& path) const {
+            std::ofstream file(path);
+            if (!file) { return false; }
+            write_vcd(file);
+            return static_cast<bool>(file);
+        }
+    };  // class gpio_model
+
+}   // namespace sim
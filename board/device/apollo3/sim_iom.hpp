@@ -0,0 +1,351 @@
+#pragma once
+
+#include "simulation.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace sim {
+
+    /**
+     * Transaction level model of one IO master for SIMULATION_BUILD. Commands shift their offset and data bytes
+     * at the rate set by CLKCFG (one byte per 8 clocks for SPI, 9 SCL cycles for I2C) in sim::clock time, with
+     * 32 byte FIFOs that stall the bus when the CPU or DMA falls behind, so driver timing and throughput can be
+     * measured on the host. DMA moves data between the FIFOs and buffers registered with sim::memory, and the
+     * command queue executes its entries from there, waiting on writes to this IOM while a command is active.
+     *
+     * Every command is logged with its offset and data bytes. Read data comes from respond(), by default the
+     * byte index; I2C addresses registered with nak() fail with the NAK interrupt.
+     */
+    class iom_model : public device_model {
+    public:
+        /// bytes seen on the bus for one command
+        struct transaction {
+            uint64_t start_ns;
+            uint64_t end_ns;
+            uint8_t  cmd;
+            uint8_t  cs;
+            uint16_t address;   ///< I2C device address
+            bool     cont;
+            std::vector<uint8_t> offset;
+            std::vector<uint8_t> data;
+        };
+
+    private:
+        static constexpr uint32_t fifo_size = 32;
+
+        // register offsets
+        static constexpr addressType fifoptr = 0x100, fifothr = 0x104, fifopop = 0x108, fifopush = 0x10C, fifoctrl = 0x110;
+        static constexpr addressType inten = 0x200, intstat = 0x204, intclr = 0x208, intset = 0x20C;
+        static constexpr addressType clkcfg = 0x210, submodctrl = 0x214, cmd = 0x218, offsethi = 0x220, status = 0x2B4;
+        static constexpr addressType dmacfg = 0x280, dmatotcount = 0x288, dmatargaddr = 0x28C, dmastat = 0x290;
+        static constexpr addressType cqcfg = 0x294, cqaddr = 0x298, cqstat = 0x29C, cqflags = 0x2A0, cqsetclear = 0x2A4;
+        static constexpr addressType cqpauseen = 0x2A8, cqcuridx = 0x2AC, cqendidx = 0x2B0, devcfg = 0x404;
+
+        // INTSTAT bits
+        static constexpr uint32_t cmdcmp = 1u << 0, thr = 1u << 1, fundfl = 1u << 2, fovfl = 1u << 3, nak_bit = 1u << 4;
+        static constexpr uint32_t icmd = 1u << 6, dcmp = 1u << 10, derr = 1u << 11, cqupd = 1u << 13, cqerr = 1u << 14;
+
+        std::deque<uint8_t> m_wfifo;
+        std::deque<uint8_t> m_rfifo;
+        uint32_t m_intstat = 0;
+        uint32_t m_inten = 0;
+        uint32_t m_fifothr = 0;
+        uint32_t m_clkcfg = 0;
+        uint32_t m_submodctrl = 0;
+        uint32_t m_offsethi = 0;
+        uint32_t m_devcfg = 0;
+        uint32_t m_dmacfg = 0;
+        uint32_t m_dmacount = 0;
+        uint32_t m_dmaaddr = 0;
+        uint32_t m_dmastat = 0;
+        uint32_t m_cqcfg = 0;
+        uint32_t m_cqaddr = 0;
+        uint32_t m_cqflags = 0;
+        uint32_t m_cqpauseen = 0;
+        uint32_t m_cqcuridx = 0;
+        uint32_t m_cqendidx = 0;
+        uint32_t m_cq_executed = 0;
+        bool     m_in_cq = false;
+
+        bool     m_active = false;      // command in flight
+        uint8_t  m_cmd = 0;
+        uint32_t m_size = 0;
+        uint32_t m_done = 0;
+        uint32_t m_offset_left = 0;
+        uint64_t m_epoch_ns = 0;        // the bus clock last (re)started here
+        uint64_t m_clocked = 0;         // bytes shifted since m_epoch_ns
+        uint64_t m_next_ns = 0;         // time the next byte is on the bus
+        std::vector<transaction> m_log;
+
+        std::function<uint8_t(const transaction&)> m_responder;
+        std::vector<uint16_t> m_nak;
+
+        [[nodiscard]] bool is_i2c() const noexcept { return m_submodctrl & 0x10u; }
+
+        /// interface clock from CLKCFG, SCL for I2C
+        [[nodiscard]] uint32_t io_hz() const noexcept {
+            const uint32_t fsel = (m_clkcfg >> 8) & 0x7u;
+            if (fsel == 0 || !(m_clkcfg & 1u)) { return 0; }
+            uint32_t hz = 48000000u >> (fsel - 1);
+            if (m_clkcfg & (1u << 11)) { hz /= 3; }
+            if (m_clkcfg & (1u << 12)) { hz /= ((m_clkcfg >> 24) & 0xFFu) + 1; }
+            return is_i2c() ? hz / 2 : hz;
+        }
+
+        /// end of byte `n` after m_epoch_ns. Computed from the epoch so fractional byte times do not add up.
+        [[nodiscard]] uint64_t byte_end(const uint64_t n) const noexcept {
+            const uint32_t hz = io_hz();
+            const uint64_t bits = is_i2c() ? 9 : 8;     // I2C adds an ACK bit per byte
+            return m_epoch_ns + (hz ? (n * bits * 1000000000ull + hz - 1) / hz : n * 1000000);
+        }
+
+        /// (re)start the bus clock at `now`, after a command was issued or a FIFO stall
+        void restart(const uint64_t now) noexcept {
+            m_epoch_ns = now;
+            m_clocked = 0;
+            m_next_ns = byte_end(1);
+        }
+
+        void complete() {
+            m_active = false;
+            m_log.back().end_ns = m_next_ns;
+            if (m_cmd == 1 && (m_size % 4) != 0) {      // the unused bytes of the last pushed word are discarded
+                for (uint32_t i = m_size % 4; i < 4 && !m_wfifo.empty(); ++i) { m_wfifo.pop_front(); }
+            }
+            m_intstat |= cmdcmp;
+        }
+
+        /// move data between memory and the FIFOs while the DMA is enabled. The DMA is much faster than the bus.
+        void dma() {
+            if (!(m_dmacfg & 1u) || m_dmacount == 0) { return; }
+            const bool to_bus = m_dmacfg & 2u;
+            while (m_dmacount != 0 && (to_bus ? m_wfifo.size() < fifo_size : !m_rfifo.empty())) {
+                uint8_t* p = memory::host(m_dmaaddr);
+                if (p == nullptr) {
+                    m_intstat |= derr;
+                    m_dmastat = 4u;
+                    m_dmacount = 0;
+                    return;
+                }
+                if (to_bus) {
+                    m_wfifo.push_back(*p);
+                } else {
+                    *p = m_rfifo.front();
+                    m_rfifo.pop_front();
+                }
+                ++m_dmaaddr;
+                --m_dmacount;
+            }
+            m_dmastat = (m_dmacount == 0) ? 2u : 1u;
+            if (m_dmacount == 0) { m_intstat |= dcmp; }
+        }
+
+        [[nodiscard]] bool cq_paused() const noexcept {
+            return ((m_cqpauseen & 0x8000u) && m_cqcuridx == m_cqendidx) || (m_cqpauseen & m_cqflags & 0xFFu);
+        }
+
+        /// execute command queue entries until the queue pauses or has to wait for the IOM
+        void cq() {
+            if (m_in_cq || !(m_cqcfg & 1u)) { return; }
+            m_in_cq = true;
+            while ((m_cqcfg & 1u) && !cq_paused()) {
+                const uint8_t* p = memory::host(m_cqaddr);
+                if (p == nullptr) {
+                    m_intstat |= cqerr;
+                    m_cqcfg = 0;
+                    break;
+                }
+                uint32_t address = 0;
+                uint32_t value = 0;
+                std::memcpy(&address, p, 4);
+                std::memcpy(&value, p + 4, 4);
+                if (m_active && address >= base && address < base + size) { break; }
+                m_cqaddr += 8;
+                ++m_cq_executed;
+                if (address & 1u) { m_intstat |= cqupd; }
+                bus::write(address & ~3u, value, 4);
+            }
+            m_in_cq = false;
+        }
+
+        /// catch the bus up with sim::clock
+        void advance() {
+            const uint64_t now = clock::now();
+            dma();
+            cq();
+            while (m_active && now >= m_next_ns) {
+                dma();
+                if (m_offset_left) {
+                    --m_offset_left;
+                } else if (m_cmd == 1) {
+                    if (m_wfifo.empty()) {              // underrun, the clock stops until data arrives
+                        restart(now);
+                        break;
+                    }
+                    m_log.back().data.push_back(m_wfifo.front());
+                    m_wfifo.pop_front();
+                    ++m_done;
+                } else {
+                    if (m_rfifo.size() >= fifo_size) {  // read FIFO full, the clock stops until it is drained
+                        restart(now);
+                        break;
+                    }
+                    const uint8_t b = m_responder ? m_responder(m_log.back()) : static_cast<uint8_t>(m_done);
+                    m_log.back().data.push_back(b);
+                    m_rfifo.push_back(b);
+                    ++m_done;
+                }
+                if (m_offset_left == 0 && m_done == m_size) {
+                    complete();
+                    cq();
+                    continue;
+                }
+                m_next_ns = byte_end(++m_clocked + 1);
+            }
+            dma();
+        }
+
+        [[nodiscard]] uint32_t interrupt_status() const noexcept {
+            const uint32_t wthr = (m_fifothr >> 8) & 0x3Fu;
+            const uint32_t rthr = m_fifothr & 0x3Fu;
+            const bool level = (wthr && fifo_size - m_wfifo.size() >= wthr) || (rthr && m_rfifo.size() >= rthr);
+            return m_intstat | (level ? thr : 0u);
+        }
+
+        void start_command(const uint32_t value) {
+            if (m_active) {
+                m_intstat |= icmd;
+                return;
+            }
+            m_cmd = value & 0x1Fu;
+            m_size = (value >> 8) & 0xFFFu;
+            m_offset_left = (value >> 5) & 0x3u;
+            m_done = 0;
+            m_active = true;
+            restart(clock::now());
+
+            transaction t{clock::now(), 0, m_cmd, static_cast<uint8_t>((value >> 20) & 0x3u),
+                          static_cast<uint16_t>(m_devcfg & 0x3FFu), static_cast<bool>(value & 0x80u), {}, {}};
+            const uint32_t offset_bytes = ((m_offsethi & 0xFFFFu) << 8) | (value >> 24);
+            for (int i = static_cast<int>(m_offset_left) - 1; i >= 0; --i) { t.offset.push_back(static_cast<uint8_t>(offset_bytes >> (8 * i))); }
+            m_log.push_back(std::move(t));
+
+            if (is_i2c() && std::find(m_nak.begin(), m_nak.end(), m_devcfg & 0x3FFu) != m_nak.end()) {
+                m_active = false;
+                m_log.back().end_ns = m_next_ns;
+                m_intstat |= nak_bit;
+                return;
+            }
+            if (m_size == 0 && m_offset_left == 0) { complete(); }
+        }
+
+    public:
+        explicit iom_model(const addressType base_address = 0x50004000) : device_model(base_address, 0x1000) { bus::attach(this); }
+        ~iom_model() override { bus::detach(this); }
+
+        iom_model(const iom_model&) = delete;
+        iom_model& operator=(const iom_model&) = delete;
+
+        uint32_t read(const addressType offset, const uint32_t stored) override {
+            advance();
+            switch (offset) {
+                case fifoptr: {
+                    const auto w = static_cast<uint32_t>(m_wfifo.size());
+                    const auto r = static_cast<uint32_t>(m_rfifo.size());
+                    return w | ((fifo_size - w) << 8) | (r << 16) | ((fifo_size - r) << 24);
+                }
+                case fifopop: {
+                    if (m_rfifo.empty()) {
+                        m_intstat |= fundfl;
+                        return 0;
+                    }
+                    uint32_t word = 0;
+                    for (unsigned i = 0; i < 4 && !m_rfifo.empty(); ++i) {
+                        word |= uint32_t{m_rfifo.front()} << (8 * i);
+                        m_rfifo.pop_front();
+                    }
+                    return word;
+                }
+                case inten:       return m_inten;
+                case intstat:     return interrupt_status();
+                case status:      return m_active ? 0x2u : 0x4u;    // CMDACT or IDLEST
+                case dmatotcount: return m_dmacount;
+                case dmatargaddr: return m_dmaaddr;
+                case dmastat:     return m_dmastat;
+                case cqcfg:       return m_cqcfg;
+                case cqaddr:      return m_cqaddr;
+                case cqstat:      return ((m_cqcfg & 1u) ? 1u : 0u) | (cq_paused() ? 2u : 0u);
+                case cqflags:     return m_cqflags;
+                case cqpauseen:   return m_cqpauseen;
+                case cqcuridx:    return m_cqcuridx;
+                case cqendidx:    return m_cqendidx;
+                default:          return stored;
+            }
+        }
+
+        void write(const addressType offset, const uint32_t value, uint32_t& stored) override {
+            advance();
+            stored = value;
+            switch (offset) {
+                case fifothr: m_fifothr = value; break;
+                case fifopush:
+                    if (m_wfifo.size() > fifo_size - 4) {
+                        m_intstat |= fovfl;
+                        break;
+                    }
+                    for (unsigned i = 0; i < 4; ++i) { m_wfifo.push_back(static_cast<uint8_t>(value >> (8 * i))); }
+                    break;
+                case fifoctrl:
+                    if (!(value & 2u)) {            // FIFORSTN low holds the FIFOs in reset
+                        m_wfifo.clear();
+                        m_rfifo.clear();
+                    }
+                    break;
+                case inten:       m_inten = value; break;
+                case intclr:      m_intstat &= ~value; break;
+                case intset:      m_intstat |= value; break;
+                case clkcfg:      m_clkcfg = value; break;
+                case submodctrl:  m_submodctrl = value; break;
+                case cmd:         start_command(value); break;
+                case offsethi:    m_offsethi = value; break;
+                case devcfg:      m_devcfg = value; break;
+                case dmacfg:      m_dmacfg = value; dma(); break;
+                case dmatotcount: m_dmacount = value & 0xFFFu; m_dmastat = 0; break;
+                case dmatargaddr: m_dmaaddr = value; break;
+                case cqcfg:       m_cqcfg = value; break;
+                case cqaddr:      m_cqaddr = value; break;
+                case cqsetclear:
+                    m_cqflags = (m_cqflags | (value & 0xFFu)) ^ ((value >> 8) & 0xFFu);
+                    m_cqflags &= ~((value >> 16) & 0xFFu);
+                    break;
+                case cqpauseen:   m_cqpauseen = value; break;
+                case cqcuridx:    m_cqcuridx = value & 0xFFu; break;
+                case cqendidx:    m_cqendidx = value & 0xFFu; break;
+                default: break;
+            }
+        }
+
+        /// let commands to I2C `address` fail with a NAK
+        void nak(const uint16_t address) { m_nak.push_back(address); }
+
+        /// source of read data, called once per byte with the transaction so far
+        void respond(std::function<uint8_t(const transaction&)> responder) { m_responder = std::move(responder); }
+
+        [[nodiscard]] const std::vector<transaction>& transactions() const noexcept { return m_log; }
+        void clear_transactions() { m_log.clear(); }
+
+        /// true while a command is on the bus
+        [[nodiscard]] bool active() {
+            advance();
+            return m_active;
+        }
+
+        /// number of command queue entries executed so far
+        [[nodiscard]] uint32_t cq_executed() const noexcept { return m_cq_executed; }
+    };  // class iom_model
+
+}   // namespace sim
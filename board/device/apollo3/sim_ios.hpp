@@ -0,0 +1,141 @@
+#pragma once
+
+#include "simulation.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+    /**
+     * Model of the IO slave for SIMULATION_BUILD, seen from the host side of the interface. The LRAM is plain
+     * bus memory; the FIFO registers follow the hardware: FIFOINC advances FIFOCTR and FIFOSIZ, host reads
+     * drain the FIFO from FIFOPTR and wrap at FIFOMAX, and FSIZE is a level interrupt while FIFOSIZ is below
+     * FIFOTHR. A read from the empty FIFO raises FUNDFL and returns 0xFF as the bus would.
+     *
+     * host_read(), host_write() and host_clear() stand in for the host; each host byte takes one microsecond
+     * of sim::clock time.
+     */
+    class ios_model : public device_model {
+        static constexpr uint64_t byte_ns = 1000;
+
+        // register offsets
+        static constexpr addressType fifoptr = 0x100, fifocfg = 0x104, fifothr = 0x108, fupd = 0x10C, fifoctr = 0x110;
+        static constexpr addressType fifoinc = 0x114, cfg = 0x118, iointctl = 0x120;
+        static constexpr addressType inten = 0x200, intstat = 0x204, intclr = 0x208, intset = 0x20C;
+
+        // INTSTAT bits
+        static constexpr uint32_t fsize = 1u << 0, fundfl = 1u << 2, xcmprf = 1u << 6, xcmpwr = 1u << 9;
+
+        uint32_t m_pointer = 0;         // FIFOPTR, LRAM offset of the next byte the host reads
+        uint32_t m_level = 0;           // FIFOSIZ
+        uint32_t m_counter = 0;         // FIFOCTR
+        uint32_t m_fifocfg = 0;
+        uint32_t m_threshold = 0;
+        uint32_t m_fupd = 0;
+        uint32_t m_intstat = 0;
+        uint32_t m_inten = 0;
+        uint32_t m_iointen = 0;
+        uint32_t m_ioint = 0;
+        uint32_t m_updates = 0;
+        bool     m_host_reading = false;
+
+        [[nodiscard]] uint32_t fifo_base() const noexcept { return (m_fifocfg & 0x1Fu) * 8; }
+        [[nodiscard]] uint32_t fifo_end() const noexcept { return ((m_fifocfg >> 8) & 0x3Fu) * 8; }
+
+        [[nodiscard]] uint8_t& lram(const uint32_t offset) const { return const_cast<uint8_t&>(bus::storage<uint8_t>(base + offset)); }
+
+    public:
+        explicit ios_model(const addressType base_address = 0x50000000) : device_model(base_address, 0x1000) { bus::attach(this); }
+        ~ios_model() override { bus::detach(this); }
+
+        ios_model(const ios_model&) = delete;
+        ios_model& operator=(const ios_model&) = delete;
+
+        uint32_t read(const addressType offset, const uint32_t stored) override {
+            switch (offset) {
+                case fifoptr:  return m_pointer | (m_level << 8);
+                case fifoctr:  return m_counter;
+                case fupd:     return m_fupd | (m_host_reading ? 2u : 0u);
+                case iointctl: return m_iointen | (m_ioint << 8);
+                case inten:    return m_inten;
+                case intstat:  return m_intstat | ((m_level < m_threshold) ? fsize : 0u);
+                default:       return stored;
+            }
+        }
+
+        void write(const addressType offset, const uint32_t value, uint32_t& stored) override {
+            stored = value;
+            switch (offset) {
+                case fifoptr: m_pointer = value & 0xFFu; m_level = (value >> 8) & 0xFFu; break;
+                case fifocfg: m_fifocfg = value; break;
+                case fifothr: m_threshold = value & 0xFFu; break;
+                case fupd:
+                    m_fupd = value & 1u;
+                    ++m_updates;
+                    break;
+                case fifoctr: m_counter = value & 0x3FFu; break;
+                case fifoinc:
+                    m_counter = (m_counter + (value & 0x3FFu)) & 0x3FFu;
+                    m_level += value & 0x3FFu;
+                    break;
+                case iointctl:
+                    m_iointen = value & 0xFFu;
+                    if (value & (1u << 16)) { m_ioint = 0; }
+                    m_ioint |= (value >> 24) & 0xFFu;
+                    break;
+                case inten:  m_inten = value; break;
+                case intclr: m_intstat &= ~value; break;
+                case intset: m_intstat |= value; break;
+                default: break;
+            }
+        }
+
+        /// the host reads `count` bytes from the FIFO
+        std::vector<uint8_t> host_read(const std::size_t count) {
+            std::vector<uint8_t> data;
+            for (std::size_t i = 0; i < count; ++i) {
+                clock::advance(byte_ns);
+                if (m_level == 0) {
+                    m_intstat |= fundfl;
+                    data.push_back(0xFF);
+                    continue;
+                }
+                data.push_back(lram(m_pointer));
+                if (++m_pointer == fifo_end()) { m_pointer = fifo_base(); }
+                --m_level;
+                m_counter = (m_counter - 1) & 0x3FFu;
+            }
+            m_intstat |= xcmprf;
+            return data;
+        }
+
+        /// the host writes `data` to the register map at `offset`
+        void host_write(const uint32_t offset, const std::vector<uint8_t>& data) {
+            for (std::size_t i = 0; i < data.size(); ++i) {
+                clock::advance(byte_ns);
+                lram(offset + static_cast<uint32_t>(i)) = data[i];
+            }
+            m_intstat |= xcmpwr;
+        }
+
+        /// the host reads one byte of the register map
+        [[nodiscard]] uint8_t host_register(const uint32_t offset) const { return lram(offset); }
+
+        /// the host clears IOINT bits after it has serviced them
+        void host_clear(const uint8_t mask) noexcept { m_ioint &= ~uint32_t{mask}; }
+
+        /// hold FUPD.IOREAD as if a host read were in progress
+        void host_reading(const bool reading) noexcept { m_host_reading = reading; }
+
+        /// FIFOCTR as the host sees it
+        [[nodiscard]] uint32_t counter() const noexcept { return m_counter; }
+
+        /// IOINT bits raised towards the host
+        [[nodiscard]] uint32_t ioint() const noexcept { return m_ioint; }
+
+        /// writes to FUPD so far, two per update bracket
+        [[nodiscard]] uint32_t updates() const noexcept { return m_updates; }
+    };  // class ios_model
+
+}   // namespace sim
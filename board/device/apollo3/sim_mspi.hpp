@@ -0,0 +1,425 @@
+#pragma once
+
+#include "simulation.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace sim {
+
+    /// a memory part on the MSPI model: instructions with data from or to the host, and its contents
+    class mspi_device {
+    protected:
+        std::vector<uint8_t> m_memory;
+        std::vector<uint8_t> m_log;
+
+        [[nodiscard]] uint8_t& at(const uint32_t address) { return m_memory[address % m_memory.size()]; }
+
+    public:
+        explicit mspi_device(const std::size_t bytes, const uint8_t fill) : m_memory(bytes, fill) { }
+        virtual ~mspi_device() = default;
+
+        /// instruction with data bytes from the host
+        virtual void write(uint8_t instruction, uint32_t address, const std::vector<uint8_t>& data) = 0;
+
+        /// instruction reading `data.size()` bytes into `data`
+        virtual void read(uint8_t instruction, uint32_t address, std::vector<uint8_t>& data) = 0;
+
+        [[nodiscard]] std::vector<uint8_t>& memory() noexcept { return m_memory; }
+
+        /// instructions received so far
+        [[nodiscard]] const std::vector<uint8_t>& instructions() const noexcept { return m_log; }
+        void clear_instructions() { m_log.clear(); }
+    };  // class mspi_device
+
+    /**
+     * SPI NOR flash behind the MSPI model: status register with write enable latch and busy bit, page program
+     * within a 256 byte page, 4 KB sector and 64 KB block erase, JEDEC ID and the serial, fast and quad reads.
+     * Programs and erases keep the part busy for a fixed sim::clock time, during which reads return 0xEE.
+     */
+    class nor_flash : public mspi_device {
+        static constexpr uint64_t status_write_ns = 5000, program_ns = 20000, sector_erase_ns = 200000, block_erase_ns = 500000;
+
+        uint64_t m_busy_until = 0;
+        uint8_t  m_status = 0;
+        bool     m_write_enabled = false;
+
+        void erase(const uint32_t address, const uint32_t size, const uint64_t ns) {
+            const uint32_t start = address & ~(size - 1);
+            for (uint32_t i = 0; i < size; ++i) { at(start + i) = 0xFF; }
+            m_busy_until = clock::now() + ns;
+        }
+
+    public:
+        explicit nor_flash(const std::size_t bytes) : mspi_device(bytes, 0xFF) { }
+
+        [[nodiscard]] bool busy() const noexcept { return clock::now() < m_busy_until; }
+
+        void write(const uint8_t instruction, const uint32_t address, const std::vector<uint8_t>& data) override {
+            m_log.push_back(instruction);
+            if (busy()) { return; }
+            if (instruction == 0x06) { m_write_enabled = true; return; }
+            if (instruction == 0x04) { m_write_enabled = false; return; }
+            if (!m_write_enabled) { return; }
+            switch (instruction) {
+                case 0x01:                                  // write status register
+                    if (data.empty()) { return; }
+                    m_status = data[0] & 0xFCu;
+                    m_busy_until = clock::now() + status_write_ns;
+                    break;
+                case 0x02:                                  // page program, serial or quad
+                case 0x38:
+                    for (std::size_t i = 0; i < data.size(); ++i) { at((address & ~0xFFu) | ((address + i) & 0xFFu)) &= data[i]; }
+                    m_busy_until = clock::now() + program_ns;
+                    break;
+                case 0x20: erase(address, 0x1000, sector_erase_ns); break;
+                case 0xD8: erase(address, 0x10000, block_erase_ns); break;
+                default: return;
+            }
+            m_write_enabled = false;
+        }
+
+        void read(const uint8_t instruction, const uint32_t address, std::vector<uint8_t>& data) override {
+            m_log.push_back(instruction);
+            switch (instruction) {
+                case 0x05: {                                // read status register
+                    const auto status = static_cast<uint8_t>(m_status | (busy() ? 1u : 0u) | (m_write_enabled ? 2u : 0u));
+                    for (uint8_t& b : data) { b = status; }
+                    break;
+                }
+                case 0x9F: {                                // JEDEC ID of an MX25R6435F
+                    constexpr uint8_t id[3] = {0xC2, 0x28, 0x17};
+                    for (std::size_t i = 0; i < data.size(); ++i) { data[i] = id[i % 3]; }
+                    break;
+                }
+                case 0x03:
+                case 0x0B:
+                case 0xEB:
+                    for (std::size_t i = 0; i < data.size(); ++i) { data[i] = busy() ? 0xEE : at(address + static_cast<uint32_t>(i)); }
+                    break;
+                default:
+                    for (uint8_t& b : data) { b = 0; }
+                    break;
+            }
+        }
+
+        [[nodiscard]] uint8_t status() const noexcept { return m_status; }
+    };  // class nor_flash
+
+    /**
+     * QSPI PSRAM such as the APS6404L: reset enable and reset (0x66, 0x99) return it to SPI mode, 0x35 enters
+     * QPI. Writes (0x02, 0x38) and reads (0x03, 0x0B, 0xEB) are linear and take effect at once.
+     */
+    class psram : public mspi_device {
+        bool m_reset_enabled = false;
+        bool m_quad = false;
+        uint32_t m_resets = 0;
+
+    public:
+        explicit psram(const std::size_t bytes) : mspi_device(bytes, 0) { }
+
+        void write(const uint8_t instruction, const uint32_t address, const std::vector<uint8_t>& data) override {
+            m_log.push_back(instruction);
+            const bool reset_enabled = m_reset_enabled;
+            m_reset_enabled = false;
+            switch (instruction) {
+                case 0x66: m_reset_enabled = true; break;
+                case 0x99:
+                    if (reset_enabled) {
+                        m_quad = false;
+                        ++m_resets;
+                    }
+                    break;
+                case 0x35: m_quad = true; break;
+                case 0x02:
+                case 0x38:
+                    for (std::size_t i = 0; i < data.size(); ++i) { at(address + static_cast<uint32_t>(i)) = data[i]; }
+                    break;
+                default: break;
+            }
+        }
+
+        void read(const uint8_t instruction, const uint32_t address, std::vector<uint8_t>& data) override {
+            m_log.push_back(instruction);
+            m_reset_enabled = false;
+            const bool readable = instruction == 0x03 || instruction == 0x0B || instruction == 0xEB;
+            for (std::size_t i = 0; i < data.size(); ++i) { data[i] = readable ? at(address + static_cast<uint32_t>(i)) : 0; }
+        }
+
+        /// true once the part is in QPI mode
+        [[nodiscard]] bool quad() const noexcept { return m_quad; }
+
+        /// completed reset sequences
+        [[nodiscard]] uint32_t resets() const noexcept { return m_resets; }
+    };  // class psram
+
+    /**
+     * Model of the MSPI for SIMULATION_BUILD with a nor_flash or psram attached. Programmed IO commands run
+     * through the 16 word FIFOs: a write completes once the CPU has pushed XFERBYTES, a read fills the RX FIFO
+     * right away.
+     * A DMA command moves its whole DMATOTCOUNT between the device and a buffer registered with sim::memory
+     * when DMAEN is written, sending FLASH.READINSTR or WRITEINSTR, and raises DCMP. The command queue runs
+     * its entries as soon as it is enabled, extended or released, until (CQFLAGS & CQPAUSE) == CQPAUSE; since
+     * commands and DMA complete at once it never waits for them. While FLASH.XIPEN is set, the XIP window at
+     * 0x04000000 reads the device contents.
+     *
+     * SCRAMBLING is modelled as an address keyed XOR of every byte DMA and XIP move inside the region, so the
+     * device holds scrambled data; a DMA into the region that is not whole words raises SCRERR instead.
+     */
+    class mspi_model : public device_model {
+    public:
+        /// one DMA command
+        struct transfer {
+            uint32_t device_address;
+            uint32_t count;
+            bool     write;
+        };
+
+    private:
+        // register offsets
+        static constexpr addressType ctrl = 0x000, addr = 0x008, instr = 0x00C, txfifo = 0x010, rxfifo = 0x014;
+        static constexpr addressType txentries = 0x018, rxentries = 0x01C, flashcfg = 0x10C, scrambling = 0x120;
+        static constexpr addressType inten = 0x200, intstat = 0x204, intclr = 0x208, intset = 0x20C;
+        static constexpr addressType dmacfg = 0x250, dmastat = 0x254, dmatargaddr = 0x258, dmadevaddr = 0x25C, dmatotcount = 0x260;
+        static constexpr addressType cqcfg = 0x2A0, cqaddr = 0x2A8, cqstat = 0x2AC, cqflags = 0x2B0, cqsetclear = 0x2B4;
+        static constexpr addressType cqpause = 0x2B8, cqcuridx = 0x2C0, cqendidx = 0x2C4;
+
+        // INTSTAT bits
+        static constexpr uint32_t cmdcmp = 1u << 0, dcmp = 1u << 6, derr = 1u << 7, cqupd = 1u << 9, cqpaused = 1u << 10, cqerr = 1u << 11;
+        static constexpr uint32_t screrr = 1u << 12;
+
+        // CQFLAGS hardware bits
+        static constexpr uint32_t cqidx = 1u << 14;
+
+        // CTRL bits
+        static constexpr uint32_t start = 1u << 0, status = 1u << 1, txrx = 1u << 10;
+
+        struct xip_window : device_model {
+            mspi_model& mspi;
+
+            explicit xip_window(mspi_model& owner) : device_model(0x04000000, 0x04000000), mspi(owner) { bus::attach(this); }
+            ~xip_window() override { bus::detach(this); }
+
+            xip_window(const xip_window&) = delete;
+            xip_window& operator=(const xip_window&) = delete;
+
+            uint32_t read(const addressType offset, const uint32_t) override {
+                if (!(mspi.m_flash_cfg & 1u)) { return 0xDEADBEEF; }    // not mapped without XIPEN
+                uint8_t bytes[4];
+                for (uint32_t i = 0; i < 4; ++i) { bytes[i] = mspi.m_device.memory()[(offset + i) % mspi.m_device.memory().size()]; }
+                mspi.scramble(offset, bytes, 4);
+                uint32_t word = 0;
+                for (uint32_t i = 0; i < 4; ++i) { word |= uint32_t{bytes[i]} << (8 * i); }
+                return word;
+            }
+        };
+
+        mspi_device& m_device;
+        xip_window m_xip;
+        std::deque<uint32_t> m_tx;
+        std::deque<uint32_t> m_rx;
+        uint32_t m_ctrl = 0;
+        uint32_t m_address = 0;
+        uint32_t m_instruction = 0;
+        uint32_t m_flash_cfg = 0;
+        uint32_t m_scrambling = 0;
+        uint32_t m_intstat = 0;
+        uint32_t m_inten = 0;
+        uint32_t m_expected = 0;        // bytes of the write in progress
+        bool     m_writing = false;
+        uint32_t m_dma_target = 0;
+        uint32_t m_dma_device = 0;
+        uint32_t m_dma_count = 0;
+        uint32_t m_dma_status = 0;
+        std::vector<transfer> m_transfers;
+        uint32_t m_cqcfg = 0;
+        uint32_t m_cqaddr = 0;
+        uint32_t m_cqflags = 0;
+        uint32_t m_cqpause = 0;
+        uint32_t m_cqcuridx = 0;
+        uint32_t m_cqendidx = 0;
+        uint32_t m_cq_executed = 0;
+        bool     m_in_cq = false;
+
+        [[nodiscard]] bool scrambled(const uint32_t address) const noexcept {
+            const uint32_t block = address >> 16;
+            return (m_scrambling >> 31) && block >= (m_scrambling & 0x3FFu) && block <= ((m_scrambling >> 16) & 0x3FFu);
+        }
+
+        /// XOR `size` bytes at device `address` with the key of their word; the same call undoes it
+        void scramble(const uint32_t address, uint8_t* const data, const std::size_t size) const noexcept {
+            for (std::size_t i = 0; i < size; ++i) {
+                const uint32_t at = address + static_cast<uint32_t>(i);
+                if (scrambled(at)) { data[i] ^= static_cast<uint8_t>(((at >> 2) * 0x9Eu) ^ 0x5Au ^ (at & 3u)); }
+            }
+        }
+
+        void dma(const uint32_t cfg) {
+            if ((cfg & 0x3u) != 0x3u) { return; }
+            const bool to_device = cfg & 0x4u;
+            m_transfers.push_back(transfer{m_dma_device, m_dma_count, to_device});
+            if (scrambled(m_dma_device) && ((m_dma_device | m_dma_count) & 3u)) {
+                m_intstat |= screrr;
+                return;
+            }
+            uint8_t* const buffer = memory::host(m_dma_target);
+            if (buffer == nullptr || memory::host(m_dma_target + m_dma_count - 1) == nullptr) {
+                m_dma_status = 0x4u;                                            // DMAERR
+                m_intstat |= derr;
+                return;
+            }
+            std::vector<uint8_t> data(m_dma_count);
+            if (to_device) {
+                std::memcpy(data.data(), buffer, m_dma_count);
+                scramble(m_dma_device, data.data(), data.size());
+                m_device.write(static_cast<uint8_t>(m_flash_cfg >> 16), m_dma_device, data);
+            } else {
+                m_device.read(static_cast<uint8_t>(m_flash_cfg >> 24), m_dma_device, data);
+                scramble(m_dma_device, data.data(), data.size());
+                std::memcpy(buffer, data.data(), m_dma_count);
+            }
+            m_dma_status = 0x2u;                                                // DMACPL
+            m_intstat |= dcmp;
+        }
+
+        [[nodiscard]] uint32_t cq_flags() const noexcept { return m_cqflags | (m_cqcuridx == m_cqendidx ? cqidx : 0u); }
+
+        [[nodiscard]] bool cq_paused() const noexcept { return m_cqpause != 0 && (cq_flags() & m_cqpause) == m_cqpause; }
+
+        /// execute command queue entries until the queue pauses
+        void cq() {
+            if (m_in_cq || !(m_cqcfg & 1u)) { return; }
+            m_in_cq = true;
+            while ((m_cqcfg & 1u) && !cq_paused()) {
+                const uint8_t* p = memory::host(m_cqaddr);
+                if (p == nullptr) {
+                    m_intstat |= cqerr;
+                    m_cqcfg = 0;
+                    break;
+                }
+                uint32_t address = 0;
+                uint32_t value = 0;
+                std::memcpy(&address, p, 4);
+                std::memcpy(&value, p + 4, 4);
+                m_cqaddr += 8;
+                ++m_cq_executed;
+                if (address & 1u) { m_intstat |= cqupd; }
+                bus::write(address & ~3u, value, 4);
+            }
+            if ((m_cqcfg & 1u) && cq_paused()) { m_intstat |= cqpaused; }
+            m_in_cq = false;
+        }
+
+        void finish_write() {
+            std::vector<uint8_t> data(m_expected);
+            for (std::size_t i = 0; i < m_expected; ++i) { data[i] = static_cast<uint8_t>(m_tx[i / 4] >> (8 * (i % 4))); }
+            m_device.write(static_cast<uint8_t>(m_instruction), m_address, data);
+            m_writing = false;
+            m_ctrl |= status;
+            m_intstat |= cmdcmp;
+        }
+
+        void start_command(const uint32_t value) {
+            m_ctrl = value & ~(start | status);
+            m_expected = value >> 16;
+            m_tx.clear();
+            m_rx.clear();
+            if (value & txrx) {
+                m_writing = true;
+                if (m_expected == 0) { finish_write(); }
+                return;
+            }
+            std::vector<uint8_t> data(m_expected);
+            m_device.read(static_cast<uint8_t>(m_instruction), m_address, data);
+            for (std::size_t i = 0; i < data.size(); i += 4) {
+                uint32_t word = 0;
+                for (std::size_t j = 0; j < 4 && i + j < data.size(); ++j) { word |= uint32_t{data[i + j]} << (8 * j); }
+                m_rx.push_back(word);
+            }
+            if (m_rx.empty()) { m_ctrl |= status; }
+            m_intstat |= cmdcmp;
+        }
+
+    public:
+        explicit mspi_model(mspi_device& device, const addressType base_address = 0x50014000)
+            : device_model(base_address, 0x1000), m_device(device), m_xip(*this) { bus::attach(this); }
+        ~mspi_model() override { bus::detach(this); }
+
+        mspi_model(const mspi_model&) = delete;
+        mspi_model& operator=(const mspi_model&) = delete;
+
+        uint32_t read(const addressType offset, const uint32_t stored) override {
+            switch (offset) {
+                case ctrl:       return m_ctrl;
+                case rxfifo: {
+                    if (m_rx.empty()) { return 0; }
+                    const uint32_t word = m_rx.front();
+                    m_rx.pop_front();
+                    if (m_rx.empty()) { m_ctrl |= status; }
+                    return word;
+                }
+                case txentries:  return 0;          // words are shifted out as they arrive
+                case rxentries:  return static_cast<uint32_t>(m_rx.size() < 16 ? m_rx.size() : 16);
+                case flashcfg:   return m_flash_cfg;
+                case scrambling: return m_scrambling;
+                case inten:      return m_inten;
+                case intstat:    return m_intstat;
+                case dmastat:    return m_dma_status;
+                case cqcfg:      return m_cqcfg;
+                case cqaddr:     return m_cqaddr;
+                case cqstat:     return ((m_cqcfg & 1u) ? 1u : 0u) | ((m_cqcfg & 1u) && cq_paused() ? 8u : 0u);
+                case cqflags:    return cq_flags();
+                case cqpause:    return m_cqpause;
+                case cqcuridx:   return m_cqcuridx;
+                case cqendidx:   return m_cqendidx;
+                default:         return stored;
+            }
+        }
+
+        void write(const addressType offset, const uint32_t value, uint32_t& stored) override {
+            stored = value;
+            switch (offset) {
+                case ctrl:
+                    if (value & start) { start_command(value); }
+                    break;
+                case addr:        m_address = value; break;
+                case instr:       m_instruction = value; break;
+                case txfifo:
+                    if (!m_writing) { break; }
+                    m_tx.push_back(value);
+                    if (m_tx.size() * 4 >= m_expected) { finish_write(); }
+                    break;
+                case flashcfg:    m_flash_cfg = value; break;
+                case scrambling:  m_scrambling = value; break;
+                case inten:       m_inten = value; break;
+                case intclr:      m_intstat &= ~value; break;
+                case intset:      m_intstat |= value; break;
+                case dmacfg:      dma(value); break;
+                case dmatargaddr: m_dma_target = value; break;
+                case dmadevaddr:  m_dma_device = value; break;
+                case dmatotcount: m_dma_count = value & 0xFFFFu; m_dma_status = 0; break;
+                case cqcfg:       m_cqcfg = value; cq(); break;
+                case cqaddr:      m_cqaddr = value; break;
+                case cqsetclear:
+                    m_cqflags = (m_cqflags | (value & 0xFFu)) ^ ((value >> 8) & 0xFFu);
+                    m_cqflags &= ~((value >> 16) & 0xFFu);
+                    cq();
+                    break;
+                case cqpause:     m_cqpause = value & 0xFFFFu; break;
+                case cqcuridx:    m_cqcuridx = value & 0xFFu; break;
+                case cqendidx:    m_cqendidx = value & 0xFFu; cq(); break;
+                default: break;
+            }
+        }
+
+        /// DMA commands so far
+        [[nodiscard]] const std::vector<transfer>& transfers() const noexcept { return m_transfers; }
+        void clear_transfers() { m_transfers.clear(); }
+
+        /// command queue entries executed so far
+        [[nodiscard]] uint32_t cq_executed() const noexcept { return m_cq_executed; }
+    };  // class mspi_model
+
+}   // namespace sim
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Register bus for SIMULATION_BUILD. Every sfr::reg_t access is routed here instead of to a hardware
+ * address. Plain registers are backed by memory; address ranges with a device_model attached are
+ * forwarded to the model so side effects (set/clear registers, status bits) can be emulated.
+ */
+namespace sim {
+
+    using addressType = uint32_t;
+
+    /// virtual time of the simulation in nanoseconds. Advances a fixed amount per register access.
+    class clock {
+        static inline uint64_t s_now_ns = 0;
+        static inline uint32_t s_access_ns = 42;    // about two APB cycles at 48 MHz
+
+    public:
+        [[nodiscard]] static uint64_t now() noexcept { return s_now_ns; }
+        static void advance(const uint64_t ns) noexcept { s_now_ns += ns; }
+        static void set_access_cost(const uint32_t ns) noexcept { s_access_ns = ns; }
+        [[nodiscard]] static uint32_t access_cost() noexcept { return s_access_ns; }
+        static void reset() noexcept { s_now_ns = 0; }
+    };
+
+    /// base class of the peripheral models. Offsets are word aligned and relative to `base`.
+    struct device_model {
+        addressType base;
+        addressType size;
+
+        constexpr device_model(const addressType base_address, const addressType span) noexcept : base(base_address), size(span) { }
+        virtual ~device_model() = default;
+
+        /// value returned for a read of the word at offset. `stored` is the last value written.
+        virtual uint32_t read(const addressType offset, const uint32_t stored) { (void)offset; return stored; }
+
+        /// apply a write of the word at offset. Byte writes are already merged into `value`.
+        virtual void write(const addressType offset, const uint32_t value, uint32_t& stored) { (void)offset; stored = value; }
+    };
+
+    class bus {
+        static inline std::unordered_map<addressType, uint32_t> s_memory;
+        static inline std::vector<device_model*> s_models;
+
+        static device_model* find(const addressType address) noexcept {
+            for (auto* m : s_models) {
+                if (address >= m->base && address < m->base + m->size) { return m; }
+            }
+            return nullptr;
+        }
+
+        static constexpr uint32_t lane_mask(const addressType address, const unsigned size) noexcept {
+            return (size >= 4 ? 0xFFFFFFFFu : ((1u << (8 * size)) - 1u)) << (8 * (address & 3u));
+        }
+
+    public:
+        /// read `size` bytes at address
+        static uint32_t read(const addressType address, const unsigned size) {
+            clock::advance(clock::access_cost());
+            const addressType word = address & ~3u;
+            uint32_t value = s_memory[word];
+            if (auto* m = find(word)) { value = m->read(word - m->base, value); }
+            return (value & lane_mask(address, size)) >> (8 * (address & 3u));
+        }
+
+        /// write `size` bytes at address
+        static void write(const addressType address, const uint32_t value, const unsigned size) {
+            clock::advance(clock::access_cost());
+            const addressType word = address & ~3u;
+            uint32_t& stored = s_memory[word];
+            const uint32_t lanes = lane_mask(address, size);
+            const uint32_t merged = (stored & ~lanes) | ((value << (8 * (address & 3u))) & lanes);
+            if (auto* m = find(word)) { m->write(word - m->base, merged, stored); }
+            else { stored = merged; }
+        }
+
+        /// direct reference to the backing store of a register. Bypasses the models, used by reg_t::value().
+        template <typename T>
+        static volatile T& storage(const addressType address) {
+            auto& word = s_memory[address & ~3u];
+            return *(reinterpret_cast<volatile T*>(reinterpret_cast<volatile uint8_t*>(&word) + (address & 3u)));
+        }
+
+        static void attach(device_model* model) { s_models.push_back(model); }
+        static void detach(device_model* model) { s_models.erase(std::remove(s_models.begin(), s_models.end(), model), s_models.end()); }
+
+        /// forget every register value. Attached models stay attached.
+        static void reset() { s_memory.clear(); }
+    };  // class bus
+
+    /**
+     * 32 bit SRAM addresses for host buffers handed to a DMA or command queue model. A 64 bit host pointer
+     * does not fit the target address registers, so each buffer gets a range of the Apollo3 SRAM window that
+     * the models translate back with host().
+     *
+     * Windows are reused: a range inside a mapped buffer gets an address in its window, and a buffer mapped
+     * chunk by chunk grows the newest window instead of taking a new one. unmap() gives a window back for
+     * later buffers. Running out of the SRAM window stops the simulation, as a leak of mappings would
+     * otherwise hand out addresses no model can resolve.
+     */
+    class memory {
+        struct window { addressType address; uint8_t* host; std::size_t size; };
+        static inline std::vector<window> s_windows;    // sorted by address
+
+        static constexpr addressType align(const std::size_t value) noexcept { return static_cast<addressType>((value + 15) & ~std::size_t{15}); }
+
+        [[noreturn]] static void exhausted(const std::size_t size) {
+            std::fprintf(stderr, "sim::memory: no room for %zu bytes in the SRAM window, unmap() buffers no longer in use\n", size);
+            std::abort();
+        }
+
+    public:
+        static constexpr addressType sram_start = 0x10000000;
+        static constexpr addressType sram_end = 0x10060000;
+
+        /// SRAM address of `size` bytes at `host`. Mapping the same buffer again reuses its address.
+        static addressType map(const volatile void* host, const std::size_t size) {
+            auto* p = const_cast<uint8_t*>(static_cast<const volatile uint8_t*>(host));
+            for (const auto& w : s_windows) {
+                if (p >= w.host && p + size <= w.host + w.size) { return w.address + static_cast<addressType>(p - w.host); }
+            }
+            if (!s_windows.empty()) {
+                window& last = s_windows.back();
+                if (p >= last.host && p <= last.host + last.size) {
+                    const std::size_t grown = static_cast<std::size_t>(p - last.host) + size;
+                    if (last.address + grown > sram_end) { exhausted(size); }
+                    last.size = grown;
+                    return last.address + static_cast<addressType>(p - last.host);
+                }
+            }
+            addressType address = sram_start;
+            auto at = s_windows.begin();
+            for (; at != s_windows.end() && at->address - address < size; ++at) { address = align(at->address + at->size); }
+            if (at == s_windows.end() && size > sram_end - address) { exhausted(size); }
+            s_windows.insert(at, window{address, p, size});
+            return address;
+        }
+
+        /// release the window that holds `host`; its addresses may be handed out again
+        static void unmap(const volatile void* host) {
+            auto* p = const_cast<uint8_t*>(static_cast<const volatile uint8_t*>(host));
+            s_windows.erase(std::remove_if(s_windows.begin(), s_windows.end(),
+                                           [p](const window& w) { return p >= w.host && p < w.host + w.size; }),
+                            s_windows.end());
+        }
+
+        /// host byte behind an SRAM address returned by map(), nullptr if it was never mapped
+        static uint8_t* host(const addressType address) noexcept {
+            for (const auto& w : s_windows) {
+                if (address >= w.address && address < w.address + w.size) { return w.host + (address - w.address); }
+            }
+            return nullptr;
+        }
+
+        /// SRAM bytes currently taken by windows
+        [[nodiscard]] static std::size_t mapped() noexcept {
+            std::size_t total = 0;
+            for (const auto& w : s_windows) { total += w.size; }
+            return total;
+        }
+
+        static void reset() { s_windows.clear(); }
+    };  // class memory
+
+}   // namespace sim
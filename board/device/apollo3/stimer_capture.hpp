@@ -0,0 +1,228 @@
+#pragma once
+
+#include "CTIMER.hpp"
+#include "ring_buffer.hpp"
+#include <cstdint>
+#include <cstddef>
+
+namespace STIMER {
+
+    /// tick rate of the system timer for each STCFG.CLKSEL setting. Prescaled CTIMER sources return 0 (unknown).
+    constexpr uint32_t clock_hz(const sfr::CTIMER::CLKSELv sel) noexcept {
+        switch (sel) {
+            case sfr::CTIMER::CLKSELv::HFRC_DIV16:  return 3000000;
+            case sfr::CTIMER::CLKSELv::HFRC_DIV256: return 187500;
+            case sfr::CTIMER::CLKSELv::XTAL_DIV1:   return 32768;
+            case sfr::CTIMER::CLKSELv::XTAL_DIV2:   return 16384;
+            case sfr::CTIMER::CLKSELv::XTAL_DIV32:  return 1024;
+            case sfr::CTIMER::CLKSELv::LFRC_DIV1:   return 1024;
+            default:                                return 0;
+        }
+    }
+
+    /// clear and start the system timer from the given clock source
+    template <typename CTIMER_T>
+    void start(const sfr::CTIMER::CLKSELv sel) noexcept {
+        CTIMER_T::STCFG.write(CTIMER_T::STCFG_t::CLKSEL.shift(sel).value | CTIMER_T::STCFG_t::CLEAR.shift(true).value);
+        CTIMER_T::STCFG.write(CTIMER_T::STCFG_t::CLKSEL.shift(sel).value);
+    }
+
+    /// Which pin transition is latched into a capture register. Values match STMRCAP.STPOLn.
+    enum class Edge : uint8_t {
+        rising  = 0,    ///< CAPLH - capture on low to high GPIO transition
+        falling = 1,    ///< CAPHL - capture on high to low GPIO transition
+    };
+
+    /// one hardware timestamp: the STIMER count latched when the routed pin changed
+    struct capture_t {
+        uint32_t timestamp;
+        uint8_t  channel;
+    };
+
+    /**
+     * Hardware edge timestamping on the four STIMER capture channels (SCAPT0-3 / capture A-D).
+     * GPIO.STMRCAP routes a pad to each channel, the STIMER copies its counter into SCAPTn on the selected
+     * edge, and isr() moves the captures into a lock-free ring. The timestamp is taken by hardware, so
+     * the latency of the interrupt does not add jitter. Call isr() from the STIMER capture interrupt handler.
+     * The routed pad must have its input buffer enabled (PADREG INPEN).
+     */
+    template <typename CTIMER_T, typename GPIO_T, std::size_t DEPTH = 32>
+    class edge_capture {
+        static inline util::spsc_ring<capture_t, DEPTH> s_events;
+
+        using STMINTEN_t = typename CTIMER_T::STMINTEN_t;
+        using STMINTSTAT_t = typename CTIMER_T::STMINTSTAT_t;
+        using STMINTCLR_t = typename CTIMER_T::STMINTCLR_t;
+        using CAPTURECONTROL_t = typename CTIMER_T::CAPTURECONTROL_t;
+
+        static constexpr uint32_t capture_irq_mask = (STMINTSTAT_t::CAPTUREA.shift(true) | STMINTSTAT_t::CAPTUREB.shift(true)
+                                                      | STMINTSTAT_t::CAPTUREC.shift(true) | STMINTSTAT_t::CAPTURED.shift(true)).value;
+
+        /// CAPTUREA-D bit of CHANNEL in one of the STMINTEN/STMINTSTAT/STMINTCLR layouts
+        template <typename INT_t, unsigned CHANNEL>
+        static constexpr uint32_t capture_irq() noexcept {
+            if constexpr (CHANNEL == 0)      { return INT_t::CAPTUREA.mask; }
+            else if constexpr (CHANNEL == 1) { return INT_t::CAPTUREB.mask; }
+            else if constexpr (CHANNEL == 2) { return INT_t::CAPTUREC.mask; }
+            else                             { return INT_t::CAPTURED.mask; }
+        }
+
+        /// CAPTURECONTROL enable of CHANNEL
+        template <unsigned CHANNEL>
+        static constexpr uint32_t capture_enable() noexcept {
+            if constexpr (CHANNEL == 0)      { return CAPTURECONTROL_t::CAPTURE0.mask; }
+            else if constexpr (CHANNEL == 1) { return CAPTURECONTROL_t::CAPTURE1.mask; }
+            else if constexpr (CHANNEL == 2) { return CAPTURECONTROL_t::CAPTURE2.mask; }
+            else                             { return CAPTURECONTROL_t::CAPTURE3.mask; }
+        }
+
+        static uint32_t read_capture(const unsigned channel) noexcept {
+            switch (channel) {
+                case 0:  return CTIMER_T::SCAPT0.read();
+                case 1:  return CTIMER_T::SCAPT1.read();
+                case 2:  return CTIMER_T::SCAPT2.read();
+                default: return CTIMER_T::SCAPT3.read();
+            }
+        }
+
+    public:
+        static constexpr unsigned channel_count = 4;
+        static constexpr uint32_t no_pin = 0x3F;   // STSELn value that disconnects the channel (reset value)
+
+        /// route pad `pin` to capture channel CHANNEL and start timestamping `edge` transitions
+        template <unsigned CHANNEL>
+        static void attach(const unsigned pin, const Edge edge) noexcept {
+            static_assert(CHANNEL < channel_count, "STIMER only has capture channels 0-3");
+            if constexpr (CHANNEL == 0) {
+                GPIO_T::STMRCAP.STSEL0 = pin;
+                GPIO_T::STMRCAP.STPOL0 = (edge == Edge::falling);
+            } else if constexpr (CHANNEL == 1) {
+                GPIO_T::STMRCAP.STSEL1 = pin;
+                GPIO_T::STMRCAP.STPOL1 = (edge == Edge::falling);
+            } else if constexpr (CHANNEL == 2) {
+                GPIO_T::STMRCAP.STSEL2 = pin;
+                GPIO_T::STMRCAP.STPOL2 = (edge == Edge::falling);
+            } else {
+                GPIO_T::STMRCAP.STSEL3 = pin;
+                GPIO_T::STMRCAP.STPOL3 = (edge == Edge::falling);
+            }
+            CTIMER_T::STMINTCLR.write(capture_irq<STMINTCLR_t, CHANNEL>());
+            CTIMER_T::STMINTEN |= capture_irq<STMINTEN_t, CHANNEL>();
+            CTIMER_T::CAPTURECONTROL |= capture_enable<CHANNEL>();
+        }
+
+        /// stop timestamping on CHANNEL and disconnect its pad
+        template <unsigned CHANNEL>
+        static void detach() noexcept {
+            static_assert(CHANNEL < channel_count, "STIMER only has capture channels 0-3");
+            CTIMER_T::CAPTURECONTROL &= ~capture_enable<CHANNEL>();
+            CTIMER_T::STMINTEN &= ~capture_irq<STMINTEN_t, CHANNEL>();
+            if constexpr (CHANNEL == 0)      { GPIO_T::STMRCAP.STSEL0 = no_pin; }
+            else if constexpr (CHANNEL == 1) { GPIO_T::STMRCAP.STSEL1 = no_pin; }
+            else if constexpr (CHANNEL == 2) { GPIO_T::STMRCAP.STSEL2 = no_pin; }
+            else                             { GPIO_T::STMRCAP.STSEL3 = no_pin; }
+        }
+
+        /**
+         * drain every pending capture register into the event ring. Call from the STIMER interrupt.
+         * Captures that arrived together are pushed oldest first, whatever their channels, so a pulse_meter
+         * sees the lead edge before the trail edge. Timestamps compare modulo 2^32.
+         */
+        static void isr() noexcept {
+            const uint32_t status = CTIMER_T::STMINTSTAT.read() & capture_irq_mask;
+            CTIMER_T::STMINTCLR.write(status);
+            const bool fired[channel_count] = {STMINTSTAT_t::CAPTUREA.extract(status), STMINTSTAT_t::CAPTUREB.extract(status),
+                                               STMINTSTAT_t::CAPTUREC.extract(status), STMINTSTAT_t::CAPTURED.extract(status)};
+
+            capture_t pending[channel_count];
+            std::size_t count = 0;
+            for (unsigned ch = 0; ch < channel_count; ++ch) {
+                if (!fired[ch]) { continue; }
+                const capture_t event{read_capture(ch), static_cast<uint8_t>(ch)};
+                std::size_t i = count++;
+                for (; i != 0 && static_cast<int32_t>(event.timestamp - pending[i - 1].timestamp) < 0; --i) { pending[i] = pending[i - 1]; }
+                pending[i] = event;
+            }
+            for (std::size_t i = 0; i < count; ++i) { s_events.push(pending[i]); }
+        }
+
+        /// take the oldest timestamp out of the ring. Returns false if there is none.
+        static bool pop(capture_t& event) noexcept { return s_events.pop(event); }
+
+        /// number of timestamps waiting to be read
+        [[nodiscard]] static std::size_t pending() noexcept { return s_events.size(); }
+
+        /// number of timestamps lost because the ring was full when the interrupt fired
+        [[nodiscard]] static uint32_t overruns() noexcept { return s_events.dropped(); }
+    };  // class edge_capture
+
+    /**
+     * Turns a stream of capture_t into pulse width and period. Route the same pad to two channels, one per
+     * edge, and feed() every popped event: `lead` is the edge that starts a pulse, `trail` the edge that ends it.
+     * For frequency-only inputs set lead == trail and only period_ticks() is meaningful.
+     * All arithmetic is modulo 2^32 so it is correct across a STIMER wrap.
+     */
+    class pulse_meter {
+        uint8_t  m_lead;
+        uint8_t  m_trail;
+        bool     m_have_lead   = false;
+        bool     m_have_period = false;
+        bool     m_have_width  = false;
+        uint32_t m_last_lead   = 0;
+        uint32_t m_period      = 0;
+        uint32_t m_width       = 0;
+
+    public:
+        constexpr pulse_meter(const uint8_t lead, const uint8_t trail) noexcept : m_lead(lead), m_trail(trail) { }
+
+        /// process one capture. Events from other channels are ignored.
+        constexpr void feed(const capture_t& event) noexcept {
+            if (event.channel == m_lead) {
+                if (m_have_lead) {
+                    m_period = event.timestamp - m_last_lead;
+                    m_have_period = true;
+                }
+                m_last_lead = event.timestamp;
+                m_have_lead = true;
+            }
+            else if (event.channel == m_trail && m_have_lead) {
+                m_width = event.timestamp - m_last_lead;
+                m_have_width = true;
+            }
+        }
+
+        [[nodiscard]] constexpr bool has_period() const noexcept { return m_have_period; }
+        [[nodiscard]] constexpr bool has_width() const noexcept { return m_have_width; }
+
+        /// STIMER ticks between the last two leading edges
+        [[nodiscard]] constexpr uint32_t period_ticks() const noexcept { return m_period; }
+
+        /// STIMER ticks from the last leading edge to the following trailing edge
+        [[nodiscard]] constexpr uint32_t width_ticks() const noexcept { return m_width; }
+
+        /// input frequency in millihertz for a STIMER running at tick_hz, 0 if no period has been seen yet
+        [[nodiscard]] constexpr uint32_t frequency_mhz(const uint32_t tick_hz) const noexcept {
+            if (!m_have_period || m_period == 0) { return 0; }
+            return static_cast<uint32_t>((static_cast<uint64_t>(tick_hz) * 1000u) / m_period);
+        }
+
+        /// high/low ratio of the last pulse in 1/65536 units, 0 if no complete pulse has been seen
+        [[nodiscard]] constexpr uint32_t duty_q16() const noexcept {
+            if (!m_have_period || !m_have_width || m_period == 0) { return 0; }
+            return static_cast<uint32_t>((static_cast<uint64_t>(m_width) << 16) / m_period);
+        }
+
+        constexpr void reset() noexcept {
+            m_have_lead = m_have_period = m_have_width = false;
+        }
+    };  // class pulse_meter
+
+    /// convert a tick count at tick_hz to microseconds without floating point
+    constexpr uint32_t ticks_to_us(const uint32_t ticks, const uint32_t tick_hz) noexcept {
+        return tick_hz == 0 ? 0 : static_cast<uint32_t>((static_cast<uint64_t>(ticks) * 1000000u) / tick_hz);
+    }
+
+    static_assert(ticks_to_us(3, 3000000) == 1, "3 MHz STIMER ticks are 1/3 us");
+    static_assert(ticks_to_us(32768, 32768) == 1000000, "one second of 32 kHz STIMER ticks");
+
+}   // namespace STIMER
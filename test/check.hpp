@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdio>
+
+/**
+ * Minimal checks for the host tests. A failed CHECK() or CHECK_EQ() prints its location and the test keeps
+ * going; main() returns test::result() so CTest sees the outcome.
+ */
+namespace test {
+
+    inline int failures = 0;
+
+    inline bool check(const bool ok, const char* expression, const char* file, const int line) {
+        if (!ok) {
+            ++failures;
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+        }
+        return ok;
+    }
+
+    template <typename A, typename B>
+    bool check_eq(const A& a, const B& b, const char* expression, const char* file, const int line) {
+        const bool ok = a == b;
+        if (!ok) {
+            ++failures;
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s) failed: %lld != %lld\n", file, line, expression,
+                         static_cast<long long>(a), static_cast<long long>(b));
+        }
+        return ok;
+    }
+
+    inline int result() {
+        if (failures != 0) { std::fprintf(stderr, "%d check(s) failed\n", failures); }
+        return failures == 0 ? 0 : 1;
+    }
+
+}   // namespace test
+
+#define CHECK(...) test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) test::check_eq((a), (b), #a " == " #b, __FILE__, __LINE__)
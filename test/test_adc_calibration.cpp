@@ -0,0 +1,102 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <bit>
+#include <cstdlib>
+
+namespace {
+
+    using MCUCTRL_T = decltype(device::MCUCTRL);
+    using calibration = ADC::calibration<MCUCTRL_T>;
+
+    constexpr uint32_t trim_address = ADC::temperature_trim::address;
+
+    /// Q15 sample of `microvolts` at the 2.0 V reference
+    constexpr ADC::sample at(const int64_t microvolts) { return static_cast<ADC::sample>(microvolts * 32768 / 2000000); }
+
+    void store_trim(const float kelvin, const float volts, const float offset_volts) {
+        sfr::store<uint32_t>(trim_address, std::bit_cast<uint32_t>(kelvin));
+        sfr::store<uint32_t>(trim_address + 4, std::bit_cast<uint32_t>(volts));
+        sfr::store<uint32_t>(trim_address + 8, std::bit_cast<uint32_t>(offset_volts));
+    }
+
+    /// the nominal trim and the fixed point conversions built from it
+    void test_nominal() {
+        constexpr ADC::temperature_trim trim{};
+        CHECK_EQ(trim.centikelvin, 29950);
+        CHECK_EQ(trim.microvolts, 1028090);
+        CHECK_EQ(trim.offset_microvolts, -4281);
+        CHECK(trim.valid());
+        CHECK(!(ADC::temperature_trim{0, 1028090, 0}.valid()));
+
+        CHECK_EQ(ADC::nominal_millivolts[0](0x4000), 1000);
+        CHECK_EQ(ADC::nominal_millivolts[1](0x4000), 750);
+        CHECK_EQ(ADC::nominal_battery[0](0x4000), 3000);
+        CHECK_EQ(ADC::millivolt_scale(ADC::Reference::INT2P0, -4281)(0x4000), 1004);
+        CHECK(std::abs(ADC::nominal_temperature[0](at(trim.microvolts)) - (trim.centikelvin - 27315)) <= 2);
+    }
+
+    /// init() converts the INFO1 floats once; erased words fall back to the nominal trim
+    void test_trim() {
+        store_trim(300.0f, 1.03f, -0.002f);
+        calibration::init(ADC::Reference::INT2P0);
+        CHECK(calibration::trimmed());
+        CHECK_EQ(calibration::temperature().centikelvin, 30000);
+        CHECK(std::abs(calibration::temperature().microvolts - 1030000) <= 1);
+        CHECK_EQ(calibration::temperature().offset_microvolts, -2000);
+        CHECK(std::abs(calibration::centicelsius(at(1030000)) - (30000 - 27315)) <= 2);
+        CHECK_EQ(calibration::millivolts(0x4000), 1002);
+        CHECK(calibration::reference() == ADC::Reference::INT2P0);
+
+        sfr::store<uint32_t>(trim_address, 0xFFFFFFFFu);
+        sfr::store<uint32_t>(trim_address + 4, 0xFFFFFFFFu);
+        sfr::store<uint32_t>(trim_address + 8, 0xFFFFFFFFu);
+        calibration::init(ADC::Reference::INT1P5);
+        CHECK(!calibration::trimmed());
+        CHECK_EQ(calibration::temperature().centikelvin, 29950);
+        CHECK_EQ(calibration::centicelsius(at(1028090) * 4 / 3), ADC::temperature_scale(ADC::Reference::INT1P5)(at(1028090) * 4 / 3));
+    }
+
+    /// the reference trims are decoded from the generated ADCTRIM and ADCREFCOMP fields
+    void test_reference_trim() {
+        MCUCTRL_T::ADCTRIM.write(0x13u << 6 | 2u << 11 | 1u);
+        MCUCTRL_T::ADCREFCOMP.write(0x0Au << 8 | 1u);
+        calibration::init(ADC::Reference::INT2P0);
+        CHECK_EQ(calibration::trims().buffer, 0x13);
+        CHECK_EQ(calibration::trims().buffer_bias, 2);
+        CHECK_EQ(calibration::trims().keeper_bias, 1);
+        CHECK_EQ(calibration::trims().keeper, 0x0A);
+        CHECK(!calibration::trims().compensation);
+        CHECK(!calibration::reference_comparator());                // compensation off
+
+        MCUCTRL_T::ADCREFCOMP.write(1u << 16 | 1u);
+        calibration::init(ADC::Reference::INT2P0);
+        CHECK(calibration::trims().compensation);
+        CHECK(calibration::reference_comparator());
+    }
+
+    /// ADCCAL and ADCBATTLOAD bits
+    void test_controls() {
+        MCUCTRL_T::ADCCAL.write(0);
+        calibration::calibrate_on_powerup(true);
+        CHECK_EQ(MCUCTRL_T::ADCCAL.read(), 1u);
+        CHECK(!calibration::calibrated());
+        MCUCTRL_T::ADCCAL.write(3u);
+        CHECK(calibration::calibrated());
+        calibration::calibrate_on_powerup(false);
+        CHECK_EQ(MCUCTRL_T::ADCCAL.read(), 2u);
+
+        calibration::battery_load(true);
+        CHECK_EQ(MCUCTRL_T::ADCBATTLOAD.read(), 1u);
+        calibration::battery_load(false);
+        CHECK_EQ(MCUCTRL_T::ADCBATTLOAD.read(), 0u);
+    }
+
+}   // namespace
+
+int main() {
+    test_nominal();
+    test_trim();
+    test_reference_trim();
+    test_controls();
+    return test::result();
+}
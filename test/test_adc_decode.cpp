@@ -0,0 +1,120 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <array>
+#include <vector>
+
+namespace {
+
+    constexpr std::array<ADC::slot_config, 3> slots{{
+        {ADC::Channel::SE0, ADC::Precision::P14B},
+        {ADC::Channel::SE1, ADC::Precision::P12B},
+        {ADC::Channel::SE2, ADC::Precision::P8B},
+    }};
+
+    /// FIFO word of `slot` with N.6 data `data`
+    constexpr uint32_t word(const unsigned slot, const uint32_t data) { return slot << 28 | data; }
+
+    /// `rows` whole scans of the three slots, data differing per slot and row
+    std::vector<uint32_t> block(const std::size_t rows) {
+        std::vector<uint32_t> words;
+        for (std::size_t row = 0; row < rows; ++row) {
+            words.push_back(word(0, static_cast<uint32_t>(0x3000 + 37 * row) << 6 | 0x15));
+            words.push_back(word(1, static_cast<uint32_t>(0x0400 + 11 * row) << 6));
+            words.push_back(word(2, static_cast<uint32_t>(0x00F0 - row) << 6 | 0x3F));
+        }
+        return words;
+    }
+
+    struct outputs {
+        std::array<std::vector<ADC::sample>, ADC::slots> storage;
+        std::array<std::span<ADC::sample>, ADC::slots> spans{};
+
+        /// `size` samples per slot starting `skew` samples into the storage, to move the output off word alignment
+        outputs(const std::size_t size, const std::size_t skew) {
+            for (std::size_t s = 0; s < ADC::slots; ++s) {
+                storage[s].assign(size + skew, 0);
+                spans[s] = std::span<ADC::sample>(storage[s]).subspan(skew, size);
+            }
+        }
+    };
+
+    /// every precision maps full scale and half scale to the same Q15 value
+    void test_scaling() {
+        CHECK_EQ(ADC::to_q15(word(0, 0x2000u << 6), ADC::Precision::P14B), 0x4000);
+        CHECK_EQ(ADC::to_q15(word(0, 0x800u << 6), ADC::Precision::P12B), 0x4000);
+        CHECK_EQ(ADC::to_q15(word(0, 0x200u << 6), ADC::Precision::P10B), 0x4000);
+        CHECK_EQ(ADC::to_q15(word(0, 0x80u << 6), ADC::Precision::P8B), 0x4000);
+        CHECK_EQ(ADC::to_q15(word(5, 0x3FFFu << 6 | 0x3F), ADC::Precision::P14B), 0x7FFF);
+        CHECK_EQ(ADC::to_q15(word(0, 0xFFu << 6), ADC::Precision::P8B), 0x7F80);
+        CHECK_EQ(ADC::to_q15(word(0, 0x20), ADC::Precision::P14B), 1);     // half an LSB of the fraction
+
+        const ADC::decoder decode(slots);
+        CHECK_EQ(decode.slot_count(), 3u);
+        CHECK_EQ(decode(word(1, 0x800u << 6)), 0x4000);
+        CHECK_EQ(decode(word(2, 0x80u << 6)), 0x4000);
+    }
+
+    /// the strided fast path gives the same samples as decode_any(), aligned or not, with an odd row count
+    void test_fast_path() {
+        ADC::decoder decode(slots);
+        decode.set_correction(1, ADC::correction{0x3000, -50});
+        const std::vector<uint32_t> words = block(7);
+        for (const std::size_t skew : {std::size_t{0}, std::size_t{1}}) {
+            outputs fast(7, skew);
+            outputs slow(7, skew);
+            const auto counts = decode.decode(words, fast.spans);
+            const auto reference = decode.decode_any(words, slow.spans);
+            CHECK(counts == reference);
+            CHECK_EQ(counts[0], 7u);
+            CHECK_EQ(counts[3], 0u);
+            for (std::size_t s = 0; s < slots.size(); ++s) { CHECK(fast.storage[s] == slow.storage[s]); }
+            CHECK_EQ(fast.spans[0][6], ADC::to_q15(words[18], ADC::Precision::P14B));
+            CHECK_EQ(fast.spans[2][0], ADC::to_q15(words[2], ADC::Precision::P8B));
+        }
+    }
+
+    /// a block that is not in scan order, or outputs that are too short, go word by word
+    void test_fallback() {
+        const ADC::decoder decode(slots);
+        std::vector<uint32_t> words = block(4);
+        std::swap(words[4], words[5]);                              // slots 2, 1 in the second scan
+        outputs out(4, 0);
+        auto counts = decode.decode(words, out.spans);
+        CHECK_EQ(counts[0], 4u);
+        CHECK_EQ(counts[1], 4u);
+        CHECK_EQ(counts[2], 4u);
+        CHECK_EQ(out.spans[1][1], ADC::to_q15(words[5], ADC::Precision::P12B));
+        CHECK_EQ(out.spans[2][1], ADC::to_q15(words[4], ADC::Precision::P8B));
+
+        outputs short_out(2, 0);
+        counts = decode.decode(block(4), short_out.spans);
+        CHECK_EQ(counts[0], 2u);
+        CHECK_EQ(counts[2], 2u);
+    }
+
+    /// gain in Q14 and offset in Q15 steps, saturated to the sample range
+    void test_correction() {
+        ADC::decoder decode(slots);
+        decode.set_correction(0, ADC::correction{0x2000, 100});
+        CHECK_EQ(decode(word(0, 0x2000u << 6)), 0x2000 + 100);
+        decode.set_correction(0, ADC::correction{0x7FFF, 0});
+        CHECK_EQ(decode(word(0, 0x3000u << 6)), 32767);
+        decode.set_correction(0, ADC::correction{0x4000, -200});
+        CHECK_EQ(decode(word(0, 0)), -200);
+        decode.set_correction(0, ADC::correction{-0x4000, -0x7000});
+        CHECK_EQ(decode(word(0, 0x3000u << 6)), -32768);
+        decode.set_correction(0, ADC::correction{});
+        CHECK_EQ(decode(word(0, 0x3000u << 6)), 0x6000);
+        decode.set_correction(ADC::slots, ADC::correction{0, 0});  // ignored
+        CHECK_EQ(decode(word(1, 0x800u << 6)), 0x4000);
+    }
+
+}   // namespace
+
+int main() {
+    test_scaling();
+    test_fast_path();
+    test_fallback();
+    test_correction();
+    return test::result();
+}
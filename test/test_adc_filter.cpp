@@ -0,0 +1,155 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace {
+
+    using samples = std::vector<ADC::sample>;
+
+    /// run `filter` over `in` in blocks of `block` samples, collecting the outputs
+    template <typename FILTER>
+    samples run(FILTER& filter, const samples& in, const std::size_t block) {
+        samples out;
+        std::array<ADC::sample, 64> buffer{};
+        for (std::size_t at = 0; at < in.size(); at += block) {
+            const std::size_t count = std::min(block, in.size() - at);
+            const std::size_t produced = filter.process(std::span<const ADC::sample>(in.data() + at, count), buffer);
+            out.insert(out.end(), buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(produced));
+        }
+        return out;
+    }
+
+    /// a constant input comes out unchanged once the stages have settled, for any rate and order
+    void test_cic_gain() {
+        ADC::cic<3, 3> cic;
+        CHECK_EQ(cic.decimation, 8u);
+        const samples out = run(cic, samples(80, 1000), 7);
+        CHECK_EQ(out.size(), 10u);
+        CHECK(out[0] < 1000);                                       // still filling
+        for (std::size_t i = 3; i < out.size(); ++i) { CHECK_EQ(out[i], 1000); }
+
+        ADC::cic<1, 2> average;                                     // mean of four, rounded
+        samples ramp(16);
+        for (std::size_t i = 0; i < ramp.size(); ++i) { ramp[i] = static_cast<ADC::sample>(i); }
+        CHECK(run(average, ramp, 3) == (samples{2, 6, 10, 14}));
+    }
+
+    /// full scale stays full scale: the wrapping integrators are exact at the largest gain that fits
+    void test_cic_full_scale() {
+        ADC::cic<4, 4> cic;
+        samples out = run(cic, samples(4096, 32767), 64);
+        CHECK_EQ(out.size(), 256u);
+        CHECK_EQ(out.back(), 32767);
+        cic.reset();
+        out = run(cic, samples(4096, -32768), 64);
+        CHECK_EQ(out.back(), -32768);
+
+        samples square(4096);
+        for (std::size_t i = 0; i < square.size(); ++i) { square[i] = (i / 512) % 2 ? ADC::sample{-32768} : ADC::sample{32767}; }
+        cic.reset();
+        out = run(cic, square, 64);
+        CHECK_EQ(out[31], 32767);
+        CHECK_EQ(out[63], -32768);
+    }
+
+    /// the impulse response is the coefficients, an odd count included; outputs saturate
+    void test_fir_impulse() {
+        constexpr std::array<int16_t, 3> taps{1000, -2000, 3000};
+        ADC::fir<3> fir(taps);
+        samples impulse(6, 0);
+        impulse[0] = 32767;
+        CHECK(run(fir, impulse, 4) == (samples{1000, -2000, 3000, 0, 0, 0}));
+
+        constexpr std::array<int16_t, 2> double_gain{32767, 32767};
+        ADC::fir<2> loud(double_gain);
+        const samples out = run(loud, samples(4, 20000), 4);
+        CHECK_EQ(out[0], 20000 - 1);
+        CHECK_EQ(out[3], 32767);
+        CHECK(run(loud, samples(2, -20000), 2).back() == -32768);
+
+        ADC::fir<4> plain;                                          // no coefficients: pass through
+        CHECK(run(plain, samples{5, -6, 7}, 3) == (samples{5, -6, 7}));
+    }
+
+    /// every DECIMATION-th output is kept, counting across process() calls
+    void test_fir_phase() {
+        constexpr std::array<int16_t, 2> delay{0, 32767};          // previous sample
+        ADC::fir<2, 3> fir(delay);
+        samples ramp(13);
+        for (std::size_t i = 0; i < ramp.size(); ++i) { ramp[i] = static_cast<ADC::sample>(100 * i); }
+        const samples out = run(fir, ramp, 5);
+        CHECK_EQ(out.size(), 4u);
+        CHECK_EQ(out[0], 100);                                      // after input 2, the sample before it
+        CHECK_EQ(out[3], 1000);                                     // after input 11
+
+        ADC::fir<2, 3> bypass;
+        CHECK(run(bypass, ramp, 4) == (samples{200, 500, 800, 1100}));
+        bypass.reset();
+        CHECK(run(bypass, samples{1, 2}, 2).empty());
+    }
+
+    /// a cascade may filter in place and gives the same as its stages run one after the other
+    void test_cascade() {
+        using chain = ADC::cascade<ADC::cic<2, 2>, ADC::fir<3, 2>>;
+        constexpr std::array<int16_t, 3> taps{8192, 16384, 8192};
+        CHECK_EQ(chain::decimation, 8u);
+
+        samples in(64);
+        for (std::size_t i = 0; i < in.size(); ++i) { in[i] = static_cast<ADC::sample>(static_cast<int>((i * 7919) % 20000) - 10000); }
+
+        chain separate;
+        separate.second.set_taps(taps);
+        samples out(in.size());
+        const std::size_t count = separate.process(in, out);
+        CHECK_EQ(count, 8u);
+        out.resize(count);
+
+        chain inplace;
+        inplace.second.set_taps(taps);
+        samples buffer = in;
+        CHECK_EQ(inplace.process(buffer, buffer), count);
+        buffer.resize(count);
+        CHECK(buffer == out);
+
+        ADC::cic<2, 2> first;
+        ADC::fir<3, 2> second(taps);
+        samples middle(in.size());
+        middle.resize(first.process(in, middle));
+        samples last(middle.size());
+        last.resize(second.process(middle, last));
+        CHECK(last == out);
+    }
+
+    /// filter_stage decodes each slot, filters it on its own and reports the decimated samples per slot
+    void test_stage() {
+        constexpr std::array<ADC::slot_config, 2> slot_list{{{ADC::Channel::SE0, ADC::Precision::P14B}, {ADC::Channel::SE1, ADC::Precision::P8B}}};
+        struct seen_t { std::array<samples, 2> slot; } seen;
+        auto output = [](void* context, const std::size_t slot, const std::span<const ADC::sample> values) {
+            auto& s = static_cast<seen_t*>(context)->slot[slot];
+            s.insert(s.end(), values.begin(), values.end());
+        };
+        ADC::filter_stage<16, ADC::cic<1, 2>> stage(slot_list, output, &seen);
+
+        std::array<uint32_t, 16> words{};
+        for (std::size_t row = 0; row < 8; ++row) {
+            words[2 * row] = 0x2000u << 6;                          // half scale
+            words[2 * row + 1] = 1u << 28 | static_cast<uint32_t>(0x40 + row % 2 * 0x40) << 6;
+        }
+        ADC::filter_stage<16, ADC::cic<1, 2>>::block(&stage, words);
+        CHECK(seen.slot[0] == (samples{0x4000, 0x4000}));
+        CHECK(seen.slot[1] == (samples{0x3000, 0x3000}));           // mean of quarter and half scale
+    }
+
+}   // namespace
+
+int main() {
+    test_cic_gain();
+    test_cic_full_scale();
+    test_fir_impulse();
+    test_fir_phase();
+    test_cascade();
+    test_stage();
+    return test::result();
+}
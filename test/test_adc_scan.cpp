@@ -0,0 +1,145 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <array>
+#include <vector>
+
+namespace {
+
+    using ADC_T = decltype(device::ADC);
+    using CTIMER_T = decltype(device::CTIMER);
+    using engine = ADC::scan_engine<ADC_T, CTIMER_T, 12>;
+
+    constexpr std::array<ADC::slot_config, 3> slots{{
+        {ADC::Channel::SE0, ADC::Precision::P14B},
+        {ADC::Channel::SE1, ADC::Precision::P12B},
+        {ADC::Channel::TEMP, ADC::Precision::P10B},
+    }};
+
+    /// 14 bit code the model converts, distinct per slot and scan
+    uint16_t code(const unsigned slot, const uint32_t scan) { return static_cast<uint16_t>(0x1000 * slot + 4 * scan); }
+
+    struct collector {
+        std::vector<std::vector<uint32_t>> blocks;
+        std::vector<const uint32_t*> buffers;
+    };
+
+    void collect(void* context, const std::span<const uint32_t> words) {
+        auto* seen = static_cast<collector*>(context);
+        seen->blocks.emplace_back(words.begin(), words.end());
+        seen->buffers.push_back(words.data());
+    }
+
+    /// no NVIC on the host: take the ADC interrupt when one is pending
+    void service() {
+        if (ADC_T::INTSTAT.read() & ADC_T::INTEN.read()) { engine::isr(); }
+    }
+
+    /// every block starts with slot 0 and holds the codes of four consecutive scans
+    void check_block(const std::vector<uint32_t>& block, const uint32_t first_scan) {
+        CHECK_EQ(block.size(), 12u);
+        for (std::size_t i = 0; i < block.size(); ++i) {
+            const unsigned slot = static_cast<unsigned>(i % slots.size());
+            const uint32_t scan = first_scan + static_cast<uint32_t>(i / slots.size());
+            const unsigned shift = 2 * static_cast<unsigned>(slots[slot].precision);
+            CHECK_EQ(ADC::fifo::slot(block[i]), slot);
+            CHECK_EQ(ADC::fifo::data(block[i]), static_cast<uint32_t>(code(slot, scan) >> shift) << 6);
+        }
+    }
+
+    /// CFG and SLnCFG images come from the generated fields
+    void test_images() {
+        constexpr ADC::slot_config slot{ADC::Channel::SE3, ADC::Precision::P12B, ADC::Average::AVG_4_MSRMTS, true};
+        CHECK_EQ(slot.value(), 2u << 24 | 1u << 16 | 3u << 8 | 1u << 1 | 1u);
+        constexpr ADC::config cfg{ADC::Clock::HFRC, ADC::Reference::INT1P5, ADC::Trigger::SWT, false, true, true};
+        CHECK_EQ(cfg.value(), 1u << 24 | 7u << 16 | 1u << 8 | 1u << 3 | 1u << 2);
+        CHECK_EQ(ADC::software_trigger, 0x37u);
+        CHECK_EQ(ADC::irq::all, 0xFFu);
+
+        ADC::controller<ADC_T>::configure(ADC::config{}, slots);
+        CHECK_EQ(ADC_T::SL2CFG.read(), slots[2].value());
+        CHECK_EQ(ADC_T::SL3CFG.read(), 0u);
+        CHECK(!ADC::controller<ADC_T>::configure(ADC::config{}, std::array<ADC::slot_config, 9>{}));
+    }
+
+    /// software triggered scans fill the two buffers in turn, each handed over once
+    void test_blocks(sim::adc_model& model) {
+        collector seen;
+        CHECK(engine::start(ADC::config{}, slots, ADC::pacing{}, collect, &seen) == ADC::Status::ok);
+        CHECK(engine::start(ADC::config{}, slots, ADC::pacing{}, collect, &seen) == ADC::Status::busy);
+        const uint32_t first = model.scans();
+        for (int i = 0; i < 12; ++i) {
+            engine::trigger();
+            service();
+        }
+        CHECK_EQ(engine::blocks(), 3u);
+        CHECK_EQ(seen.blocks.size(), 3u);
+        for (std::size_t b = 0; b < seen.blocks.size(); ++b) { check_block(seen.blocks[b], first + 4 * static_cast<uint32_t>(b)); }
+        CHECK(seen.buffers[0] != seen.buffers[1]);
+        CHECK(seen.buffers[0] == seen.buffers[2]);
+        CHECK(engine::status() == ADC::Status::ok);
+        engine::stop();
+        CHECK(!engine::running());
+        CHECK(!ADC::controller<ADC_T>::enabled());
+    }
+
+    /// with a pacing period CTIMER A3 starts the scans after the first software trigger
+    void test_paced(sim::adc_model& model) {
+        collector seen;
+        CHECK(engine::start(ADC::config{}, slots, ADC::pacing{sfr::CTIMER::TMRA0CLKv::HFRC_DIV16, 100}, collect, &seen) == ADC::Status::ok);
+        CHECK(CTIMER_T::CTRL3.read() & CTIMER_T::CTRL3_t::ADCEN.mask);
+        CHECK(ADC_T::CFG.read() & ADC_T::CFG_t::RPTEN.mask);
+        const uint32_t first = model.scans() - 1;
+        for (int i = 0; i < 7; ++i) {
+            model.timer_trigger();
+            service();
+        }
+        CHECK_EQ(seen.blocks.size(), 2u);
+        check_block(seen.blocks[1], first + 4);
+        engine::stop();
+        CHECK_EQ(CTIMER_T::CTRL3.read() & CTIMER_T::CTRL3_t::ADCEN.mask, 0u);
+        model.timer_trigger();
+        CHECK_EQ(model.scans(), first + 8);
+    }
+
+    /// a handler that falls behind lets the FIFO overflow: counted, reported, and the engine keeps going
+    void test_overflow(sim::adc_model& model) {
+        collector seen;
+        CHECK(engine::start(ADC::config{}, slots, ADC::pacing{}, collect, &seen) == ADC::Status::ok);
+        for (int i = 0; i < 10; ++i) { engine::trigger(); }         // interrupt not taken
+        CHECK(model.dropped() > 0u);
+        service();
+        CHECK_EQ(engine::overflows(), 1u);
+        CHECK(engine::status() == ADC::Status::overflow);
+        CHECK_EQ(seen.blocks.size(), 1u);
+        CHECK(engine::running());
+        engine::stop();
+        CHECK_EQ(model.fifo_level(), 0u);
+    }
+
+    /// a DMA error stops the engine
+    void test_dma_error() {
+        collector seen;
+        CHECK(engine::start(ADC::config{}, slots, ADC::pacing{}, collect, &seen) == ADC::Status::ok);
+        ADC_T::DMATARGADDR.write(0x1FF00000);                       // not a mapped buffer
+        for (int i = 0; i < 4 && engine::running(); ++i) {
+            engine::trigger();
+            service();
+        }
+        CHECK(!engine::running());
+        CHECK(engine::status() == ADC::Status::dma_error);
+        CHECK(seen.blocks.empty());
+        CHECK(ADC_T::DMASTAT.read() & ADC_T::DMASTAT_t::DMAERR.mask);
+    }
+
+}   // namespace
+
+int main() {
+    sim::adc_model model;
+    model.input(code);
+    test_images();
+    test_blocks(model);
+    test_paced(model);
+    test_overflow(model);
+    test_dma_error();
+    return test::result();
+}
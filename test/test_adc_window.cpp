@@ -0,0 +1,128 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <array>
+#include <vector>
+
+namespace {
+
+    using ADC_T = decltype(device::ADC);
+    using CTIMER_T = decltype(device::CTIMER);
+    using monitor = ADC::window_monitor<ADC_T, CTIMER_T, 8>;
+
+    constexpr ADC::pacing pace{sfr::CTIMER::TMRA0CLKv::HFRC_DIV16, 1000};
+    constexpr ADC::window limits = ADC::window::from_q15(0x2000, 0x5000);     // 14 bit codes 0x1000 to 0x2800
+
+    /// 14 bit code of each slot for the next scans
+    std::array<uint16_t, ADC::slots> level{};
+
+    uint16_t input(const unsigned slot, uint32_t) { return level[slot]; }
+
+    std::vector<uint32_t> events;
+
+    void record(void*, const uint32_t pending) { events.push_back(pending); }
+
+    /// one CTIMER paced scan, with the ADC interrupt taken on the host
+    void scan(sim::adc_model& model) {
+        model.timer_trigger();
+        if (ADC_T::INTSTAT.read() & ADC_T::INTEN.read()) { monitor::isr(); }
+    }
+
+    /// limits map to WLLIM, WULIM and SCWLIM
+    void test_limits() {
+        CHECK_EQ(limits.lower, 0x2000u << 5);
+        CHECK_EQ(limits.upper, 0x5000u << 5);
+        CHECK(limits.valid());
+        CHECK(ADC::window{}.valid());
+        CHECK(!(ADC::window{10, 9}.valid()));
+        CHECK(!(ADC::window{0, 0x100000}.valid()));
+
+        monitor::set_window(ADC::window{0x123, 0x45678, false});
+        CHECK_EQ(ADC_T::WLLIM.read(), 0x123u);
+        CHECK_EQ(ADC_T::WULIM.read(), 0x45678u);
+        CHECK_EQ(ADC_T::SCWLIM.read(), 0u);
+        monitor::set_window(limits);
+        CHECK_EQ(ADC_T::SCWLIM.read(), 1u);
+    }
+
+    /// start() needs a window slot, a pacing period, a handler and events
+    void test_invalid() {
+        const std::array<ADC::slot_config, 1> plain{{{ADC::Channel::SE0, ADC::Precision::P14B}}};
+        const std::array<ADC::slot_config, 1> watched{{{ADC::Channel::SE0, ADC::Precision::P14B, ADC::Average::AVG_1_MSRMT, true}}};
+        CHECK(monitor::start(ADC::config{}, plain, limits, pace, record) == ADC::Status::invalid);
+        CHECK(monitor::start(ADC::config{}, watched, limits, ADC::pacing{}, record) == ADC::Status::invalid);
+        CHECK(monitor::start(ADC::config{}, watched, ADC::window{2, 1}, pace, record) == ADC::Status::invalid);
+        CHECK(monitor::start(ADC::config{}, watched, limits, pace, nullptr) == ADC::Status::invalid);
+        CHECK(monitor::start(ADC::config{}, watched, limits, pace, record, nullptr, ADC::irq::dcmp) == ADC::Status::invalid);
+        CHECK(!monitor::running());
+    }
+
+    /// the handler runs once per excursion and incursion of the window slot; other slots are not compared
+    void test_events(sim::adc_model& model) {
+        const std::array<ADC::slot_config, 2> slot_list{{
+            {ADC::Channel::SE0, ADC::Precision::P14B, ADC::Average::AVG_1_MSRMT, true},
+            {ADC::Channel::SE1, ADC::Precision::P14B},
+        }};
+        events.clear();
+        level = {0x2000, 0x3FFF};
+        CHECK(monitor::start(ADC::config{}, slot_list, limits, pace, record, nullptr, ADC::irq::wcexc | ADC::irq::wcinc) == ADC::Status::ok);
+        CHECK(ADC_T::CFG.read() & ADC_T::CFG_t::LPMODE.mask);
+        for (int i = 0; i < 3; ++i) { scan(model); }
+        CHECK(events.empty());
+        CHECK(monitor::last_block().empty());
+
+        level[0] = 0x2900;
+        for (int i = 0; i < 3; ++i) { scan(model); }
+        CHECK_EQ(events.size(), 1u);
+        CHECK_EQ(events[0], ADC::irq::wcexc);
+        CHECK(monitor::outside());
+
+        level[0] = 0x1000;                                          // inclusive lower limit
+        scan(model);
+        CHECK_EQ(events.size(), 2u);
+        CHECK_EQ(events[1], ADC::irq::wcinc);
+        CHECK(!monitor::outside());
+        CHECK_EQ(monitor::wakes(), 2u);
+
+        const std::span<const uint32_t> last = monitor::last_block();     // the first four scans, one by start()
+        CHECK_EQ(last.size(), 8u);
+        CHECK_EQ(ADC::fifo::slot(last[7]), 1u);
+        CHECK_EQ(ADC::fifo::data(last[6]), 0x2000u << 6);
+        CHECK_EQ(ADC::fifo::data(last[7]), 0x3FFFu << 6);
+        CHECK(monitor::status() == ADC::Status::ok);
+        monitor::stop();
+        CHECK(!monitor::running());
+    }
+
+    /// scaled limits follow the slot precision; unscaled ones are compared with the FIFO data as is
+    void test_scaled(sim::adc_model& model) {
+        const std::array<ADC::slot_config, 1> slot_list{{{ADC::Channel::SE0, ADC::Precision::P8B, ADC::Average::AVG_1_MSRMT, true}}};
+        events.clear();
+        level = {0x2000};
+        CHECK(monitor::start(ADC::config{}, slot_list, limits, pace, record) == ADC::Status::ok);
+        for (int i = 0; i < 4; ++i) { scan(model); }
+        CHECK(events.empty());
+        level[0] = 0x3000;
+        scan(model);
+        CHECK_EQ(events.size(), 1u);
+        monitor::stop();
+
+        events.clear();
+        level[0] = 0x2000;
+        CHECK(monitor::start(ADC::config{}, slot_list, ADC::window{limits.lower, limits.upper, false}, pace, record) == ADC::Status::ok);
+        scan(model);
+        CHECK_EQ(events.size(), 1u);                                // 8 bit data lies below the 14 bit limits
+        CHECK(monitor::outside());
+        monitor::stop();
+    }
+
+}   // namespace
+
+int main() {
+    sim::adc_model model;
+    model.input(input);
+    test_limits();
+    test_invalid();
+    test_events(model);
+    test_scaled(model);
+    return test::result();
+}
@@ -0,0 +1,114 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <coroutine>
+#include <vector>
+
+namespace {
+
+    using IOM_T = decltype(device::IOM0);
+    using engine = IOM::async_engine<IOM_T>;
+    using bus = IOM::shared_bus<IOM_T>;
+
+    /// fire-and-forget coroutine, runs until its first co_await and is resumed from isr()
+    struct task {
+        struct promise_type {
+            task get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept { }
+            void unhandled_exception() noexcept { }
+        };
+    };
+
+    std::vector<IOM::Status> results;
+    std::vector<int> order;
+
+    template <typename ISR>
+    void run_interrupts(const std::size_t until, ISR isr) {
+        for (int k = 0; k < 1000000 && results.size() < until; ++k) {
+            sim::clock::advance(200);
+            if (IOM_T::INTSTAT.read() & IOM_T::INTEN.read()) { isr(); }
+        }
+    }
+
+    task reader(const std::span<const IOM::segment> segments) {
+        for (int i = 0; i < 3; ++i) { results.push_back(co_await IOM::transfer<IOM_T>(segments, 0, false, 1, 0x0B)); }
+    }
+
+    task bus_user(const IOM::device_config& device, const std::span<const IOM::segment> segments, const int id, const uint8_t priority) {
+        results.push_back(co_await IOM::submit<bus>(device, segments, priority));
+        order.push_back(id);
+    }
+
+    void callback(void* const context, const IOM::Status result) {
+        *static_cast<IOM::Status*>(context) = result;
+    }
+
+    /// the callback runs once from isr() with the result, and a failed start never calls it
+    void test_callback(sim::iom_model& model) {
+        model.clear_transactions();
+        std::vector<uint8_t> data(100);
+        const IOM::segment segments[] = {IOM::segment::rx(data)};
+        IOM::Status result = IOM::Status::busy;
+        CHECK(engine::start(segments, callback, &result) == IOM::Status::ok);
+        CHECK(engine::start(segments, callback, &result) == IOM::Status::busy);
+        for (int k = 0; k < 100000 && engine::busy(); ++k) {
+            sim::clock::advance(200);
+            if (IOM_T::INTSTAT.read() & IOM_T::INTEN.read()) { engine::isr(); }
+        }
+        CHECK(result == IOM::Status::ok);
+        CHECK(model.transactions().at(0).data == data);
+
+        result = IOM::Status::busy;
+        CHECK(engine::start({}, callback, &result) == IOM::Status::invalid);
+        CHECK(result == IOM::Status::busy);
+    }
+
+    /// a coroutine awaits three transfers in a row, each resumed from the interrupt
+    void test_awaitable(sim::iom_model& model) {
+        model.clear_transactions();
+        results.clear();
+        const std::vector<uint8_t> command = {0x0B, 0, 0, 0};
+        std::vector<uint8_t> data(300);
+        const IOM::segment segments[] = {IOM::segment::tx(command), IOM::segment::rx(data)};
+        reader(segments);
+        CHECK(results.empty());                                     // suspended until the interrupt
+        run_interrupts(3, engine::isr);
+        CHECK(results == std::vector<IOM::Status>(3, IOM::Status::ok));
+        CHECK_EQ(model.transactions().size(), 6u);
+    }
+
+    /// a transfer that can not start completes the co_await without suspending
+    void test_failed_start() {
+        results.clear();
+        reader({});
+        CHECK(results == std::vector<IOM::Status>(3, IOM::Status::invalid));
+    }
+
+    /// awaiting shared bus requests resumes them in priority order
+    void test_bus_awaitable() {
+        results.clear();
+        order.clear();
+        static constexpr auto fast = IOM::device_config::spi(IOM::clkcfg(sfr::IOM0::FSELv::HFRC_DIV2));
+        static constexpr auto slow = IOM::device_config::spi(IOM::clkcfg(sfr::IOM0::FSELv::HFRC_DIV4), IOM::SpiMode::mode3, 1);
+        const std::vector<uint8_t> bulk(1000, 0x5A);
+        const IOM::segment segments[] = {IOM::segment::tx(bulk)};
+        bus_user(slow, segments, 1, 0);
+        bus_user(slow, segments, 2, 0);
+        bus_user(fast, segments, 3, 9);
+        run_interrupts(3, bus::isr);
+        CHECK(order == std::vector<int>({1, 3, 2}));
+        CHECK(results == std::vector<IOM::Status>(3, IOM::Status::ok));
+    }
+
+}   // namespace
+
+int main() {
+    sim::iom_model model(IOM_T::BaseAddress);
+    IOM::spi_master<IOM_T>::init(IOM::clkcfg(sfr::IOM0::FSELv::HFRC_DIV2));
+    test_callback(model);
+    test_awaitable(model);
+    test_failed_start();
+    test_bus_awaitable();
+    return test::result();
+}
@@ -0,0 +1,57 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <cstdio>
+
+// Runs the IOM benchmark on the simulated IOM and prints its table (ctest -V shows it), checking that every
+// run completes, that no path beats the wire rate and that the DMA and command queue paths get close to it
+// for large transfers.
+
+namespace {
+
+    using IOM_T = decltype(device::IOM0);
+    using bench = IOM::benchmark<IOM_T>;
+
+    constexpr uint32_t wire_rate = 24000000 / 8;
+
+    const char* const path_names[] = {"fifo", "dma", "cq"};
+
+    void report(const IOM::bench_result& r) {
+        std::printf("%-4s %s %6u B  wire %9u ns  setup %6u ns  gap %7u ns  %8u B/s\n", path_names[static_cast<int>(r.path)],
+                    r.direction == IOM::Direction::write ? "tx" : "rx", r.size, r.wire_ns, r.setup_ns, r.gap_ns, r.bytes_per_second);
+        CHECK(r.status == IOM::Status::ok);
+        CHECK(r.bytes_per_second <= wire_rate);
+        CHECK_EQ(r.wire_ns, static_cast<uint32_t>(uint64_t{r.size} * 1000000000ull / wire_rate));
+        if (r.size >= 16384 && r.path != IOM::Path::fifo) { CHECK(r.bytes_per_second > wire_rate / 100 * 99); }
+    }
+
+    void test_sweeps() {
+        for (const IOM::Path path : {IOM::Path::fifo, IOM::Path::dma, IOM::Path::cq}) {
+            CHECK(bench::sweep(path, report, 2) == IOM::Status::ok);
+            report(bench::run(path, 5000, 2, IOM::Direction::read));
+        }
+        CHECK(bench::run(IOM::Path::dma, 0).status == IOM::Status::invalid);
+        CHECK(bench::run(IOM::Path::dma, bench::max_size + 1).status == IOM::Status::invalid);
+    }
+
+    /// the command queue path puts the whole buffer on the bus, in order
+    void test_cq_data(sim::iom_model& model) {
+        model.clear_transactions();
+        CHECK(bench::run(IOM::Path::cq, 9000, 1).status == IOM::Status::ok);
+        std::size_t count = 0;
+        bool in_order = true;
+        for (const auto& t : model.transactions()) {
+            for (const uint8_t b : t.data) { in_order = in_order && b == static_cast<uint8_t>(count++ % 9000); }
+        }
+        CHECK_EQ(count, 2u * 9000);                                 // setup run and one back to back run
+        CHECK(in_order);
+    }
+
+}   // namespace
+
+int main() {
+    sim::iom_model model(IOM_T::BaseAddress);
+    IOM::spi_master<IOM_T>::init(IOM::spi_clkcfg<24000000>());
+    test_sweeps();
+    test_cq_data(model);
+    return test::result();
+}
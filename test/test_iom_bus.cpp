@@ -0,0 +1,83 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+    using IOM_T = decltype(device::IOM0);
+    using bus = IOM::shared_bus<IOM_T>;
+
+    std::vector<int> completed;
+    IOM::Status last_status = IOM::Status::ok;
+
+    void done(void* const context, const IOM::Status result) {
+        completed.push_back(static_cast<int>(reinterpret_cast<intptr_t>(context)));
+        if (result != IOM::Status::ok) { last_status = result; }
+    }
+
+    void* tag(const int id) { return reinterpret_cast<void*>(static_cast<intptr_t>(id)); }
+
+    void run_interrupts() {
+        for (int k = 0; k < 100000 && !bus::idle(); ++k) {
+            sim::clock::advance(500);
+            if (IOM_T::INTSTAT.read() & IOM_T::INTEN.read()) { bus::isr(); }
+        }
+    }
+
+    constexpr auto flash = IOM::device_config::spi(IOM::clkcfg(sfr::IOM0::FSELv::HFRC_DIV2), IOM::SpiMode::mode0, 0);
+    constexpr auto display = IOM::device_config::spi(IOM::clkcfg(sfr::IOM0::FSELv::HFRC_DIV4), IOM::SpiMode::mode3, 1);
+    constexpr auto sensor = IOM::device_config::i2c(0x68);
+
+    static_assert(!flash.is_i2c() && sensor.is_i2c());
+    static_assert(sensor.devcfg == 0x68 && IOM::device_config::i2c(0x1FF, {}, true).mi2ccfg == 1u);
+
+    /// queued sensor reads overtake queued display updates, the running one finishes first
+    void test_priority(sim::iom_model& model) {
+        model.clear_transactions();
+        completed.clear();
+        std::vector<uint8_t> bulk(2000);
+        std::vector<uint8_t> first(6);
+        std::vector<uint8_t> second(6);
+        const IOM::segment bulk_segments[] = {IOM::segment::tx(bulk)};
+        const IOM::segment first_segments[] = {IOM::segment::rx(first)};
+        const IOM::segment second_segments[] = {IOM::segment::rx(second)};
+
+        for (int i = 0; i < 3; ++i) { CHECK(bus::submit({&display, bulk_segments, 0, 0, 0, false, done, tag(10 + i)}) == IOM::Status::ok); }
+        CHECK(bus::submit({&flash, first_segments, 5, 1, 0x03, false, done, tag(1)}) == IOM::Status::ok);
+        CHECK(bus::submit({&flash, second_segments, 5, 1, 0x03, false, done, tag(2)}) == IOM::Status::ok);
+        CHECK_EQ(bus::pending(), 4u);
+        run_interrupts();
+
+        CHECK(completed == std::vector<int>({10, 1, 2, 11, 12}));
+        CHECK(last_status == IOM::Status::ok);
+        const auto& log = model.transactions();
+        CHECK_EQ(log.size(), 5u);
+        CHECK_EQ(log.at(1).cs, 0);
+        CHECK(log.at(1).data == first);
+        CHECK_EQ(log.at(4).cs, 1);
+    }
+
+    /// back to back requests to one device write no configuration registers
+    void test_register_cache() {
+        bus::invalidate();
+        std::vector<uint8_t> data(4);
+        const IOM::segment segments[] = {IOM::segment::rx(data)};
+        CHECK(bus::submit({&flash, segments, 0, 0, 0, false, done, tag(20)}) == IOM::Status::ok);
+        run_interrupts();
+        const uint32_t writes = bus::register_writes();
+        CHECK(bus::submit({&flash, segments, 0, 0, 0, false, done, tag(21)}) == IOM::Status::ok);
+        run_interrupts();
+        CHECK_EQ(bus::register_writes(), writes);
+        CHECK_EQ(IOM_T::CLKCFG.read(), flash.clkcfg);
+        CHECK(bus::submit({nullptr, segments}) == IOM::Status::invalid);
+    }
+
+}   // namespace
+
+int main() {
+    sim::iom_model model(IOM_T::BaseAddress);
+    test_priority(model);
+    test_register_cache();
+    return test::result();
+}
@@ -0,0 +1,51 @@
+#include "check.hpp"
+#include "device.hpp"
+
+namespace {
+
+    using namespace IOM;
+    using CLKCFG_t = registers::CLKCFG_t;
+
+    static_assert(spi_clkcfg<48000000>() == clkcfg(sfr::IOM0::FSELv::HFRC));
+    static_assert(clock_hz(spi_clkcfg<8000000>()) == 8000000);
+    static_assert(clock_hz(spi_clkcfg<7000000>()) <= 7000000);
+    static_assert(clock_hz(i2c_clkcfg<400000>(), ClockMode::i2c) == 400000);
+
+    /// SPI targets: exact where a tap or divider reaches them, never above, duty cycle near 50%
+    void test_spi() {
+        for (const uint32_t target : {48000000u, 30000000u, 24000000u, 16000000u, 13000000u, 8000000u, 1000000u, 123456u, 10000u, 1000u}) {
+            const clock_setting setting = solve_clock(target, ClockMode::spi);
+            CHECK(setting.valid());
+            CHECK(setting.hz <= target);
+            CHECK_EQ(clock_hz(setting.clkcfg), setting.hz);
+            if (CLKCFG_t::DIVEN.extract(setting.clkcfg)) {
+                const uint32_t total = CLKCFG_t::TOTPER.extract(setting.clkcfg) + 1;
+                const uint32_t low = CLKCFG_t::LOWPER.extract(setting.clkcfg) + 1;
+                CHECK(low == total / 2);
+            }
+        }
+        CHECK_EQ(solve_clock(16000000u).hz, 16000000u);
+        CHECK_EQ(solve_clock(13000000u).hz, 12000000u);
+        CHECK(!solve_clock(100u).valid());
+    }
+
+    /// I2C targets: SCL at or below the target with valid low and high times, nothing above 1 MHz
+    void test_i2c() {
+        for (const uint32_t target : {1000000u, 400000u, 100000u, 10000u, 1000u}) {
+            const clock_setting setting = solve_clock(target, ClockMode::i2c);
+            CHECK(setting.valid());
+            CHECK(setting.hz <= target);
+            CHECK(scl_timing_ok(setting.clkcfg));
+        }
+        CHECK_EQ(solve_clock(400000u, ClockMode::i2c).hz, 400000u);
+        CHECK(!solve_clock(2000000u, ClockMode::i2c).valid());
+        CHECK(!scl_timing_ok(clkcfg(sfr::IOM0::FSELv::HFRC_DIV64)));     // no divider, no LOWPER
+    }
+
+}   // namespace
+
+int main() {
+    test_spi();
+    test_i2c();
+    return test::result();
+}
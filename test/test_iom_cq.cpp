@@ -0,0 +1,95 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <vector>
+
+namespace {
+
+    using IOM_T = decltype(device::IOM1);
+    using program = IOM::cq_program<IOM_T, 16>;
+    using queue = IOM::command_queue<IOM_T, 32>;
+
+    constexpr uint8_t wake[] = {0x10, 0x01, 0x02};
+
+    constexpr program make_fixed() {
+        program p;
+        p.write_inline(wake, 0).command(IOM::command_word(IOM::Command::WRITE, 0, 1, false, 2, 0xAB12), 0xAB12);
+        return p;
+    }
+
+    /// the constant part of a program is built at compile time
+    constexpr program fixed = make_fixed();
+    static_assert(fixed.size() == 4 && !fixed.overflow());
+    static_assert(fixed.entries()[0].address == IOM_T::FIFOPUSH.address && fixed.entries()[0].value == 0x020110);
+    static_assert(fixed.entries()[2].address == IOM_T::OFFSETHI.address && fixed.entries()[2].value == 0xAB);
+    static_assert(fixed.entries()[3].address == IOM_T::CMD.address);
+
+    /// entries address the registers of this IOM with the generated field layout
+    void test_entries() {
+        program p;
+        p.set_flags(0x05).clear_flags(0x02).toggle_flags(0x80).wait_for_release(3).notify();
+        const auto e = p.entries();
+        CHECK_EQ(e.size(), 6u);
+        CHECK_EQ(e[0].address, IOM_T::CQSETCLEAR.address);
+        CHECK_EQ(e[0].value, 0x05u);
+        CHECK_EQ(e[1].value, 0x020000u);
+        CHECK_EQ(e[2].value, 0x8000u);
+        CHECK_EQ(e[3].value, 0x08u);
+        CHECK_EQ(e[4].address, IOM_T::CQPAUSEEN.address);
+        CHECK_EQ(e[4].value, IOM::cq_pause::software(3) | IOM::cq_pause::index_equal);
+        CHECK_EQ(e[5].address, IOM_T::CQSETCLEAR.address | 1u);
+
+        program full;
+        for (int i = 0; i < 17; ++i) { full.set_flags(1); }
+        CHECK(full.overflow());
+        CHECK(queue::append(full) == IOM::Status::invalid);
+    }
+
+    /// forty polls through a 32 entry ring: appends wait for room, one block waits for release()
+    void test_queue(sim::iom_model& model) {
+        model.clear_transactions();
+        queue::start();
+        std::vector<std::vector<uint8_t>> buffers(40, std::vector<uint8_t>(6));
+        unsigned retries = 0;
+        for (std::size_t i = 0; i < buffers.size() && retries < 10000;) {
+            program p;
+            p.append(fixed).dma_read(buffers[i], 2, false, 1, 0x80 | static_cast<uint32_t>(i));
+            if (i == 20) { p.wait_for_release(3); }
+            const IOM::Status s = queue::append(p);
+            if (s == IOM::Status::busy) {
+                ++retries;
+                sim::clock::advance(2000);
+                if (i > 20) { queue::release(3); }
+                continue;
+            }
+            CHECK(s == IOM::Status::ok);
+            ++i;
+        }
+        for (int k = 0; k < 1000 && !queue::idle(); ++k) {
+            sim::clock::advance(2000);
+            queue::release(3);
+        }
+        CHECK(queue::idle());
+        CHECK(retries > 0);
+        CHECK_EQ(queue::completed_index(), 40);
+        CHECK_EQ(queue::errors(), 0u);
+
+        std::size_t reads = 0;
+        for (const auto& t : model.transactions()) {
+            if (t.cmd != static_cast<uint8_t>(IOM::Command::READ)) { continue; }
+            CHECK_EQ(t.cs, 2);
+            CHECK(t.offset.size() == 1 && t.data == buffers.at(t.offset[0] & 0x7Fu));
+            ++reads;
+        }
+        CHECK_EQ(reads, buffers.size());
+        queue::stop();
+    }
+
+}   // namespace
+
+int main() {
+    sim::iom_model model(IOM_T::BaseAddress);
+    IOM::spi_master<IOM_T>::init(IOM::clkcfg(sfr::IOM0::FSELv::HFRC));
+    test_entries();
+    test_queue(model);
+    return test::result();
+}
@@ -0,0 +1,89 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <vector>
+
+namespace {
+
+    using IOM_T = decltype(device::IOM3);
+    using dma = IOM::dma_engine<IOM_T>;
+
+    /// let the model run and call isr() whenever an enabled interrupt is pending, until the transfer is done
+    unsigned run_interrupts() {
+        unsigned calls = 0;
+        while (dma::busy() && calls < 100000) {
+            sim::clock::advance(1000);
+            if (IOM_T::INTSTAT.read() & IOM_T::INTEN.read()) {
+                dma::isr();
+                ++calls;
+            }
+        }
+        return calls;
+    }
+
+    /// a command byte, a payload longer than one command and a read run as one transaction
+    void test_scatter_gather(sim::iom_model& model) {
+        model.clear_transactions();
+        std::vector<uint8_t> command = {0x2C};
+        std::vector<uint8_t> pixels(9001);
+        for (std::size_t i = 0; i < pixels.size(); ++i) { pixels[i] = static_cast<uint8_t>(i ^ 0x5A); }
+        std::vector<uint8_t> reply(13);
+        const IOM::segment segments[] = {IOM::segment::tx(command), IOM::segment::tx(pixels), IOM::segment::rx(reply)};
+
+        CHECK(dma::start(segments, 1) == IOM::Status::ok);
+        CHECK(dma::start(segments, 1) == IOM::Status::busy);
+        run_interrupts();
+        CHECK(dma::status() == IOM::Status::ok);
+        CHECK_EQ(dma::transferred(), 0u + 1 + 9001 + 13);
+
+        const auto& log = model.transactions();
+        std::vector<uint8_t> written;
+        for (std::size_t i = 0; i < log.size(); ++i) {
+            CHECK_EQ(log[i].cs, 1);
+            CHECK_EQ(log[i].cont, i + 1 < log.size());             // one transaction, CS released after the read
+            if (i + 1 < log.size()) { written.insert(written.end(), log[i].data.begin(), log[i].data.end()); }
+        }
+        std::vector<uint8_t> expected = command;
+        expected.insert(expected.end(), pixels.begin(), pixels.end());
+        CHECK(written == expected);
+        CHECK(log.back().data == reply);
+    }
+
+    /// single buffer helpers and argument checks
+    void test_single(sim::iom_model& model) {
+        model.clear_transactions();
+        std::vector<uint8_t> data(300);
+        CHECK(dma::read(data, 0, false, 1, 0x03) == IOM::Status::ok);
+        run_interrupts();
+        CHECK(dma::status() == IOM::Status::ok);
+        CHECK_EQ(model.transactions().size(), 1u);
+        CHECK(model.transactions().front().data == data);
+
+        const IOM::segment empty[] = {IOM::segment::rx(std::span<uint8_t>(data).first(0))};
+        CHECK(dma::start(empty) == IOM::Status::invalid);
+        CHECK(dma::write(data, 0, false, 4) == IOM::Status::invalid);
+    }
+
+    /// wait() takes the interrupts itself on the host and returns the result
+    void test_wait(sim::iom_model& model) {
+        model.clear_transactions();
+        std::vector<uint8_t> data(2500);
+        for (std::size_t i = 0; i < data.size(); ++i) { data[i] = static_cast<uint8_t>(i * 7); }
+        CHECK(dma::write(data, 2) == IOM::Status::ok);
+        CHECK(dma::wait() == IOM::Status::ok);
+        CHECK(!dma::busy());
+        CHECK_EQ(dma::transferred(), data.size());
+        std::vector<uint8_t> written;
+        for (const auto& t : model.transactions()) { written.insert(written.end(), t.data.begin(), t.data.end()); }
+        CHECK(written == data);
+    }
+
+}   // namespace
+
+int main() {
+    sim::iom_model model(IOM_T::BaseAddress);
+    IOM::spi_master<IOM_T>::init(IOM::clkcfg(sfr::IOM0::FSELv::HFRC_DIV2));
+    test_scatter_gather(model);
+    test_single(model);
+    test_wait(model);
+    return test::result();
+}
@@ -0,0 +1,62 @@
+#include "check.hpp"
+#include "device.hpp"
+
+namespace {
+
+    using IOM_T = decltype(device::IOM4);
+    using i2c = IOM::i2c_master<IOM_T>;
+
+    /// the timing images match the CLKCFG and MI2CCFG values of the previous hand-written tables
+    void test_timing() {
+        CHECK_EQ(IOM::i2c_timing_for(IOM::I2cSpeed::standard_100k).clkcfg, 0x773B1201u);
+        CHECK_EQ(IOM::i2c_timing_for(IOM::I2cSpeed::fast_400k).clkcfg, 0x1D0F1201u);
+        CHECK_EQ(IOM::i2c_timing_for(IOM::I2cSpeed::fast_plus_1m).clkcfg, 0x0B051201u);
+        CHECK_EQ(IOM::i2c_timing_for(IOM::I2cSpeed::fast_400k).mi2ccfg, 0x3F270u);
+    }
+
+    /// a batch of register reads: each is one transaction, a NAK fails only its own entry
+    void test_read_registers(sim::iom_model& model) {
+        model.clear_transactions();
+        uint8_t buffers[8][6] = {};
+        IOM::i2c_read batch[8];
+        for (unsigned i = 0; i < 8; ++i) {
+            batch[i] = IOM::i2c_read{static_cast<uint16_t>(i == 5 ? 0x55 : 0x68 + i), 0x3B + i, 1, buffers[i]};
+        }
+        CHECK_EQ(i2c::read_registers(batch), 7u);
+        for (unsigned i = 0; i < 8; ++i) { CHECK(batch[i].status == (i == 5 ? IOM::Status::nak : IOM::Status::ok)); }
+
+        const auto& log = model.transactions();
+        CHECK_EQ(log.size(), 8u);
+        CHECK_EQ(log[1].address, 0x69);
+        CHECK(log[1].offset == std::vector<uint8_t>({0x3C}));
+        CHECK(log[1].data == std::vector<uint8_t>(buffers[1], buffers[1] + 6));
+        CHECK(log[7].data == std::vector<uint8_t>(buffers[7], buffers[7] + 6));
+    }
+
+    /// single register access and the NAK of an absent device
+    void test_single(sim::iom_model& model) {
+        model.clear_transactions();
+        const uint8_t values[] = {1, 2, 3};
+        uint8_t data[4] = {};
+        CHECK(i2c::write_register(0x10, 0x20, values) == IOM::Status::ok);
+        CHECK(i2c::read_register(0x10, 0x1234, data, 2) == IOM::Status::ok);
+        CHECK(i2c::read(0x55, data) == IOM::Status::nak);
+        CHECK(i2c::read(0x10, data) == IOM::Status::ok);            // the NAK left nothing behind in the FIFO
+
+        const auto& log = model.transactions();
+        CHECK(log.at(0).offset == std::vector<uint8_t>({0x20}) && log[0].data == std::vector<uint8_t>({1, 2, 3}));
+        CHECK(log.at(1).offset == std::vector<uint8_t>({0x12, 0x34}));
+        CHECK(i2c::read(0x10, std::span<uint8_t>(data).first(0)) == IOM::Status::invalid);
+    }
+
+}   // namespace
+
+int main() {
+    sim::iom_model model(IOM_T::BaseAddress);
+    model.nak(0x55);
+    i2c::init(IOM::I2cSpeed::fast_400k);
+    test_timing();
+    test_read_registers(model);
+    test_single(model);
+    return test::result();
+}
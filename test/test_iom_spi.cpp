@@ -0,0 +1,123 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <vector>
+
+namespace {
+
+    using IOM_T = decltype(device::IOM2);
+    using spi = IOM::spi_master<IOM_T>;
+
+    std::vector<uint8_t> pattern(const std::size_t size) {
+        std::vector<uint8_t> bytes(size);
+        for (std::size_t i = 0; i < size; ++i) { bytes[i] = static_cast<uint8_t>(i * 7 + 3); }
+        return bytes;
+    }
+
+    /// data bytes of every logged command, in bus order
+    std::vector<uint8_t> bus_data(const sim::iom_model& model) {
+        std::vector<uint8_t> bytes;
+        for (const auto& t : model.transactions()) { bytes.insert(bytes.end(), t.data.begin(), t.data.end()); }
+        return bytes;
+    }
+
+    /// let the model run and call isr() whenever an enabled interrupt is pending, until the transfer is done
+    unsigned run_interrupts() {
+        unsigned calls = 0;
+        while (spi::busy() && calls < 100000) {
+            sim::clock::advance(200);
+            if (IOM_T::INTSTAT.read() & IOM_T::INTEN.read()) {
+                spi::isr();
+                ++calls;
+            }
+        }
+        return calls;
+    }
+
+    /// a write longer than one command is split into chained commands, unaligned source, offset byte on the first
+    void test_blocking_write(sim::iom_model& model) {
+        model.clear_transactions();
+        const std::vector<uint8_t> tx = pattern(10001);
+        const std::span<const uint8_t> data(tx.data() + 1, 10000);
+        CHECK(spi::write(data, 1, false, 1, 0x02) == IOM::Status::ok);
+
+        const auto& log = model.transactions();
+        CHECK(log.size() >= 3);
+        CHECK_EQ(log.front().offset.size(), 1u);
+        CHECK_EQ(log.front().offset.at(0), 0x02);
+        for (std::size_t i = 0; i < log.size(); ++i) {
+            CHECK_EQ(log[i].cs, 1);
+            CHECK_EQ(log[i].cont, i + 1 < log.size());             // chip select held between the chunks only
+        }
+        CHECK(bus_data(model) == std::vector<uint8_t>(data.begin(), data.end()));
+    }
+
+    /// a read with a three byte address returns what the device shifted out
+    void test_blocking_read(sim::iom_model& model) {
+        model.clear_transactions();
+        std::vector<uint8_t> rx(4104);
+        const std::span<uint8_t> data(rx.data() + 1, 4103);
+        CHECK(spi::read(data, 0, false, 3, 0x0B1234) == IOM::Status::ok);
+
+        const auto& log = model.transactions();
+        CHECK(log.front().offset == std::vector<uint8_t>({0x0B, 0x12, 0x34}));
+        CHECK(bus_data(model) == std::vector<uint8_t>(data.begin(), data.end()));
+        CHECK_EQ(rx[0], 0);
+    }
+
+    void test_invalid(sim::iom_model&) {
+        std::vector<uint8_t> buffer(4);
+        CHECK(spi::write({}, 0) == IOM::Status::invalid);
+        CHECK(spi::read(buffer, 0, false, 4) == IOM::Status::invalid);
+        CHECK(spi::transfer(buffer, std::span<uint8_t>(buffer).first(2)) == IOM::Status::invalid);
+    }
+
+    /// interrupt driven transfers move every byte through THR and command complete interrupts
+    void test_interrupt_driven(sim::iom_model& model) {
+        model.clear_transactions();
+        std::vector<uint8_t> rx(9000);
+        CHECK(spi::start_read(rx, 2) == IOM::Status::ok);
+        CHECK(spi::start_read(rx, 2) == IOM::Status::busy);
+        CHECK(run_interrupts() > 0);
+        CHECK(spi::status() == IOM::Status::ok);
+        CHECK(bus_data(model) == rx);
+
+        model.clear_transactions();
+        const std::vector<uint8_t> tx = pattern(5000);
+        CHECK(spi::start_write(tx) == IOM::Status::ok);
+        CHECK(run_interrupts() > 0);
+        CHECK(spi::status() == IOM::Status::ok);
+        CHECK(bus_data(model) == tx);
+    }
+
+    /// command and configuration words from the generated fields
+    void test_register_images() {
+        CHECK_EQ(IOM::command_word(IOM::Command::WRITE, 4, 1, true, 1, 0xAB), 0xAB1004A1u);
+        CHECK_EQ(IOM::command_word(IOM::Command::READ, 4095, 3, false, 3, 0x123456), 0x563FFF62u);
+        CHECK_EQ(IOM::clkcfg(sfr::IOM0::FSELv::HFRC_DIV2), 0x201u);
+        CHECK_EQ(IOM::mspicfg(IOM::SpiMode::mode3, true), 0x800003u);
+        CHECK_EQ(IOM::mspicfg(IOM::SpiMode::mode1), 0x2u);
+    }
+
+    /// power() sets the IOM bit of DEVPWREN and waits for its power domain
+    void test_power() {
+        using PWR = decltype(device::PWRCTRL);
+        sim::bus::write(PWR::DEVPWRSTATUS.address, PWR::DEVPWRSTATUS_t::HCPB.mask, 4);
+        IOM::power<PWR, IOM_T>(true);
+        CHECK(PWR::DEVPWREN.read() & PWR::DEVPWREN_t::PWRIOM2.mask);
+        IOM::power<PWR, IOM_T>(false);
+        CHECK(!(PWR::DEVPWREN.read() & PWR::DEVPWREN_t::PWRIOM2.mask));
+    }
+
+}   // namespace
+
+int main() {
+    test_register_images();
+    test_power();
+    sim::iom_model model(IOM_T::BaseAddress);
+    spi::init(IOM::clkcfg(sfr::IOM0::FSELv::HFRC), IOM::SpiMode::mode0);
+    test_blocking_write(model);
+    test_blocking_read(model);
+    test_invalid(model);
+    test_interrupt_driven(model);
+    return test::result();
+}
@@ -0,0 +1,99 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+    using IOS_T = decltype(device::IOSLAVE);
+    using ios = IOS::slave<IOS_T, 1024>;
+
+    /// let the host read `count` bytes in bursts of 16, servicing the interrupt between bursts
+    std::vector<uint8_t> drain(sim::ios_model& model, const std::size_t count) {
+        std::vector<uint8_t> data;
+        while (data.size() < count) {
+            const std::vector<uint8_t> part = model.host_read(std::min<std::size_t>(16, count - data.size()));
+            data.insert(data.end(), part.begin(), part.end());
+            if (IOS_T::INTSTAT.read() & IOS_T::INTEN.read()) { ios::isr(); }
+        }
+        return data;
+    }
+
+    /// FIFOCFG, CFG and FIFOTHR as programmed by init()
+    void test_init() {
+        CHECK(!ios::init(IOS::Interface::i2c, 0x10, IOS::layout{0x7C, 0x80, 0x100}));     // ro_base not on 8 bytes
+        CHECK(ios::init(IOS::Interface::i2c, 0x42));
+        CHECK_EQ(IOS_T::FIFOCFG.value(), (0x78u / 8) << 24 | (0x100u / 8) << 8 | (0x80u / 8));
+        CHECK_EQ(IOS_T::CFG.value(), 1u << 31 | 0x84u << 8);
+        CHECK_EQ(IOS_T::FIFOTHR.value(), 0x40u);
+        CHECK_EQ(IOS_T::INTEN.read(), IOS::irq::fundfl | IOS::irq::fovfl);
+
+        CHECK(ios::init(IOS::Interface::spi, 0, IOS::layout{}, 16));
+        CHECK_EQ(IOS_T::CFG.value(), 1u << 31 | 1u);
+        CHECK_EQ(IOS_T::FIFOTHR.value(), 16u);
+    }
+
+    /// register map updates land in LRAM inside an FUPD bracket; host writes come back through read_registers()
+    void test_registers(sim::ios_model& model) {
+        CHECK(ios::init(IOS::Interface::spi, 0, IOS::layout{}, 0, IOS::irq::xcmpwr));
+        const uint32_t updates = model.updates();
+        const uint8_t values[] = {0x11, 0x22, 0x33, 0x44};
+        CHECK(ios::write_registers(0x10, values));
+        CHECK(!ios::write_registers(0x7E, values));                 // runs into the FIFO
+        CHECK_EQ(model.updates(), updates + 2);
+        CHECK_EQ(model.host_register(0x10), 0x11);
+        CHECK_EQ(model.host_register(0x13), 0x44);
+
+        model.host_write(0x20, {0xA5, 0x5A});
+        CHECK_EQ(ios::isr(), IOS::irq::xcmpwr);
+        uint8_t back[2] = {};
+        CHECK(ios::read_registers(0x20, back));
+        CHECK_EQ(back[0], 0xA5);
+        CHECK_EQ(back[1], 0x5A);
+    }
+
+    /// a burst several times the LRAM FIFO reaches the host intact through FSIZE refills
+    void test_stream(sim::ios_model& model) {
+        CHECK(ios::init(IOS::Interface::spi));
+        std::vector<uint8_t> burst(900);
+        for (std::size_t i = 0; i < burst.size(); ++i) { burst[i] = static_cast<uint8_t>(i * 7 + 3); }
+        CHECK_EQ(ios::write(burst), burst.size());
+        CHECK_EQ(ios::pending(), burst.size());
+        CHECK_EQ(model.counter(), 128u);                            // the whole LRAM FIFO, the rest in the ring
+        CHECK(IOS_T::INTEN.read() & IOS::irq::fsize);
+
+        CHECK(drain(model, burst.size()) == burst);
+        CHECK_EQ(ios::underruns(), 0u);
+        CHECK_EQ(ios::pending(), 0u);
+        CHECK(!(IOS_T::INTEN.read() & IOS::irq::fsize));            // disabled once the ring ran dry
+
+        model.host_read(1);
+        ios::isr();
+        CHECK_EQ(ios::underruns(), 1u);
+    }
+
+    /// flush() drops queued bytes and zeroes the host counter
+    void test_flush(sim::ios_model& model) {
+        CHECK(ios::init(IOS::Interface::spi));
+        const std::vector<uint8_t> data(300, 0x5C);
+        CHECK_EQ(ios::write(data), data.size());
+        ios::flush();
+        CHECK_EQ(ios::pending(), 0u);
+        CHECK_EQ(model.counter(), 0u);
+        CHECK(!(IOS_T::INTEN.read() & IOS::irq::fsize));
+
+        const std::vector<uint8_t> next = {1, 2, 3};
+        CHECK_EQ(ios::write(next), next.size());
+        CHECK(drain(model, next.size()) == next);
+    }
+
+}   // namespace
+
+int main() {
+    sim::ios_model model;
+    test_init();
+    test_registers(model);
+    test_stream(model);
+    test_flush(model);
+    return test::result();
+}
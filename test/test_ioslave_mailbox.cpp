@@ -0,0 +1,98 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <vector>
+
+namespace {
+
+    using IOS_T = decltype(device::IOSLAVE);
+    using ios = IOS::slave<IOS_T, 16>;                  // a small ring, so larger batches are delivered in parts
+    using mailbox = IOS::mailbox<IOS_T, ios, 128>;
+
+    constexpr uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    int s_commands = 0;
+    uint8_t s_command = 0;
+
+    void on_command(const std::span<const uint8_t> command) {
+        ++s_commands;
+        s_command = command[0];
+    }
+
+    /// frames [type][8][payload] for types first .. first + count - 1
+    std::vector<uint8_t> frames(const uint8_t first, const int count) {
+        std::vector<uint8_t> bytes;
+        for (int i = 0; i < count; ++i) {
+            bytes.push_back(static_cast<uint8_t>(first + i));
+            bytes.push_back(sizeof(payload));
+            bytes.insert(bytes.end(), std::begin(payload), std::end(payload));
+        }
+        return bytes;
+    }
+
+    /// events wait for the latency deadline, are delivered in one batch and raise the host interrupt once
+    void test_latency(sim::ios_model& model) {
+        CHECK(ios::init(IOS::Interface::spi));
+        mailbox::init(IOS::batch_policy{96, 16, 100, 2});
+        for (uint8_t i = 0; i < 3; ++i) { CHECK(mailbox::post(static_cast<uint8_t>(0x10 + i), std::span<const uint8_t>(payload, 4), 5)); }
+        CHECK_EQ(mailbox::staged(), 18u);
+        mailbox::service(104);
+        CHECK_EQ(model.counter(), 0u);
+        mailbox::service(105);
+        CHECK_EQ(mailbox::staged(), 2u);                    // the ring takes 16 bytes at a time
+        CHECK_EQ(mailbox::staged_events(), 1u);
+        CHECK_EQ(model.ioint(), 1u << 2);
+        CHECK_EQ(mailbox::interrupts(), 1u);
+
+        mailbox::flush();
+        CHECK_EQ(mailbox::staged(), 0u);
+        CHECK_EQ(mailbox::staged_events(), 0u);
+        CHECK_EQ(mailbox::interrupts(), 1u);                // the host has not cleared the first one
+        CHECK_EQ(model.host_read(model.counter()).size(), 18u);
+        model.host_clear(0xFF);
+    }
+
+    /// after a partial delivery the rest is re-counted, frame cut in two included, and waits from the delivery tick
+    void test_partial(sim::ios_model& model) {
+        CHECK(ios::init(IOS::Interface::spi));
+        mailbox::init(IOS::batch_policy{120, 16, 100, 0});
+        for (int i = 0; i < 12; ++i) { CHECK(mailbox::post(static_cast<uint8_t>(0x20 + i), payload, static_cast<uint32_t>(i))); }
+        CHECK_EQ(mailbox::staged(), 104u);                  // 120 bytes due at tick 11, 16 of them taken
+        CHECK_EQ(mailbox::staged_events(), 11u);            // frame 1 was cut after 6 bytes
+
+        mailbox::service(105);                              // 94 ticks since the partial delivery
+        CHECK_EQ(mailbox::staged(), 104u);
+        mailbox::service(111);
+        CHECK_EQ(mailbox::staged(), 88u);
+        CHECK_EQ(mailbox::staged_events(), 9u);             // the rest of frame 1, frame 2 and part of frame 3 went
+
+        std::vector<uint8_t> received = model.host_read(model.counter());
+        for (uint32_t tick = 211; mailbox::staged() != 0; tick += 100) {
+            mailbox::service(tick);
+            const std::vector<uint8_t> part = model.host_read(model.counter());
+            received.insert(received.end(), part.begin(), part.end());
+        }
+        CHECK_EQ(mailbox::staged_events(), 0u);
+        CHECK(received == frames(0x20, 12));
+        CHECK_EQ(ios::underruns(), 0u);
+        model.host_clear(0xFF);
+    }
+
+    /// a host write to the inbox reaches the command handler
+    void test_inbox(sim::ios_model& model) {
+        CHECK(ios::init(IOS::Interface::spi, 0, IOS::layout{}, 0, IOS::irq::xcmpwr));
+        mailbox::init(IOS::batch_policy{}, 0x20, on_command);
+        model.host_write(0x20, {0x7E, 0x01});
+        CHECK_EQ(mailbox::isr(), 0u);
+        CHECK_EQ(s_commands, 1);
+        CHECK_EQ(s_command, 0x7E);
+    }
+
+}   // namespace
+
+int main() {
+    sim::ios_model model;
+    test_latency(model);
+    test_partial(model);
+    test_inbox(model);
+    return test::result();
+}
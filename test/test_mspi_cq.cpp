@@ -0,0 +1,132 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    using MSPI_T = decltype(device::MSPI);
+    using controller = MSPI::controller<MSPI_T>;
+    using program = MSPI::cq_program<MSPI_T, 16>;
+    using queue = MSPI::command_queue<MSPI_T, 32>;
+    using pipeline = MSPI::flash_pipeline<MSPI_T, 64>;
+
+    /// entries address the generated registers with the generated field layout
+    void test_program() {
+        program p;
+        p.command(0x20, true, 0x1000);
+        CHECK_EQ(p.size(), 3u);
+        CHECK_EQ(p.entries()[0].address, MSPI_T::ADDR.address);
+        CHECK_EQ(p.entries()[0].value, 0x1000u);
+        CHECK_EQ(p.entries()[1].address, MSPI_T::INSTR.address);
+        CHECK_EQ(p.entries()[2].address, MSPI_T::CTRL.address);
+        CHECK_EQ(p.entries()[2].value, 1u << 10 | 1u << 9 | 1u << 8 | 1u);
+
+        p.clear();
+        p.transfer(MSPI::Direction::write, 0x10001000, 0x200, 256, 16);
+        CHECK_EQ(p.size(), 6u);
+        CHECK_EQ(p.entries()[4].address, MSPI_T::DMABCOUNT.address);
+        CHECK_EQ(p.entries()[4].value, 16u);
+        CHECK_EQ(p.entries()[5].address, MSPI_T::DMACFG.address);
+        CHECK_EQ(p.entries()[5].value, 0x7u);
+
+        p.clear();
+        p.wait_for_release(2);
+        CHECK_EQ(p.entries()[0].address, MSPI_T::CQSETCLEAR.address | 1u);
+        CHECK_EQ(p.entries()[0].value, 1u << 2);
+        CHECK_EQ(p.entries()[1].address, MSPI_T::CQPAUSE.address);
+        CHECK_EQ(p.entries()[1].value, MSPI::cq_pause::software(2));
+        CHECK_EQ(p.entries()[2].value, MSPI::cq_pause::index_equal);
+
+        p.clear();
+        p.transfer(MSPI::Direction::read, 0, 0, MSPI::max_dma_bytes + 4);
+        CHECK(p.overflow());
+    }
+
+    /// a block runs up to its pause, continues on release() and the queue goes idle at the index marker
+    void test_queue(sim::nor_flash& flash) {
+        CHECK(controller::configure(MSPI::device_config{}));
+        flash.clear_instructions();
+        queue::start();
+        program p;
+        p.command(0x06).wait_for_release(1).command(0x04);
+        CHECK(queue::append(p) == MSPI::Status::ok);
+        CHECK(queue::waiting(1));
+        CHECK(!queue::idle());
+        CHECK_EQ(flash.instructions().size(), 1u);
+        CHECK(MSPI_T::INTSTAT.read() & MSPI::irq::cqupd);
+
+        queue::release(1);
+        CHECK(queue::idle());
+        CHECK(queue::done(queue::queued_index()));
+        CHECK_EQ(flash.instructions().size(), 2u);
+        CHECK_EQ(flash.instructions()[1], 0x04);
+        CHECK_EQ(queue::isr() & MSPI::irq::cqupd, MSPI::irq::cqupd);
+        queue::stop();
+    }
+
+    /// isr() only records the pause; poll() from the loop does the status reads and releases
+    void test_pipeline(sim::mspi_model& model, sim::nor_flash& flash) {
+        CHECK(controller::configure(MSPI::device_config{}));
+        CHECK(pipeline::init());
+        std::vector<uint8_t> image(70000);
+        for (std::size_t i = 0; i < image.size(); ++i) { image[i] = static_cast<uint8_t>(i * 7 + 1); }
+        std::memset(flash.memory().data(), 0, 0x30000);
+        flash.clear_instructions();
+        model.clear_transfers();
+
+        CHECK(pipeline::update(0x10000, image) == MSPI::Status::ok);
+        CHECK_EQ(pipeline::total(), 3u + 274u);             // one block and two sector erases, 274 pages
+        bool recorded_only = true;
+        for (unsigned spins = 0; pipeline::busy() && spins < 1000000; ++spins) {
+            sim::clock::advance(1000);
+            if (MSPI_T::INTSTAT.read() & MSPI_T::INTEN.read()) {
+                const uint32_t completed = pipeline::completed();
+                pipeline::isr();
+                recorded_only = recorded_only && pipeline::completed() == completed && pipeline::pending();
+            }
+            pipeline::poll();
+            recorded_only = recorded_only && !pipeline::pending();
+        }
+        CHECK(recorded_only);
+        CHECK(pipeline::status() == MSPI::Status::ok);
+        CHECK_EQ(pipeline::completed(), pipeline::total());
+        CHECK(std::memcmp(flash.memory().data() + 0x10000, image.data(), image.size()) == 0);
+        CHECK_EQ(flash.memory()[0x10000 + image.size()], 0xFF);     // rest of the last sector erased
+        CHECK_EQ(flash.memory()[0xFFFF], 0);
+
+        std::size_t sector = 0, block = 0;
+        for (const uint8_t instruction : flash.instructions()) {
+            sector += instruction == 0x20;
+            block += instruction == 0xD8;
+        }
+        CHECK_EQ(sector, 2u);
+        CHECK_EQ(block, 1u);
+        CHECK_EQ(model.transfers().size(), 274u);
+    }
+
+    /// a CQERR seen by isr() ends the request on the next poll()
+    void test_error() {
+        CHECK(pipeline::erase(0x100, 4096) == MSPI::Status::invalid);
+        CHECK(pipeline::erase(0, 8192) == MSPI::Status::ok);
+        MSPI_T::INTSET.write(MSPI::irq::cqerr);
+        pipeline::isr();
+        CHECK(pipeline::busy());
+        CHECK(pipeline::pending());
+        CHECK(!pipeline::poll());
+        CHECK(pipeline::status() == MSPI::Status::dma_error);
+        CHECK(pipeline::erase(0, 4096) == MSPI::Status::ok);
+        CHECK(pipeline::wait() == MSPI::Status::ok);
+    }
+
+}   // namespace
+
+int main() {
+    sim::nor_flash flash(1u << 20);
+    sim::mspi_model model(flash);
+    test_program();
+    test_queue(flash);
+    test_pipeline(model, flash);
+    test_error();
+    return test::result();
+}
@@ -0,0 +1,104 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    using MSPI_T = decltype(device::MSPI);
+    using controller = MSPI::controller<MSPI_T>;
+    using dma = MSPI::dma_engine<MSPI_T>;
+
+    /// service the interrupt and the page programs until the transfer is done
+    void run() {
+        for (unsigned spins = 0; dma::busy() && spins < 100000; ++spins) {
+            sim::clock::advance(1000);
+            if (MSPI_T::INTSTAT.read() & MSPI_T::INTEN.read()) { dma::isr(); }
+            dma::poll();
+        }
+    }
+
+    /// a flash write is cut at page boundaries, each page preceded by WREN; the read back is one command
+    void test_flash(sim::mspi_model& model, sim::nor_flash& flash) {
+        CHECK(controller::configure(MSPI::device_config{}));
+        CHECK(dma::configure(MSPI::profiles::nor_flash));
+        std::vector<uint8_t> data(1000);
+        for (std::size_t i = 0; i < data.size(); ++i) { data[i] = static_cast<uint8_t>(i * 3); }
+
+        model.clear_transfers();
+        flash.clear_instructions();
+        CHECK(dma::write(0x1F0, data) == MSPI::Status::ok);
+        CHECK(dma::write(0x1F0, data) == MSPI::Status::busy);
+        run();
+        CHECK(dma::status() == MSPI::Status::ok);
+        CHECK_EQ(dma::transferred(), data.size());
+        const uint32_t chunks[][2] = {{0x1F0, 16}, {0x200, 256}, {0x300, 256}, {0x400, 256}, {0x500, 216}};
+        CHECK_EQ(model.transfers().size(), 5u);
+        for (std::size_t i = 0; i < model.transfers().size() && i < 5; ++i) {
+            CHECK_EQ(model.transfers()[i].device_address, chunks[i][0]);
+            CHECK_EQ(model.transfers()[i].count, chunks[i][1]);
+            CHECK(model.transfers()[i].write);
+        }
+        std::size_t wren = 0;
+        for (const uint8_t instruction : flash.instructions()) { wren += instruction == 0x06; }
+        CHECK_EQ(wren, 5u);
+        CHECK(std::memcmp(flash.memory().data() + 0x1F0, data.data(), data.size()) == 0);
+
+        std::vector<uint8_t> back(data.size());
+        model.clear_transfers();
+        CHECK(dma::read(0x1F0, back) == MSPI::Status::ok);
+        run();
+        CHECK_EQ(model.transfers().size(), 1u);
+        CHECK(back == data);
+    }
+
+    /// max_chunk splits reads too; wait() finishes the last page program
+    void test_chunks(sim::mspi_model& model) {
+        CHECK(dma::configure(MSPI::memory_profile{0, 256}));
+        std::vector<uint8_t> back(1000);
+        model.clear_transfers();
+        CHECK(dma::read(0, back) == MSPI::Status::ok);
+        run();
+        CHECK_EQ(model.transfers().size(), 4u);
+
+        CHECK(dma::configure(MSPI::profiles::nor_flash));
+        const std::vector<uint8_t> small(16, 0x42);
+        CHECK(dma::write(0x2000, small) == MSPI::Status::ok);
+        dma::isr();                                         // DCMP of the only chunk, the page program follows
+        CHECK(dma::busy());
+        CHECK(dma::wait() == MSPI::Status::ok);
+        CHECK_EQ(dma::transferred(), small.size());
+    }
+
+    /// argument checks and a DMA error
+    void test_errors() {
+        CHECK(!dma::configure(MSPI::memory_profile{100}));                 // page not a power of two
+        CHECK(!dma::configure(MSPI::memory_profile{256, 0}));
+        CHECK(!dma::configure(MSPI::profiles::psram, 32, 16));
+        std::vector<uint8_t> data(64);
+        CHECK(dma::read(0, std::span<uint8_t>()) == MSPI::Status::invalid);
+
+        CHECK(dma::configure(MSPI::memory_profile{}));
+        CHECK(dma::read(0, data) == MSPI::Status::ok);
+        MSPI_T::INTSET.write(MSPI::irq::derr);
+        dma::isr();
+        CHECK(dma::status() == MSPI::Status::dma_error);
+
+        MSPI::device_config paired{};
+        paired.frame = MSPI::Frame::QUADPAIRED;
+        CHECK(controller::configure(paired));
+        CHECK(dma::configure(MSPI::profiles::nor_flash));
+        CHECK(dma::write(0x101, std::span<const uint8_t>(data.data(), 10)) == MSPI::Status::invalid);
+        CHECK(dma::write(0x100, std::span<const uint8_t>(data.data(), 9)) == MSPI::Status::invalid);
+    }
+
+}   // namespace
+
+int main() {
+    sim::nor_flash flash(1u << 20);
+    sim::mspi_model model(flash);
+    test_flash(model, flash);
+    test_chunks(model);
+    test_errors();
+    return test::result();
+}
@@ -0,0 +1,108 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <array>
+
+namespace {
+
+    using MSPI_T = decltype(device::MSPI);
+    using store = MSPI::log_store<MSPI_T, 4, 8, 64>;
+    using pipeline = MSPI::flash_pipeline<MSPI_T, 64>;
+
+    constexpr uint32_t base = 0x40000;
+
+    std::array<uint8_t, 64> value(const uint8_t seed) {
+        std::array<uint8_t, 64> v{};
+        for (std::size_t i = 0; i < v.size(); ++i) { v[i] = static_cast<uint8_t>(seed + i); }
+        return v;
+    }
+
+    /// run poll() with the interrupt serviced until the store is idle
+    void drive() {
+        for (unsigned spins = 0; store::poll() && spins < 100000; ++spins) {
+            sim::clock::advance(1000);
+            if (MSPI_T::INTSTAT.read() & MSPI_T::INTEN.read()) { store::isr(); }
+        }
+    }
+
+    /// put() until it answers something else than ok, driving each append to the end
+    MSPI::Status fill(const uint8_t key, const int count) {
+        for (int i = 0; i < count; ++i) {
+            if (const MSPI::Status s = store::put(key, value(static_cast<uint8_t>(i))); s != MSPI::Status::ok) { return s; }
+            drive();
+        }
+        return MSPI::Status::ok;
+    }
+
+    /// values survive a remount; a removed key stays removed
+    void test_mount() {
+        CHECK(MSPI::controller<MSPI_T>::configure(MSPI::device_config{}));
+        CHECK(store::mount(base) == MSPI::Status::ok);
+        CHECK(store::put(1, value(10)) == MSPI::Status::ok);
+        drive();
+        CHECK(store::put(2, value(20)) == MSPI::Status::ok);
+        drive();
+        CHECK(store::remove(2) == MSPI::Status::ok);
+        drive();
+
+        CHECK(store::mount(base) == MSPI::Status::ok);
+        std::array<uint8_t, 64> back{};
+        std::size_t length = 0;
+        CHECK(store::get(1, back, length) == MSPI::Status::ok);
+        CHECK_EQ(length, 64u);
+        CHECK(back == value(10));
+        CHECK(!store::contains(2));
+        CHECK_EQ(store::live_bytes(), 72u);
+    }
+
+    /// garbage collection erases dead sectors as the ring goes round
+    void test_collect() {
+        CHECK(store::format() == MSPI::Status::ok);
+        CHECK(fill(3, 300) == MSPI::Status::ok);
+        CHECK(store::status() == MSPI::Status::ok);
+        CHECK(store::free_sectors() >= 1u);
+        std::array<uint8_t, 64> back{};
+        std::size_t length = 0;
+        CHECK(store::get(3, back, length) == MSPI::Status::ok);
+        CHECK(back == value(static_cast<uint8_t>(299)));
+    }
+
+    /// an erase that fails stops garbage collection: put() reports the error instead of busy, clear() resumes
+    void test_recover() {
+        CHECK(store::format() == MSPI::Status::ok);
+        bool injected = false;
+        for (int i = 0; i < 300 && !injected; ++i) {
+            CHECK(store::put(4, value(static_cast<uint8_t>(i))) == MSPI::Status::ok);
+            for (unsigned spins = 0; store::poll() && spins < 100000; ++spins) {
+                sim::clock::advance(1000);
+                if (pipeline::busy() && !injected) {
+                    MSPI_T::INTSET.write(MSPI::irq::cqerr);
+                    injected = true;
+                }
+                if (MSPI_T::INTSTAT.read() & MSPI_T::INTEN.read()) { store::isr(); }
+            }
+        }
+        CHECK(injected);
+        CHECK(store::status() == MSPI::Status::dma_error);
+        CHECK(fill(4, 300) == MSPI::Status::dma_error);
+        CHECK(fill(4, 1) == MSPI::Status::dma_error);
+
+        CHECK(store::clear() == MSPI::Status::dma_error);
+        drive();
+        CHECK(store::status() == MSPI::Status::ok);
+        CHECK(fill(4, 200) == MSPI::Status::ok);
+        std::array<uint8_t, 64> back{};
+        std::size_t length = 0;
+        CHECK(store::get(4, back, length) == MSPI::Status::ok);
+        CHECK(back == value(static_cast<uint8_t>(199)));
+    }
+
+}   // namespace
+
+int main() {
+    sim::nor_flash flash(1u << 20);
+    sim::mspi_model model(flash);
+    test_mount();
+    test_collect();
+    test_recover();
+    return test::result();
+}
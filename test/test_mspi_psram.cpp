@@ -0,0 +1,104 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <vector>
+
+namespace {
+
+    using MSPI_T = decltype(device::MSPI);
+    using psram = MSPI::psram<MSPI_T>;
+
+    /// the DMA chunk is what fits in tCEM after instruction, address and wait clocks
+    void test_profile() {
+        const MSPI::memory_profile profile = MSPI::psram_profile(MSPI::psram_parts::aps6404l);
+        CHECK_EQ(profile.page, MSPI::profiles::psram.page);
+        CHECK_EQ(profile.max_chunk, MSPI::profiles::psram.max_chunk);
+        CHECK(!profile.write_enable);
+    }
+
+    /// bump allocation with alignment, exhaustion and release to a mark
+    void test_arena() {
+        MSPI::arena arena(0x100, 0x1000);
+        const MSPI::psram_block a = arena.allocate(10);
+        CHECK_EQ(a.address, 0x100u);
+        CHECK_EQ(a.window(), MSPI::xip_base + 0x100u);
+        const uint32_t mark = arena.mark();
+        const MSPI::psram_block b = arena.allocate(64, 256);
+        CHECK_EQ(b.address, 0x200u);
+        CHECK(!arena.allocate(0x1000));
+        arena.release(mark);
+        CHECK_EQ(arena.used(), 10u);
+        CHECK(arena.allocate(0x1000 - 0x20));
+        CHECK_EQ(arena.available(), 0u);
+        arena.reset();
+        CHECK_EQ(arena.used(), 0u);
+    }
+
+    /// pools hand out every block once and refuse foreign or double frees; the slab falls back to larger classes
+    void test_pools() {
+        MSPI::arena arena(0, 1u << 16);
+        MSPI::pool<256, 40> pool;
+        CHECK(pool.attach(arena));
+        std::vector<MSPI::psram_block> blocks;
+        while (const MSPI::psram_block block = pool.allocate()) { blocks.push_back(block); }
+        CHECK_EQ(blocks.size(), 40u);
+        CHECK_EQ(blocks[39].address, 39u * 256);
+        CHECK(pool.free(blocks[33]));
+        CHECK(!pool.free(blocks[33]));
+        CHECK(!pool.free(MSPI::psram_block{0x10, 256}));
+        CHECK_EQ(pool.allocate().address, blocks[33].address);
+
+        MSPI::slab_heap<2, 64, 512> heap;
+        CHECK(heap.attach(arena));
+        const MSPI::psram_block small1 = heap.allocate(60);
+        const MSPI::psram_block small2 = heap.allocate(60);
+        const MSPI::psram_block spill = heap.allocate(60);
+        CHECK_EQ(small1.size, 64u);
+        CHECK_EQ(small2.size, 64u);
+        CHECK_EQ(spill.size, 512u);
+        CHECK_EQ(heap.available(60), 0u);
+        CHECK_EQ(heap.available(100), 1u);
+        CHECK(!heap.allocate(1000));
+        CHECK(heap.free(small1));
+        CHECK(!heap.free(small1));
+        CHECK_EQ(heap.available(60), 1u);
+    }
+
+    /// init() resets the part into QPI; store(), load() and copy() move data in tCEM sized chunks
+    void test_transfers(sim::mspi_model& model, sim::psram& part) {
+        CHECK(psram::init(MSPI::psram_parts::aps6404l) == MSPI::Status::ok);
+        CHECK_EQ(part.resets(), 1u);
+        CHECK(part.quad());
+
+        MSPI::arena arena(0, 8u << 20);
+        const MSPI::psram_block from = arena.allocate(2048);
+        const MSPI::psram_block to = arena.allocate(2048);
+        std::vector<uint8_t> data(1000);
+        for (std::size_t i = 0; i < data.size(); ++i) { data[i] = static_cast<uint8_t>(i * 5 + 1); }
+
+        model.clear_transfers();
+        CHECK(psram::store(from, 24, data) == MSPI::Status::ok);
+        CHECK(psram::wait() == MSPI::Status::ok);
+        CHECK_EQ(model.transfers().size(), 6u);             // 184 byte chunks
+        for (const auto& t : model.transfers()) { CHECK(t.count <= MSPI::profiles::psram.max_chunk); }
+        CHECK(psram::store(from, 1500, data) == MSPI::Status::invalid);
+
+        std::vector<uint8_t> bounce(300);
+        CHECK(psram::copy(to, 0, from, 24, data.size(), bounce) == MSPI::Status::ok);
+        std::vector<uint8_t> back(data.size());
+        CHECK(psram::load(to, 0, back) == MSPI::Status::ok);
+        CHECK(psram::wait() == MSPI::Status::ok);
+        CHECK(back == data);
+        CHECK(psram::copy(to, 0, from, 0, 10, std::span<uint8_t>()) == MSPI::Status::invalid);
+    }
+
+}   // namespace
+
+int main() {
+    sim::psram part(8u << 20);
+    sim::mspi_model model(part);
+    test_profile();
+    test_arena();
+    test_pools();
+    test_transfers(model, part);
+    return test::result();
+}
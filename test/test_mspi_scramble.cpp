@@ -0,0 +1,109 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    using MSPI_T = decltype(device::MSPI);
+    using dma = MSPI::dma_engine<MSPI_T>;
+    using store = MSPI::secure_store<MSPI_T, 64>;
+
+    constexpr MSPI::scramble_region region{1, 2};
+
+    std::vector<uint8_t> pattern(const std::size_t size, const uint8_t seed) {
+        std::vector<uint8_t> data(size);
+        for (std::size_t i = 0; i < size; ++i) { data[i] = static_cast<uint8_t>(i * 13 + seed); }
+        return data;
+    }
+
+    /// the region maps to the generated SCRAMBLING fields
+    void test_region() {
+        CHECK_EQ(region.scrambling(), 1u << 31 | 2u << 16 | 1u);
+        CHECK_EQ(MSPI::scramble_region::covering(0x1FFFE, 4).last, 2);
+        CHECK(!MSPI::scramble_region{2, 1}.valid());
+        CHECK(!MSPI::scramble_region{0, 0x400}.valid());
+        CHECK(region.contains(0x10000, 0x20000));
+        CHECK(!region.contains(0x2FFFC, 8));
+    }
+
+    /// data is scrambled on the device and reads back through DMA and XIP; unaligned ends go through word reads
+    void test_round_trip(sim::mspi_model& model, sim::psram& part) {
+        CHECK(MSPI::controller<MSPI_T>::configure(MSPI::device_config{}));
+        CHECK(dma::configure(MSPI::profiles::psram));
+        CHECK(store::init(region));
+        CHECK_EQ(MSPI_T::SCRAMBLING.read(), region.scrambling());
+
+        model.clear_transfers();
+        const std::vector<uint8_t> data = pattern(301, 7);
+        CHECK(store::write(0x10001, data) == MSPI::Status::invalid);
+        CHECK(store::write(0x10100, data) == MSPI::Status::ok);
+        CHECK(store::wait() == MSPI::Status::ok);
+        CHECK(std::memcmp(part.memory().data() + 0x10100, data.data(), data.size()) != 0);
+        CHECK_EQ(MSPI_T::INTSTAT.read() & MSPI::irq::screrr, 0u);
+
+        std::vector<uint8_t> back(data.size() - 3);
+        CHECK(store::read(0x10103, back) == MSPI::Status::ok);
+        CHECK(store::wait() == MSPI::Status::ok);
+        CHECK(std::memcmp(back.data(), data.data() + 3, back.size()) == 0);
+        uint8_t tail[4] = {};
+        CHECK(store::read(0x10100 + 300, tail) == MSPI::Status::ok);
+        CHECK(store::wait() == MSPI::Status::ok);
+        CHECK_EQ(tail[0], data[300]);
+        CHECK_EQ(tail[1], 0xFF);                                    // padding of the last word
+
+        for (const auto& t : model.transfers()) { CHECK_EQ((t.device_address | t.count) & 3u, 0u); }
+
+        const uint32_t flash = MSPI_T::FLASH.read();
+        MSPI_T::FLASH.write(flash | MSPI_T::FLASH_t::XIPEN.mask);
+        CHECK_EQ(sfr::load<uint32_t>(MSPI::xip_base + 0x10100), uint32_t{data[0]} | data[1] << 8 | data[2] << 16 | uint32_t{data[3]} << 24);
+        MSPI_T::FLASH.write(flash);
+    }
+
+    /// the DMA into the region must be whole words, a raw unaligned one fails with SCRERR
+    void test_unaligned() {
+        uint8_t bytes[6] = {};
+        CHECK(dma::read(0x10002, bytes) == MSPI::Status::ok);
+        CHECK(dma::wait() == MSPI::Status::scramble_error);
+        MSPI_T::INTCLR.write(MSPI::irq::screrr);
+    }
+
+    /// put() batches records into full stages; flush() writes the rest
+    void test_stream(sim::mspi_model& model) {
+        CHECK(store::stream(0x20000) == MSPI::Status::ok);
+        model.clear_transfers();
+        const std::vector<uint8_t> record = pattern(10, 40);
+        std::vector<uint8_t> sent;
+        for (int i = 0; i < 15; ++i) {
+            CHECK_EQ(store::put(record), record.size());
+            sent.insert(sent.end(), record.begin(), record.end());
+            if (MSPI_T::INTSTAT.read() & MSPI_T::INTEN.read()) { dma::isr(); }
+            store::poll();
+        }
+        CHECK(store::wait() == MSPI::Status::ok);
+        CHECK(store::flush() == MSPI::Status::ok);
+        CHECK(store::wait() == MSPI::Status::ok);
+        CHECK_EQ(model.transfers().size(), 3u);                     // two full stages and the flushed rest
+        CHECK_EQ(store::position(), 0x20000u + 152);
+
+        std::vector<uint8_t> back(sent.size());
+        CHECK(store::read(0x20000, back) == MSPI::Status::ok);
+        CHECK(store::wait() == MSPI::Status::ok);
+        CHECK(back == sent);
+
+        store::disable();
+        CHECK_EQ(MSPI_T::SCRAMBLING.read(), 0u);
+        CHECK(store::read(0x20000, back) == MSPI::Status::invalid);
+    }
+
+}   // namespace
+
+int main() {
+    sim::psram part(1u << 20);
+    sim::mspi_model model(part);
+    test_region();
+    test_round_trip(model, part);
+    test_unaligned();
+    test_stream(model);
+    return test::result();
+}
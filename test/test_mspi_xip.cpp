@@ -0,0 +1,92 @@
+#include "check.hpp"
+#include "device.hpp"
+
+namespace {
+
+    using MSPI_T = decltype(device::MSPI);
+    using CACHECTRL_T = decltype(device::CACHECTRL);
+    using xip = MSPI::xip<MSPI_T, CACHECTRL_T>;
+    using controller = MSPI::controller<MSPI_T>;
+
+    /// CFG, PADOUTEN and FLASH images of the presets
+    void test_images() {
+        constexpr MSPI::flash_part quad = MSPI::flash_parts::mx25r6435f;
+        static_assert(quad.bus.cfg() == 0x621u);                    // TURNAROUND 6, three address bytes, SERIAL0
+        static_assert(quad.bus.padouten() == 0x10Fu);               // clock and four data lines
+        static_assert(quad.bus.flash(true) == 0xEB3807E1u);
+        static_assert(quad.bus.flash(false) == 0xEB3807E0u);
+        static_assert(quad.bus.mspicfg() == 0x272u);
+
+        constexpr MSPI::flash_part serial = MSPI::flash_parts::serial_nor(32u << 20);
+        static_assert(serial.bus.cfg() == 0x831u);                  // four address bytes above 16 MB
+        static_assert(serial.bus.padouten() == 0x103u);
+        static_assert(serial.bus.flash(true) == 0x0B0200E1u);
+
+        MSPI::device_config octal{};
+        octal.frame = MSPI::Frame::OCTAL0;
+        CHECK_EQ(octal.padouten(), 0x1FFu);
+        MSPI::device_config second{};
+        second.frame = MSPI::Frame::SERIAL1;
+        CHECK_EQ(second.padouten(), 0x130u);                        // the data lines of chip select 1
+    }
+
+    /// init() enables quad mode through WRSR, waits for the write and maps the flash
+    void test_init(sim::nor_flash& flash) {
+        for (uint32_t i = 0; i < 64; ++i) { flash.memory()[i] = static_cast<uint8_t>(i); }
+        CHECK(xip::init(MSPI::flash_part{}) == MSPI::Status::invalid);
+        CHECK(xip::init(MSPI::flash_parts::mx25r6435f) == MSPI::Status::ok);
+        CHECK_EQ(flash.status(), 0x40);
+        CHECK_EQ(flash.instructions()[0], 0x06);
+        CHECK_EQ(flash.instructions()[1], 0x01);
+        CHECK(flash.instructions().size() > 3);                     // polled RDSR while the write was in progress
+        CHECK(xip::enabled());
+        CHECK_EQ(MSPI_T::CFG.read(), 0x621u);
+        CHECK_EQ(MSPI_T::MSPICFG.read(), 0xC0000272u);
+        CHECK_EQ(CACHECTRL_T::CACHECFG.read() & 0x301u, 0x301u);
+        CHECK_EQ(sfr::load<uint32_t>(xip::address(4)), 0x07060504u);
+    }
+
+    /// programmed IO with XIP off: JEDEC ID, read at an address, page program and wait_ready()
+    void test_programmed_io(sim::nor_flash& flash) {
+        xip::disable();
+        CHECK(!xip::enabled());
+        uint8_t id[3] = {};
+        CHECK(controller::read(0x9F, id) == MSPI::Status::ok);
+        CHECK_EQ(id[0], 0xC2);
+        CHECK_EQ(id[2], 0x17);
+
+        uint8_t data[10] = {};
+        CHECK(controller::command(0x03, nullptr, data, sizeof(data), true, 5) == MSPI::Status::ok);
+        CHECK_EQ(data[0], 5);
+        CHECK_EQ(data[9], 14);
+
+        const uint8_t page[7] = {};
+        CHECK(controller::command(0x06) == MSPI::Status::ok);
+        CHECK(controller::command(0x02, page, nullptr, sizeof(page), true, 0x100) == MSPI::Status::ok);
+        CHECK(flash.busy());
+        CHECK(xip::wait_ready() == MSPI::Status::ok);
+        CHECK(!flash.busy());
+        CHECK_EQ(flash.memory()[0x106], 0);
+        CHECK(controller::command(0x03, nullptr, nullptr, 4) == MSPI::Status::invalid);
+    }
+
+    /// core addresses of the window and the mapped range
+    void test_addresses() {
+        CHECK_EQ(xip::address(0x1234), 0x04001234u);
+        CHECK_EQ(xip::offset(reinterpret_cast<const void*>(uintptr_t{0x04000100})), 0x100u);
+        CHECK(xip::contains(reinterpret_cast<const void*>(uintptr_t{0x047FFFFF})));
+        CHECK(!xip::contains(reinterpret_cast<const void*>(uintptr_t{0x047FFFFF}), 2));    // past the 8 MB part
+        CHECK(!xip::contains(reinterpret_cast<const void*>(uintptr_t{0x10000000})));
+    }
+
+}   // namespace
+
+int main() {
+    sim::nor_flash flash(8u << 20);
+    sim::mspi_model model(flash);
+    test_images();
+    test_init(flash);
+    test_programmed_io(flash);
+    test_addresses();
+    return test::result();
+}
@@ -0,0 +1,52 @@
+#include "check.hpp"
+#include "board.hpp"
+
+namespace {
+
+    /// gpio_model that counts whole-register writes of WTA/WTB
+    class counting_gpio : public sim::gpio_model {
+    public:
+        uint32_t wt_writes = 0;
+
+        void write(const sim::addressType offset, const uint32_t value, uint32_t& stored) override {
+            if (offset == 0x88 || offset == 0x8C) { ++wt_writes; }
+            gpio_model::write(offset, value, stored);
+        }
+    };
+
+    using Level = sim::gpio_model::Level;
+
+    /// toggle() flips its own pad through WTS/WTC and leaves the other pads of the bank alone
+    void test_toggle_uses_set_clear() {
+        counting_gpio gpio;
+        sim::bus::attach(&gpio);
+
+        constexpr GPIO::Led led{device::P19};
+        constexpr GPIO::Led other{device::P18};
+        constexpr GPIO::Led high_bank{device::P40};
+        board_init(led, other, high_bank);
+        led.on();
+        other.off();
+        high_bank.on();
+        const uint32_t before = gpio.wt_writes;
+
+        led.toggle();
+        CHECK(gpio.level(19) == Level::low);
+        other.toggle();
+        CHECK(gpio.level(18) == Level::high);
+        led.toggle();
+        CHECK(gpio.level(19) == Level::high);
+        high_bank.toggle();
+        CHECK(gpio.level(40) == Level::low);
+        CHECK(gpio.level(18) == Level::high);
+        CHECK_EQ(gpio.wt_writes, before);
+
+        sim::bus::detach(&gpio);
+    }
+
+}   // namespace
+
+int main() {
+    test_toggle_uses_set_clear();
+    return test::result();
+}
@@ -0,0 +1,105 @@
+#include "check.hpp"
+#include "device.hpp"
+#include <array>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using sim::memory;
+
+    /// mapping a buffer again, or a range inside it, reuses its window
+    void test_reuse() {
+        memory::reset();
+        static std::array<uint8_t, 64> buffer{};
+        const auto address = memory::map(buffer.data(), buffer.size());
+        CHECK_EQ(address, memory::sram_start);
+        for (int i = 0; i < 1000; ++i) { CHECK_EQ(memory::map(buffer.data(), buffer.size()), address); }
+        CHECK_EQ(memory::map(buffer.data() + 16, 8), address + 16);
+        CHECK_EQ(memory::mapped(), buffer.size());
+        CHECK(memory::host(address + 5) == buffer.data() + 5);
+    }
+
+    /// a buffer handed out chunk by chunk stays one window with contiguous addresses
+    void test_chunks() {
+        memory::reset();
+        static std::array<uint8_t, 4096> buffer{};
+        const auto address = memory::map(buffer.data(), 256);
+        for (std::size_t offset = 256; offset < buffer.size(); offset += 256) {
+            CHECK_EQ(memory::map(buffer.data() + offset, 256), address + offset);
+        }
+        CHECK_EQ(memory::mapped(), buffer.size());
+    }
+
+    /// unmap() frees the range for the next buffer, and the lookup of the old one fails
+    void test_unmap() {
+        memory::reset();
+        // separate heap blocks, so no buffer continues another and grows its window
+        std::vector<uint8_t> first(100);
+        std::vector<uint8_t> second(32);
+        std::vector<uint8_t> third(48);
+        const auto a = memory::map(first.data(), first.size());
+        const auto b = memory::map(second.data(), second.size());
+        CHECK_EQ(b, a + 112);
+        memory::unmap(first.data());
+        CHECK(memory::host(a) == nullptr);
+        CHECK_EQ(memory::map(third.data(), third.size()), a);
+        CHECK(memory::host(b) == second.data());
+        memory::reset();
+    }
+
+    constexpr sim::addressType gpio = 0x40010000;
+    using Level = sim::gpio_model::Level;
+
+    /// pad configuration is dropped while PADKEY is locked; push-pull levels and transitions are recorded
+    void test_gpio_levels() {
+        sim::clock::reset();
+        sim::gpio_model model;
+        sim::bus::write(gpio + 0x04, uint32_t{3} << 3, 1);             // PADREG of P4, FNCSEL GPIO
+        sim::bus::write(gpio + 0x40, uint32_t{1} << 17, 4);            // CFGA, P4 push-pull
+        CHECK_EQ(model.locked_writes(), 2u);
+        CHECK(model.level(4) == Level::floating);
+
+        sim::bus::write(gpio + 0x60, 0x73, 4);
+        sim::bus::write(gpio + 0x40, uint32_t{1} << 17, 4);
+        sim::bus::write(gpio + 0x90, 1u << 4, 4);                      // WTSA
+        CHECK(model.level(4) == Level::high);
+        sim::bus::write(gpio + 0x98, 1u << 4, 4);                      // WTCA
+        sim::bus::write(gpio + 0x90, 1u << 4, 4);
+        CHECK_EQ(model.transitions(4), 3u);   // low once configured, then high, low, high
+        CHECK(model.is_output(4));
+
+        std::ostringstream vcd;
+        model.write_vcd(vcd);
+        const std::string text = vcd.str();
+        CHECK(text.find("$var wire 1 % P4 $end") != std::string::npos);
+        CHECK(text.find("\n1%\n") != std::string::npos);
+        CHECK(text.find("\n0%\n") != std::string::npos);
+    }
+
+    /// an open drain pad only pulls low; released it shows what the test bench drives
+    void test_gpio_open_drain() {
+        sim::gpio_model model;
+        sim::bus::write(gpio + 0x60, 0x73, 4);
+        sim::bus::write(gpio + 0x40, uint32_t{2} << 17, 4);            // CFGA, P4 open drain
+        sim::bus::write(gpio + 0x90, 1u << 4, 4);
+        CHECK(model.level(4) == Level::floating);
+        model.drive(4, true);
+        CHECK(model.level(4) == Level::high);
+        sim::bus::write(gpio + 0x98, 1u << 4, 4);
+        CHECK(model.level(4) == Level::low);
+        model.release(4);
+        CHECK(model.level(4) == Level::low);
+    }
+
+}   // namespace
+
+int main() {
+    test_reuse();
+    test_chunks();
+    test_unmap();
+    test_gpio_levels();
+    test_gpio_open_drain();
+    return test::result();
+}
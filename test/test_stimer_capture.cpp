@@ -0,0 +1,80 @@
+#include "check.hpp"
+#include "device.hpp"
+
+namespace {
+
+    using CT = decltype(device::CTIMER);
+    using capture = STIMER::edge_capture<CT, decltype(device::GPIO), 8>;
+
+    /// latch `channels` and run the interrupt; the plain simulated STMINTSTAT does not clear itself
+    void interrupt(const uint32_t channels) {
+        CT::STMINTSTAT.write(channels << 9);
+        capture::isr();
+        CT::STMINTSTAT.write(0);
+    }
+
+    void drain() {
+        STIMER::capture_t event;
+        while (capture::pop(event)) { }
+    }
+
+    /// captures latched together come out oldest first, not in channel order
+    void test_timestamp_order() {
+        drain();
+        CT::SCAPT0.write(500);
+        CT::SCAPT1.write(300);
+        CT::SCAPT2.write(400);
+        CT::SCAPT3.write(100);
+        interrupt(0xF);
+
+        const uint8_t channels[] = {3, 1, 2, 0};
+        STIMER::capture_t event{};
+        for (const uint8_t channel : channels) {
+            CHECK(capture::pop(event));
+            CHECK_EQ(event.channel, channel);
+        }
+        CHECK(!capture::pop(event));
+    }
+
+    /// ordering is modulo 2^32, so an edge just before a wrap still comes first
+    void test_order_across_wrap() {
+        drain();
+        CT::SCAPT0.write(0x00000010);
+        CT::SCAPT2.write(0xFFFFFFF0);
+        interrupt(0x5);
+
+        STIMER::capture_t event{};
+        CHECK(capture::pop(event));
+        CHECK_EQ(event.channel, 2);
+        CHECK(capture::pop(event));
+        CHECK_EQ(event.channel, 0);
+    }
+
+    /// lead on channel 3, trail on channel 0 of the same pulse gives a positive width
+    void test_pulse_with_lead_on_higher_channel() {
+        drain();
+        STIMER::pulse_meter meter(3, 0);
+        const uint32_t leads[] = {1000, 4000};
+        for (const uint32_t lead : leads) {
+            CT::SCAPT3.write(lead);
+            CT::SCAPT0.write(lead + 750);
+            interrupt((1u << 3) | 1u);  // both edges seen in one interrupt
+            STIMER::capture_t event;
+            while (capture::pop(event)) { meter.feed(event); }
+        }
+        CHECK(meter.has_width());
+        CHECK(meter.has_period());
+        CHECK_EQ(meter.width_ticks(), 750u);
+        CHECK_EQ(meter.period_ticks(), 3000u);
+        CHECK_EQ(meter.duty_q16(), (750u << 16) / 3000u);
+        CHECK_EQ(meter.frequency_mhz(3000000), 1000000u);
+    }
+
+}   // namespace
+
+int main() {
+    test_timestamp_order();
+    test_order_across_wrap();
+    test_pulse_with_lead_on_higher_channel();
+    return test::result();
+}